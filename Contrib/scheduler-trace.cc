@@ -0,0 +1,247 @@
+// Analyses a trace recorded with the openMSX 'scheduler_trace' command.
+//
+// For each Schedulable it prints how often it set/removed sync points and how
+// often its executeUntil() method was called (per second of emulated time).
+// Every executed sync point makes the CPU emulation loop exit, so the devices
+// at the top of the list are the ones that most often interrupt the CPU. For
+// the executeUntil() calls a histogram of the host time they took is shown.
+//
+// Optionally the trace can be converted to the text format that is used by
+// the SchedulerQueueBench program (src/SchedulerQueueBench.cc).
+//
+// compile with:
+//   g++ -Wall -O2 -std=c++11 scheduler-trace.cc -o scheduler-trace
+// usage:
+//   scheduler-trace <trace-file> [<queue-bench-output>]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+using namespace std;
+
+// must match the layout in src/SchedulerTrace.hh
+struct Record
+{
+	uint64_t time;
+	uint32_t cost;
+	uint16_t device;
+	uint8_t type;
+	uint8_t pad;
+};
+static_assert(sizeof(Record) == 16, "must be packed");
+
+struct Trace
+{
+	vector<string> names;
+	vector<Record> records;
+	uint64_t dropped;
+	uint64_t freq;
+};
+
+static const unsigned NUM_BUCKETS = 16; // <1us, <2us, <4us, ... , >=16ms
+
+struct DeviceStats
+{
+	DeviceStats() : set(0), remove(0), removeAll(0), execute(0),
+	                totalCost(0), maxCost(0), histogram() {}
+
+	uint64_t set, remove, removeAll, execute;
+	uint64_t totalCost, maxCost;
+	uint64_t histogram[NUM_BUCKETS];
+};
+
+
+template<typename T> static T readValue(ifstream& in)
+{
+	T t;
+	if (!in.read(reinterpret_cast<char*>(&t), sizeof(t))) {
+		throw runtime_error("Unexpected end of file");
+	}
+	return t;
+}
+
+static Trace load(const string& filename)
+{
+	ifstream in(filename, ios::binary);
+	if (!in) throw runtime_error("Couldn't open " + filename);
+
+	char magic[8];
+	if (!in.read(magic, 8) || memcmp(magic, "OMSXSCHT", 8)) {
+		throw runtime_error("Not a scheduler trace file");
+	}
+	if (readValue<uint32_t>(in) != 1) {
+		throw runtime_error("Unsupported trace version");
+	}
+	Trace trace;
+	auto numDevices = readValue<uint32_t>(in);
+	auto numRecords = readValue<uint64_t>(in);
+	trace.dropped   = readValue<uint64_t>(in);
+	trace.freq      = readValue<uint64_t>(in);
+	for (uint32_t i = 0; i < numDevices; ++i) {
+		string name(readValue<uint32_t>(in), '\0');
+		if (!in.read(&name[0], name.size())) {
+			throw runtime_error("Unexpected end of file");
+		}
+		trace.names.push_back(name);
+	}
+	trace.records.resize(numRecords);
+	if (!in.read(reinterpret_cast<char*>(trace.records.data()),
+	             numRecords * sizeof(Record))) {
+		throw runtime_error("Unexpected end of file");
+	}
+	for (auto& r : trace.records) {
+		if (r.device >= numDevices) {
+			throw runtime_error("Invalid device number in trace");
+		}
+	}
+	return trace;
+}
+
+// Names are stored as typeid().name(), possibly followed by "#<n>".
+static string demangle(const string& name)
+{
+	string type = name;
+	string suffix;
+	auto pos = name.find('#');
+	if (pos != string::npos) {
+		type = name.substr(0, pos);
+		suffix = name.substr(pos);
+	}
+#ifdef __GNUC__
+	int status;
+	char* d = abi::__cxa_demangle(type.c_str(), nullptr, nullptr, &status);
+	if (d) {
+		type = d;
+		free(d);
+	}
+#endif
+	if (type.compare(0, 9, "openmsx::") == 0) type = type.substr(9);
+	return type + suffix;
+}
+
+static unsigned bucket(uint32_t ns)
+{
+	unsigned b = 0;
+	for (uint32_t limit = 1000; (ns >= limit) && (b < NUM_BUCKETS - 1); limit *= 2) {
+		++b;
+	}
+	return b;
+}
+
+static void printStats(const Trace& trace)
+{
+	auto& records = trace.records;
+	vector<DeviceStats> stats(trace.names.size());
+	for (auto& r : records) {
+		auto& s = stats[r.device];
+		switch (r.type) {
+		case 's': ++s.set;       break;
+		case 'r': ++s.remove;    break;
+		case 'a': ++s.removeAll; break;
+		case 'x':
+			++s.execute;
+			s.totalCost += r.cost;
+			s.maxCost = max<uint64_t>(s.maxCost, r.cost);
+			++s.histogram[bucket(r.cost)];
+			break;
+		}
+	}
+
+	double seconds = 0.0;
+	if (records.size() > 1) {
+		seconds = double(records.back().time - records.front().time) /
+		          double(trace.freq);
+	}
+	printf("%zu events, %.3f seconds of emulated time", records.size(), seconds);
+	if (trace.dropped) {
+		printf(" (%llu older events were overwritten)",
+		       (unsigned long long)trace.dropped);
+	}
+	printf("\n\n");
+	if (seconds == 0.0) seconds = 1.0; // avoid division by zero
+
+	vector<unsigned> order(stats.size());
+	for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+	sort(order.begin(), order.end(), [&](unsigned x, unsigned y) {
+		return stats[x].execute > stats[y].execute; });
+
+	printf("%-40s %10s %10s %10s %10s %10s %10s\n", "device",
+	       "set/s", "remove/s", "rm_all/s", "execute/s", "avg_ns", "max_ns");
+	for (auto i : order) {
+		auto& s = stats[i];
+		printf("%-40s %10.1f %10.1f %10.1f %10.1f %10.0f %10llu\n",
+		       demangle(trace.names[i]).c_str(),
+		       s.set / seconds, s.remove / seconds,
+		       s.removeAll / seconds, s.execute / seconds,
+		       s.execute ? double(s.totalCost) / s.execute : 0.0,
+		       (unsigned long long)s.maxCost);
+	}
+
+	printf("\nexecuteUntil() cost histogram (number of calls):\n");
+	printf("%-40s", "device");
+	for (unsigned b = 0; b < NUM_BUCKETS; ++b) {
+		if (b == NUM_BUCKETS - 1) {
+			printf(" %7s", ">=16ms");
+		} else if (b < 10) {
+			printf("  <%3uus", 1u << b);
+		} else {
+			printf("  <%3ums", 1u << (b - 10));
+		}
+	}
+	printf("\n");
+	for (auto i : order) {
+		auto& s = stats[i];
+		if (!s.execute) continue;
+		printf("%-40s", demangle(trace.names[i]).c_str());
+		for (unsigned b = 0; b < NUM_BUCKETS; ++b) {
+			printf(" %7llu", (unsigned long long)s.histogram[b]);
+		}
+		printf("\n");
+	}
+}
+
+// Note: when older events were overwritten, the sync points that were
+// pending at the start of the trace are unknown. Removing or executing
+// those is simply ignored by SchedulerQueueBench.
+static void exportQueueTrace(const Trace& trace, const string& filename)
+{
+	ofstream out(filename);
+	if (!out) throw runtime_error("Couldn't open " + filename);
+	for (auto& r : trace.records) {
+		switch (r.type) {
+		case 's': out << "s " << r.device << ' ' << r.time << '\n'; break;
+		case 'r': out << "r " << r.device << '\n'; break;
+		case 'a': out << "a " << r.device << '\n'; break;
+		case 'x': out << "x\n"; break;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if ((argc < 2) || (argc > 3)) {
+		cerr << "Usage: " << argv[0]
+		     << " <trace-file> [<queue-bench-output>]\n";
+		return 1;
+	}
+	try {
+		Trace trace = load(argv[1]);
+		printStats(trace);
+		if (argc == 3) exportQueueTrace(trace, argv[2]);
+	} catch (exception& e) {
+		cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
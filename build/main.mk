@@ -63,7 +63,7 @@ endif
 # TODO: "dist" and "createsubs" are missing
 # TODO: more missing?
 # Logical targets which require dependency files.
-DEPEND_TARGETS:=all default install run bindist
+DEPEND_TARGETS:=all default install run bindist benchmarks
 # Logical targets which do not require dependency files.
 NODEPEND_TARGETS:=clean config probe 3rdparty run-3rdparty staticbindist
 # Mark all logical targets as such.
@@ -98,6 +98,9 @@ BOOLCHECK=$(DEFCHECK)$(strip \
 #       platform specific flags.
 CXXFLAGS:=
 COMPILE_FLAGS:=-pthread
+# 64-bit off_t on 32-bit platforms as well (e.g. for raw video recordings
+# larger than 2GB, see RawFrameWriter).
+COMPILE_FLAGS+=-D_FILE_OFFSET_BITS=64
 # Note: LDFLAGS are passed to the linker itself, LINK_FLAGS are passed to the
 #       compiler in the link phase.
 LDFLAGS:=
@@ -261,6 +264,7 @@ SOURCE_DIRS:=$(sort $(shell find src -type d))
 
 SOURCES_FULL:=$(foreach dir,$(SOURCE_DIRS),$(sort $(wildcard $(dir)/*.cc)))
 SOURCES_FULL:=$(filter-out %Test.cc,$(SOURCES_FULL))
+SOURCES_FULL:=$(filter-out %Bench.cc,$(SOURCES_FULL))
 SOURCES_FULL:=$(filter-out src/sound/generate%.cc,$(SOURCES_FULL))
 
 # TODO: This doesn't work since MAX_SCALE_FACTOR is not a Make variable,
@@ -316,6 +320,18 @@ DEPEND_FULL:=$(addsuffix .d,$(addprefix $(DEPEND_PATH)/,$(SOURCES)))
 OBJECTS_PATH:=$(BUILD_PATH)/obj
 OBJECTS_FULL:=$(addsuffix .o,$(addprefix $(OBJECTS_PATH)/,$(SOURCES)))
 
+# Benchmarks: stand-alone programs that are linked with all objects above,
+# except the one containing main().
+BENCH_SOURCES_FULL:=$(foreach dir,$(SOURCE_DIRS),$(sort $(wildcard $(dir)/*Bench.cc)))
+BENCH_SOURCES_FULL:=$(filter $(SOURCES_PATH)/$(OPENMSX_SUBSET)%,$(BENCH_SOURCES_FULL))
+BENCH_SOURCES:=$(BENCH_SOURCES_FULL:$(SOURCES_PATH)/%.cc=%)
+BENCH_DEPEND_FULL:=$(addsuffix .d,$(addprefix $(DEPEND_PATH)/,$(BENCH_SOURCES)))
+BENCH_OBJECTS_FULL:=$(addsuffix .o,$(addprefix $(OBJECTS_PATH)/,$(BENCH_SOURCES)))
+BENCH_PATH:=$(BUILD_PATH)/bench
+BENCH_FULL:=$(addsuffix $(EXEEXT),$(addprefix $(BENCH_PATH)/,$(BENCH_SOURCES)))
+BENCH_LINK_OBJECTS:=$(filter-out \
+	$(OBJECTS_PATH)/main.o $(OBJECTS_PATH)/unittest/%,$(OBJECTS_FULL))
+
 ifneq ($(filter mingw%,$(OPENMSX_TARGET_OS)),)
 RESOURCE_SRC:=src/resource/openmsx.rc
 RESOURCE_OBJ:=$(OBJECTS_PATH)/resources.o
@@ -502,7 +518,7 @@ endif
 
 # Include dependency files.
 ifneq ($(filter $(DEPEND_TARGETS),$(MAKECMDGOALS)),)
-  -include $(DEPEND_FULL)
+  -include $(DEPEND_FULL) $(BENCH_DEPEND_FULL)
 endif
 
 # Clean up build tree of current flavour.
@@ -531,8 +547,8 @@ endif
 
 # Compile and generate dependency files in one go.
 DEPEND_SUBST=$(patsubst $(SOURCES_PATH)/%.cc,$(DEPEND_PATH)/%.d,$<)
-$(OBJECTS_FULL): $(INIT_DUMMY_FILE)
-$(OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
+$(OBJECTS_FULL) $(BENCH_OBJECTS_FULL): $(INIT_DUMMY_FILE)
+$(OBJECTS_FULL) $(BENCH_OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
 	$(SUM) "Compiling $(patsubst $(SOURCES_PATH)/%,%,$<)..."
 	$(CMD)mkdir -p $(@D)
 	$(CMD)mkdir -p $(patsubst $(OBJECTS_PATH)%,$(DEPEND_PATH)%,$(@D))
@@ -543,7 +559,7 @@ $(OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
 # Generate dependencies that do not exist yet.
 # This is only in case some .d files have been deleted;
 # in normal operation this rule is never triggered.
-$(DEPEND_FULL):
+$(DEPEND_FULL) $(BENCH_DEPEND_FULL):
 
 # Windows resources that are added to the executable.
 ifneq ($(filter mingw%,$(OPENMSX_TARGET_OS)),)
@@ -579,6 +595,17 @@ $(LIBRARY_FULL): $(OBJECTS_FULL) $(RESOURCE_OBJ)
 	$(CMD)mkdir -p $(@D)
 	$(CMD)$(CXX) -o $@ $(CXXFLAGS) $^ $(LINK_FLAGS)
 
+# Link benchmarks.
+benchmarks: $(BENCH_FULL)
+$(BENCH_FULL): $(BENCH_PATH)/%$(EXEEXT): $(OBJECTS_PATH)/%.o $(BENCH_LINK_OBJECTS)
+ifeq ($(OPENMSX_SUBSET),)
+	$(SUM) "Linking $(patsubst $(BENCH_PATH)/%,%,$@)..."
+	$(CMD)mkdir -p $(@D)
+	$(CMD)$(CXX) -o $@ $(CXXFLAGS) $^ $(LINK_FLAGS)
+else
+	$(SUM) "Not linking $(notdir $@) because only a subset was built."
+endif # subset
+
 # Run executable.
 run: all
 	$(SUM) "Running $(notdir $(BINARY_FULL))..."
@@ -29,6 +29,13 @@ class MMapFunction(SystemFunction):
 			yield '<sys/types.h>'
 		yield '<sys/mman.h>'
 
+class PosixFallocateFunction(SystemFunction):
+	name = 'posix_fallocate'
+
+	@classmethod
+	def iterHeaders(cls, targetPlatform):
+		yield '<fcntl.h>'
+
 class PosixMemAlignFunction(SystemFunction):
 	name = 'posix_memalign'
 
@@ -56,6 +56,7 @@ CommandLineParser::CommandLineParser(Reactor& reactor_)
 {
 	haveConfig = false;
 	haveSettings = false;
+	batch = false;
 
 	registerOption("-h",          helpOption,    PHASE_BEFORE_INIT, 1);
 	registerOption("--help",      helpOption,    PHASE_BEFORE_INIT, 1);
@@ -70,6 +71,7 @@ CommandLineParser::CommandLineParser(Reactor& reactor_)
 	registerOption("-nopbo",      noPBOOption,   PHASE_BEFORE_SETTINGS, 1);
 	#endif
 	registerOption("-testconfig", testConfigOption, PHASE_BEFORE_SETTINGS, 1);
+	registerOption("-batch",      batchOption,   PHASE_BEFORE_SETTINGS, 1);
 
 	registerOption("-machine",    machineOption, PHASE_LOAD_MACHINE);
 
@@ -276,7 +278,10 @@ void CommandLineParser::parse(int argc, char** argv)
 
 bool CommandLineParser::isHiddenStartup() const
 {
-	return (parseStatus == CONTROL) || (parseStatus == TEST);
+	// in batch mode the renderer stays 'none', so no frames are drawn,
+	// until a 'screenshot' or 'record' command needs them (see
+	// Display::enableBatchRenderer())
+	return (parseStatus == CONTROL) || (parseStatus == TEST) || batch;
 }
 
 CommandLineParser::ParseStatus CommandLineParser::getParseStatus() const
@@ -574,6 +579,24 @@ string_ref CommandLineParser::TestConfigOption::optionHelp() const
 	return "Test if the specified config works and exit";
 }
 
+// class BatchOption
+
+void CommandLineParser::BatchOption::parseOption(
+	const string& /*option*/, array_ref<string>& /*cmdLine*/)
+{
+	auto& parser = OUTER(CommandLineParser, batchOption);
+	if (!parser.batch) {
+		parser.batch = true;
+		parser.reactor.enableBatchMode();
+	}
+}
+
+string_ref CommandLineParser::BatchOption::optionHelp() const
+{
+	return "Run as fast as possible without video and sound output "
+	       "(for automated tests)";
+}
+
 // class BashOption
 
 void CommandLineParser::BashOption::parseOption(
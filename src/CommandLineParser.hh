@@ -126,6 +126,11 @@ private:
 		string_ref optionHelp() const override;
 	} testConfigOption;
 
+	struct BatchOption final : CLIOption {
+		void parseOption(const std::string& option, array_ref<std::string>& cmdLine) override;
+		string_ref optionHelp() const override;
+	} batchOption;
+
 	struct BashOption final : CLIOption {
 		void parseOption(const std::string& option, array_ref<std::string>& cmdLine) override;
 		string_ref optionHelp() const override;
@@ -145,6 +150,7 @@ private:
 	ParseStatus parseStatus;
 	bool haveConfig;
 	bool haveSettings;
+	bool batch;
 };
 
 } // namespace openmsx
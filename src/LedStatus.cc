@@ -40,6 +40,7 @@ void LedStatus::setLed(Led led, bool status)
 {
 	if (ledValue[led] == status) return;
 	ledValue[led] = status;
+	if (msxCliComm.isDeferring()) return; // see flushDeferred()
 
 	// Some MSX programs generate tons of LED events (e.g. New Era uses
 	// the LEDs as a VU meter while playing samples). Without throttling
@@ -69,6 +70,11 @@ void LedStatus::handleEvent(Led led)
 	msxCliComm.update(CliComm::LED, getLedName(led), str);
 }
 
+void LedStatus::flushDeferred()
+{
+	executeRT();
+}
+
 void LedStatus::executeRT()
 {
 	for (int i = 0; i < NUM_LEDS; ++i) {
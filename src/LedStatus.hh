@@ -33,6 +33,12 @@ public:
 
 	void setLed(Led led, bool status);
 
+	/** While CliComm messages are deferred (see MSXCliComm::setDeferring())
+	  * LED changes are only recorded. This publishes them, must be called
+	  * from the main thread.
+	  */
+	void flushDeferred();
+
 private:
 	void handleEvent(Led led);
 
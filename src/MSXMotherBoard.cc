@@ -10,6 +10,7 @@
 #include "MSXCommandController.hh"
 #include "Scheduler.hh"
 #include "Schedulable.hh"
+#include "SchedulerTrace.hh"
 #include "CartridgeSlotManager.hh"
 #include "EventDistributor.hh"
 #include "Debugger.hh"
@@ -35,7 +36,9 @@
 #include "Command.hh"
 #include "CommandException.hh"
 #include "InfoTopic.hh"
+#include "FileContext.hh"
 #include "FileException.hh"
+#include "FileOperations.hh"
 #include "TclObject.hh"
 #include "Observer.hh"
 #include "StringOp.hh"
@@ -108,6 +111,20 @@ private:
 	MSXMotherBoard& motherBoard;
 };
 
+class SchedulerTraceCmd final : public Command
+{
+public:
+	explicit SchedulerTraceCmd(MSXMotherBoard& motherBoard);
+	~SchedulerTraceCmd();
+	void execute(array_ref<TclObject> tokens, TclObject& result) override;
+	string help(const vector<string>& tokens) const override;
+	void tabCompletion(vector<string>& tokens) const override;
+private:
+	MSXMotherBoard& motherBoard;
+	std::unique_ptr<SchedulerTrace> trace;
+	bool recording;
+};
+
 class MachineNameInfo final : public InfoTopic
 {
 public:
@@ -194,6 +211,7 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	, powered(false)
 	, active(false)
 	, fastForwarding(false)
+	, background(false)
 {
 	slotManager = make_unique<CartridgeSlotManager>(*this);
 	reverseManager = make_unique<ReverseManager>(*this);
@@ -202,6 +220,7 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	listExtCommand = make_unique<ListExtCmd>(*this);
 	extCommand = make_unique<ExtCmd>(*this, "ext");
 	removeExtCommand = make_unique<RemoveExtCmd>(*this);
+	schedulerTraceCommand = make_unique<SchedulerTraceCmd>(*this);
 	machineNameInfo = make_unique<MachineNameInfo>(*this);
 	machineTypeInfo = make_unique<MachineTypeInfo>(*this);
 	deviceInfo = make_unique<DeviceInfo>(*this);
@@ -224,11 +243,19 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	realTime = make_unique<RealTime>(
 		*this, reactor.getGlobalSettings(), *eventDelay);
 
+	backgroundSetting = make_unique<BooleanSetting>(
+		*msxCommandController, "run_in_background",
+		"when this machine is not the active machine, keep emulating it "
+		"as fast as possible (without sound and video)",
+		false, Setting::DONT_SAVE);
+
 	powerSetting.attach(*settingObserver);
+	backgroundSetting->attach(*settingObserver);
 }
 
 MSXMotherBoard::~MSXMotherBoard()
 {
+	backgroundSetting->detach(*settingObserver);
 	powerSetting.detach(*settingObserver);
 	deleteMachine();
 
@@ -500,6 +527,43 @@ bool MSXMotherBoard::execute()
 	return true;
 }
 
+void MSXMotherBoard::executeInWorker()
+{
+	assert(background);
+	msxCliComm->setDeferring(true);
+	execute();
+}
+
+void MSXMotherBoard::flushDeferred()
+{
+	msxCliComm->setDeferring(false);
+	getLedStatus().flushDeferred();
+}
+
+bool MSXMotherBoard::canRunInWorker() const
+{
+	if (MSXCPUInterface::anyBreakPoints()) return false;
+	if (msxCpuInterface && !msxCpuInterface->getWatchPoints().empty()) {
+		return false;
+	}
+	return !debugger->hasProbeBreakPoints();
+}
+
+void MSXMotherBoard::updateBackground()
+{
+	bool newBackground = backgroundSetting->getBoolean() && !active;
+	if (newBackground == background) return;
+	background = newBackground;
+	if (background) {
+		// LedStatus creates settings, can't do that in a worker thread
+		getLedStatus();
+		msxMixer->mute();
+	} else {
+		msxMixer->unmute();
+		realTime->resync();
+	}
+}
+
 void MSXMotherBoard::fastForward(EmuTime::param time, bool fast)
 {
 	assert(powered);
@@ -623,6 +687,7 @@ void MSXMotherBoard::powerDown()
 void MSXMotherBoard::activate(bool active_)
 {
 	active = active_;
+	updateBackground();
 	auto event = std::make_shared<SimpleEvent>(
 		active ? OPENMSX_MACHINE_ACTIVATED : OPENMSX_MACHINE_DEACTIVATED);
 	msxEventDistributor->distributeEvent(event, scheduler->getCurrentTime());
@@ -909,6 +974,96 @@ void RemoveExtCmd::tabCompletion(vector<string>& tokens) const
 }
 
 
+// SchedulerTraceCmd
+SchedulerTraceCmd::SchedulerTraceCmd(MSXMotherBoard& motherBoard_)
+	: Command(motherBoard_.getCommandController(), "scheduler_trace")
+	, motherBoard(motherBoard_)
+	, recording(false)
+{
+}
+
+SchedulerTraceCmd::~SchedulerTraceCmd()
+{
+	motherBoard.getScheduler().setTrace(nullptr);
+}
+
+void SchedulerTraceCmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw CommandException("Missing subcommand");
+	}
+	auto& scheduler = motherBoard.getScheduler();
+	string_ref subcommand = tokens[1].getString();
+	if (subcommand == "start") {
+		if (tokens.size() > 3) throw SyntaxError();
+		int size = 1000000;
+		if (tokens.size() == 3) {
+			size = tokens[2].getInt(getInterpreter());
+			if (size <= 0) {
+				throw CommandException("Size must be positive");
+			}
+		}
+		trace = make_unique<SchedulerTrace>(size);
+		scheduler.setTrace(trace.get());
+		recording = true;
+	} else if (subcommand == "stop") {
+		if (tokens.size() != 2) throw SyntaxError();
+		scheduler.setTrace(nullptr);
+		recording = false;
+	} else if (subcommand == "save") {
+		if (tokens.size() != 3) throw SyntaxError();
+		if (!trace) {
+			throw CommandException("No trace recorded");
+		}
+		string filename = FileOperations::expandTilde(
+			tokens[2].getString().str());
+		try {
+			trace->save(filename);
+		} catch (FileException& e) {
+			throw CommandException("Couldn't save trace: " +
+			                       e.getMessage());
+		}
+		result.setString("Saved " + StringOp::toString(trace->size()) +
+		                 " events to " + filename);
+	} else if (subcommand == "status") {
+		if (tokens.size() != 2) throw SyntaxError();
+		result.addListElement("recording");
+		result.addListElement(recording);
+		result.addListElement("events");
+		result.addListElement(int(trace ? trace->size() : 0));
+		result.addListElement("total");
+		result.addListElement(StringOp::toString(
+			trace ? trace->getTotal() : 0));
+	} else {
+		throw CommandException("Invalid subcommand: " + subcommand);
+	}
+}
+
+string SchedulerTraceCmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Record all scheduler activity (setting, removing and executing "
+	       "sync points) of this machine in a ring buffer.\n"
+	       "  scheduler_trace start [<size>]  start a new trace, keeps the "
+	       "last <size> events (default 1000000)\n"
+	       "  scheduler_trace stop            stop recording\n"
+	       "  scheduler_trace save <file>     save the recorded events\n"
+	       "  scheduler_trace status          show number of recorded events\n"
+	       "A saved trace can be analysed with Contrib/scheduler-trace.cc.";
+}
+
+void SchedulerTraceCmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCommands[] = {
+			"start", "stop", "save", "status",
+		};
+		completeString(tokens, subCommands);
+	} else if ((tokens.size() == 3) && (tokens[1] == "save")) {
+		completeFileName(tokens, userFileContext());
+	}
+}
+
+
 // MachineNameInfo
 
 MachineNameInfo::MachineNameInfo(MSXMotherBoard& motherBoard_)
@@ -1049,6 +1204,8 @@ void SettingObserver::update(const Setting& setting)
 		} else {
 			motherBoard.powerDown();
 		}
+	} else if (&setting == motherBoard.backgroundSetting.get()) {
+		motherBoard.updateBackground();
 	} else {
 		UNREACHABLE;
 	}
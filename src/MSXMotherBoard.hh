@@ -54,6 +54,7 @@ class ResetCmd;
 class ReverseManager;
 class SettingObserver;
 class Scheduler;
+class SchedulerTraceCmd;
 class Setting;
 class StateChangeDistributor;
 
@@ -75,6 +76,27 @@ public:
 	 */
 	bool execute();
 
+	/** Like execute(), but for a machine that runs in the background.
+	 * While the main thread is blocked, this may be called from a worker
+	 * thread (for different machines in parallel). Things that can only
+	 * be done in the main thread (CliComm messages, LED updates) are
+	 * deferred till flushDeferred() gets called.
+	 */
+	void executeInWorker();
+	void flushDeferred();
+
+	/** Is this machine running (unthrottled and muted) in the background?
+	 * This is the case for a non-active machine when its
+	 * 'run_in_background' setting is enabled.
+	 */
+	bool isRunningInBackground() const { return background; }
+
+	/** Tcl can only be used from the main thread. So machines that may
+	 * execute Tcl callbacks while emulating (breakpoints, watchpoints,
+	 * conditions) cannot use executeInWorker().
+	 */
+	bool canRunInWorker() const;
+
 	/** Run emulation until a certain time in fast forward mode.
 	 */
 	void fastForward(EmuTime::param time, bool fast);
@@ -257,6 +279,7 @@ private:
 	std::unique_ptr<ListExtCmd>   listExtCommand;
 	std::unique_ptr<ExtCmd>       extCommand;
 	std::unique_ptr<RemoveExtCmd> removeExtCommand;
+	std::unique_ptr<SchedulerTraceCmd> schedulerTraceCommand;
 	std::unique_ptr<MachineNameInfo> machineNameInfo;
 	std::unique_ptr<MachineTypeInfo> machineTypeInfo;
 	std::unique_ptr<DeviceInfo>   deviceInfo;
@@ -267,10 +290,13 @@ private:
 	std::unique_ptr<SettingObserver> settingObserver;
 	friend class SettingObserver;
 	BooleanSetting& powerSetting;
+	std::unique_ptr<BooleanSetting> backgroundSetting;
+	void updateBackground();
 
 	bool powered;
 	bool active;
 	bool fastForwarding;
+	bool background;
 };
 SERIALIZE_CLASS_VERSION(MSXMotherBoard, 4);
 
@@ -36,6 +36,7 @@
 #include "ReadDir.hh"
 #include "Thread.hh"
 #include "Timer.hh"
+#include "WorkerPool.hh"
 #include "serialize.hh"
 #include "openmsx.hh"
 #include "checked_cast.hh"
@@ -44,7 +45,9 @@
 #include "unreachable.hh"
 #include "memory.hh"
 #include "build-info.hh"
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 
 using std::string;
 using std::vector;
@@ -178,6 +181,7 @@ Reactor::Reactor()
 	, paused(false)
 	, running(true)
 	, isInit(false)
+	, batchMode(false)
 {
 #if UNIQUE_PTR_BUG
 	display = nullptr;
@@ -532,11 +536,31 @@ void Reactor::run(CommandLineParser& parser)
 		}
 	}
 
+	// only used in batch mode
+	double emulatedSeconds = 0.0;
+	uint64_t startRealTime = Timer::getTime();
+
 	while (running) {
 		eventDistributor->deliverEvents();
 		assert(garbageBoards.empty());
 		bool blocked = (blockedCounter > 0) || !activeBoard;
-		if (!blocked) blocked = !activeBoard->execute();
+		if (!blocked) {
+			if (batchMode) {
+				// execute() may switch the active machine
+				MSXMotherBoard* board = activeBoard;
+				EmuTime before = board->getCurrentTime();
+				blocked = !board->execute();
+				EmuTime after = board->getCurrentTime();
+				if (after > before) {
+					emulatedSeconds += (after - before).toDouble();
+				}
+			} else {
+				blocked = !activeBoard->execute();
+			}
+		}
+		if ((blockedCounter == 0) && runBackgroundMachines()) {
+			blocked = false;
+		}
 		if (blocked) {
 			// At first sight a better alternative is to use the
 			// SDL_WaitEvent() function. Though when inspecting
@@ -547,6 +571,55 @@ void Reactor::run(CommandLineParser& parser)
 			eventDistributor->sleep(20 * 1000);
 		}
 	}
+
+	if (batchMode) {
+		double realSeconds = (Timer::getTime() - startRealTime) / 1000000.0;
+		std::cout << "Batch mode: emulated " << emulatedSeconds
+		     << "s in " << realSeconds << "s, "
+		     << (emulatedSeconds / std::max(realSeconds, 1e-6))
+		     << " emulated seconds per second" << std::endl;
+	}
+}
+
+// Give all machines that run in the background (see the 'run_in_background'
+// setting) a time slice. The machines are independent, so they are executed in
+// parallel in a pool of worker threads. Meanwhile the main thread is blocked,
+// so the machines can still use most of the (not thread-safe) global
+// infrastructure. Only Tcl and CliComm need special care (see
+// MSXMotherBoard::executeInWorker()): Tcl callbacks (e.g. di_halt_callback)
+// are handed over to the main thread (see TclCallback::executeCommon()), so
+// they should only access their own machine. Scratch buffers that are shared
+// by all instances of a class must be thread_local (e.g. in SoundDevice).
+// Returns true iff at least one machine was executed.
+bool Reactor::runBackgroundMachines()
+{
+	vector<MSXMotherBoard*> parallel;
+	vector<MSXMotherBoard*> serial;
+	for (auto& b : boards) {
+		if (!b->isRunningInBackground()) continue;
+		(b->canRunInWorker() ? parallel : serial).push_back(b.get());
+	}
+	if (parallel.empty() && serial.empty()) return false;
+
+	if (!parallel.empty()) {
+		if (!workerPool) workerPool = make_unique<WorkerPool>();
+		try {
+			workerPool->parallelFor(unsigned(parallel.size()),
+				[&](unsigned i) {
+					Thread::setMachineThread(true);
+					parallel[i]->executeInWorker();
+					Thread::setMachineThread(false);
+				});
+		} catch (...) {
+			for (auto* b : parallel) b->flushDeferred();
+			throw;
+		}
+		for (auto* b : parallel) b->flushDeferred();
+	}
+	for (auto* b : serial) {
+		b->execute();
+	}
+	return true;
 }
 
 void Reactor::unpause()
@@ -581,6 +654,15 @@ void Reactor::unblock()
 	mixer->unmute();
 }
 
+void Reactor::enableBatchMode()
+{
+	assert(!batchMode);
+	batchMode = true;
+	// There's no (real-time) sound output in batch mode, so the sound
+	// devices are still emulated but nothing gets uploaded to the driver.
+	mixer->mute();
+}
+
 
 // Observer<Setting>
 void Reactor::update(const Setting& setting)
@@ -48,6 +48,7 @@ class ActivateMachineCommand;
 class StoreMachineCommand;
 class RestoreMachineCommand;
 class AviRecorder;
+class WorkerPool;
 class ConfigInfo;
 class RealTimeInfo;
 template <typename T> class EnumSetting;
@@ -96,6 +97,14 @@ public:
 	void block();
 	void unblock();
 
+	/** Batch mode (see the '-batch' command line option): run as fast as
+	  * possible without any synchronization with the host (no throttling,
+	  * no sound output). When the main loop ends the achieved emulation
+	  * speed is printed.
+	  */
+	void enableBatchMode();
+	bool isBatchMode() const { return batchMode; }
+
 	// convenience methods
 	GlobalSettings& getGlobalSettings() { return *globalSettings; }
 	InfoCommand& getOpenMSXInfoCommand();
@@ -126,6 +135,8 @@ private:
 	void unpause();
 	void pause();
 
+	bool runBackgroundMachines();
+
 	std::mutex mbMutex; // this should come first, because it's still used by
 	                    // the destructors of the unique_ptr below
 
@@ -168,6 +179,7 @@ private:
 	std::unique_ptr<ConfigInfo> machineInfo;
 	std::unique_ptr<RealTimeInfo> realTimeInfo;
 	std::unique_ptr<TclCallbackMessages> tclCallbackMessages;
+	std::unique_ptr<WorkerPool> workerPool; // created on first use
 
 	// Locking rules for activeBoard access:
 	//  - main thread can always access activeBoard without taking a lock
@@ -191,6 +203,7 @@ private:
 	bool running;
 
 	bool isInit; // has the init() method been run successfully
+	bool batchMode;
 
 	friend class MachineCommand;
 	friend class TestMachineCommand;
@@ -86,7 +86,9 @@ void RealTime::sync(EmuTime::param time, bool allowSleep)
 
 void RealTime::internalSync(EmuTime::param time, bool allowSleep)
 {
-	if (throttleManager.isThrottled()) {
+	// in batch mode never wait for the host
+	if (throttleManager.isThrottled() &&
+	    !motherBoard.getReactor().isBatchMode()) {
 		auto realDuration = static_cast<uint64_t>(
 		        getRealDuration(emuTime, time) * 1000000ULL);
 		idealRealTime += realDuration;
@@ -117,7 +119,10 @@ void RealTime::internalSync(EmuTime::param time, bool allowSleep)
 
 void RealTime::executeUntil(EmuTime::param time)
 {
-	internalSync(time, true);
+	if (!motherBoard.isRunningInBackground()) {
+		// machines running in the background are not throttled
+		internalSync(time, true);
+	}
 	setSyncPoint(time + getEmuDuration(SYNC_INTERVAL));
 }
 
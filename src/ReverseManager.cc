@@ -22,6 +22,7 @@
 #include "serialize.hh"
 #include "serialize_stl.hh"
 #include "xrange.hh"
+#include <algorithm>
 #include <functional>
 #include <cassert>
 #include <cmath>
@@ -36,6 +37,17 @@ namespace openmsx {
 // Time between two snapshots (in seconds)
 static const double SNAPSHOT_PERIOD = 1.0;
 
+// Number of fully decompressed snapshots that are kept (for fast repeated
+// jumps to the same region)
+static const unsigned NUM_DECODED_SNAPSHOTS = 4;
+
+// Number of extra snapshots at recently visited points in time that are kept
+static const unsigned NUM_VISITED_SNAPSHOTS = 8;
+
+// A jump creates an extra snapshot at its destination when the distance to the
+// snapshot it started from is at least this long (in seconds)
+static const double MIN_VISIT_DISTANCE = 0.1;
+
 // Max number of snapshots in a replay file
 static const unsigned MAX_NOF_SNAPSHOTS = 10;
 
@@ -105,6 +117,8 @@ void ReverseManager::ReverseHistory::swap(ReverseHistory& other)
 {
 	std::swap(chunks, other.chunks);
 	std::swap(events, other.events);
+	std::swap(visited, other.visited);
+	std::swap(decoded, other.decoded);
 }
 
 void ReverseManager::ReverseHistory::clear()
@@ -112,6 +126,63 @@ void ReverseManager::ReverseHistory::clear()
 	// clear() and free storage capacity
 	Chunks().swap(chunks);
 	Events().swap(events);
+	visited.clear();
+	decltype(decoded)().swap(decoded);
+}
+
+const ReverseManager::ReverseChunk* ReverseManager::ReverseHistory::findDecoded(
+	const ReverseChunk& chunk)
+{
+	auto it = find_if(begin(decoded), end(decoded),
+		[&](const std::pair<const ReverseChunk*, ReverseChunk>& p) {
+			return p.first == &chunk; });
+	if (it == end(decoded)) return nullptr;
+	// move to front (most recently used)
+	std::rotate(begin(decoded), it, it + 1);
+	return &decoded.front().second;
+}
+
+void ReverseManager::ReverseHistory::addDecoded(
+	const ReverseChunk& chunk, ReverseChunk&& copy)
+{
+	forget(chunk);
+	decoded.emplace(begin(decoded), &chunk, move(copy));
+	if (decoded.size() > NUM_DECODED_SNAPSHOTS) {
+		decoded.pop_back(); // drop least recently used
+	}
+}
+
+// Returns the most recent visited snapshot that is not newer than the given
+// time, or nullptr if there's none.
+const ReverseManager::ReverseChunk* ReverseManager::ReverseHistory::findVisited(
+	EmuTime::param time) const
+{
+	const ReverseChunk* result = nullptr;
+	for (auto& chunk : visited) {
+		if ((chunk.time <= time) && (!result || (chunk.time > result->time))) {
+			result = &chunk;
+		}
+	}
+	return result;
+}
+
+// Marks the given snapshot as recently used (if it's a visited snapshot).
+void ReverseManager::ReverseHistory::touchVisited(const ReverseChunk& chunk)
+{
+	auto it = find_if(begin(visited), end(visited),
+		[&](const ReverseChunk& v) { return &v == &chunk; });
+	if (it != end(visited)) {
+		visited.splice(begin(visited), visited, it);
+	}
+}
+
+// Must be called when the given snapshot is removed or replaced.
+void ReverseManager::ReverseHistory::forget(const ReverseChunk& chunk)
+{
+	decoded.erase(remove_if(begin(decoded), end(decoded),
+		[&](const std::pair<const ReverseChunk*, ReverseChunk>& p) {
+			return p.first == &chunk; }),
+		end(decoded));
 }
 
 
@@ -254,14 +325,26 @@ void ReverseManager::debugInfo(TclObject& result) const
 	// information means nothing. We should remove this later.
 	StringOp::Builder res;
 	size_t totalSize = 0;
-	for (auto& p : history.chunks) {
-		auto& chunk = p.second;
-		res << p.first << ' '
-		    << (chunk.time - EmuTime::zero).toDouble() << ' '
+	auto print = [&](const ReverseChunk& chunk) {
+		res << (chunk.time - EmuTime::zero).toDouble() << ' '
 		    << ((chunk.time - EmuTime::zero).toDouble() / (getCurrentTime() - EmuTime::zero).toDouble()) * 100 << '%'
 		    << " (" << chunk.size << ')'
-		    << " (next event index: " << chunk.eventCount << ")\n";
+		    << " (next event index: " << chunk.eventCount << ')';
+		if (any_of(begin(history.decoded), end(history.decoded),
+		           [&](const std::pair<const ReverseChunk*, ReverseChunk>& d) {
+				return d.first == &chunk; })) {
+			res << " decoded";
+		}
+		res << '\n';
 		totalSize += chunk.size;
+	};
+	for (auto& p : history.chunks) {
+		res << p.first << ' ';
+		print(p.second);
+	}
+	for (auto& chunk : history.visited) {
+		res << "visited ";
+		print(chunk);
 	}
 	res << "total size: " << totalSize << '\n';
 	result.setString(string(res));
@@ -389,7 +472,12 @@ void ReverseManager::goTo(
 		// one that's not newer (thus older or equal).
 		assert(it != begin(hist.chunks));
 		--it;
-		ReverseChunk& chunk = it->second;
+		// A snapshot at a recently visited point can be even closer.
+		const ReverseChunk* visited = hist.findVisited(preTarget);
+		const ReverseChunk& chunk =
+			(visited && (visited->time > it->second.time))
+			? *visited : it->second;
+		hist.touchVisited(chunk);
 		EmuTime snapshotTime = chunk.time;
 		assert(snapshotTime <= preTarget);
 
@@ -415,10 +503,19 @@ void ReverseManager::goTo(
 			// -- restore old snapshot --
 			newBoard_ = reactor.createEmptyMotherBoard();
 			newBoard = newBoard_.get();
-			MemInputArchive in(chunk.savestate.data(),
-					   chunk.size,
-					   chunk.deltaBlocks);
-			in.serialize("machine", *newBoard);
+			bool wasDecoded = false;
+			if (auto* decoded = hist.findDecoded(chunk)) {
+				MemInputArchive in(decoded->savestate.data(),
+				                   decoded->size,
+				                   decoded->deltaBlocks);
+				in.serialize("machine", *newBoard);
+				wasDecoded = true;
+			} else {
+				MemInputArchive in(chunk.savestate.data(),
+						   chunk.size,
+						   chunk.deltaBlocks);
+				in.serialize("machine", *newBoard);
+			}
 
 			if (eventDelay) {
 				// Handle all events that are scheduled, but not yet
@@ -438,7 +535,13 @@ void ReverseManager::goTo(
 			// Also we should stop collecting in this ReverseManager,
 			// and start collecting in the new one.
 			auto& newManager = newBoard->getReverseManager();
-			newManager.transferHistory(hist, chunk.eventCount);
+			unsigned eventCount = chunk.eventCount;
+			newManager.transferHistory(hist, eventCount);
+			if (!wasDecoded) {
+				// keep a decompressed copy for next time
+				newManager.history.addDecoded(chunk,
+					newManager.decodeSnapshot(*newBoard, eventCount));
+			}
 
 			// transfer (or copy) state from old to new machine
 			transferState(*newBoard);
@@ -490,6 +593,22 @@ void ReverseManager::goTo(
 				lastSnapshotTarget = nextSnapshotTarget;
 			}
 		}
+		// Adaptive snapshot density: also put a snapshot at the
+		// destination of this jump (unless we started close to it).
+		// Scrubbing typically jumps to the same region over and over
+		// again, so also keep a decompressed copy of it.
+		// Note: 'chunk' may already be dropped by now.
+		auto currentTimeNewBoard = newBoard->getCurrentTime();
+		if ((currentTimeNewBoard - snapshotTime) >
+		    EmuDuration(MIN_VISIT_DISTANCE)) {
+			auto& newManager = newBoard->getReverseManager();
+			newManager.takeVisitedSnapshot(currentTimeNewBoard);
+			newManager.history.addDecoded(
+				newManager.history.visited.front(),
+				newManager.decodeSnapshot(*newBoard,
+				                          newManager.replayIndex));
+		}
+
 		// re-enable automatic snapshots
 		schedule(getCurrentTime());
 
@@ -911,12 +1030,49 @@ void ReverseManager::takeSnapshot(EmuTime::param time)
 
 	// actually create new snapshot
 	ReverseChunk& newChunk = history.chunks[seqNum];
-	newChunk.deltaBlocks.clear();
-	MemOutputArchive out(history.lastDeltaBlocks, newChunk.deltaBlocks, true);
+	history.forget(newChunk); // in case we're replacing an existing one
+	storeSnapshot(newChunk, time);
+}
+
+// Take an extra snapshot at the destination of a jump. Only the most recently
+// used NUM_VISITED_SNAPSHOTS of these are kept.
+void ReverseManager::takeVisitedSnapshot(EmuTime::param time)
+{
+	auto& visited = history.visited;
+	visited.emplace_front();
+	storeSnapshot(visited.front(), time);
+	if (visited.size() > NUM_VISITED_SNAPSHOTS) {
+		history.forget(visited.back());
+		visited.pop_back();
+	}
+}
+
+void ReverseManager::storeSnapshot(ReverseChunk& chunk, EmuTime::param time)
+{
+	chunk.deltaBlocks.clear();
+	MemOutputArchive out(history.lastDeltaBlocks, chunk.deltaBlocks, true);
 	out.serialize("machine", motherBoard);
-	newChunk.time = time;
-	newChunk.savestate = out.releaseBuffer(newChunk.size);
-	newChunk.eventCount = replayIndex;
+	chunk.time = time;
+	chunk.savestate = out.releaseBuffer(chunk.size);
+	chunk.eventCount = replayIndex;
+}
+
+// Serialize the given machine (which must be in the state of the snapshot)
+// without delta compression. A fresh LastDeltaBlocks object has no history,
+// so all blobs are stored as (uncompressed) DeltaBlockCopy objects.
+// Note: this is not a 'reverse snapshot' archive, that would reset the dirty
+// tracking (see TrackedRam) which is relative to 'history.lastDeltaBlocks'.
+ReverseManager::ReverseChunk ReverseManager::decodeSnapshot(
+	MSXMotherBoard& board, unsigned eventCount)
+{
+	ReverseChunk result;
+	LastDeltaBlocks noHistory;
+	MemOutputArchive out(noHistory, result.deltaBlocks, false);
+	out.serialize("machine", board);
+	result.time = board.getCurrentTime();
+	result.savestate = out.releaseBuffer(result.size);
+	result.eventCount = eventCount;
+	return result;
 }
 
 void ReverseManager::replayNextEvent()
@@ -962,7 +1118,19 @@ void ReverseManager::stopReplay(EmuTime::param time)
 		// search snapshots that are newer than 'time' and erase them
 		auto it = find_if(begin(history.chunks), end(history.chunks),
 			[&](Chunks::value_type& p) { return p.second.time > time; });
+		for (auto it2 = it; it2 != end(history.chunks); ++it2) {
+			history.forget(it2->second);
+		}
 		history.chunks.erase(it, end(history.chunks));
+		auto& visited = history.visited;
+		for (auto it2 = begin(visited); it2 != end(visited); ) {
+			if (it2->time > time) {
+				history.forget(*it2);
+				it2 = visited.erase(it2);
+			} else {
+				++it2;
+			}
+		}
 		// this also means someone is changing history, record that
 		reRecordCount++;
 	}
@@ -990,7 +1158,11 @@ void ReverseManager::dropOldSnapshots(unsigned count)
 	while (true) {
 		y >>= 1;
 		if ((y == 0) || (count < d)) return;
-		history.chunks.erase(count - d);
+		auto it = history.chunks.find(count - d);
+		if (it != end(history.chunks)) {
+			history.forget(it->second);
+			history.chunks.erase(it);
+		}
 		d += d2;
 		d2 *= 2;
 	}
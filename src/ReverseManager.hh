@@ -11,8 +11,10 @@
 #include "array_ref.hh"
 #include "outer.hh"
 #include <vector>
+#include <list>
 #include <map>
 #include <memory>
+#include <utility>
 #include <cstdint>
 
 namespace openmsx {
@@ -72,9 +74,26 @@ private:
 		void clear();
 		unsigned getNextSeqNum(EmuTime::param time) const;
 
+		const ReverseChunk* findDecoded(const ReverseChunk& chunk);
+		void addDecoded(const ReverseChunk& chunk, ReverseChunk&& copy);
+		const ReverseChunk* findVisited(EmuTime::param time) const;
+		void touchVisited(const ReverseChunk& chunk);
+		void forget(const ReverseChunk& chunk);
+
 		Chunks chunks;
 		Events events;
 		LastDeltaBlocks lastDeltaBlocks;
+
+		// Extra snapshots at recently visited points in time (most
+		// recently used first). These are kept apart from the regular
+		// snapshots in 'chunks', so they don't replace one of those
+		// and they don't influence dropOldSnapshots().
+		std::list<ReverseChunk> visited;
+		// Fully decompressed copies of recently restored snapshots
+		// (most recently used first), identified by the address of
+		// the chunk in 'chunks' or 'visited'. Restoring from such a
+		// copy doesn't need to decompress or apply any delta blocks.
+		std::vector<std::pair<const ReverseChunk*, ReverseChunk>> decoded;
 	};
 
 	bool isCollecting() const { return collecting; }
@@ -99,6 +118,9 @@ private:
 	                     unsigned oldEventCount);
 	void transferState(MSXMotherBoard& newBoard);
 	void takeSnapshot(EmuTime::param time);
+	void takeVisitedSnapshot(EmuTime::param time);
+	void storeSnapshot(ReverseChunk& chunk, EmuTime::param time);
+	ReverseChunk decodeSnapshot(MSXMotherBoard& board, unsigned eventCount);
 	void schedule(EmuTime::param time);
 	void replayNextEvent();
 	template<unsigned N> void dropOldSnapshots(unsigned count);
@@ -1,10 +1,12 @@
 #include "Scheduler.hh"
 #include "Schedulable.hh"
+#include "SchedulerTrace.hh"
 #include "Thread.hh"
 #include "MSXCPU.hh"
 #include "serialize.hh"
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 #include <iterator> // for back_inserter
 
 namespace openmsx {
@@ -22,6 +24,7 @@ struct EqualSchedulable {
 Scheduler::Scheduler()
 	: scheduleTime(EmuTime::zero)
 	, cpu(nullptr)
+	, trace(nullptr)
 	, scheduleInProgress(false)
 {
 }
@@ -39,14 +42,18 @@ Scheduler::~Scheduler()
 
 void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
 	assert(time >= scheduleTime);
+	if (unlikely(trace != nullptr)) trace->record(SchedulerTrace::SET, time, device);
 
 	// Push sync point into queue.
+#ifdef SCHEDULER_HEAP_QUEUE
+	queue.insert(SynchronizationPoint(time, &device));
+#else
 	queue.insert(SynchronizationPoint(time, &device),
 	             [](SynchronizationPoint& sp) { sp.setTime(EmuTime::infinity); },
-	             [](const SynchronizationPoint& x, const SynchronizationPoint& y) {
-	                     return x.getTime() < y.getTime(); });
+	             SyncPointLess());
+#endif
 
 	if (!scheduleInProgress && cpu) {
 		// only when scheduleHelper() is not being executed
@@ -59,27 +66,53 @@ void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 Scheduler::SyncPoints Scheduler::getSyncPoints(const Schedulable& device) const
 {
 	SyncPoints result;
+#ifdef SCHEDULER_HEAP_QUEUE
+	queue.copy_key(&device, back_inserter(result));
+#else
 	copy_if(std::begin(queue), std::end(queue), back_inserter(result),
 	        EqualSchedulable(device));
+#endif
 	return result;
 }
 
 bool Scheduler::removeSyncPoint(Schedulable& device)
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
+	if (unlikely(trace != nullptr)) {
+		trace->record(SchedulerTrace::REMOVE, scheduleTime, device);
+	}
+#ifdef SCHEDULER_HEAP_QUEUE
+	return queue.remove(&device);
+#else
 	return queue.remove(EqualSchedulable(device));
+#endif
 }
 
 void Scheduler::removeSyncPoints(Schedulable& device)
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
+	if (unlikely(trace != nullptr)) {
+		trace->record(SchedulerTrace::REMOVE_ALL, scheduleTime, device);
+	}
+#ifdef SCHEDULER_HEAP_QUEUE
+	queue.remove_all(&device);
+#else
 	queue.remove_all(EqualSchedulable(device));
+#endif
 }
 
 bool Scheduler::pendingSyncPoint(const Schedulable& device,
                                  EmuTime& result) const
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
+#ifdef SCHEDULER_HEAP_QUEUE
+	if (auto* sp = queue.find_first(&device)) {
+		result = sp->getTime();
+		return true;
+	} else {
+		return false;
+	}
+#else
 	auto it = std::find_if(std::begin(queue), std::end(queue),
 	                       EqualSchedulable(device));
 	if (it != std::end(queue)) {
@@ -88,11 +121,12 @@ bool Scheduler::pendingSyncPoint(const Schedulable& device,
 	} else {
 		return false;
 	}
+#endif
 }
 
 EmuTime::param Scheduler::getCurrentTime() const
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
 	return scheduleTime;
 }
 
@@ -109,7 +143,11 @@ void Scheduler::scheduleHelper(EmuTime::param limit, EmuTime next)
 
 		queue.remove_front();
 
-		device->executeUntil(next);
+		if (unlikely(trace != nullptr)) {
+			executeTraced(*device, next);
+		} else {
+			device->executeUntil(next);
+		}
 
 		next = getNext();
 		if (likely(next > limit)) break;
@@ -119,6 +157,19 @@ void Scheduler::scheduleHelper(EmuTime::param limit, EmuTime next)
 	cpu->setNextSyncPoint(next);
 }
 
+void Scheduler::executeTraced(Schedulable& device, EmuTime::param time)
+{
+	using namespace std::chrono;
+	auto* t = trace;
+	auto event = t->record(SchedulerTrace::EXECUTE, time, device);
+	auto start = steady_clock::now();
+	device.executeUntil(time);
+	auto ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+	// tracing can be stopped/restarted from within executeUntil() (e.g.
+	// via an 'after' command)
+	if (trace == t) t->setCost(event, ns);
+}
+
 
 template <typename Archive>
 void SynchronizationPoint::serialize(Archive& ar, unsigned /*version*/)
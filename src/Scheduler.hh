@@ -2,13 +2,31 @@
 #define SCHEDULER_HH
 
 #include "EmuTime.hh"
-#include "SchedulerQueue.hh"
 #include "likely.hh"
 #include <vector>
 
+//
+// #define SCHEDULER_HEAP_QUEUE
+//
+// By default the sync points are stored in a SchedulerQueue (a sorted array).
+// When this symbol is defined a SchedulerHeapQueue (a 4-ary heap) is used
+// instead. The heap has O(log N) insert and removal, which helps when a lot of
+// devices have pending sync points. For the typical case (only a few pending
+// sync points) the sorted array is faster. Use the SchedulerQueueBench
+// program to compare both implementations on a (recorded) trace.
+//
+// Like for USE_COMPUTED_GOTO, the easiest way to enable this is to pass the
+// -DSCHEDULER_HEAP_QUEUE flag to the compiler.
+#ifdef SCHEDULER_HEAP_QUEUE
+#include "SchedulerHeapQueue.hh"
+#else
+#include "SchedulerQueue.hh"
+#endif
+
 namespace openmsx {
 
 class Schedulable;
+class SchedulerTrace;
 class MSXCPU;
 
 class SynchronizationPoint
@@ -30,6 +48,19 @@ private:
 	Schedulable* device;
 };
 
+struct SyncPointLess {
+	bool operator()(const SynchronizationPoint& x,
+	                const SynchronizationPoint& y) const {
+		return x.getTime() < y.getTime();
+	}
+};
+
+struct SyncPointDevice {
+	const Schedulable* operator()(const SynchronizationPoint& sp) const {
+		return sp.getDevice();
+	}
+};
+
 
 class Scheduler
 {
@@ -69,6 +100,12 @@ public:
 		scheduleTime = limit;
 	}
 
+	/**
+	 * Start (non-null) or stop (nullptr) recording all scheduler activity
+	 * in the given trace. The caller retains ownership.
+	 */
+	void setTrace(SchedulerTrace* trace_) { trace = trace_; }
+
 	template <typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -108,13 +145,19 @@ private: // -> intended for Schedulable
 
 private:
 	void scheduleHelper(EmuTime::param limit, EmuTime next);
+	void executeTraced(Schedulable& device, EmuTime::param time);
 
 	/** Vector used as heap, not a priority queue because that
 	  * doesn't allow removal of non-top element.
 	  */
+#ifdef SCHEDULER_HEAP_QUEUE
+	SchedulerHeapQueue<SynchronizationPoint, SyncPointLess, SyncPointDevice> queue;
+#else
 	SchedulerQueue<SynchronizationPoint> queue;
+#endif
 	EmuTime scheduleTime;
 	MSXCPU* cpu;
+	SchedulerTrace* trace;
 	bool scheduleInProgress;
 };
 
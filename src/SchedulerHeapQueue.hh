@@ -0,0 +1,252 @@
+#ifndef SCHEDULERHEAPQUEUE_HH
+#define SCHEDULERHEAPQUEUE_HH
+
+#include "hash_map.hh"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+
+namespace openmsx {
+
+// Alternative for SchedulerQueue, based on a 4-ary heap.
+//
+// SchedulerQueue is a sorted array. It's very fast when there are only a few
+// elements and when new elements are (mostly) inserted near the front. But
+// insert and (non-front) removal are O(N). This class has O(log N) insert and
+// O(log N) removal of an element for a given key (the Schedulable). The price
+// is a more complex (and for small N somewhat slower) data structure.
+//
+// The observable behaviour is the same as for SchedulerQueue:
+//  - Elements with equivalent sorting keys come out in insertion order (this
+//    is needed for deterministic replays). This is implemented by
+//    additionally ordering on an insertion sequence number.
+//  - remove(key) removes the earliest element for the given key.
+//
+// LESS is the sorting predicate. KEY_OF must be a functor that extracts the
+// key from an element. Elements with the same key are linked together so that
+// they can be found without scanning the whole heap.
+template<typename T, typename LESS, typename KEY_OF> class SchedulerHeapQueue
+{
+	using Key = decltype(std::declval<KEY_OF>()(std::declval<const T&>()));
+	static const unsigned NONE = unsigned(-1);
+
+	struct Entry {
+		T value;
+		uint64_t seq; // tie-breaker for equivalent values
+		unsigned id;  // index in 'meta'
+	};
+	struct Meta {
+		unsigned heapIdx;   // position of this element in 'heap'
+		unsigned nextSame;  // next id with the same key (or NONE)
+	};
+
+public:
+	class const_iterator : public std::iterator<
+		std::forward_iterator_tag, const T>
+	{
+	public:
+		explicit const_iterator(const Entry* e_) : e(e_) {}
+		const T& operator*()  const { return  e->value; }
+		const T* operator->() const { return &e->value; }
+		const_iterator& operator++() { ++e; return *this; }
+		bool operator==(const const_iterator& o) const { return e == o.e; }
+		bool operator!=(const const_iterator& o) const { return e != o.e; }
+	private:
+		const Entry* e;
+	};
+
+	SchedulerHeapQueue()
+		: seqCounter(0)
+		, freeId(NONE)
+	{
+	}
+
+	size_t size()  const { return heap.size(); }
+	bool   empty() const { return heap.empty(); }
+
+	// Returns reference to the smallest element.
+	const T& front() const { return heap.front().value; }
+
+	// Iterate over all elements, in no particular order.
+	const_iterator begin() const { return const_iterator(heap.data()); }
+	const_iterator end()   const { return const_iterator(heap.data() + heap.size()); }
+
+	// Insert new element.
+	void insert(const T& t)
+	{
+		unsigned id = allocId();
+		Key key = keyOf(t);
+		auto it = heads.find(key);
+		if (it == heads.end()) {
+			meta[id].nextSame = NONE;
+			heads[key] = id;
+		} else {
+			meta[id].nextSame = it->second;
+			it->second = id;
+		}
+		heap.push_back(Entry{t, seqCounter++, id});
+		siftUp(unsigned(heap.size() - 1));
+	}
+
+	// Remove the smallest element.
+	void remove_front()
+	{
+		assert(!empty());
+		removeAt(0);
+	}
+
+	// Remove the earliest element with the given key.
+	// Returns false if there was no such element.
+	bool remove(const Key& key)
+	{
+		auto it = heads.find(key);
+		if (it == heads.end()) return false;
+		unsigned best = NONE;
+		for (unsigned id = it->second; id != NONE; id = meta[id].nextSame) {
+			if ((best == NONE) ||
+			    entryLess(heap[meta[id].heapIdx], heap[meta[best].heapIdx])) {
+				best = id;
+			}
+		}
+		assert(best != NONE);
+		removeAt(meta[best].heapIdx);
+		return true;
+	}
+
+	// Remove all elements with the given key.
+	void remove_all(const Key& key)
+	{
+		while (remove(key)) {}
+	}
+
+	// Returns the earliest element with the given key, or nullptr.
+	const T* find_first(const Key& key) const
+	{
+		auto it = heads.find(key);
+		if (it == heads.end()) return nullptr;
+		const Entry* best = nullptr;
+		for (unsigned id = it->second; id != NONE; id = meta[id].nextSame) {
+			const Entry& e = heap[meta[id].heapIdx];
+			if (!best || entryLess(e, *best)) best = &e;
+		}
+		return &best->value;
+	}
+
+	// Copy all elements with the given key, sorted, to 'out'.
+	template<typename OUT> void copy_key(const Key& key, OUT out) const
+	{
+		auto it = heads.find(key);
+		if (it == heads.end()) return;
+		std::vector<const Entry*> tmp;
+		for (unsigned id = it->second; id != NONE; id = meta[id].nextSame) {
+			tmp.push_back(&heap[meta[id].heapIdx]);
+		}
+		std::sort(tmp.begin(), tmp.end(),
+		          [&](const Entry* x, const Entry* y) {
+		                  return entryLess(*x, *y); });
+		for (auto* e : tmp) *out++ = e->value;
+	}
+
+private:
+	bool entryLess(const Entry& x, const Entry& y) const
+	{
+		if (less(x.value, y.value)) return true;
+		if (less(y.value, x.value)) return false;
+		return x.seq < y.seq;
+	}
+
+	unsigned allocId()
+	{
+		if (freeId != NONE) {
+			unsigned id = freeId;
+			freeId = meta[id].nextSame;
+			return id;
+		}
+		meta.push_back(Meta());
+		return unsigned(meta.size() - 1);
+	}
+
+	void unlinkId(unsigned id)
+	{
+		Key key = keyOf(heap[meta[id].heapIdx].value);
+		auto it = heads.find(key);
+		assert(it != heads.end());
+		unsigned* link = &it->second;
+		while (*link != id) link = &meta[*link].nextSame;
+		*link = meta[id].nextSame;
+		if (it->second == NONE) heads.erase(it);
+
+		meta[id].nextSame = freeId;
+		freeId = id;
+	}
+
+	void removeAt(unsigned idx)
+	{
+		unlinkId(heap[idx].id);
+		unsigned last = unsigned(heap.size() - 1);
+		if (idx != last) {
+			move(idx, heap[last]);
+			heap.pop_back();
+			if ((idx > 0) &&
+			    entryLess(heap[idx], heap[(idx - 1) / 4])) {
+				siftUp(idx);
+			} else {
+				siftDown(idx);
+			}
+		} else {
+			heap.pop_back();
+		}
+	}
+
+	void move(unsigned idx, const Entry& e)
+	{
+		heap[idx] = e;
+		meta[e.id].heapIdx = idx;
+	}
+
+	void siftUp(unsigned idx)
+	{
+		Entry e = heap[idx];
+		while (idx > 0) {
+			unsigned parent = (idx - 1) / 4;
+			if (!entryLess(e, heap[parent])) break;
+			move(idx, heap[parent]);
+			idx = parent;
+		}
+		move(idx, e);
+	}
+
+	void siftDown(unsigned idx)
+	{
+		Entry e = heap[idx];
+		unsigned n = unsigned(heap.size());
+		while (true) {
+			unsigned first = 4 * idx + 1;
+			if (first >= n) break;
+			unsigned last = std::min(first + 4, n);
+			unsigned best = first;
+			for (unsigned c = first + 1; c < last; ++c) {
+				if (entryLess(heap[c], heap[best])) best = c;
+			}
+			if (!entryLess(heap[best], e)) break;
+			move(idx, heap[best]);
+			idx = best;
+		}
+		move(idx, e);
+	}
+
+	std::vector<Entry> heap;
+	std::vector<Meta> meta;
+	hash_map<Key, unsigned> heads; // key -> first id with that key
+	LESS less;
+	KEY_OF keyOf;
+	uint64_t seqCounter;
+	unsigned freeId; // head of the free-list of ids (linked via nextSame)
+};
+
+} // namespace openmsx
+
+#endif // SCHEDULERHEAPQUEUE_HH
@@ -0,0 +1,205 @@
+// Micro-benchmark for the Scheduler sync point queue.
+//
+// Replays a trace of setSyncPoint / removeSyncPoint / executeUntil operations
+// against both SchedulerQueue (sorted array) and SchedulerHeapQueue (4-ary
+// heap), verifies that both produce the exact same sequence of executed sync
+// points and reports the time per operation.
+//
+// The trace is a text file with one operation per line:
+//   s <device> <time>   setSyncPoint(time) for the given device
+//   r <device>          removeSyncPoint() for the given device
+//   a <device>          removeSyncPoints() for the given device
+//   x                   execute (remove) the earliest sync point
+// where <device> is a small integer and <time> an unsigned tick count. Such a
+// trace can be recorded in openMSX itself (see the 'scheduler_trace' command)
+// and then be converted with Contrib/scheduler-trace.cc.
+// Without a trace file a synthetic trace is generated.
+//
+// Usage: SchedulerQueueBench [trace [repeat]]
+
+#include "SchedulerQueue.hh"
+#include "SchedulerHeapQueue.hh"
+#include "Benchmark.hh"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+
+struct SP
+{
+	uint64_t time;
+	unsigned device;
+};
+struct SPLess {
+	bool operator()(const SP& x, const SP& y) const { return x.time < y.time; }
+};
+struct SPDevice {
+	unsigned operator()(const SP& sp) const { return sp.device; }
+};
+
+struct Op
+{
+	char type; // 's', 'r', 'a' or 'x'
+	unsigned device;
+	uint64_t time;
+};
+using Trace = vector<Op>;
+
+
+static Trace loadTrace(const string& filename)
+{
+	Trace trace;
+	ifstream in(filename);
+	if (!in) {
+		cerr << "Couldn't open " << filename << endl;
+		exit(1);
+	}
+	string type;
+	while (in >> type) {
+		Op op = { type[0], 0, 0 };
+		switch (op.type) {
+		case 's': in >> op.device >> op.time; break;
+		case 'r': case 'a': in >> op.device; break;
+		case 'x': break;
+		default:
+			cerr << "Invalid trace line: " << type << endl;
+			exit(1);
+		}
+		trace.push_back(op);
+	}
+	return trace;
+}
+
+// Roughly mimics a busy machine: a few devices with frequent, near-future sync
+// points (timers, VDP) and many devices with far-future sync points that get
+// frequently rescheduled (sound chips, MIDI, RS232, ...).
+static Trace generateTrace(unsigned numDevices, unsigned numOps)
+{
+	Trace trace;
+	minstd_rand rng(12345);
+	vector<unsigned> pending(numDevices);
+	// simulate the queue, so we know which device gets executed
+	SchedulerQueue<SP> queue;
+	auto set = [&](unsigned d, uint64_t t) {
+		trace.push_back({'s', d, t});
+		queue.insert(SP{t, d}, [](SP& s) { s.time = uint64_t(-1); }, SPLess());
+		++pending[d];
+	};
+	auto delay = [&](unsigned d) {
+		return 10 + rng() % ((d < 4) ? 1000 : 100000);
+	};
+
+	uint64_t now = 0;
+	for (unsigned d = 0; d < numDevices; ++d) {
+		set(d, now + delay(d));
+	}
+	while (trace.size() < numOps) {
+		unsigned r = rng() % 8;
+		if (r < 4) {
+			// execute the earliest sync point, that device re-schedules
+			trace.push_back({'x', 0, 0});
+			SP sp = queue.front();
+			queue.remove_front();
+			--pending[sp.device];
+			now = sp.time;
+			set(sp.device, now + delay(sp.device));
+			continue;
+		}
+		unsigned d = rng() % numDevices;
+		if ((r < 7) && pending[d]) {
+			// reprogram a device: remove and re-add its sync point
+			trace.push_back({'r', d, 0});
+			queue.remove([&](const SP& s) { return s.device == d; });
+			--pending[d];
+			set(d, now + delay(d));
+		} else if (pending[d] < 4) {
+			set(d, now + delay(d));
+		}
+	}
+	return trace;
+}
+
+template<typename QUEUE, typename INSERT, typename REMOVE, typename REMOVE_ALL>
+static vector<SP> replay(const Trace& trace, QUEUE& queue, INSERT insert,
+                         REMOVE remove, REMOVE_ALL removeAll)
+{
+	vector<SP> executed;
+	for (auto& op : trace) {
+		switch (op.type) {
+		case 's': insert(queue, SP{op.time, op.device}); break;
+		case 'r': remove(queue, op.device); break;
+		case 'a': removeAll(queue, op.device); break;
+		case 'x':
+			if (!queue.empty()) {
+				executed.push_back(queue.front());
+				queue.remove_front();
+			}
+			break;
+		}
+	}
+	return executed;
+}
+
+static vector<SP> runSorted(const Trace& trace)
+{
+	SchedulerQueue<SP> queue;
+	return replay(trace, queue,
+		[](SchedulerQueue<SP>& q, const SP& sp) {
+			q.insert(sp, [](SP& s) { s.time = uint64_t(-1); }, SPLess()); },
+		[](SchedulerQueue<SP>& q, unsigned d) {
+			q.remove([&](const SP& s) { return s.device == d; }); },
+		[](SchedulerQueue<SP>& q, unsigned d) {
+			q.remove_all([&](const SP& s) { return s.device == d; }); });
+}
+
+static vector<SP> runHeap(const Trace& trace)
+{
+	using Queue = SchedulerHeapQueue<SP, SPLess, SPDevice>;
+	Queue queue;
+	return replay(trace, queue,
+		[](Queue& q, const SP& sp) { q.insert(sp); },
+		[](Queue& q, unsigned d) { q.remove(d); },
+		[](Queue& q, unsigned d) { q.remove_all(d); });
+}
+
+// Prints the best time per operation of 'repeat' replays of the trace.
+template<typename FUNC>
+static void measure(const char* name, const Trace& trace, unsigned repeat,
+                    FUNC func, vector<SP>& result)
+{
+	double us = Benchmark::best(repeat, [&]() { result = func(trace); });
+	cout << name << ": " << (1000.0 * us / trace.size()) << " ns/op" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	Trace trace = (argc > 1) ? loadTrace(argv[1])
+	                         : generateTrace(40, 1000000);
+	unsigned repeat = Benchmark::getCount(argc, argv, 2, 10);
+	if (trace.empty()) {
+		cerr << "Nothing to replay" << endl;
+		return 1;
+	}
+	cout << "Replaying " << trace.size() << " operations, best of "
+	     << repeat << " times" << endl;
+
+	vector<SP> sortedResult, heapResult;
+	measure("sorted array", trace, repeat, runSorted, sortedResult);
+	measure("4-ary heap  ", trace, repeat, runHeap,   heapResult);
+
+	Benchmark::Checker checker;
+	checker.check(sortedResult.size() == heapResult.size());
+	for (size_t i = 0; checker.ok() && (i < sortedResult.size()); ++i) {
+		checker.check((sortedResult[i].time   == heapResult[i].time) &&
+		              (sortedResult[i].device == heapResult[i].device));
+	}
+	return checker.exitCode("both implementations executed a different "
+	                        "sequence of sync points");
+}
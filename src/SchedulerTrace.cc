@@ -0,0 +1,82 @@
+#include "SchedulerTrace.hh"
+#include "Schedulable.hh"
+#include "File.hh"
+#include "StringOp.hh"
+#include "likely.hh"
+#include <algorithm>
+#include <typeinfo>
+
+namespace openmsx {
+
+SchedulerTrace::SchedulerTrace(size_t capacity)
+	: buffer(std::max<size_t>(capacity, 1))
+	, total(0)
+	, head(0)
+{
+}
+
+size_t SchedulerTrace::size() const
+{
+	return size_t(std::min<uint64_t>(total, buffer.size()));
+}
+
+void SchedulerTrace::setCost(uint64_t event, int64_t ns)
+{
+	// ignore if the event got already overwritten (or is the oldest entry,
+	// so the next one to be overwritten)
+	if ((total - event) >= buffer.size()) return;
+	auto cost = uint32_t(std::min<int64_t>(std::max<int64_t>(ns, 0), 0xFFFFFFFF));
+	buffer[event % buffer.size()].cost = cost;
+}
+
+uint16_t SchedulerTrace::getDeviceId(const Schedulable& device)
+{
+	auto it = ids.find(&device);
+	if (likely(it != ids.end())) return it->second;
+
+	// The (mangled) class name identifies the type of the device, when
+	// there are several instances of the same type append a counter.
+	// Note: a Schedulable that gets deleted and a new one that later
+	// gets allocated at the same address share the same id.
+	std::string name = typeid(device).name();
+	unsigned count = ++nameCount[name];
+	if (count > 1) name += '#' + StringOp::toString(count);
+
+	// Ids are 16-bit, in the (very unlikely) case we run out, all
+	// remaining devices share the last id.
+	uint16_t id = uint16_t(std::min<size_t>(names.size(), 0xFFFF));
+	if (id == names.size()) names.push_back(name);
+	ids[&device] = id;
+	return id;
+}
+
+template<typename T> static void writeValue(File& file, T t)
+{
+	file.write(&t, sizeof(t));
+}
+
+void SchedulerTrace::save(string_ref filename) const
+{
+	File file(filename, File::TRUNCATE);
+
+	uint64_t num = size();
+	file.write("OMSXSCHT", 8);
+	writeValue<uint32_t>(file, 1); // version
+	writeValue<uint32_t>(file, uint32_t(names.size()));
+	writeValue<uint64_t>(file, num);
+	writeValue<uint64_t>(file, total - num);
+	writeValue<uint64_t>(file, MAIN_FREQ);
+
+	for (auto& name : names) {
+		writeValue<uint32_t>(file, uint32_t(name.size()));
+		file.write(name.data(), name.size());
+	}
+
+	// oldest record first
+	if (total > buffer.size()) {
+		file.write(&buffer[head], (buffer.size() - head) * sizeof(Record));
+	}
+	file.write(buffer.data(), head * sizeof(Record));
+}
+
+} // namespace openmsx
@@ -0,0 +1,94 @@
+#ifndef SCHEDULERTRACE_HH
+#define SCHEDULERTRACE_HH
+
+#include "EmuTime.hh"
+#include "hash_map.hh"
+#include "string_ref.hh"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class Schedulable;
+
+/** Records all Scheduler activity (setSyncPoint(), removeSyncPoint(),
+  * removeSyncPoints() and executeUntil()) in a fixed-size ring buffer. When
+  * the buffer is full the oldest events are overwritten.
+  *
+  * This is a debugging aid to find out which Schedulables cause the CPU
+  * emulation loop to exit (and how much host time their executeUntil()
+  * callbacks take). Use the 'scheduler_trace' console command to start/stop
+  * recording and to save the trace to a file. The saved file can be analysed
+  * offline with Contrib/scheduler-trace.cc.
+  *
+  * File format (all values in host byte order, normally little endian):
+  *   header:  char magic[8] = "OMSXSCHT"
+  *            uint32_t version (currently 1)
+  *            uint32_t number of devices
+  *            uint64_t number of records
+  *            uint64_t number of dropped (overwritten) records
+  *            uint64_t EmuTime ticks per second
+  *   devices: per device a uint32_t length followed by that many chars
+  *   records: 'number of records' times a Record (16 bytes), oldest first
+  */
+class SchedulerTrace
+{
+public:
+	enum Type : uint8_t { SET = 's', REMOVE = 'r', REMOVE_ALL = 'a', EXECUTE = 'x' };
+
+	struct Record {
+		uint64_t time;   // EmuTime in ticks
+		uint32_t cost;   // host time of executeUntil() in ns (0 for others)
+		uint16_t device; // index in the device table
+		uint8_t type;    // one of the Type values
+		uint8_t pad;
+	};
+	static_assert(sizeof(Record) == 16, "must be packed");
+
+	explicit SchedulerTrace(size_t capacity);
+
+	/** Add an event to the trace. Returns a sequence number that can be
+	  * passed to setCost().
+	  */
+	uint64_t record(Type type, EmuTime::param time, const Schedulable& device)
+	{
+		Record& r = buffer[head];
+		r.time = (time - EmuTime::zero).length();
+		r.cost = 0;
+		r.device = getDeviceId(device);
+		r.type = type;
+		r.pad = 0;
+		if (++head == buffer.size()) head = 0;
+		return total++;
+	}
+
+	/** Set the cost of an earlier recorded EXECUTE event. The event is
+	  * recorded before executeUntil() is called (so that it comes before
+	  * the events that are triggered by executeUntil()), the cost is only
+	  * known afterwards.
+	  */
+	void setCost(uint64_t event, int64_t ns);
+
+	/** Number of records currently in the buffer. */
+	size_t size() const;
+	/** Total number of recorded events (including overwritten ones). */
+	uint64_t getTotal() const { return total; }
+	size_t getCapacity() const { return buffer.size(); }
+
+	void save(string_ref filename) const;
+
+private:
+	uint16_t getDeviceId(const Schedulable& device);
+
+	std::vector<Record> buffer;
+	std::vector<std::string> names;
+	hash_map<const Schedulable*, uint16_t> ids;
+	hash_map<std::string, unsigned> nameCount;
+	uint64_t total;
+	size_t head;
+};
+
+} // namespace openmsx
+
+#endif
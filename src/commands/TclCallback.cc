@@ -3,6 +3,7 @@
 #include "CliComm.hh"
 #include "CommandException.hh"
 #include "StringSetting.hh"
+#include "WorkerPool.hh"
 #include "memory.hh"
 #include <iostream>
 
@@ -95,6 +96,19 @@ TclObject TclCallback::execute(string_ref arg1, string_ref arg2)
 }
 
 TclObject TclCallback::executeCommon(TclObject& command)
+{
+	// Tcl can only be used from the main thread. A machine that runs in
+	// the background can call this from a worker thread (see
+	// Reactor::runBackgroundMachines()), then the main thread executes the
+	// callback while that machine waits.
+	TclObject result;
+	WorkerPool::runInCallerThread([&]() {
+		result = executeHelper(command);
+	});
+	return result;
+}
+
+TclObject TclCallback::executeHelper(TclObject& command)
 {
 	try {
 		return command.executeCommand(callbackSetting.getInterpreter());
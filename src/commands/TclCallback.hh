@@ -32,6 +32,7 @@ public:
 
 private:
 	TclObject executeCommon(TclObject& command);
+	TclObject executeHelper(TclObject& command);
 
 	std::unique_ptr<StringSetting> callbackSetting2; // can be nullptr
 	StringSetting& callbackSetting;
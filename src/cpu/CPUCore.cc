@@ -16,12 +16,13 @@
 //
 // It is possible to combine the speed of array accesses with the flexibility
 // of virtual methods. In openMSX it's implemened as follows: the 64kb address
-// space is divided in 256 regions of 256 bytes (called cacheLines in the code
-// below). For each such region we store a pointer, if this pointer is nullptr
-// then we have to use the slow way (=virtual method call). If it is not nullptr,
-// the pointer points to a block of memory that can be directly accessed. In
-// some contexts accesses via the pointer are known as backdoor accesses while
-// the accesses directly to the device are known as frontdoor accesses.
+// space is divided in regions of CacheLine::SIZE bytes (called cacheLines in
+// the code below). For each such region we store a pointer, if this pointer is
+// nullptr then we have to use the slow way (=virtual method call). If it is not
+// nullptr, the pointer points to a block of memory that can be directly
+// accessed. In some contexts accesses via the pointer are known as backdoor
+// accesses while the accesses directly to the device are known as frontdoor
+// accesses.
 //
 // We keep different pointers for read and write accesses. This allows to also
 // implement ROMs efficiently: read is handled as regular RAM, but writes end
@@ -280,12 +281,6 @@ static CONSTEXPR Table initTables()
 
 static CONSTEXPR Table table = initTables();
 
-// Global variable, because it should be shared between Z80 and R800.
-// It must not be shared between the CPUs of different MSX machines, but
-// the (logical) lifetime of this variable cannot overlap between execution
-// of two MSX machines.
-static word start_pc;
-
 // conditions
 struct CondC  { bool operator()(byte f) const { return  (f & C_FLAG) != 0; } };
 struct CondNC { bool operator()(byte f) const { return !(f & C_FLAG); } };
@@ -325,10 +320,18 @@ template<class T> CPUCore<T>::CPUCore(
 		"custom " + name + " frequency (only valid when unlocked)",
 		T::CLOCK_FREQ, 1000000, 1000000000)
 	, freq(T::CLOCK_FREQ)
+	, profileSetting(
+		motherboard.getCommandController(), name + "_profile",
+		"count executed " + name + " opcodes and uncached memory "
+		"accesses, see 'machine_info " + name + "_profile'",
+		false, Setting::DONT_SAVE)
+	, profiler(motherboard, name)
 	, NMIStatus(0)
 	, nmiEdge(false)
 	, exitLoop(false)
 	, tracingEnabled(traceSetting.getBoolean())
+	, start_pc(0)
+	, profilingEnabled(profileSetting.getBoolean())
 	, isTurboR(motherboard.isTurboR())
 {
 	static_assert(!std::is_polymorphic<CPUCore<T>>::value,
@@ -429,7 +432,7 @@ template<class T> void CPUCore<T>::exitCPULoopAsync()
 }
 template<class T> void CPUCore<T>::exitCPULoopSync()
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isMachineThread());
 	exitLoop = true;
 	T::disableLimit();
 }
@@ -561,6 +564,8 @@ template<class T> void CPUCore<T>::update(const Setting& setting)
 		doSetFreq();
 	} else if (&setting == &traceSetting) {
 		tracingEnabled = traceSetting.getBoolean();
+	} else if (&setting == &profileSetting) {
+		profilingEnabled = profileSetting.getBoolean();
 	}
 }
 
@@ -617,6 +622,7 @@ NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 	}
 	// uncacheable
 	readCacheTried[high] = true;
+	if (unlikely(profilingEnabled)) profiler.countSlowRead(address);
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
@@ -721,6 +727,7 @@ NEVER_INLINE void CPUCore<T>::WRMEMslow(unsigned address, byte value, unsigned c
 	}
 	// uncacheable
 	writeCacheTried[high] = true;
+	if (unlikely(profilingEnabled)) profiler.countSlowWrite(address);
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
@@ -912,6 +919,9 @@ void CPUCore<T>::executeInstructions()
 	T::add(ii.cycles); \
 	T::R800Refresh(*this); \
 	if (likely(!T::limitReached())) { \
+		if (unlikely(profilingEnabled)) { \
+			goto start; \
+		} \
 		incR(1); \
 		unsigned address = getPC(); \
 		const byte* line = readCacheLine[address >> CacheLine::BITS]; \
@@ -973,12 +983,13 @@ void CPUCore<T>::executeInstructions()
 
 #endif // USE_COMPUTED_GOTO
 
-#ifndef USE_COMPUTED_GOTO
 start:
-#endif
 	unsigned ixy; // for dd_cb/fd_cb
 	byte opcodeMain = RDMEM_OPCODE<0>(T::CC_MAIN);
 	incR(1);
+	if (unlikely(profilingEnabled)) {
+		profiler.countOpcode(CPUProfiler::MAIN, opcodeMain);
+	}
 #ifdef USE_COMPUTED_GOTO
 	goto *(opcodeTable[opcodeMain]);
 
@@ -1252,6 +1263,9 @@ CASE(CB) {
 	setPC(getPC() + 1); // M1 cycle at this point
 	byte cb_opcode = RDMEM_OPCODE<0>(T::CC_PREFIX);
 	incR(1);
+	if (unlikely(profilingEnabled)) {
+		profiler.countOpcode(CPUProfiler::CB, cb_opcode);
+	}
 	switch (cb_opcode) {
 		case 0x00: { II ii = rlc_R<B>(); NEXT; }
 		case 0x01: { II ii = rlc_R<C>(); NEXT; }
@@ -1519,6 +1533,9 @@ CASE(ED) {
 	setPC(getPC() + 1); // M1 cycle at this point
 	byte ed_opcode = RDMEM_OPCODE<0>(T::CC_PREFIX);
 	incR(1);
+	if (unlikely(profilingEnabled)) {
+		profiler.countOpcode(CPUProfiler::ED, ed_opcode);
+	}
 	switch (ed_opcode) {
 		case 0x00: case 0x01: case 0x02: case 0x03:
 		case 0x04: case 0x05: case 0x06: case 0x07:
@@ -1660,6 +1677,9 @@ CASE(DD) {
 	setPC(getPC() + 1); // M1 cycle at this point
 	byte opcodeDD = RDMEM_OPCODE<0>(T::CC_DD + T::CC_MAIN);
 	incR(1);
+	if (unlikely(profilingEnabled)) {
+		profiler.countOpcode(CPUProfiler::DDFD, opcodeDD);
+	}
 	switch (opcodeDD) {
 		case 0x00: // nop();
 		case 0x01: // ld_bc_word();
@@ -1945,6 +1965,9 @@ CASE(FD) {
 	setPC(getPC() + 1); // M1 cycle at this point
 	byte opcodeFD = RDMEM_OPCODE<0>(T::CC_DD + T::CC_MAIN);
 	incR(1);
+	if (unlikely(profilingEnabled)) {
+		profiler.countOpcode(CPUProfiler::DDFD, opcodeFD);
+	}
 	switch (opcodeFD) {
 		case 0x00: // nop();
 		case 0x01: // ld_bc_word();
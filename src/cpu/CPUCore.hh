@@ -3,6 +3,7 @@
 
 #include "CPURegs.hh"
 #include "CacheLine.hh"
+#include "CPUProfiler.hh"
 #include "Probe.hh"
 #include "EmuTime.hh"
 #include "BooleanSetting.hh"
@@ -143,6 +144,9 @@ private:
 	IntegerSetting freqValue;
 	unsigned freq;
 
+	BooleanSetting profileSetting;
+	CPUProfiler profiler;
+
 	// state machine variables
 	int slowInstructions;
 	int NMIStatus;
@@ -159,6 +163,15 @@ private:
 	/** In sync with traceSetting.getBoolean(). */
 	bool tracingEnabled;
 
+	/** Address of the instruction that is being traced, see cpuTracePre().
+	 * This is per instance: background machines can run in parallel (see
+	 * Reactor::runBackgroundMachines()).
+	 */
+	word start_pc;
+
+	/** In sync with profileSetting.getBoolean(). */
+	bool profilingEnabled;
+
 	/** 'normal' Z80 and Z80 in a turboR behave slightly different */
 	const bool isTurboR;
 
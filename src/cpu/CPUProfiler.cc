@@ -0,0 +1,123 @@
+#include "CPUProfiler.hh"
+#include "MSXMotherBoard.hh"
+#include "CommandException.hh"
+#include "TclObject.hh"
+#include "StringOp.hh"
+#include "outer.hh"
+#include <algorithm>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const char* const tableNames[CPUProfiler::NUM_TABLES] = {
+	"main", "cb", "ed", "ddfd", "slow_read", "slow_write"
+};
+
+CPUProfiler::CPUProfiler(MSXMotherBoard& motherBoard, const string& name)
+	: debuggable(motherBoard, name)
+	, profileInfo(motherBoard.getMachineInfoCommand(), name)
+{
+	reset();
+}
+
+void CPUProfiler::reset()
+{
+	memset(counters, 0, sizeof(counters));
+}
+
+
+// class Debuggable
+
+CPUProfiler::Debuggable::Debuggable(
+		MSXMotherBoard& motherBoard_, const string& name_)
+	: SimpleDebuggable(motherBoard_, name_ + " profile",
+		"Profile counters of the " + name_ + ", see the '" + name_ +
+		"_profile' setting. Contains 6 tables of 256 32-bit little "
+		"endian counters: executed opcodes in the main, CB, ED and "
+		"DD/FD opcode tables and the number of reads and writes per "
+		"256-byte memory region that couldn't use the memory cache.",
+		sizeof(counters))
+{
+}
+
+byte CPUProfiler::Debuggable::read(unsigned address)
+{
+	auto& profiler = OUTER(CPUProfiler, debuggable);
+	auto* counters = &profiler.counters[0][0];
+	return counters[address / 4] >> (8 * (address % 4));
+}
+
+void CPUProfiler::Debuggable::write(unsigned address, byte value)
+{
+	auto& profiler = OUTER(CPUProfiler, debuggable);
+	auto* counters = &profiler.counters[0][0];
+	unsigned shift = 8 * (address % 4);
+	uint32_t& counter = counters[address / 4];
+	counter = (counter & ~(0xFFu << shift)) | (value << shift);
+}
+
+
+// class ProfileInfo
+
+CPUProfiler::ProfileInfo::ProfileInfo(
+		InfoCommand& machineInfoCommand, const string& name_)
+	: InfoTopic(machineInfoCommand, name_ + "_profile")
+{
+}
+
+void CPUProfiler::ProfileInfo::execute(
+	array_ref<TclObject> tokens, TclObject& result) const
+{
+	auto& profiler = OUTER(CPUProfiler, profileInfo);
+	switch (tokens.size()) {
+	case 2:
+		// total per table
+		for (unsigned t = 0; t < NUM_TABLES; ++t) {
+			uint64_t total = 0;
+			for (auto& c : profiler.counters[t]) total += c;
+			result.addListElement(tableNames[t]);
+			result.addListElement(StringOp::toString(total));
+		}
+		break;
+	case 3: {
+		auto tableName = tokens[2].getString();
+		auto it = std::find(std::begin(tableNames), std::end(tableNames), tableName);
+		if (it == std::end(tableNames)) {
+			throw CommandException("Unknown table: " + tableName);
+		}
+		// all non-zero counters in this table
+		auto& table = profiler.counters[it - std::begin(tableNames)];
+		for (unsigned i = 0; i < TABLE_SIZE; ++i) {
+			if (table[i] == 0) continue;
+			result.addListElement(int(i));
+			result.addListElement(StringOp::toString(table[i]));
+		}
+		break;
+	}
+	default:
+		throw CommandException("Too many parameters");
+	}
+}
+
+string CPUProfiler::ProfileInfo::help(const vector<string>& /*tokens*/) const
+{
+	return "Shows the CPU profile counters (only counted while the "
+	       "corresponding '<cpu>_profile' setting is enabled).\n"
+	       "Without argument returns the total count per table. With a "
+	       "table name returns index/count pairs for all non-zero "
+	       "counters in that table.\n"
+	       "Tables main, cb, ed and ddfd are indexed by opcode, tables "
+	       "slow_read and slow_write by the high byte of the address.\n";
+}
+
+void CPUProfiler::ProfileInfo::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 3) {
+		completeString(tokens, tableNames);
+	}
+}
+
+} // namespace openmsx
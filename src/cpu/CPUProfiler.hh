@@ -0,0 +1,62 @@
+#ifndef CPUPROFILER_HH
+#define CPUPROFILER_HH
+
+#include "InfoTopic.hh"
+#include "SimpleDebuggable.hh"
+#include "openmsx.hh"
+#include <cstdint>
+#include <string>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+
+/** Exact counters on where the CPU spends its time: the number of executed
+  * opcodes per opcode table and the number of memory accesses per 256-byte
+  * region that couldn't be handled via the read/write cache
+  * (RDMEMslow/WRMEMslow).
+  * Counting only happens while the '<cpu>_profile' setting is enabled.
+  * The counters are visible via the '<cpu> profile' debuggable and via
+  * the 'machine_info <cpu>_profile' topic.
+  */
+class CPUProfiler
+{
+public:
+	enum Table { MAIN, CB, ED, DDFD, SLOW_READ, SLOW_WRITE, NUM_TABLES };
+	static const unsigned TABLE_SIZE = 256;
+
+	CPUProfiler(MSXMotherBoard& motherBoard, const std::string& name);
+
+	void countOpcode(Table table, byte opcode) {
+		++counters[table][opcode];
+	}
+	void countSlowRead(unsigned address) {
+		++counters[SLOW_READ][address >> 8];
+	}
+	void countSlowWrite(unsigned address) {
+		++counters[SLOW_WRITE][address >> 8];
+	}
+	void reset();
+
+private:
+	uint32_t counters[NUM_TABLES][TABLE_SIZE];
+
+	struct Debuggable final : SimpleDebuggable {
+		Debuggable(MSXMotherBoard& motherBoard, const std::string& name);
+		byte read(unsigned address) override;
+		void write(unsigned address, byte value) override;
+	} debuggable;
+
+	struct ProfileInfo final : InfoTopic {
+		ProfileInfo(InfoCommand& machineInfoCommand,
+		            const std::string& name);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) const override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} profileInfo;
+};
+
+} // namespace openmsx
+
+#endif
@@ -4,7 +4,11 @@
 namespace openmsx {
 namespace CacheLine {
 
-static const unsigned BITS = 8; // 256 bytes
+// The 64kB address space is divided in NUM regions of SIZE bytes. Small lines
+// mean that a memory mapped register (or a watchpoint) only makes a small
+// region around it uncacheable. Large lines mean fewer lines to (re)fill after
+// the cache is invalidated (e.g. on slot or bank switches).
+static const unsigned BITS = 6; // 64 bytes
 static const unsigned SIZE = 1 << BITS;
 static const unsigned NUM  = 0x10000 / SIZE;
 static const unsigned LOW  = SIZE - 1;
@@ -52,9 +52,11 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 
 	z80->freqLocked.attach(*this);
 	z80->freqValue.attach(*this);
+	z80->profileSetting.attach(*this);
 	if (r800) {
 		r800->freqLocked.attach(*this);
 		r800->freqValue.attach(*this);
+		r800->profileSetting.attach(*this);
 	}
 }
 
@@ -63,9 +65,11 @@ MSXCPU::~MSXCPU()
 	traceSetting.detach(*this);
 	z80->freqLocked.detach(*this);
 	z80->freqValue.detach(*this);
+	z80->profileSetting.detach(*this);
 	if (r800) {
 		r800->freqLocked.detach(*this);
 		r800->freqValue.detach(*this);
+		r800->profileSetting.detach(*this);
 	}
 	motherboard.getScheduler().setCPU(nullptr);
 	motherboard.getDebugger() .setCPU(nullptr);
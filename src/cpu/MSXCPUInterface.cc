@@ -299,14 +299,15 @@ void MSXCPUInterface::unsetExpanded(int ps)
 
 void MSXCPUInterface::changeExpanded(bool newExpanded)
 {
+	const unsigned line = 0xFFFF >> CacheLine::BITS;
 	if (newExpanded) {
-		disallowReadCache [0xFF] |=  SECONDARY_SLOT_BIT;
-		disallowWriteCache[0xFF] |=  SECONDARY_SLOT_BIT;
+		disallowReadCache [line] |=  SECONDARY_SLOT_BIT;
+		disallowWriteCache[line] |=  SECONDARY_SLOT_BIT;
 	} else {
-		disallowReadCache [0xFF] &= ~SECONDARY_SLOT_BIT;
-		disallowWriteCache[0xFF] &= ~SECONDARY_SLOT_BIT;
+		disallowReadCache [line] &= ~SECONDARY_SLOT_BIT;
+		disallowWriteCache[line] &= ~SECONDARY_SLOT_BIT;
 	}
-	msxcpu.invalidateMemCache(0xFFFF & CacheLine::HIGH, 0x100);
+	msxcpu.invalidateMemCache(0xFFFF & CacheLine::HIGH, CacheLine::SIZE);
 }
 
 MSXDevice*& MSXCPUInterface::getDevicePtr(byte port, bool isIn)
@@ -542,7 +543,7 @@ void MSXCPUInterface::registerGlobalWrite(MSXDevice& device, word address)
 	globalWrites.push_back({&device, address});
 
 	disallowWriteCache[address >> CacheLine::BITS] |= GLOBAL_RW_BIT;
-	msxcpu.invalidateMemCache(address & CacheLine::HIGH, 0x100);
+	msxcpu.invalidateMemCache(address & CacheLine::HIGH, CacheLine::SIZE);
 }
 
 void MSXCPUInterface::unregisterGlobalWrite(MSXDevice& device, word address)
@@ -558,7 +559,7 @@ void MSXCPUInterface::unregisterGlobalWrite(MSXDevice& device, word address)
 		}
 	}
 	disallowWriteCache[address >> CacheLine::BITS] &= ~GLOBAL_RW_BIT;
-	msxcpu.invalidateMemCache(address & CacheLine::HIGH, 0x100);
+	msxcpu.invalidateMemCache(address & CacheLine::HIGH, CacheLine::SIZE);
 }
 
 void MSXCPUInterface::registerGlobalRead(MSXDevice& device, word address)
@@ -566,7 +567,7 @@ void MSXCPUInterface::registerGlobalRead(MSXDevice& device, word address)
 	globalReads.push_back({&device, address});
 
 	disallowReadCache[address >> CacheLine::BITS] |= GLOBAL_RW_BIT;
-	msxcpu.invalidateMemCache(address & CacheLine::HIGH, 0x100);
+	msxcpu.invalidateMemCache(address & CacheLine::HIGH, CacheLine::SIZE);
 }
 
 void MSXCPUInterface::unregisterGlobalRead(MSXDevice& device, word address)
@@ -582,7 +583,7 @@ void MSXCPUInterface::unregisterGlobalRead(MSXDevice& device, word address)
 		}
 	}
 	disallowReadCache[address >> CacheLine::BITS] &= ~GLOBAL_RW_BIT;
-	msxcpu.invalidateMemCache(address & CacheLine::HIGH, 0x100);
+	msxcpu.invalidateMemCache(address & CacheLine::HIGH, CacheLine::SIZE);
 }
 
 ALWAYS_INLINE void MSXCPUInterface::updateVisible(int page, int ps, int ss)
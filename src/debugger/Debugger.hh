@@ -37,6 +37,7 @@ public:
 	ProbeBase* findProbe(string_ref name);
 
 	void removeProbeBreakPoint(ProbeBreakPoint& bp);
+	bool hasProbeBreakPoints() const { return !probeBreakPoints.empty(); }
 	void setCPU(MSXCPU* cpu_) { cpu = cpu_; }
 
 	void transfer(Debugger& other);
@@ -1,17 +1,24 @@
 #include "MSXCliComm.hh"
 #include "GlobalCliComm.hh"
 #include "MSXMotherBoard.hh"
+#include "Thread.hh"
+#include <cassert>
 
 namespace openmsx {
 
 MSXCliComm::MSXCliComm(MSXMotherBoard& motherBoard_, GlobalCliComm& cliComm_)
 	: motherBoard(motherBoard_)
 	, cliComm(cliComm_)
+	, deferring(false)
 {
 }
 
 void MSXCliComm::log(LogLevel level, string_ref message)
 {
+	if (deferring) {
+		deferred.push_back({true, level, NUM_UPDATES, message.str(), {}});
+		return;
+	}
 	cliComm.log(level, message);
 }
 
@@ -27,7 +34,29 @@ void MSXCliComm::update(UpdateType type, string_ref name, string_ref value)
 	} else {
 		prevValues[type].emplace_noDuplicateCheck(name.str(), value.str());
 	}
+	if (deferring) {
+		deferred.push_back({false, INFO, type, name.str(), value.str()});
+		return;
+	}
 	cliComm.updateHelper(type, motherBoard.getMachineID(), name, value);
 }
 
+void MSXCliComm::setDeferring(bool deferring_)
+{
+	deferring = deferring_;
+	if (deferring) return;
+
+	assert(Thread::isMainThread());
+	auto tmp = std::move(deferred);
+	deferred.clear();
+	for (auto& d : tmp) {
+		if (d.isLog) {
+			cliComm.log(d.level, d.name);
+		} else {
+			cliComm.updateHelper(d.type, motherBoard.getMachineID(),
+			                     d.name, d.value);
+		}
+	}
+}
+
 } // namespace openmsx
@@ -4,6 +4,8 @@
 #include "CliComm.hh"
 #include "hash_map.hh"
 #include "xxhash.hh"
+#include <string>
+#include <vector>
 
 namespace openmsx {
 
@@ -19,10 +21,28 @@ public:
 	void update(UpdateType type, string_ref name,
 	            string_ref value) override;
 
+	/** While the machine runs in a worker thread (see
+	  * MSXMotherBoard::executeInWorker()), messages are queued instead
+	  * of delivered. Switching deferring off delivers the queued
+	  * messages, this must be done from the main thread.
+	  */
+	void setDeferring(bool deferring);
+	bool isDeferring() const { return deferring; }
+
 private:
+	struct Deferred {
+		bool isLog;
+		LogLevel level;
+		UpdateType type;
+		std::string name; // or message for log
+		std::string value;
+	};
+
 	MSXMotherBoard& motherBoard;
 	GlobalCliComm& cliComm;
 	hash_map<std::string, std::string, XXHasher> prevValues[NUM_UPDATES];
+	std::vector<Deferred> deferred;
+	bool deferring;
 };
 
 } // namespace openmsx
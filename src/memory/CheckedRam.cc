@@ -4,6 +4,7 @@
 #include "DeviceConfig.hh"
 #include "GlobalSettings.hh"
 #include "StringSetting.hh"
+#include "serialize.hh"
 #include "likely.hh"
 #include <cassert>
 
@@ -52,8 +53,12 @@ const byte* CheckedRam::getReadCacheLine(unsigned addr) const
 
 byte* CheckedRam::getWriteCacheLine(unsigned addr) const
 {
+	// The CPU writes via this pointer without further notice, so the
+	// line is marked dirty now and the cache is invalidated after each
+	// reverse snapshot (see serialize()).
 	return (completely_initialized_cacheline[addr >> CacheLine::BITS])
-	     ? const_cast<byte*>(&ram[addr]) : nullptr;
+	     ? const_cast<TrackedRam&>(ram).getWriteBackdoor(addr, CacheLine::SIZE)
+	     : nullptr;
 }
 
 void CheckedRam::write(unsigned addr, const byte value)
@@ -67,7 +72,7 @@ void CheckedRam::write(unsigned addr, const byte value)
 			                          CacheLine::SIZE);
 		}
 	}
-	ram[addr] = value;
+	ram.write(addr, value);
 }
 
 void CheckedRam::clear()
@@ -102,4 +107,15 @@ void CheckedRam::update(const Setting& setting)
 	init();
 }
 
+template<typename Archive>
+void CheckedRam::serialize(Archive& ar, unsigned version)
+{
+	ram.serialize(ar, version);
+	if (ar.isReverseSnapshot()) {
+		// Start tracking the CPU writes via write cache lines again.
+		msxcpu.invalidateMemCache(0, 0x10000);
+	}
+}
+INSTANTIATE_SERIALIZE_METHODS(CheckedRam);
+
 } // namespace openmsx
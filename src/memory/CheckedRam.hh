@@ -1,7 +1,7 @@
 #ifndef CHECKEDRAM_HH
 #define CHECKEDRAM_HH
 
-#include "Ram.hh"
+#include "TrackedRam.hh"
 #include "TclCallback.hh"
 #include "CacheLine.hh"
 #include "Observer.hh"
@@ -47,11 +47,14 @@ public:
 	 * consistently, so that the initialized-administration will be always
 	 * up to date!
 	 */
-	Ram& getUncheckedRam() { return ram; }
+	TrackedRam& getUncheckedRam() { return ram; }
 
-	// TODO
-	//template<typename Archive>
-	//void serialize(Archive& ar, unsigned version);
+	/**
+	 * Only the ram content is serialized (in the same format as Ram), not
+	 * the initialized-administration.
+	 */
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
 
 private:
 	void init();
@@ -61,7 +64,7 @@ private:
 
 	std::vector<bool> completely_initialized_cacheline;
 	std::vector<std::bitset<CacheLine::SIZE>> uninitialized;
-	Ram ram;
+	TrackedRam ram;
 	MSXCPU& msxcpu;
 	TclCallback umrCallback;
 };
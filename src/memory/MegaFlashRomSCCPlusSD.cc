@@ -912,8 +912,7 @@ void MegaFlashRomSCCPlusSD::serialize(Archive& ar, unsigned /*version*/)
 	}
 
 	// subslot 2 stuff
-	// TODO ar.serialize("checkedRam", checkedRam);
-	if (checkedRam) ar.serialize("ram", checkedRam->getUncheckedRam());
+	if (checkedRam) ar.serialize("ram", *checkedRam);
 	ar.serialize("memMapperRegs", memMapperRegs);
 
 	// subslot 3 stuff
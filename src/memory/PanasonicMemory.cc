@@ -1,8 +1,9 @@
 #include "PanasonicMemory.hh"
 #include "MSXMotherBoard.hh"
 #include "MSXCPU.hh"
-#include "Ram.hh"
 #include "Rom.hh"
+#include "TrackedRam.hh"
+#include "CacheLine.hh"
 #include "DeviceConfig.hh"
 #include "HardwareConfig.hh"
 #include "XMLElement.hh"
@@ -34,9 +35,9 @@ PanasonicMemory::PanasonicMemory(MSXMotherBoard& motherBoard)
 
 PanasonicMemory::~PanasonicMemory() = default;
 
-void PanasonicMemory::registerRam(Ram& ram_)
+void PanasonicMemory::registerRam(TrackedRam& ram_)
 {
-	ram = &ram_[0];
+	ram = &ram_;
 	ramSize = ram_.getSize();
 }
 
@@ -52,7 +53,7 @@ const byte* PanasonicMemory::getRomBlock(unsigned block)
 		unsigned offset = (block & 0x03) * 0x2000;
 		unsigned ramOffset = (block < 0x30) ? ramSize - 0x10000 :
 		                                      ramSize - 0x08000;
-		return ram + ramOffset + offset;
+		return &(*ram)[ramOffset + offset];
 	} else {
 		unsigned offset = block * 0x2000;
 		if (offset >= rom->getSize()) {
@@ -84,15 +85,32 @@ const byte* PanasonicMemory::getRomRange(unsigned first, unsigned last)
 	return &(*rom)[start];
 }
 
-byte* PanasonicMemory::getRamBlock(unsigned block)
+unsigned PanasonicMemory::getRamOffset(unsigned block) const
 {
-	if (!ram) return nullptr;
-
 	unsigned offset = block * 0x2000;
 	if (offset >= ramSize) {
 		offset &= ramSize - 1;
 	}
-	return ram + offset;
+	return offset;
+}
+
+const byte* PanasonicMemory::getRamBlock(unsigned block) const
+{
+	if (!ram) return nullptr;
+	return &(*ram)[getRamOffset(block)];
+}
+
+void PanasonicMemory::writeRam(unsigned block, unsigned offset, byte value)
+{
+	assert(ram);
+	ram->write(getRamOffset(block) + offset, value);
+}
+
+byte* PanasonicMemory::getRamWriteCacheLine(unsigned block, unsigned offset)
+{
+	assert(ram);
+	return ram->getWriteBackdoor(getRamOffset(block) + offset,
+	                             CacheLine::SIZE);
 }
 
 void PanasonicMemory::setDRAM(bool dram_)
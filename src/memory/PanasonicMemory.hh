@@ -8,8 +8,8 @@ namespace openmsx {
 
 class MSXMotherBoard;
 class MSXCPU;
-class Ram;
 class Rom;
+class TrackedRam;
 
 class PanasonicMemory
 {
@@ -21,23 +21,32 @@ public:
 	 * Pass reference of the actual Ram block for use in DRAM mode and RAM
 	 * access via the ROM mapper. Note that this is always unchecked Ram!
 	 */
-	void registerRam(Ram& ram);
+	void registerRam(TrackedRam& ram);
 	const byte* getRomBlock(unsigned block);
 	const byte* getRomRange(unsigned first, unsigned last);
 	/**
 	 * Note that this is always unchecked RAM! There is no UMR detection
 	 * when accessing Ram in DRAM mode or via the ROM mapper!
 	 */
-	byte* getRamBlock(unsigned block);
+	const byte* getRamBlock(unsigned block) const;
 	unsigned getRamSize() const { return ramSize; }
+	/**
+	 * Write access to a block returned by getRamBlock(). These keep the
+	 * dirty pages of the Ram up to date (see TrackedRam), so all writes
+	 * must go via these methods.
+	 */
+	void writeRam(unsigned block, unsigned offset, byte value);
+	byte* getRamWriteCacheLine(unsigned block, unsigned offset);
 	void setDRAM(bool dram);
 	bool isWritable(unsigned address) const;
 
 private:
+	unsigned getRamOffset(unsigned block) const;
+
 	MSXCPU& msxcpu;
 
 	const std::unique_ptr<Rom> rom; // can be nullptr
-	byte* ram;
+	TrackedRam* ram;
 	unsigned ramSize;
 	bool dram;
 };
@@ -1,5 +1,4 @@
 #include "RomMitsubishiMLTS2.hh"
-#include "CacheLine.hh"
 #include "serialize.hh"
 
 #include <iostream>
@@ -68,7 +67,8 @@ byte RomMitsubishiMLTS2::peekMem(word address, EmuTime::param time) const
 
 const byte* RomMitsubishiMLTS2::getReadCacheLine(word address) const
 {
-	if (address == (0x7FC0 & CacheLine::HIGH)) return nullptr;
+	// registers at 0x7F00-0x7F03 and 0x7FC0
+	if ((0x7F00 <= address) && (address < 0x8000)) return nullptr;
 	if ((0x6000 <= address) && (address < 0x8000)) {
                 return &ram[address & 0x1FFF];
 	}
@@ -77,7 +77,8 @@ const byte* RomMitsubishiMLTS2::getReadCacheLine(word address) const
 
 byte* RomMitsubishiMLTS2::getWriteCacheLine(word address) const
 {
-	if (address == (0x7FC0 & CacheLine::HIGH)) return nullptr;
+	// registers at 0x7F00-0x7F03 and 0x7FC0
+	if ((0x7F00 <= address) && (address < 0x8000)) return nullptr;
 	if ((0x6000 <= address) && (address < 0x8000)) {
                 return const_cast<byte*>(&ram[address & 0x1FFF]);
 	}
@@ -122,7 +122,8 @@ void RomPanasonic::writeMem(word address, byte value, EmuTime::param /*time*/)
 			sram->write((block * 0x2000) | (address & 0x1FFF), value);
 		} else if (RAM_BASE <= selectedBank) {
 			// RAM
-			const_cast<byte*>(bankPtr[region])[address & 0x1FFF] = value;
+			panasonicMem.writeRam(selectedBank - RAM_BASE,
+			                      address & 0x1FFF, value);
 		}
 	}
 }
@@ -141,7 +142,8 @@ byte* RomPanasonic::getWriteCacheLine(word address) const
 			return nullptr;
 		} else if (RAM_BASE <= selectedBank) {
 			// RAM
-			return const_cast<byte*>(&bankPtr[region][address & 0x1FFF]);
+			return panasonicMem.getRamWriteCacheLine(
+				selectedBank - RAM_BASE, address & 0x1FFF);
 		} else {
 			return unmappedWrite;
 		}
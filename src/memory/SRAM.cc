@@ -79,7 +79,7 @@ void SRAM::memset(unsigned addr, byte c, unsigned size)
 		schedulable->scheduleRT(5000000); // sync to disk after 5s
 	}
 	assert((addr + size) <= getSize());
-	::memset(ram.getWriteBackdoor() + addr, c, size);
+	::memset(ram.getWriteBackdoor(addr, size), c, size);
 }
 
 void SRAM::load(bool* loaded)
@@ -9,9 +9,21 @@ void TrackedRam::serialize(Archive& ar, unsigned /*version*/)
 	// Note: This is the exact same serialization format as the Ram class.
 	//  This allows to change from Ram to TrackedRam without having to
 	//  increase the class serialization version (of the user).
-	bool diff = writeSinceLastReverseSnapshot || !ar.isReverseSnapshot();
-	ar.serialize_blob("ram", &ram[0], getSize(), diff);
-	if (ar.isReverseSnapshot()) writeSinceLastReverseSnapshot = false;
+	if (!ar.isReverseSnapshot()) {
+		ar.serialize_blob("ram", &ram[0], getSize());
+		if (ar.isLoader()) {
+			writeSinceLastReverseSnapshot = true;
+			dirty.markAll();
+		}
+	} else if (!writeSinceLastReverseSnapshot) {
+		ar.serialize_blob("ram", &ram[0], getSize(), false);
+	} else {
+		// Only the dirty pages have to be compared against the
+		// previous snapshot.
+		ar.serialize_blob("ram", &ram[0], getSize(), dirty);
+		writeSinceLastReverseSnapshot = false;
+		dirty.clear();
+	}
 }
 INSTANTIATE_SERIALIZE_METHODS(TrackedRam);
 
@@ -2,6 +2,7 @@
 #define TRACKED_RAM_HH
 
 #include "Ram.hh"
+#include "DirtyPages.hh"
 
 namespace openmsx {
 
@@ -12,10 +13,10 @@ public:
 	// Most methods simply delegate to the internal 'ram' object.
 	TrackedRam(const DeviceConfig& config, const std::string& name,
 	           const std::string& description, unsigned size)
-		: ram(config, name, description, size) {}
+		: ram(config, name, description, size), dirty(size) {}
 
 	TrackedRam(const XMLElement& xml, unsigned size)
-		: ram(xml, size) {}
+		: ram(xml, size), dirty(size) {}
 
 	unsigned getSize() const {
 		return ram.getSize();
@@ -37,11 +38,13 @@ public:
 	// Only allow write/clear via an explicit method.
 	void write(unsigned addr, byte value) {
 		writeSinceLastReverseSnapshot = true;
+		dirty.mark(addr);
 		ram[addr] = value;
 	}
 
 	void clear(byte c = 0xff) {
 		writeSinceLastReverseSnapshot = true;
+		dirty.markAll();
 		ram.clear(c);
 	}
 
@@ -51,14 +54,26 @@ public:
 	// should not be reused for multiple (distinct) bulk write operations.
 	byte* getWriteBackdoor() {
 		writeSinceLastReverseSnapshot = true;
+		dirty.markAll();
 		return &ram[0];
 	}
 
+	// Same as above, but only marks the range [addr, addr + size) as
+	// dirty. The returned pointer points to 'addr' and may only be used
+	// to write within this range.
+	byte* getWriteBackdoor(unsigned addr, unsigned size) {
+		assert((addr + size) <= getSize());
+		writeSinceLastReverseSnapshot = true;
+		dirty.mark(addr, size);
+		return &ram[addr];
+	}
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
 private:
 	Ram ram;
+	DirtyPages dirty; // pages written since last reverse snapshot
 	bool writeSinceLastReverseSnapshot = true;
 };
 
@@ -233,6 +233,20 @@ void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len,
 
 }
 
+void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len,
+                                      const DirtyPages& dirty)
+{
+	if (len > SMALL_SIZE) {
+		unsigned deltaBlockIdx = unsigned(deltaBlocks.size());
+		save(deltaBlockIdx);
+		deltaBlocks.push_back(lastDeltaBlocks.createNew(
+			data, static_cast<const uint8_t*>(data), len, &dirty));
+	} else {
+		byte* buf = buffer.allocate(len);
+		memcpy(buf, data, len);
+	}
+}
+
 void MemInputArchive::serialize_blob(const char*, void* data, size_t len, bool /*diff*/)
 {
 	if (len > SMALL_SIZE) {
@@ -22,6 +22,7 @@ namespace openmsx {
 
 class LastDeltaBlocks;
 class DeltaBlock;
+class DirtyPages;
 
 template<typename T> struct SerializeClassVersion;
 
@@ -135,6 +136,14 @@ public:
 	//   type).
 	//
 	//
+	// void serialize_blob(const char* tag, const void* data, size_t len,
+	//                     const DirtyPages& dirty)
+	//
+	//   Same as above, but additionally indicates which pages of the blob
+	//   were modified since the previous (reverse) snapshot. In-memory
+	//   archives use this to only compare those pages.
+	//
+	//
 	// template<typename T> void serialize(const char* tag, const T& t)
 	//
 	//   This is much like the serializeWithID() method above, but it doesn't
@@ -439,6 +448,13 @@ public:
 	// the resulting string. But memory archives will memcpy the blob.
 	void serialize_blob(const char* tag, const void* data, size_t len,
 	                    bool diff = true);
+	// Only memory archives can make use of the dirty page information,
+	// all other archives serialize the full blob.
+	void serialize_blob(const char* tag, const void* data, size_t len,
+	                    const DirtyPages& /*dirty*/)
+	{
+		this->self().serialize_blob(tag, data, len);
+	}
 
 	template<typename T> void serialize(const char* tag, const T& t)
 	{
@@ -534,6 +550,11 @@ public:
 	}
 	void serialize_blob(const char* tag, void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char* tag, void* data, size_t len,
+	                    const DirtyPages& /*dirty*/)
+	{
+		this->self().serialize_blob(tag, data, len);
+	}
 
 	template<typename T>
 	void serialize(const char* tag, T& t)
@@ -624,6 +645,8 @@ public:
 	void save(const std::string& s);
 	void serialize_blob(const char*, const void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char*, const void* data, size_t len,
+	                    const DirtyPages& dirty);
 
 	void beginSection()
 	{
@@ -692,6 +715,11 @@ public:
 	string_ref loadStr();
 	void serialize_blob(const char*, void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char* tag, void* data, size_t len,
+	                    const DirtyPages& /*dirty*/)
+	{
+		serialize_blob(tag, data, len);
+	}
 
 	void skipSection(bool skip)
 	{
@@ -30,6 +30,10 @@ public:
 	template <unsigned PITCH>
 	bool readSamples(int* dest, unsigned samples);
 
+	// Will readSamples() return false (without changing the state) until
+	// the next call to addDelta()?
+	bool isSilent() const { return (availSamp <= 0) && (accum == 0); }
+
 private:
 	template <unsigned PITCH>
 	void readSamplesHelper(int* out, unsigned samples) __restrict;
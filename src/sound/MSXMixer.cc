@@ -1,5 +1,6 @@
 #include "MSXMixer.hh"
 #include "Mixer.hh"
+#include "MixKernels.hh"
 #include "SoundDevice.hh"
 #include "MSXMotherBoard.hh"
 #include "MSXCommandController.hh"
@@ -13,6 +14,8 @@
 #include "AviRecorder.hh"
 #include "Filename.hh"
 #include "CliComm.hh"
+#include "Thread.hh"
+#include "WorkerPool.hh"
 #include "Math.hh"
 #include "StringOp.hh"
 #include "memory.hh"
@@ -49,6 +52,7 @@ MSXMixer::MSXMixer(Mixer& mixer_, MSXMotherBoard& motherBoard_,
 	, soundDeviceInfo(commandController.getMachineInfoCommand())
 	, recorder(nullptr)
 	, synchronousCounter(0)
+	, deviceBufSize(0)
 {
 	hostSampleRate = 44100;
 	fragmentSize = 0;
@@ -172,7 +176,9 @@ void MSXMixer::updateStream(EmuTime::param time)
 	unsigned count = prevTime.getTicksTill(time);
 	assert(count <= 8192);
 
-	// call generate() even if count==0 and even if muted
+	// call generate() even if count==0 and even if muted (e.g. in batch
+	// mode): the sound devices must still be updated because some of them
+	// (e.g. VLM5030::getBSY()) depend on that for state visible to the MSX
 	generate(mixBuffer, time, count);
 
 	if (!muteCount && fragmentSize) {
@@ -187,153 +193,6 @@ void MSXMixer::updateStream(EmuTime::param time)
 }
 
 
-// Various (inner) loops that multiply one buffer by a constant and add the
-// result to a second buffer. Either buffer can be mono or stereo, so if
-// necessary the mono buffer is expanded to stereo. It's possible the
-// accumulation buffer is still empty (as-if it contains zeros), in that case
-// we skip the accumulation step.
-
-// buf[0:n] *= f
-static inline void mul(int32_t* buf, int n, int f)
-{
-#ifdef __arm__
-	// ARM assembly version
-	int32_t dummy1, dummy2;
-	asm volatile (
-	"0:\n\t"
-		"ldmia	%[buf],{r3-r6}\n\t"
-		"mul	r3,%[f],r3\n\t"
-		"mul	r4,%[f],r4\n\t"
-		"mul	r5,%[f],r5\n\t"
-		"mul	r6,%[f],r6\n\t"
-		"stmia	%[buf]!,{r3-r6}\n\t"
-		"subs	%[n],%[n],#4\n\t"
-		"bgt	0b\n\t"
-		: [buf] "=r"    (dummy1)
-		, [n]   "=r"    (dummy2)
-		:       "[buf]" (buf)
-		,       "[n]"   (n)
-		, [f]   "r"     (f)
-		: "memory", "r3","r4","r5","r6"
-	);
-	return;
-#endif
-
-	// C++ version, unrolled 4x,
-	//   this allows gcc/clang to do much better auto-vectorization
-	// Note that this can process upto 3 samples too many, but that's OK.
-	assume_SSE_aligned(buf);
-	int i = 0;
-	do {
-		buf[i + 0] *= f;
-		buf[i + 1] *= f;
-		buf[i + 2] *= f;
-		buf[i + 3] *= f;
-		i += 4;
-	} while (i < n);
-}
-
-// acc[0:n] += mul[0:n] * f
-static inline void mulAcc(
-	int32_t* __restrict acc, const int32_t* __restrict mul, int n, int f)
-{
-#ifdef __arm__
-	// ARM assembly version
-	int32_t dummy1, dummy2, dummy3;
-	asm volatile (
-	"0:\n\t"
-		"ldmia	%[in]!,{r3,r4,r5,r6}\n\t"
-		"ldmia	%[out],{r8,r9,r10,r12}\n\t"
-		"mla	r3,%[f],r3,r8\n\t"
-		"mla	r4,%[f],r4,r9\n\t"
-		"mla	r5,%[f],r5,r10\n\t"
-		"mla	r6,%[f],r6,r12\n\t"
-		"stmia	%[out]!,{r3,r4,r5,r6}\n\t"
-		"subs	%[n],%[n],#4\n\t"
-		"bgt	0b\n\t"
-		: [in]  "=r"    (dummy1)
-		, [out] "=r"    (dummy2)
-		, [n]   "=r"    (dummy3)
-		:       "[in]"  (mul)
-		,       "[out]" (acc)
-		,       "[n]"   (n)
-		, [f]   "r"     (f)
-		: "memory"
-		, "r3","r4","r5","r6"
-		, "r8","r9","r10","r12"
-	);
-	return;
-#endif
-
-	// C++ version, unrolled 4x, see comments above.
-	assume_SSE_aligned(acc);
-	assume_SSE_aligned(mul);
-	int i = 0;
-	do {
-		acc[i + 0] += mul[i + 0] * f;
-		acc[i + 1] += mul[i + 1] * f;
-		acc[i + 2] += mul[i + 2] * f;
-		acc[i + 3] += mul[i + 3] * f;
-		i += 4;
-	} while (i < n);
-}
-
-// buf[0:2n+0:2] = buf[0:n] * l
-// buf[1:2n+1:2] = buf[0:n] * r
-static inline void mulExpand(int32_t* buf, int n, int l, int r)
-{
-	int i = n;
-	do {
-		--i; // back-to-front
-		auto t = buf[i];
-		buf[2 * i + 0] = l * t;
-		buf[2 * i + 1] = r * t;
-	} while (i != 0);
-}
-
-// acc[0:2n+0:2] += mul[0:n] * l
-// acc[1:2n+1:2] += mul[0:n] * r
-static inline void mulExpandAcc(
-	int32_t* __restrict acc, const int32_t* __restrict mul, int n,
-	int l, int r)
-{
-	int i = 0;
-	do {
-		auto t = mul[i];
-		acc[2 * i + 0] += l * t;
-		acc[2 * i + 1] += r * t;
-	} while (++i < n);
-}
-
-// buf[0:2n+0:2] = buf[0:2n+0:2] * l1 + buf[1:2n+1:2] * l2
-// buf[1:2n+1:2] = buf[0:2n+0:2] * r1 + buf[1:2n+1:2] * r2
-static inline void mulMix2(int32_t* buf, int n, int l1, int l2, int r1, int r2)
-{
-	int i = 0;
-	do {
-		auto t1 = buf[2 * i + 0];
-		auto t2 = buf[2 * i + 1];
-		buf[2 * i + 0] = l1 * t1 + l2 * t2;
-		buf[2 * i + 1] = r1 * t1 + r2 * t2;
-	} while (++i < n);
-}
-
-// acc[0:2n+0:2] += mul[0:2n+0:2] * l1 + mul[1:2n+1:2] * l2
-// acc[1:2n+1:2] += mul[0:2n+0:2] * r1 + mul[1:2n+1:2] * r2
-static inline void mulMix2Acc(
-	int32_t* __restrict acc, const int32_t* __restrict mul, int n,
-	int l1, int l2, int r1, int r2)
-{
-	int i = 0;
-	do {
-		auto t1 = mul[2 * i + 0];
-		auto t2 = mul[2 * i + 1];
-		acc[2 * i + 0] += l1 * t1 + l2 * t2;
-		acc[2 * i + 1] += r1 * t1 + r2 * t2;
-	} while (++i < n);
-}
-
-
 // DC removal filter routines:
 //
 //  formula:
@@ -472,7 +331,7 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 	if (samples == 0) {
 		SSE_ALIGNED(int32_t dummyBuf[4]);
 		for (auto& info : infos) {
-			info.device->updateBuffer(0, dummyBuf, time);
+			updateDevice(info, 0, dummyBuf, time);
 		}
 		return;
 	}
@@ -488,33 +347,65 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 	static const unsigned HAS_STEREO_FLAG = 2;
 	unsigned usedBuffers = 0;
 
+	// When allowed by the 'sound_threads' setting, first all devices
+	// calculate their output in parallel (each in a buffer of its own).
+	// The mixing below is always done in the same order and with the
+	// same operations, so the result is exactly the same as when the
+	// devices are calculated one after the other.
+	unsigned stride = (2 * samples + 3 + 3) & ~3; // keep each part aligned
+	VLA(bool, rendered, infos.size());
+	bool parallel = renderParallel(time, samples, stride, rendered);
+
+	// Get the output of device 'i' in 'buf'. Returns false when the device
+	// didn't produce any sound.
+	auto render = [&](unsigned i, int32_t* buf) {
+		if (!parallel) {
+			return updateDevice(infos[i], samples, buf, time);
+		}
+		if (!rendered[i]) return false;
+		unsigned num = (infos[i].device->isStereo() ? 2 : 1) * samples;
+		memcpy(buf, &deviceBuf[i * stride], num * sizeof(int32_t));
+		return true;
+	};
+	// Same, but for output that gets added to an already filled buffer.
+	// Returns nullptr when the device didn't produce any sound.
+	auto renderAcc = [&](unsigned i) -> const int32_t* {
+		if (!parallel) {
+			return updateDevice(infos[i], samples, tmpBuf, time)
+			     ? tmpBuf : nullptr;
+		}
+		return rendered[i] ? &deviceBuf[i * stride] : nullptr;
+	};
+
 	// FIXME: The Infos should be ordered such that all the mono
 	// devices are handled first
-	for (auto& info : infos) {
+	for (unsigned i = 0; i < infos.size(); ++i) {
+		auto& info = infos[i];
 		SoundDevice& device = *info.device;
 		int l1 = info.left1;
 		int r1 = info.right1;
 		if (!device.isStereo()) {
 			if (l1 == r1) {
 				if (!(usedBuffers & HAS_MONO_FLAG)) {
-					if (device.updateBuffer(samples, monoBuf, time)) {
+					if (render(i, monoBuf)) {
 						usedBuffers |= HAS_MONO_FLAG;
-						mul(monoBuf, samples, l1);
+						MixKernels::mul(monoBuf, samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(monoBuf, tmpBuf, samples, l1);
+					if (auto* buf = renderAcc(i)) {
+						MixKernels::mulAcc(monoBuf, buf, samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (render(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
-						mulExpand(stereoBuf, samples, l1, r1);
+						MixKernels::mulExpand(stereoBuf, samples, l1, r1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulExpandAcc(stereoBuf, tmpBuf, samples, l1, r1);
+					if (auto* buf = renderAcc(i)) {
+						MixKernels::mulExpandAcc(
+							stereoBuf, buf, samples, l1, r1);
 					}
 				}
 			}
@@ -525,24 +416,27 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 				assert(l2 == 0);
 				assert(r1 == 0);
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (render(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
-						mul(stereoBuf, 2 * samples, l1);
+						MixKernels::mul(stereoBuf, 2 * samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(stereoBuf, tmpBuf, 2 * samples, l1);
+					if (auto* buf = renderAcc(i)) {
+						MixKernels::mulAcc(stereoBuf, buf, 2 * samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (render(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
-						mulMix2(stereoBuf, samples, l1, l2, r1, r2);
+						MixKernels::mulMix2(
+							stereoBuf, samples, l1, l2, r1, r2);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulMix2Acc(stereoBuf, tmpBuf, samples, l1, l2, r1, r2);
+					if (auto* buf = renderAcc(i)) {
+						MixKernels::mulMix2Acc(
+							stereoBuf, buf, samples,
+							l1, l2, r1, r2);
 					}
 				}
 			}
@@ -590,6 +484,52 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 	}
 }
 
+// Calls updateBuffer() on the device, unless the device can skip its output
+// because it's silent (that's much cheaper, but gives the same result).
+bool MSXMixer::updateDevice(SoundDeviceInfo& info, unsigned samples,
+                            int32_t* buf, EmuTime::param time)
+{
+	if (info.device->skipSilence(time)) {
+		info.idleSamples += samples;
+		return false;
+	}
+	info.activeSamples += samples;
+	return info.device->updateBuffer(samples, buf, time);
+}
+
+// Let all sound devices calculate their output in parallel, each in its own
+// part (of 'stride' samples) of 'deviceBuf'. Returns false when this isn't
+// enabled (or not useful), then nothing is calculated yet.
+bool MSXMixer::renderParallel(EmuTime::param time, unsigned samples,
+                              unsigned stride, bool* rendered)
+{
+	unsigned threads = mixer.getSoundThreads().getInt();
+	if (threads < 2) {
+		workerPool.reset();
+		return false;
+	}
+	if (infos.size() < 2) return false;
+
+	if (!workerPool || (workerPool->getNumThreads() != threads)) {
+		workerPool.reset(); // first stop the old threads
+		workerPool = make_unique<WorkerPool>(threads - 1);
+	}
+	size_t size = infos.size() * stride;
+	if (deviceBufSize < size) {
+		deviceBuf.resize(size);
+		deviceBufSize = size;
+	}
+	workerPool->parallelFor(unsigned(infos.size()), [&](unsigned i) {
+		// The calling thread may itself be a (background) machine thread.
+		bool machine = Thread::isMachineThread();
+		if (!machine) Thread::setMachineThread(true);
+		rendered[i] = updateDevice(
+			infos[i], samples, &deviceBuf[i * stride], time);
+		if (!machine) Thread::setMachineThread(false);
+	});
+	return true;
+}
+
 bool MSXMixer::needStereoRecording() const
 {
 	return any_of(begin(infos), end(infos),
@@ -826,6 +766,27 @@ void MSXMixer::SoundDeviceInfoTopic::execute(
 		result.setString(device->getDescription());
 		break;
 	}
+	case 4: {
+		auto it = find_if(begin(msxMixer.infos), end(msxMixer.infos),
+			[&](const SoundDeviceInfo& i) {
+				return i.device->getName() == tokens[2].getString(); });
+		if (it == end(msxMixer.infos)) {
+			throw CommandException("Unknown sound device");
+		}
+		if (tokens[3].getString() != "activity") {
+			throw CommandException("Unknown sub-topic: " +
+			                       tokens[3].getString());
+		}
+		uint64_t total = it->activeSamples + it->idleSamples;
+		result.addListElement("active");
+		result.addListElement(StringOp::toString(it->activeSamples));
+		result.addListElement("idle");
+		result.addListElement(StringOp::toString(it->idleSamples));
+		result.addListElement("active_ratio");
+		result.addListElement(total ? double(it->activeSamples) / total
+		                            : 0.0);
+		break;
+	}
 	default:
 		throw CommandException("Too many parameters");
 	}
@@ -833,7 +794,11 @@ void MSXMixer::SoundDeviceInfoTopic::execute(
 
 string MSXMixer::SoundDeviceInfoTopic::help(const vector<string>& /*tokens*/) const
 {
-	return "Shows a list of available sound devices.\n";
+	return "Shows a list of available sound devices, or the description "
+	       "of the given sound device.\n"
+	       "'machine_info sounddevice <device> activity' shows for how "
+	       "many samples the device was calculated (active) and for how "
+	       "many it could be skipped because it was silent (idle).\n";
 }
 
 void MSXMixer::SoundDeviceInfoTopic::tabCompletion(vector<string>& tokens) const
@@ -845,6 +810,9 @@ void MSXMixer::SoundDeviceInfoTopic::tabCompletion(vector<string>& tokens) const
 			devices.emplace_back(info.device->getName());
 		}
 		completeString(tokens, devices);
+	} else if (tokens.size() == 4) {
+		static const char* const subTopics[] = { "activity" };
+		completeString(tokens, subTopics);
 	}
 }
 
@@ -6,6 +6,7 @@
 #include "InfoTopic.hh"
 #include "EmuTime.hh"
 #include "DynamicClock.hh"
+#include "MemBuffer.hh"
 #include <cstdint>
 #include <vector>
 #include <memory>
@@ -23,6 +24,7 @@ class StringSetting;
 class BooleanSetting;
 class Setting;
 class AviRecorder;
+class WorkerPool;
 
 class MSXMixer final : private Schedulable, private Observer<Setting>
                      , private Observer<ThrottleManager>
@@ -126,6 +128,10 @@ private:
 		};
 		std::vector<ChannelSettings> channelSettings;
 		int left1, right1, left2, right2;
+		// Number of (host) samples for which the device was calculated,
+		// respectively skipped because it was silent.
+		uint64_t activeSamples = 0;
+		uint64_t idleSamples = 0;
 	};
 
 	void updateVolumeParams(SoundDeviceInfo& info);
@@ -133,6 +139,10 @@ private:
 	void reschedule();
 	void reschedule2();
 	void generate(int16_t* buffer, EmuTime::param time, unsigned samples);
+	bool updateDevice(SoundDeviceInfo& info, unsigned samples,
+	                  int32_t* buf, EmuTime::param time);
+	bool renderParallel(EmuTime::param time, unsigned samples,
+	                    unsigned stride, bool* rendered);
 
 	// Schedulable
 	void executeUntil(EmuTime::param time) override;
@@ -174,6 +184,11 @@ private:
 
 	unsigned muteCount;
 	int32_t tl0, tr0; // internal DC-filter state
+
+	// Parallel sound synthesis, see 'sound_threads' setting.
+	std::unique_ptr<WorkerPool> workerPool;
+	MemBuffer<int32_t, SSE2_ALIGNMENT> deviceBuf; // one part per device
+	size_t deviceBufSize;
 };
 
 } // namespace openmsx
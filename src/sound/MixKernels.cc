@@ -0,0 +1,552 @@
+#include "MixKernels.hh"
+#include "HostCPU.hh"
+#include "aligned.hh"
+#include "vla.hh"
+#include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace openmsx {
+namespace MixKernels {
+
+// Reorder the channels so that the ones that only go to the left output come
+// first, followed by the ones that go to both outputs and then the ones that
+// only go to the right. The left output is then the sum of the channels in
+// range [0, endLeft) and the right output of range [beginRight, numBufs).
+// (Integer addition is associative, so the order doesn't change the result.)
+struct BalanceOrder
+{
+	BalanceOrder(const int32_t** ordered, const int32_t* const* bufs,
+	             const int* balance, unsigned numBufs)
+	{
+		beginRight = 0;
+		for (unsigned j = 0; j < numBufs; ++j) {
+			if (balance[j] < 0) ordered[beginRight++] = bufs[j];
+		}
+		endLeft = beginRight;
+		for (unsigned j = 0; j < numBufs; ++j) {
+			if (balance[j] == 0) ordered[endLeft++] = bufs[j];
+		}
+		unsigned end = endLeft;
+		for (unsigned j = 0; j < numBufs; ++j) {
+			if (balance[j] > 0) ordered[end++] = bufs[j];
+		}
+		assert(end == numBufs);
+	}
+
+	unsigned beginRight;
+	unsigned endLeft;
+};
+
+#if HAVE_AVX2_DISPATCH
+
+TARGET_AVX2 static void addChannels_AVX2(
+	int32_t* out, const int32_t* const* bufs, unsigned numBufs, unsigned num)
+{
+	unsigned num4 = (num + 3) & ~3;
+	unsigned i = 0;
+	for (; (i + 8) <= num4; i += 8) {
+		auto* o = reinterpret_cast<__m256i*>(out + i);
+		__m256i acc = _mm256_loadu_si256(o);
+		for (unsigned j = 0; j < numBufs; ++j) {
+			acc = _mm256_add_epi32(acc, _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(bufs[j] + i)));
+		}
+		_mm256_storeu_si256(o, acc);
+	}
+	if (i < num4) {
+		auto* o = reinterpret_cast<__m128i*>(out + i);
+		__m128i acc = _mm_load_si128(o);
+		for (unsigned j = 0; j < numBufs; ++j) {
+			acc = _mm_add_epi32(acc, _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(bufs[j] + i)));
+		}
+		_mm_store_si128(o, acc);
+	}
+}
+
+TARGET_AVX2 static void addChannelsBalanced_AVX2(
+	int32_t* out, const int32_t* const* bufs, const BalanceOrder& order,
+	unsigned numBufs, unsigned samples)
+{
+	unsigned i = 0;
+	for (; (i + 8) <= samples; i += 8) {
+		__m256i l = _mm256_setzero_si256();
+		__m256i r = _mm256_setzero_si256();
+		unsigned j = 0;
+		for (; j < order.beginRight; ++j) {
+			l = _mm256_add_epi32(l, _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(bufs[j] + i)));
+		}
+		for (; j < order.endLeft; ++j) {
+			__m256i v = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(bufs[j] + i));
+			l = _mm256_add_epi32(l, v);
+			r = _mm256_add_epi32(r, v);
+		}
+		for (; j < numBufs; ++j) {
+			r = _mm256_add_epi32(r, _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(bufs[j] + i)));
+		}
+		// per 128-bit lane: samples [0..2) and [2..4)
+		__m256i lo = _mm256_unpacklo_epi32(l, r);
+		__m256i hi = _mm256_unpackhi_epi32(l, r);
+		auto* o = reinterpret_cast<__m256i*>(out + 2 * i);
+		_mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	for (; i < samples; ++i) {
+		int32_t l = 0;
+		int32_t r = 0;
+		unsigned j = 0;
+		for (; j < order.beginRight; ++j) l += bufs[j][i];
+		for (; j < order.endLeft; ++j) { l += bufs[j][i]; r += bufs[j][i]; }
+		for (; j < numBufs; ++j) r += bufs[j][i];
+		out[2 * i + 0] = l;
+		out[2 * i + 1] = r;
+	}
+}
+
+TARGET_AVX2 static void mul_AVX2(int32_t* buf, int n, int f)
+{
+	int n4 = (n + 3) & ~3;
+	__m256i f8 = _mm256_set1_epi32(f);
+	int i = 0;
+	for (; (i + 8) <= n4; i += 8) {
+		auto* p = reinterpret_cast<__m256i*>(buf + i);
+		_mm256_storeu_si256(p, _mm256_mullo_epi32(_mm256_loadu_si256(p), f8));
+	}
+	if (i < n4) {
+		auto* p = reinterpret_cast<__m128i*>(buf + i);
+		_mm_store_si128(p, _mm_mullo_epi32(_mm_load_si128(p),
+		                                   _mm256_castsi256_si128(f8)));
+	}
+}
+
+TARGET_AVX2 static void mulAcc_AVX2(
+	int32_t* __restrict acc, const int32_t* __restrict mul, int n, int f)
+{
+	int n4 = (n + 3) & ~3;
+	__m256i f8 = _mm256_set1_epi32(f);
+	int i = 0;
+	for (; (i + 8) <= n4; i += 8) {
+		auto* a = reinterpret_cast<__m256i*>(acc + i);
+		__m256i m = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(mul + i));
+		_mm256_storeu_si256(a, _mm256_add_epi32(
+			_mm256_loadu_si256(a), _mm256_mullo_epi32(m, f8)));
+	}
+	if (i < n4) {
+		auto* a = reinterpret_cast<__m128i*>(acc + i);
+		__m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(mul + i));
+		_mm_store_si128(a, _mm_add_epi32(_mm_load_si128(a),
+			_mm_mullo_epi32(m, _mm256_castsi256_si128(f8))));
+	}
+}
+
+TARGET_AVX2 static void mulExpand_AVX2(int32_t* buf, int n, int l, int r)
+{
+	// In place, so back-to-front: a block of 8 input samples is loaded
+	// before the 16 output samples (at or above the input) are stored.
+	__m256i l8 = _mm256_set1_epi32(l);
+	__m256i r8 = _mm256_set1_epi32(r);
+	int i = n;
+	while (i >= 8) {
+		i -= 8;
+		__m256i t = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(buf + i));
+		__m256i tl = _mm256_mullo_epi32(t, l8);
+		__m256i tr = _mm256_mullo_epi32(t, r8);
+		__m256i lo = _mm256_unpacklo_epi32(tl, tr);
+		__m256i hi = _mm256_unpackhi_epi32(tl, tr);
+		auto* p = reinterpret_cast<__m256i*>(buf + 2 * i);
+		_mm256_storeu_si256(p + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+		_mm256_storeu_si256(p + 0, _mm256_permute2x128_si256(lo, hi, 0x20));
+	}
+	while (i != 0) {
+		--i;
+		auto t = buf[i];
+		buf[2 * i + 0] = l * t;
+		buf[2 * i + 1] = r * t;
+	}
+}
+
+TARGET_AVX2 static void mulExpandAcc_AVX2(
+	int32_t* __restrict acc, const int32_t* __restrict mul, int n,
+	int l, int r)
+{
+	__m256i l8 = _mm256_set1_epi32(l);
+	__m256i r8 = _mm256_set1_epi32(r);
+	int i = 0;
+	for (; (i + 8) <= n; i += 8) {
+		__m256i t = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(mul + i));
+		__m256i tl = _mm256_mullo_epi32(t, l8);
+		__m256i tr = _mm256_mullo_epi32(t, r8);
+		__m256i lo = _mm256_unpacklo_epi32(tl, tr);
+		__m256i hi = _mm256_unpackhi_epi32(tl, tr);
+		auto* a = reinterpret_cast<__m256i*>(acc + 2 * i);
+		_mm256_storeu_si256(a + 0, _mm256_add_epi32(_mm256_loadu_si256(a + 0),
+			_mm256_permute2x128_si256(lo, hi, 0x20)));
+		_mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1),
+			_mm256_permute2x128_si256(lo, hi, 0x31)));
+	}
+	for (; i < n; ++i) {
+		auto t = mul[i];
+		acc[2 * i + 0] += l * t;
+		acc[2 * i + 1] += r * t;
+	}
+}
+
+// For each stereo sample: (t1, t2) -> (t1 * l1 + t2 * l2, t2 * r2 + t1 * r1)
+TARGET_AVX2 static inline __m256i mix2(__m256i v, __m256i f1, __m256i f2)
+{
+	__m256i s = _mm256_shuffle_epi32(v, 0xB1); // swap left and right
+	return _mm256_add_epi32(_mm256_mullo_epi32(v, f1),
+	                        _mm256_mullo_epi32(s, f2));
+}
+
+TARGET_AVX2 static void mulMix2_AVX2(
+	int32_t* buf, int n, int l1, int l2, int r1, int r2)
+{
+	__m256i f1 = _mm256_setr_epi32(l1, r2, l1, r2, l1, r2, l1, r2);
+	__m256i f2 = _mm256_setr_epi32(l2, r1, l2, r1, l2, r1, l2, r1);
+	int i = 0;
+	for (; (i + 4) <= n; i += 4) {
+		auto* p = reinterpret_cast<__m256i*>(buf + 2 * i);
+		_mm256_storeu_si256(p, mix2(_mm256_loadu_si256(p), f1, f2));
+	}
+	for (; i < n; ++i) {
+		auto t1 = buf[2 * i + 0];
+		auto t2 = buf[2 * i + 1];
+		buf[2 * i + 0] = l1 * t1 + l2 * t2;
+		buf[2 * i + 1] = r1 * t1 + r2 * t2;
+	}
+}
+
+TARGET_AVX2 static void mulMix2Acc_AVX2(
+	int32_t* __restrict acc, const int32_t* __restrict mul, int n,
+	int l1, int l2, int r1, int r2)
+{
+	__m256i f1 = _mm256_setr_epi32(l1, r2, l1, r2, l1, r2, l1, r2);
+	__m256i f2 = _mm256_setr_epi32(l2, r1, l2, r1, l2, r1, l2, r1);
+	int i = 0;
+	for (; (i + 4) <= n; i += 4) {
+		auto* a = reinterpret_cast<__m256i*>(acc + 2 * i);
+		__m256i m = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(mul + 2 * i));
+		_mm256_storeu_si256(a, _mm256_add_epi32(
+			_mm256_loadu_si256(a), mix2(m, f1, f2)));
+	}
+	for (; i < n; ++i) {
+		auto t1 = mul[2 * i + 0];
+		auto t2 = mul[2 * i + 1];
+		acc[2 * i + 0] += l1 * t1 + l2 * t2;
+		acc[2 * i + 1] += r1 * t1 + r2 * t2;
+	}
+}
+
+#endif // HAVE_AVX2_DISPATCH
+
+
+void addChannels(int32_t* out, const int32_t* const* bufs,
+                 unsigned numBufs, unsigned num)
+{
+	assert(numBufs > 0);
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		addChannels_AVX2(out, bufs, numBufs, num);
+		return;
+	}
+#endif
+
+#ifdef __SSE2__
+	unsigned i = 0;
+	do {
+		auto* o = reinterpret_cast<__m128i*>(out + i);
+		__m128i acc = _mm_load_si128(o);
+		unsigned j = 0;
+		do {
+			acc = _mm_add_epi32(acc, _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(bufs[j] + i)));
+		} while (++j < numBufs);
+		_mm_store_si128(o, acc);
+		i += 4;
+	} while (i < num);
+#else
+	unsigned i = 0;
+	do {
+		int32_t out0 = out[i + 0];
+		int32_t out1 = out[i + 1];
+		int32_t out2 = out[i + 2];
+		int32_t out3 = out[i + 3];
+		unsigned j = 0;
+		do {
+			out0 += bufs[j][i + 0];
+			out1 += bufs[j][i + 1];
+			out2 += bufs[j][i + 2];
+			out3 += bufs[j][i + 3];
+		} while (++j < numBufs);
+		out[i + 0] = out0;
+		out[i + 1] = out1;
+		out[i + 2] = out2;
+		out[i + 3] = out3;
+		i += 4;
+	} while (i < num);
+#endif
+}
+
+void addChannelsBalanced(int32_t* out, const int32_t* const* bufs,
+                         const int* balance, unsigned numBufs,
+                         unsigned samples)
+{
+	assert(numBufs > 0);
+#if HAVE_AVX2_DISPATCH || defined(__SSE2__)
+	VLA(const int32_t*, ordered, numBufs);
+	BalanceOrder order(ordered, bufs, balance, numBufs);
+#endif
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		addChannelsBalanced_AVX2(out, ordered, order, numBufs, samples);
+		return;
+	}
+#endif
+
+#ifdef __SSE2__
+	unsigned i = 0;
+	for (; (i + 4) <= samples; i += 4) {
+		__m128i l = _mm_setzero_si128();
+		__m128i r = _mm_setzero_si128();
+		unsigned j = 0;
+		for (; j < order.beginRight; ++j) {
+			l = _mm_add_epi32(l, _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(ordered[j] + i)));
+		}
+		for (; j < order.endLeft; ++j) {
+			__m128i v = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(ordered[j] + i));
+			l = _mm_add_epi32(l, v);
+			r = _mm_add_epi32(r, v);
+		}
+		for (; j < numBufs; ++j) {
+			r = _mm_add_epi32(r, _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(ordered[j] + i)));
+		}
+		auto* o = reinterpret_cast<__m128i*>(out + 2 * i);
+		_mm_storeu_si128(o + 0, _mm_unpacklo_epi32(l, r));
+		_mm_storeu_si128(o + 1, _mm_unpackhi_epi32(l, r));
+	}
+	for (; i < samples; ++i) {
+		int32_t l = 0;
+		int32_t r = 0;
+		unsigned j = 0;
+		for (; j < order.beginRight; ++j) l += ordered[j][i];
+		for (; j < order.endLeft; ++j) { l += ordered[j][i]; r += ordered[j][i]; }
+		for (; j < numBufs; ++j) r += ordered[j][i];
+		out[2 * i + 0] = l;
+		out[2 * i + 1] = r;
+	}
+#else
+	unsigned i = 0;
+	do {
+		int32_t left0  = 0;
+		int32_t right0 = 0;
+		int32_t left1  = 0;
+		int32_t right1 = 0;
+		unsigned j = 0;
+		do {
+			if (balance[j] <= 0) {
+				left0  += bufs[j][i + 0];
+				left1  += bufs[j][i + 1];
+			}
+			if (balance[j] >= 0) {
+				right0 += bufs[j][i + 0];
+				right1 += bufs[j][i + 1];
+			}
+			j++;
+		} while (j < numBufs);
+		out[i * 2 + 0] = left0;
+		out[i * 2 + 1] = right0;
+		out[i * 2 + 2] = left1;
+		out[i * 2 + 3] = right1;
+		i += 2;
+	} while (i < samples);
+#endif
+}
+
+void mul(int32_t* buf, int n, int f)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mul_AVX2(buf, n, f);
+		return;
+	}
+#endif
+
+#ifdef __arm__
+	// ARM assembly version
+	int32_t dummy1, dummy2;
+	asm volatile (
+	"0:\n\t"
+		"ldmia	%[buf],{r3-r6}\n\t"
+		"mul	r3,%[f],r3\n\t"
+		"mul	r4,%[f],r4\n\t"
+		"mul	r5,%[f],r5\n\t"
+		"mul	r6,%[f],r6\n\t"
+		"stmia	%[buf]!,{r3-r6}\n\t"
+		"subs	%[n],%[n],#4\n\t"
+		"bgt	0b\n\t"
+		: [buf] "=r"    (dummy1)
+		, [n]   "=r"    (dummy2)
+		:       "[buf]" (buf)
+		,       "[n]"   (n)
+		, [f]   "r"     (f)
+		: "memory", "r3","r4","r5","r6"
+	);
+	return;
+#endif
+
+	// C++ version, unrolled 4x,
+	//   this allows gcc/clang to do much better auto-vectorization
+	// Note that this can process upto 3 samples too many, but that's OK.
+	assume_SSE_aligned(buf);
+	int i = 0;
+	do {
+		buf[i + 0] *= f;
+		buf[i + 1] *= f;
+		buf[i + 2] *= f;
+		buf[i + 3] *= f;
+		i += 4;
+	} while (i < n);
+}
+
+void mulAcc(int32_t* __restrict acc, const int32_t* __restrict mul,
+            int n, int f)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mulAcc_AVX2(acc, mul, n, f);
+		return;
+	}
+#endif
+
+#ifdef __arm__
+	// ARM assembly version
+	int32_t dummy1, dummy2, dummy3;
+	asm volatile (
+	"0:\n\t"
+		"ldmia	%[in]!,{r3,r4,r5,r6}\n\t"
+		"ldmia	%[out],{r8,r9,r10,r12}\n\t"
+		"mla	r3,%[f],r3,r8\n\t"
+		"mla	r4,%[f],r4,r9\n\t"
+		"mla	r5,%[f],r5,r10\n\t"
+		"mla	r6,%[f],r6,r12\n\t"
+		"stmia	%[out]!,{r3,r4,r5,r6}\n\t"
+		"subs	%[n],%[n],#4\n\t"
+		"bgt	0b\n\t"
+		: [in]  "=r"    (dummy1)
+		, [out] "=r"    (dummy2)
+		, [n]   "=r"    (dummy3)
+		:       "[in]"  (mul)
+		,       "[out]" (acc)
+		,       "[n]"   (n)
+		, [f]   "r"     (f)
+		: "memory"
+		, "r3","r4","r5","r6"
+		, "r8","r9","r10","r12"
+	);
+	return;
+#endif
+
+	// C++ version, unrolled 4x, see comments above.
+	assume_SSE_aligned(acc);
+	assume_SSE_aligned(mul);
+	int i = 0;
+	do {
+		acc[i + 0] += mul[i + 0] * f;
+		acc[i + 1] += mul[i + 1] * f;
+		acc[i + 2] += mul[i + 2] * f;
+		acc[i + 3] += mul[i + 3] * f;
+		i += 4;
+	} while (i < n);
+}
+
+void mulExpand(int32_t* buf, int n, int l, int r)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mulExpand_AVX2(buf, n, l, r);
+		return;
+	}
+#endif
+
+	int i = n;
+	do {
+		--i; // back-to-front
+		auto t = buf[i];
+		buf[2 * i + 0] = l * t;
+		buf[2 * i + 1] = r * t;
+	} while (i != 0);
+}
+
+void mulExpandAcc(int32_t* __restrict acc, const int32_t* __restrict mul,
+                  int n, int l, int r)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mulExpandAcc_AVX2(acc, mul, n, l, r);
+		return;
+	}
+#endif
+
+	int i = 0;
+	do {
+		auto t = mul[i];
+		acc[2 * i + 0] += l * t;
+		acc[2 * i + 1] += r * t;
+	} while (++i < n);
+}
+
+void mulMix2(int32_t* buf, int n, int l1, int l2, int r1, int r2)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mulMix2_AVX2(buf, n, l1, l2, r1, r2);
+		return;
+	}
+#endif
+
+	int i = 0;
+	do {
+		auto t1 = buf[2 * i + 0];
+		auto t2 = buf[2 * i + 1];
+		buf[2 * i + 0] = l1 * t1 + l2 * t2;
+		buf[2 * i + 1] = r1 * t1 + r2 * t2;
+	} while (++i < n);
+}
+
+void mulMix2Acc(int32_t* __restrict acc, const int32_t* __restrict mul,
+                int n, int l1, int l2, int r1, int r2)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		mulMix2Acc_AVX2(acc, mul, n, l1, l2, r1, r2);
+		return;
+	}
+#endif
+
+	int i = 0;
+	do {
+		auto t1 = mul[2 * i + 0];
+		auto t2 = mul[2 * i + 1];
+		acc[2 * i + 0] += l1 * t1 + l2 * t2;
+		acc[2 * i + 1] += r1 * t1 + r2 * t2;
+	} while (++i < n);
+}
+
+} // namespace MixKernels
+} // namespace openmsx
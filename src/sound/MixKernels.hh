@@ -0,0 +1,69 @@
+#ifndef MIXKERNELS_HH
+#define MIXKERNELS_HH
+
+#include <cstdint>
+
+namespace openmsx {
+
+/** Inner loops used to mix the output of sound devices: summing the channels
+  * of a device (SoundDevice::mixChannels()) and applying the volume/balance
+  * of a device (MSXMixer::generate()).
+  *
+  * All buffers contain 32-bit samples. Stereo buffers are interleaved (left,
+  * right). Each function has a generic (C++ or SSE2) version and, on x86, an
+  * AVX2 version that is selected at runtime (see HostCPU.hh). All versions
+  * produce exactly the same result.
+  */
+namespace MixKernels {
+
+/** out[0:num] += bufs[0][0:num] + ... + bufs[numBufs - 1][0:num]
+  * 'num' is rounded up to a multiple of 4, all buffers must be large
+  * enough for that. 'out' must be 16-byte aligned. */
+void addChannels(int32_t* out, const int32_t* const* bufs,
+                 unsigned numBufs, unsigned num);
+
+/** Mix mono channels into a stereo buffer, according to their balance:
+  *   out[2i + 0] = sum of bufs[j][i] for all j with balance[j] <= 0
+  *   out[2i + 1] = sum of bufs[j][i] for all j with balance[j] >= 0
+  * The previous content of 'out' is overwritten. 'samples' is rounded up
+  * to a multiple of 2, all buffers must be large enough for that. */
+void addChannelsBalanced(int32_t* out, const int32_t* const* bufs,
+                         const int* balance, unsigned numBufs,
+                         unsigned samples);
+
+// The functions below multiply one buffer by a constant and (possibly) add
+// the result to a second buffer. Either buffer can be mono or stereo, so if
+// necessary the mono buffer is expanded to stereo.
+
+/** buf[0:n] *= f
+  * Can process up to 3 samples too many (n is rounded up to a multiple of
+  * 4). 'buf' must be 16-byte aligned. */
+void mul(int32_t* buf, int n, int f);
+
+/** acc[0:n] += mul[0:n] * f
+  * Same restrictions as mul(). */
+void mulAcc(int32_t* __restrict acc, const int32_t* __restrict mul,
+            int n, int f);
+
+/** buf[0:2n+0:2] = buf[0:n] * l
+  * buf[1:2n+1:2] = buf[0:n] * r */
+void mulExpand(int32_t* buf, int n, int l, int r);
+
+/** acc[0:2n+0:2] += mul[0:n] * l
+  * acc[1:2n+1:2] += mul[0:n] * r */
+void mulExpandAcc(int32_t* __restrict acc, const int32_t* __restrict mul,
+                  int n, int l, int r);
+
+/** buf[0:2n+0:2] = buf[0:2n+0:2] * l1 + buf[1:2n+1:2] * l2
+  * buf[1:2n+1:2] = buf[0:2n+0:2] * r1 + buf[1:2n+1:2] * r2 */
+void mulMix2(int32_t* buf, int n, int l1, int l2, int r1, int r2);
+
+/** acc[0:2n+0:2] += mul[0:2n+0:2] * l1 + mul[1:2n+1:2] * l2
+  * acc[1:2n+1:2] += mul[0:2n+0:2] * r1 + mul[1:2n+1:2] * r2 */
+void mulMix2Acc(int32_t* __restrict acc, const int32_t* __restrict mul,
+                int n, int l1, int l2, int r1, int r2);
+
+} // namespace MixKernels
+} // namespace openmsx
+
+#endif
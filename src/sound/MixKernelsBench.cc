@@ -0,0 +1,173 @@
+// Micro-benchmark for MixKernels.
+//
+// Mixes random channel data the way SoundDevice::mixChannels() and
+// MSXMixer::generate() do for devices with many channels (YM2413, YMF262 and
+// YMF278), once with the AVX2 kernels (if the host CPU supports them) and once
+// with the generic versions. Reports the time per fragment and verifies that
+// both produce exactly the same samples as a straightforward C++ loop.
+//
+// Usage: MixKernelsBench [repeat]
+
+#include "MixKernels.hh"
+#include "HostCPU.hh"
+#include "MemBuffer.hh"
+#include "Benchmark.hh"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned SAMPLES = 1024; // typical fragment size
+static const unsigned PITCH = 2 * SAMPLES + 8; // stereo + some extra room
+
+struct Device
+{
+	const char* name;
+	unsigned channels;
+	unsigned stereo;
+};
+static const Device devices[] = {
+	{ "YM2413 ", 9 + 5, 1 },
+	{ "YMF262 ", 18,    2 },
+	{ "YMF278 ", 24,    2 },
+};
+
+using Buffer = MemBuffer<int32_t, SSE2_ALIGNMENT>;
+
+// Run 'func' with the generic and the AVX2 kernels, print the timings and
+// compare the content of 'out' (first 'num' elements) with 'expected'. The
+// content of 'out' is restored from 'init' before each run.
+static void run(const char* name, const function<void()>& func,
+                int32_t* out, const int32_t* init, const int32_t* expected,
+                unsigned num, unsigned repeat, bool avx2,
+                Benchmark::Checker& checker)
+{
+	auto check = [&]() {
+		std::copy(init, init + PITCH, out);
+		func();
+		checker.check(std::equal(out, out + num, expected));
+	};
+	auto timed = [&]() { std::copy(init, init + PITCH, out); func(); };
+
+	HostCPU::setAVX2Enabled(false);
+	check();
+	double tGeneric = Benchmark::best(repeat, timed);
+	cout << name << "  " << tGeneric;
+	if (avx2) {
+		HostCPU::setAVX2Enabled(true);
+		check();
+		cout << "   " << Benchmark::best(repeat, timed);
+	}
+	cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 1000);
+
+	bool avx2 = HostCPU::hasAVX2();
+	if (!avx2) {
+		cout << "Host CPU doesn't support AVX2, "
+		        "only measuring the generic code." << endl;
+	}
+	cout << "Best time per fragment of " << SAMPLES << " samples (us), "
+	     << repeat << " repetitions (including a copy of the output)" << endl;
+	cout << "                             generic   AVX2" << endl;
+
+	Benchmark::Checker checker;
+	mt19937 gen(12345);
+	uniform_int_distribution<int32_t> dist(-(1 << 16), 1 << 16);
+	auto fill = [&](int32_t* p, unsigned n) {
+		for (unsigned i = 0; i < n; ++i) p[i] = dist(gen);
+	};
+
+	Buffer init(PITCH), out(PITCH), expected(PITCH), in(PITCH);
+	fill(init.data(), PITCH);
+	fill(in.data(), PITCH);
+
+	for (auto& d : devices) {
+		vector<Buffer> chans;
+		vector<const int32_t*> bufs;
+		vector<int> balance;
+		for (unsigned j = 0; j < d.channels; ++j) {
+			chans.emplace_back(PITCH);
+			fill(chans.back().data(), PITCH);
+			bufs.push_back(chans.back().data());
+			balance.push_back(int(j % 3) - 1);
+		}
+		unsigned num = SAMPLES * d.stereo;
+		string prefix = d.name;
+
+		// sum all channels (channels are recorded or muted)
+		for (unsigned i = 0; i < num; ++i) {
+			int32_t sum = init[i];
+			for (auto* b : bufs) sum += b[i];
+			expected[i] = sum;
+		}
+		run((prefix + "addChannels         ").c_str(),
+		    [&]() { MixKernels::addChannels(
+		                out.data(), bufs.data(), d.channels, num); },
+		    out.data(), init.data(), expected.data(), num, repeat, avx2, checker);
+
+		// mono channels with a balance setting
+		if (d.stereo == 1) {
+			for (unsigned i = 0; i < SAMPLES; ++i) {
+				int32_t l = 0, r = 0;
+				for (unsigned j = 0; j < d.channels; ++j) {
+					if (balance[j] <= 0) l += bufs[j][i];
+					if (balance[j] >= 0) r += bufs[j][i];
+				}
+				expected[2 * i + 0] = l;
+				expected[2 * i + 1] = r;
+			}
+			run((prefix + "addChannelsBalanced ").c_str(),
+			    [&]() { MixKernels::addChannelsBalanced(
+			                out.data(), bufs.data(), balance.data(),
+			                d.channels, SAMPLES); },
+			    out.data(), init.data(), expected.data(),
+			    2 * SAMPLES, repeat, avx2, checker);
+		}
+	}
+
+	// volume/balance stage in MSXMixer, once per device
+	const int f = 301, l1 = 201, l2 = -17, r1 = 33, r2 = 415;
+	for (unsigned i = 0; i < 2 * SAMPLES; ++i) {
+		expected[i] = init[i] + in[i] * f;
+	}
+	run("mixer  mulAcc (stereo)     ",
+	    [&]() { MixKernels::mulAcc(out.data(), in.data(), 2 * SAMPLES, f); },
+	    out.data(), init.data(), expected.data(), 2 * SAMPLES, repeat, avx2, checker);
+	for (unsigned i = 0; i < SAMPLES; ++i) {
+		expected[2 * i + 0] = init[i] * l1;
+		expected[2 * i + 1] = init[i] * r1;
+	}
+	run("mixer  mulExpand           ",
+	    [&]() { MixKernels::mulExpand(out.data(), SAMPLES, l1, r1); },
+	    out.data(), init.data(), expected.data(), 2 * SAMPLES, repeat, avx2, checker);
+	for (unsigned i = 0; i < SAMPLES; ++i) {
+		expected[2 * i + 0] = init[2 * i + 0] + in[i] * l1;
+		expected[2 * i + 1] = init[2 * i + 1] + in[i] * r1;
+	}
+	run("mixer  mulExpandAcc        ",
+	    [&]() { MixKernels::mulExpandAcc(
+	                out.data(), in.data(), SAMPLES, l1, r1); },
+	    out.data(), init.data(), expected.data(), 2 * SAMPLES, repeat, avx2, checker);
+	for (unsigned i = 0; i < SAMPLES; ++i) {
+		auto t1 = in[2 * i + 0];
+		auto t2 = in[2 * i + 1];
+		expected[2 * i + 0] = init[2 * i + 0] + l1 * t1 + l2 * t2;
+		expected[2 * i + 1] = init[2 * i + 1] + r1 * t1 + r2 * t2;
+	}
+	run("mixer  mulMix2Acc          ",
+	    [&]() { MixKernels::mulMix2Acc(
+	                out.data(), in.data(), SAMPLES, l1, l2, r1, r2); },
+	    out.data(), init.data(), expected.data(), 2 * SAMPLES, repeat, avx2, checker);
+
+	return checker.exitCode("kernels produced wrong samples");
+}
@@ -49,6 +49,11 @@ Mixer::Mixer(Reactor& reactor_, CommandController& commandController_)
 	, samplesSetting(
 		commandController, "samples",
 		"mixer samples", defaultsamples, 64, 8192)
+	, soundThreadsSetting(
+		commandController, "sound_threads",
+		"number of threads used to calculate the output of the sound "
+		"devices, 1 means all devices are calculated one after the other",
+		1, 1, 16)
 	, muteCount(0)
 {
 	muteSetting       .attach(*this);
@@ -46,6 +46,7 @@ public:
 	void uploadBuffer(MSXMixer& msxMixer, int16_t* buffer, unsigned len);
 
 	IntegerSetting& getMasterVolume() { return masterVolume; }
+	IntegerSetting& getSoundThreads() { return soundThreadsSetting; }
 
 private:
 	void reloadDriver();
@@ -65,6 +66,7 @@ private:
 	IntegerSetting masterVolume;
 	IntegerSetting frequencySetting;
 	IntegerSetting samplesSetting;
+	IntegerSetting soundThreadsSetting;
 
 	int muteCount;
 };
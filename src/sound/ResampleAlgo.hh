@@ -11,6 +11,13 @@ public:
 	virtual ~ResampleAlgo() {}
 	virtual bool generateOutput(int* dataOut, unsigned num,
 	                            EmuTime::param time) = 0;
+
+	/** The input is known to be all zero up to the given time. Advance to
+	  * that time without fetching the input, if that gives the same
+	  * result as generateOutput() (IOW if that would return false).
+	  * @result true iff the output was skipped.
+	  */
+	virtual bool skipSilence(EmuTime::param time) = 0;
 };
 
 } // namespace openmsx
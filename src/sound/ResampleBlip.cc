@@ -103,6 +103,16 @@ bool ResampleBlip<CHANNELS>::generateOutput(int* dataOut, unsigned hostNum,
 	return result;
 }
 
+template <unsigned CHANNELS>
+bool ResampleBlip<CHANNELS>::skipSilence(EmuTime::param time)
+{
+	for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+		if ((lastInput[ch] != 0) || !blip[ch].isSilent()) return false;
+	}
+	emuClock += emuClock.getTicksTill(time);
+	return true;
+}
+
 // Force template instantiation.
 template class ResampleBlip<1>;
 template class ResampleBlip<2>;
@@ -18,6 +18,7 @@ public:
 
 	bool generateOutput(int* dataOut, unsigned num,
 	                    EmuTime::param time) override;
+	bool skipSilence(EmuTime::param time) override;
 
 private:
 	BlipBuffer blip[CHANNELS];
@@ -2,8 +2,8 @@
 #define RESAMPLEHQ_HH
 
 #include "ResampleAlgo.hh"
+#include "ResampleHQFilter.hh"
 #include "DynamicClock.hh"
-#include <cstdint>
 #include <vector>
 
 namespace openmsx {
@@ -16,13 +16,12 @@ class ResampleHQ final : public ResampleAlgo
 public:
 	ResampleHQ(ResampledSoundDevice& input,
 	           const DynamicClock& hostClock, unsigned emuSampleRate);
-	~ResampleHQ();
 
 	bool generateOutput(int* dataOut, unsigned num,
 	                    EmuTime::param time) override;
+	bool skipSilence(EmuTime::param time) override;
 
 private:
-	void calcOutput(float pos, int* output);
 	void prepareData(unsigned emuNum);
 
 	ResampledSoundDevice& input;
@@ -30,13 +29,11 @@ private:
 	DynamicClock emuClock;
 
 	const float ratio;
+	const ResampleHQFilter filter;
 	unsigned bufStart;
 	unsigned bufEnd;
 	unsigned nonzeroSamples;
-	unsigned filterLen;
 	std::vector<float> buffer;
-	float* table;
-	int16_t* permute;
 };
 
 } // namespace openmsx
@@ -0,0 +1,95 @@
+// Throughput benchmark for the ResampleHQ filter.
+//
+// Resamples random mono and stereo input for a couple of typical ratios (e.g.
+// a 44.1kHz, 49.7kHz or 55.9kHz sound chip played back at 44.1kHz, 48kHz or
+// 96kHz), once with the AVX2 kernels (if the host CPU supports them) and once
+// with the generic (SSE2 or C++) versions. Reports the number of output samples
+// per microsecond and verifies that both versions produce exactly the same
+// output.
+//
+// Usage: ResampleHQBench [repeat]
+
+#include "ResampleHQFilter.hh"
+#include "HostCPU.hh"
+#include "Benchmark.hh"
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned OUTPUT = 4096; // output samples per run
+
+struct Ratio
+{
+	const char* name;
+	unsigned emuFreq;
+	unsigned hostFreq;
+};
+static const Ratio ratios[] = {
+	{ "44100 -> 48000", 44100, 48000 },
+	{ "44100 -> 96000", 44100, 96000 },
+	{ "49716 -> 44100", 49716, 44100 },
+	{ "55930 -> 48000", 55930, 48000 },
+	{ "62500 -> 44100", 62500, 44100 },
+};
+
+template <unsigned CHANNELS>
+static void run(const Ratio& r, unsigned repeat, bool avx2,
+                Benchmark::Checker& checker)
+{
+	float ratio = float(r.emuFreq) / r.hostFreq;
+	ResampleHQFilter filter(ratio);
+
+	// position of the first output sample, somewhere in between two input
+	// samples (like in ResampleHQ it's at most 'ratio + 2')
+	float pos = 0.37f;
+	unsigned inSamples = unsigned(pos + OUTPUT * ratio) + filter.getFilterLen() + 1;
+
+	mt19937 gen(12345);
+	uniform_int_distribution<int> dist(-(1 << 15), 1 << 15);
+	vector<float> in(inSamples * CHANNELS);
+	for (auto& s : in) s = float(dist(gen));
+	vector<int> outGeneric(OUTPUT * CHANNELS);
+	vector<int> outAvx2   (OUTPUT * CHANNELS);
+
+	auto calc = [&](vector<int>& out) {
+		filter.calcOutputs<CHANNELS>(in.data(), pos, OUTPUT, out.data());
+	};
+
+	HostCPU::setAVX2Enabled(false);
+	double tGeneric = Benchmark::best(repeat, [&]() { calc(outGeneric); });
+	cout << r.name << "  " << (CHANNELS == 1 ? "mono  " : "stereo")
+	     << "  " << setw(3) << filter.getFilterLen()
+	     << "   " << setw(8) << OUTPUT / tGeneric;
+	if (avx2) {
+		HostCPU::setAVX2Enabled(true);
+		double tAvx2 = Benchmark::best(repeat, [&]() { calc(outAvx2); });
+		cout << "   " << setw(8) << OUTPUT / tAvx2;
+		checker.check(outGeneric == outAvx2);
+	}
+	cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 100);
+
+	bool avx2 = HostCPU::hasAVX2();
+	if (!avx2) {
+		cout << "Host CPU doesn't support AVX2, "
+		        "only measuring the generic code." << endl;
+	}
+	cout << "Output samples per microsecond (best of " << repeat
+	     << " runs of " << OUTPUT << " samples)" << endl;
+	cout << "                          taps    generic       AVX2" << endl;
+
+	Benchmark::Checker checker;
+	for (auto& r : ratios) {
+		run<1>(r, repeat, avx2, checker);
+		run<2>(r, repeat, avx2, checker);
+	}
+	return checker.exitCode("AVX2 and generic versions differ");
+}
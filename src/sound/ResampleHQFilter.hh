@@ -0,0 +1,51 @@
+#ifndef RESAMPLEHQFILTER_HH
+#define RESAMPLEHQFILTER_HH
+
+#include <cstdint>
+
+namespace openmsx {
+
+/** The polyphase (band limited sinc) filter used by ResampleHQ.
+  *
+  * The coefficient tables only depend on the resample ratio, so they are
+  * shared by all filters (thus all sound devices) with the same ratio.
+  *
+  * This is separate from ResampleHQ (which manages the input buffer) so that
+  * it can also be used without a sound device, see ResampleHQBench.cc.
+  */
+class ResampleHQFilter
+{
+public:
+	explicit ResampleHQFilter(float ratio);
+	~ResampleHQFilter();
+	ResampleHQFilter(const ResampleHQFilter&) = delete;
+	ResampleHQFilter& operator=(const ResampleHQFilter&) = delete;
+
+	/** Each output sample is calculated from this many input samples.
+	  * Always a multiple of 4. */
+	unsigned getFilterLen() const { return filterLen; }
+
+	/** Calculate 'num' output samples. The first output sample is at
+	  * position 'pos' (measured in input samples, relative to 'buf'), the
+	  * following ones are each 'ratio' input samples further.
+	  * The input and output buffers contain CHANNELS interleaved samples
+	  * (1 = mono, 2 = stereo). The input must contain at least
+	  * int(pos + (num - 1) * ratio) + getFilterLen() samples.
+	  */
+	template <unsigned CHANNELS>
+	void calcOutputs(const float* buf, float pos, unsigned num,
+	                 int* __restrict out) const;
+
+private:
+	template <unsigned CHANNELS>
+	void calcOutput(const float* buf, float pos, int* __restrict out) const;
+
+	const float ratio;
+	unsigned filterLen;
+	float* table;
+	int16_t* permute;
+};
+
+} // namespace openmsx
+
+#endif
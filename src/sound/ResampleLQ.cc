@@ -8,10 +8,11 @@
 
 namespace openmsx {
 
-// 16-byte aligned buffer of ints (shared among all instances of this resampler)
-static std::vector<int> bufferStorage; // (possibly) unaligned storage
-static unsigned bufferSize = 0; // usable buffer size (aligned portion)
-static int* bufferInt = nullptr; // pointer to aligned sub-buffer
+// 16-byte aligned buffer of ints (shared among all instances of this resampler
+// that run in the same thread, see Reactor::runBackgroundMachines())
+static thread_local std::vector<int> bufferStorage; // (possibly) unaligned storage
+static thread_local unsigned bufferSize = 0; // usable buffer size (aligned portion)
+static thread_local int* bufferInt = nullptr; // pointer to aligned sub-buffer
 
 ////
 
@@ -44,6 +45,19 @@ ResampleLQ<CHANNELS>::ResampleLQ(
 	for (auto& l : lastInput) l = 0;
 }
 
+template <unsigned CHANNELS>
+bool ResampleLQ<CHANNELS>::skipSilence(EmuTime::param time)
+{
+	// Only when the last input samples were also zero (see fetchData()).
+	for (auto& l : lastInput) {
+		if (l != 0) return false;
+	}
+	unsigned emuNum = emuClock.getTicksTill(time);
+	if (emuNum == 0) return false; // fetchData() returns true
+	emuClock += emuNum;
+	return true;
+}
+
 template <unsigned CHANNELS>
 bool ResampleLQ<CHANNELS>::fetchData(EmuTime::param time, unsigned& valid)
 {
@@ -18,6 +18,8 @@ public:
 		ResampledSoundDevice& input,
 		const DynamicClock& hostClock, unsigned emuSampleRate);
 
+	bool skipSilence(EmuTime::param time) override;
+
 protected:
 	ResampleLQ(ResampledSoundDevice& input,
 	           const DynamicClock& hostClock, unsigned emuSampleRate);
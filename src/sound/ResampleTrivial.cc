@@ -18,4 +18,10 @@ bool ResampleTrivial::generateOutput(int* dataOut, unsigned num,
 	return input.generateInput(dataOut, num);
 }
 
+bool ResampleTrivial::skipSilence(EmuTime::param /*time*/)
+{
+	// no state
+	return true;
+}
+
 } // namespace openmsx
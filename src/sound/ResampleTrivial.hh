@@ -13,6 +13,7 @@ public:
 	explicit ResampleTrivial(ResampledSoundDevice& input);
 	bool generateOutput(int* dataOut, unsigned num,
 	                    EmuTime::param time) override;
+	bool skipSilence(EmuTime::param time) override;
 
 private:
 	ResampledSoundDevice& input;
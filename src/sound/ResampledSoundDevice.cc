@@ -40,6 +40,12 @@ bool ResampledSoundDevice::updateBuffer(unsigned length, int* buffer,
 	return algo->generateOutput(buffer, length, time);
 }
 
+bool ResampledSoundDevice::skipSilence(EmuTime::param time)
+{
+	// Recorded channels must still get their (silent) samples.
+	return !isRecording() && isSilent() && algo->skipSilence(time);
+}
+
 bool ResampledSoundDevice::generateInput(int* buffer, unsigned num)
 {
 	return mixChannels(buffer, num);
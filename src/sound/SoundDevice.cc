@@ -1,5 +1,6 @@
 #include "SoundDevice.hh"
 #include "MSXMixer.hh"
+#include "MixKernels.hh"
 #include "DeviceConfig.hh"
 #include "XMLElement.hh"
 #include "WavWriter.hh"
@@ -17,8 +18,11 @@ using std::string;
 
 namespace openmsx {
 
-static MemBuffer<int, SSE2_ALIGNMENT> mixBuffer;
-static unsigned mixBufferSize = 0;
+// One buffer per thread: machines that run in the background are executed in
+// parallel (see Reactor::runBackgroundMachines()) and so can be the sound
+// devices of one machine (see MSXMixer::generate()).
+static thread_local MemBuffer<int, SSE2_ALIGNMENT> mixBuffer;
+static thread_local unsigned mixBufferSize = 0;
 
 static void allocateMixBuffer(unsigned size)
 {
@@ -215,6 +219,16 @@ void SoundDevice::muteChannel(unsigned channel, bool muted)
 	channelMuted[channel] = muted;
 }
 
+bool SoundDevice::skipSilence(EmuTime::param /*time*/)
+{
+	return false;
+}
+
+bool SoundDevice::isSilent() const
+{
+	return false;
+}
+
 bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 {
 #ifdef __SSE2__
@@ -309,60 +323,12 @@ bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 
 	// actually mix channels
 	if (!balanceCenter) {
-		unsigned i = 0;
-		do {
-			int left0  = 0;
-			int right0 = 0;
-			int left1  = 0;
-			int right1 = 0;
-			unsigned j = 0;
-			do {
-				if (mixBalance[j] <= 0) {
-					left0  += bufs[j][i + 0];
-					left1  += bufs[j][i + 1];
-				}
-				if (mixBalance[j] >= 0) {
-					right0 += bufs[j][i + 0];
-					right1 += bufs[j][i + 1];
-				}
-				j++;
-			} while (j < numMix);
-			dataOut[i * 2 + 0] = left0;
-			dataOut[i * 2 + 1] = right0;
-			dataOut[i * 2 + 2] = left1;
-			dataOut[i * 2 + 3] = right1;
-			i += 2;
-		} while (i < samples);
-
-		return true;
+		MixKernels::addChannelsBalanced(
+			dataOut, bufs, mixBalance, numMix, samples);
+	} else {
+		MixKernels::addChannels(dataOut, bufs, numMix, samples * stereo);
 	}
 
-	// In the past we had ARM and x86-SSE2 optimized assembly routines for
-	// the stuff below. Currently this code is only rarely used anymore
-	// (only when recording or muting individual soundchip channels), so
-	// it's not worth the extra complexity anymore.
-	unsigned num = samples * stereo;
-	unsigned i = 0;
-	do {
-		int out0 = dataOut[i + 0];
-		int out1 = dataOut[i + 1];
-		int out2 = dataOut[i + 2];
-		int out3 = dataOut[i + 3];
-		unsigned j = 0;
-		do {
-			out0 += bufs[j][i + 0];
-			out1 += bufs[j][i + 1];
-			out2 += bufs[j][i + 2];
-			out3 += bufs[j][i + 3];
-			++j;
-		} while (j < numMix);
-		dataOut[i + 0] = out0;
-		dataOut[i + 1] = out1;
-		dataOut[i + 2] = out2;
-		dataOut[i + 3] = out3;
-		i += 4;
-	} while (i < num);
-
 	return true;
 }
 
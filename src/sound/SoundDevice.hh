@@ -137,6 +137,16 @@ public: // Will be called by Mixer:
 	virtual bool updateBuffer(unsigned length, int* buffer,
 	                          EmuTime::param time) = 0;
 
+	/** Called instead of updateBuffer() to quickly skip the output up to
+	  * the given time when the device is silent (see isSilent()).
+	  * @result true iff the output was skipped. That has exactly the same
+	  *         effect as calling updateBuffer() and getting 'false' as
+	  *         result. When this returns false nothing happened and
+	  *         updateBuffer() must be called as usual.
+	  * The default implementation never skips.
+	  */
+	virtual bool skipSilence(EmuTime::param time);
+
 protected:
 	/** Adds a number of samples that all have the same value.
 	  * Can be used to synthesize the high half of a square wave cycle.
@@ -163,6 +173,18 @@ protected:
 	  */
 	virtual void generateChannels(int** buffers, unsigned num) = 0;
 
+	/** Is this device guaranteed to produce only silence until its state
+	  * is changed again (e.g. by a register write)? When this returns
+	  * true, generateChannels() must set all buffer pointers to nullptr
+	  * and must not change the state of the device. This allows to skip
+	  * the device (and its resampler) completely.
+	  * The default implementation returns false.
+	  */
+	virtual bool isSilent() const;
+
+	/** Is at least one of the channels being recorded? */
+	bool isRecording() const { return numRecordChannels != 0; }
+
 	/** Calls generateChannels() and combines the output to a single
 	  * channel.
 	  * @param dataOut Output buffer, must be big enough to hold
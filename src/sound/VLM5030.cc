@@ -232,11 +232,16 @@ int VLM5030::parseFrame()
 	return FR_SIZE;
 }
 
+bool VLM5030::isSilent() const
+{
+	return phase == PH_IDLE;
+}
+
 // decode and buffering data
 void VLM5030::generateChannels(int** bufs, unsigned length)
 {
 	// Single channel device: replace content of bufs[0] (not add to it).
-	if (phase == PH_IDLE) {
+	if (isSilent()) {
 		bufs[0] = nullptr;
 		return;
 	}
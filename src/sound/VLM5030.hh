@@ -38,6 +38,7 @@ private:
 
 	// SoundDevice
 	void generateChannels(int** bufs, unsigned num) override;
+	bool isSilent() const override;
 	int getAmplificationFactorImpl() const override;
 
 	void setupParameter(byte param);
@@ -809,7 +809,7 @@ void Y8950::setEnabled(bool enabled_, EmuTime::param time)
 	enabled = enabled_;
 }
 
-bool Y8950::checkMuteHelper()
+bool Y8950::isSilent() const
 {
 	if (!enabled) {
 		return true;
@@ -835,7 +835,7 @@ bool Y8950::checkMuteHelper()
 void Y8950::generateChannels(int** bufs, unsigned num)
 {
 	// TODO implement per-channel mute (instead of all-or-nothing)
-	if (checkMuteHelper()) {
+	if (isSilent()) {
 		// TODO update internal state even when muted
 		// during mute pm_phase, am_phase, noiseA_phase, noiseB_phase
 		// and noise_seed aren't updated, probably ok
@@ -75,6 +75,7 @@ private:
 	// SoundDevice
 	int getAmplificationFactorImpl() const override;
 	void generateChannels(int** bufs, unsigned num) override;
+	bool isSilent() const override;
 
 	inline void keyOn_BD();
 	inline void keyOn_SD();
@@ -89,7 +90,6 @@ private:
 	inline void setRythmMode(int data);
 	void update_key_status();
 
-	bool checkMuteHelper();
 
 	void changeStatusMask(byte newMask);
 
@@ -860,7 +860,7 @@ YM2151::~YM2151()
 	unregisterSound();
 }
 
-bool YM2151::checkMuteHelper()
+bool YM2151::isSilent() const
 {
 	for (auto& op : oper) {
 		if (op.state != EG_OFF) return false;
@@ -1458,7 +1458,7 @@ void YM2151::advance()
 
 void YM2151::generateChannels(int** bufs, unsigned num)
 {
-	if (checkMuteHelper()) {
+	if (isSilent()) {
 		// TODO update internal state, even if muted
 		for (int i = 0; i < 8; ++i) {
 			bufs[i] = nullptr;
@@ -119,6 +119,7 @@ private:
 
 	// SoundDevice
 	void generateChannels(int** bufs, unsigned num) override;
+	bool isSilent() const override;
 
 	void callback(byte flag) override;
 	void setStatus(byte flags);
@@ -143,7 +144,6 @@ private:
 	void advanceEG();
 	void advance();
 
-	bool checkMuteHelper();
 
 	IRQHelper irq;
 
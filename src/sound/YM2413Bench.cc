@@ -0,0 +1,247 @@
+// Regression test and benchmark for the YM2413 cores.
+//
+// Plays a couple of register write logs on both YM2413 cores and compares a
+// SHA1 sum of the (amplified) output of each channel with the sums that the
+// cores produced before YM2413Okazaki was optimized (see 'okazakiSums' and
+// 'burczynskiSums' below). All other channels must remain silent. Some logs
+// generate the samples in irregular chunks, so that the blocks in which the
+// cores internally calculate the output don't always align with them. Also
+// reports how long it takes to play each log.
+//
+// When the output of a core intentionally changes, the new sums are printed
+// on a mismatch, but only update the table after listening to the result.
+//
+// Usage: YM2413Bench [repeat]
+
+#include "YM2413Okazaki.hh"
+#include "YM2413Burczynski.hh"
+#include "sha1.hh"
+#include "Benchmark.hh"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+
+static const unsigned CHANNELS = 9 + 5; // melodic + rhythm
+
+
+struct RegWrite
+{
+	RegWrite(byte reg_, byte val_) : reg(reg_), val(val_) {}
+	byte reg;
+	byte val;
+};
+struct LogEvent
+{
+	vector<RegWrite> regWrites;
+	unsigned samples; // number of samples between this and next event
+};
+using Log = vector<LogEvent>;
+using Samples = vector<int>;
+
+
+static LogEvent event(unsigned samples, vector<RegWrite> regWrites = {})
+{
+	LogEvent result;
+	result.regWrites = std::move(regWrites);
+	result.samples = samples;
+	return result;
+}
+
+static Log logSilence()
+{
+	Log log;
+	log.push_back(event(1000)); // no register writes
+	return log;
+}
+
+static Log logViolin()
+{
+	Log log;
+	log.push_back(event(11000, {
+		{ 0x30, 0x10 },   // instrument / volume
+		{ 0x10, 0xAD },   // frequency
+		{ 0x20, 0x14 } }));  // key-on / frequency
+	log.push_back(event(11000, { { 0x20, 0x16 } })); // change freq
+	log.push_back(event(11000, { { 0x20, 0x06 } })); // key-off
+	return log;
+}
+
+// A custom instrument and two ROM instruments in melodic mode, then rhythm
+// mode (all five instruments), all in irregular chunks. Channels 6-8 still
+// release the rhythm instruments after switching back to melodic mode.
+static Log logMixed()
+{
+	Log log;
+	log.push_back(event(127, {
+		{ 0x00, 0x61 }, { 0x01, 0x21 }, { 0x02, 0x1E }, { 0x03, 0x17 },
+		{ 0x04, 0xF0 }, { 0x05, 0x7F }, { 0x06, 0x00 }, { 0x07, 0x17 },
+		{ 0x31, 0x02 }, { 0x11, 0x61 }, { 0x21, 0x1C },   // custom
+		{ 0x34, 0x51 }, { 0x14, 0x20 }, { 0x24, 0x19 },   // guitar
+		{ 0x35, 0xB3 }, { 0x15, 0x81 }, { 0x25, 0x3A } })); // organ
+	log.push_back(event(1));
+	log.push_back(event(4999, { { 0x11, 0x30 } }));
+	log.push_back(event(3,    { { 0x31, 0x08 } }));
+	log.push_back(event(2001, { { 0x24, 0x09 } })); // key-off
+	log.push_back(event(3000, {
+		{ 0x16, 0x20 }, { 0x26, 0x05 }, { 0x36, 0x00 },
+		{ 0x17, 0x50 }, { 0x27, 0x05 }, { 0x37, 0x00 },
+		{ 0x18, 0xC0 }, { 0x28, 0x01 }, { 0x38, 0x00 },
+		{ 0x0E, 0x3F } })); // rhythm mode, all keys
+	log.push_back(event(77,   { { 0x0E, 0x20 } })); // rhythm key-off
+	log.push_back(event(2500, { { 0x0E, 0x2A } })); // snare, top-cymbal
+	log.push_back(event(4000, { { 0x0E, 0x35 } })); // bass, tom, high hat
+	log.push_back(event(1500, { { 0x0E, 0x00 } })); // back to melodic
+	return log;
+}
+
+
+struct Test
+{
+	const char* name;
+	Log (*makeLog)();
+};
+static const Test tests[] = {
+	{ "silence", logSilence },
+	{ "violin",  logViolin  },
+	{ "mixed",   logMixed   },
+};
+
+struct Sum
+{
+	const char* test;
+	unsigned channel;
+	const char* sha1;
+};
+// Generated with the cores from before the optimizations of YM2413Okazaki
+// (without the block-based generateChannels()), over the 32-bit little endian
+// samples of each channel. Channels that are not listed must be silent.
+static const vector<Sum> okazakiSums = {
+	{ "violin",  0, "e2a12231b6890af8248ef43f813f68bc8920b3e3" },
+	{ "mixed",   1, "72dbfbb9ec87c0e6e9be2aff3cd0ccdcf56c6e5c" },
+	{ "mixed",   4, "732489124bf7283c835380c77141fd8c45390ce0" },
+	{ "mixed",   5, "e5137264bb9ad028b609af2152aff6ad29de8562" },
+	{ "mixed",   6, "dd1b95dad42f704500feacc1deefe86e2dd4b1ac" },
+	{ "mixed",   8, "0a6c62cd8ad77857144971813be320499bbf374b" },
+	{ "mixed",   9, "7b3b5230219fb5a16b895760066714781b54d51e" },
+	{ "mixed",  10, "4f36bb9858c9af93a9e9241c24aa2abc9b30419c" },
+	{ "mixed",  11, "4b5629dca63f811e322e53ffa23235b816b037d7" },
+	{ "mixed",  12, "767f85a644733e52cb129eb670bf719624c75d09" },
+	{ "mixed",  13, "1d439dbab53580a5f39775fb851e27f007f1d7a1" },
+};
+static const vector<Sum> burczynskiSums = {
+	{ "violin",  0, "fc467b0fbc8e9fccd075303a55c5acba823db5b3" },
+	{ "mixed",   1, "463ba9cde4a0ab7720107409084b64e402f95544" },
+	{ "mixed",   4, "529c5c17d89258016cca16d2fe47c76f888c344e" },
+	{ "mixed",   5, "593ad8b44c772a81c947ce5c49a91d9b49d7632a" },
+	{ "mixed",   7, "3fd9f94a8610acdf486a58ea0e9402cafe4b908d" },
+	{ "mixed",   8, "aa70bb402bfb9299ff51070c3e484a3c8c222c0f" },
+	{ "mixed",   9, "744c4b6b1d8d89b1a36d20df1de3403bfe66e040" },
+	{ "mixed",  10, "5a5d2082290f15ff319a18a422e5cba67aa0ec98" },
+	{ "mixed",  11, "567b3c6e44701c99df552c63abb6137b3a9a8318" },
+	{ "mixed",  12, "1a680742f95d532e9d436097414feb34034e91f2" },
+	{ "mixed",  13, "e5319218024002d2dba0dbaaab449694d06792a3" },
+};
+
+
+// Plays the log and returns the generated samples of each channel.
+static void play(YM2413Core& core, const Log& log, Samples (&samples)[CHANNELS])
+{
+	for (auto& l : log) {
+		// write registers
+		for (auto& w : l.regWrites) {
+			core.writeReg(w.reg, w.val);
+		}
+
+		// setup buffers (silent channels set their pointer to nullptr
+		// and leave the zeros in the buffer)
+		int* bufs[CHANNELS];
+		auto oldSize = samples[0].size();
+		for (unsigned i = 0; i < CHANNELS; ++i) {
+			samples[i].resize(oldSize + l.samples);
+			bufs[i] = &samples[i][oldSize];
+		}
+
+		// actually generate samples
+		core.generateChannels(bufs, l.samples);
+	}
+}
+
+// Amplifies the samples (makes comparison between different cores easier).
+static Sha1Sum calcSum(const Samples& samples, int factor)
+{
+	SHA1 sha1;
+	for (auto& s : samples) {
+		int32_t a = s * factor;
+		uint8_t buf[4] = { uint8_t(a), uint8_t(a >> 8),
+		                   uint8_t(a >> 16), uint8_t(a >> 24) };
+		sha1.update(buf, 4);
+	}
+	return sha1.digest();
+}
+
+static void verify(const char* coreName, const vector<Sum>& sums,
+                   const Test& test, const Samples (&samples)[CHANNELS],
+                   int factor, Benchmark::Checker& checker)
+{
+	for (unsigned i = 0; i < CHANNELS; ++i) {
+		auto it = std::find_if(sums.begin(), sums.end(), [&](const Sum& s) {
+			return (s.channel == i) && (string(s.test) == test.name);
+		});
+		if (it == sums.end()) {
+			bool silent = std::all_of(samples[i].begin(), samples[i].end(),
+			                          [](int s) { return s == 0; });
+			if (!silent) {
+				cout << "MISMATCH: " << coreName << ' ' << test.name
+				     << " channel " << i << " should be silent" << endl;
+			}
+			checker.check(silent);
+		} else {
+			auto sum = calcSum(samples[i], factor);
+			bool same = sum == Sha1Sum(it->sha1);
+			if (!same) {
+				cout << "MISMATCH: " << coreName << ' ' << test.name
+				     << " channel " << i << ": expected " << it->sha1
+				     << " but got " << sum << endl;
+			}
+			checker.check(same);
+		}
+	}
+}
+
+template<typename CORE>
+static void testCore(const char* coreName, const vector<Sum>& sums,
+                     unsigned repeat, Benchmark::Checker& checker)
+{
+	for (auto& test : tests) {
+		Log log = test.makeLog();
+		double best = std::numeric_limits<double>::max();
+		for (unsigned i = 0; i < repeat; ++i) {
+			CORE impl;
+			YM2413Core& core = impl; // the overrides are private
+			Samples samples[CHANNELS];
+			best = std::min(best, Benchmark::time([&] {
+				play(core, log, samples);
+			}));
+			if (i == 0) {
+				verify(coreName, sums, test, samples,
+				       core.getAmplificationFactor(), checker);
+			}
+		}
+		cout << coreName << ' ' << test.name << ": " << best << "us" << endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 10);
+	Benchmark::Checker checker;
+	testCore<YM2413Okazaki::   YM2413>("Okazaki",    okazakiSums,    repeat, checker);
+	testCore<YM2413Burczynski::YM2413>("Burczynski", burczynskiSums, repeat, checker);
+	return checker.exitCode("output of a YM2413 core changed");
+}
@@ -9,6 +9,7 @@
 #include "cstd.hh"
 #include "inline.hh"
 #include "unreachable.hh"
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <iostream>
@@ -1000,6 +1001,19 @@ template <bool HAS_AM> unsigned Slot::calc_fixed_env() const
 	return out;
 }
 
+// Number of samples until (and including) the sample in which calc_envelope()
+// moves to the next envelope state, or 'limit' if that's later.
+unsigned Slot::envelopeSamples(unsigned limit) const
+{
+	int phase = eg_phase.getRawValue();
+	int step = eg_dphase.getRawValue();
+	int max = eg_phase_max.getRawValue();
+	if ((phase + step) >= max) return 1;
+	if (step == 0) return limit; // SUSHOLD, FINISH or rate 0
+	unsigned n = (max - phase + step - 1) / step;
+	return std::min(n, limit);
+}
+
 // CARRIER
 template<bool HAS_AM, bool FIXED_ENV>
 ALWAYS_INLINE int Slot::calc_slot_car(unsigned lfo_pm, int lfo_am, int fm, unsigned fixed_env)
@@ -1096,7 +1110,8 @@ Patch& YM2413::getPatch(unsigned instrument, bool carrier)
 }
 
 template <unsigned FLAGS>
-ALWAYS_INLINE void YM2413::calcChannel(Channel& ch, int* buf, unsigned num)
+ALWAYS_INLINE void YM2413::calcChannel(Channel& ch, int* buf, unsigned num,
+                                       unsigned pmPhase, unsigned amPhase)
 {
 	// VC++ requires explicit conversion to bool. Compiler bug??
 	const bool HAS_CAR_PM = (FLAGS &  1) != 0;
@@ -1112,8 +1127,8 @@ ALWAYS_INLINE void YM2413::calcChannel(Channel& ch, int* buf, unsigned num)
 	assert(((ch.mod.patch.AMPM & 1) != 0) == HAS_MOD_PM);
 	assert(((ch.mod.patch.AMPM & 2) != 0) == HAS_MOD_AM);
 
-	unsigned tmp_pm_phase = pm_phase;
-	unsigned tmp_am_phase = am_phase;
+	unsigned tmp_pm_phase = pmPhase;
+	unsigned tmp_am_phase = amPhase;
 	unsigned car_fixed_env = 0; // dummy
 	unsigned mod_fixed_env = 0; // dummy
 	if (HAS_CAR_FIXED_ENV) {
@@ -1150,6 +1165,156 @@ ALWAYS_INLINE void YM2413::calcChannel(Channel& ch, int* buf, unsigned num)
 	} while (sample < num);
 }
 
+void YM2413::calcChannelBlock(Channel& ch, int* buf, unsigned num,
+                              unsigned pmPhase, unsigned amPhase)
+{
+	// Below we choose between 128 specialized versions of calcChannel().
+	// This allows to move a lot of conditional code out of the inner-loop.
+	bool carFixedEnv = (ch.car.state == SUSHOLD) ||
+	                   (ch.car.state == FINISH);
+	bool modFixedEnv = (ch.mod.state == SUSHOLD) ||
+	                   (ch.mod.state == FINISH);
+	if (ch.car.state == SETTLE) {
+		modFixedEnv = false;
+	}
+	unsigned flags = ( ch.car.patch.AMPM     << 0) |
+	                 ( ch.mod.patch.AMPM     << 2) |
+	                 ((ch.mod.patch.FB != 0) << 4) |
+	                 ( carFixedEnv           << 5) |
+	                 ( modFixedEnv           << 6);
+	switch (flags) {
+	case   0: calcChannel<  0>(ch, buf, num, pmPhase, amPhase); break;
+	case   1: calcChannel<  1>(ch, buf, num, pmPhase, amPhase); break;
+	case   2: calcChannel<  2>(ch, buf, num, pmPhase, amPhase); break;
+	case   3: calcChannel<  3>(ch, buf, num, pmPhase, amPhase); break;
+	case   4: calcChannel<  4>(ch, buf, num, pmPhase, amPhase); break;
+	case   5: calcChannel<  5>(ch, buf, num, pmPhase, amPhase); break;
+	case   6: calcChannel<  6>(ch, buf, num, pmPhase, amPhase); break;
+	case   7: calcChannel<  7>(ch, buf, num, pmPhase, amPhase); break;
+	case   8: calcChannel<  8>(ch, buf, num, pmPhase, amPhase); break;
+	case   9: calcChannel<  9>(ch, buf, num, pmPhase, amPhase); break;
+	case  10: calcChannel< 10>(ch, buf, num, pmPhase, amPhase); break;
+	case  11: calcChannel< 11>(ch, buf, num, pmPhase, amPhase); break;
+	case  12: calcChannel< 12>(ch, buf, num, pmPhase, amPhase); break;
+	case  13: calcChannel< 13>(ch, buf, num, pmPhase, amPhase); break;
+	case  14: calcChannel< 14>(ch, buf, num, pmPhase, amPhase); break;
+	case  15: calcChannel< 15>(ch, buf, num, pmPhase, amPhase); break;
+	case  16: calcChannel< 16>(ch, buf, num, pmPhase, amPhase); break;
+	case  17: calcChannel< 17>(ch, buf, num, pmPhase, amPhase); break;
+	case  18: calcChannel< 18>(ch, buf, num, pmPhase, amPhase); break;
+	case  19: calcChannel< 19>(ch, buf, num, pmPhase, amPhase); break;
+	case  20: calcChannel< 20>(ch, buf, num, pmPhase, amPhase); break;
+	case  21: calcChannel< 21>(ch, buf, num, pmPhase, amPhase); break;
+	case  22: calcChannel< 22>(ch, buf, num, pmPhase, amPhase); break;
+	case  23: calcChannel< 23>(ch, buf, num, pmPhase, amPhase); break;
+	case  24: calcChannel< 24>(ch, buf, num, pmPhase, amPhase); break;
+	case  25: calcChannel< 25>(ch, buf, num, pmPhase, amPhase); break;
+	case  26: calcChannel< 26>(ch, buf, num, pmPhase, amPhase); break;
+	case  27: calcChannel< 27>(ch, buf, num, pmPhase, amPhase); break;
+	case  28: calcChannel< 28>(ch, buf, num, pmPhase, amPhase); break;
+	case  29: calcChannel< 29>(ch, buf, num, pmPhase, amPhase); break;
+	case  30: calcChannel< 30>(ch, buf, num, pmPhase, amPhase); break;
+	case  31: calcChannel< 31>(ch, buf, num, pmPhase, amPhase); break;
+	case  32: calcChannel< 32>(ch, buf, num, pmPhase, amPhase); break;
+	case  33: calcChannel< 33>(ch, buf, num, pmPhase, amPhase); break;
+	case  34: calcChannel< 34>(ch, buf, num, pmPhase, amPhase); break;
+	case  35: calcChannel< 35>(ch, buf, num, pmPhase, amPhase); break;
+	case  36: calcChannel< 36>(ch, buf, num, pmPhase, amPhase); break;
+	case  37: calcChannel< 37>(ch, buf, num, pmPhase, amPhase); break;
+	case  38: calcChannel< 38>(ch, buf, num, pmPhase, amPhase); break;
+	case  39: calcChannel< 39>(ch, buf, num, pmPhase, amPhase); break;
+	case  40: calcChannel< 40>(ch, buf, num, pmPhase, amPhase); break;
+	case  41: calcChannel< 41>(ch, buf, num, pmPhase, amPhase); break;
+	case  42: calcChannel< 42>(ch, buf, num, pmPhase, amPhase); break;
+	case  43: calcChannel< 43>(ch, buf, num, pmPhase, amPhase); break;
+	case  44: calcChannel< 44>(ch, buf, num, pmPhase, amPhase); break;
+	case  45: calcChannel< 45>(ch, buf, num, pmPhase, amPhase); break;
+	case  46: calcChannel< 46>(ch, buf, num, pmPhase, amPhase); break;
+	case  47: calcChannel< 47>(ch, buf, num, pmPhase, amPhase); break;
+	case  48: calcChannel< 48>(ch, buf, num, pmPhase, amPhase); break;
+	case  49: calcChannel< 49>(ch, buf, num, pmPhase, amPhase); break;
+	case  50: calcChannel< 50>(ch, buf, num, pmPhase, amPhase); break;
+	case  51: calcChannel< 51>(ch, buf, num, pmPhase, amPhase); break;
+	case  52: calcChannel< 52>(ch, buf, num, pmPhase, amPhase); break;
+	case  53: calcChannel< 53>(ch, buf, num, pmPhase, amPhase); break;
+	case  54: calcChannel< 54>(ch, buf, num, pmPhase, amPhase); break;
+	case  55: calcChannel< 55>(ch, buf, num, pmPhase, amPhase); break;
+	case  56: calcChannel< 56>(ch, buf, num, pmPhase, amPhase); break;
+	case  57: calcChannel< 57>(ch, buf, num, pmPhase, amPhase); break;
+	case  58: calcChannel< 58>(ch, buf, num, pmPhase, amPhase); break;
+	case  59: calcChannel< 59>(ch, buf, num, pmPhase, amPhase); break;
+	case  60: calcChannel< 60>(ch, buf, num, pmPhase, amPhase); break;
+	case  61: calcChannel< 61>(ch, buf, num, pmPhase, amPhase); break;
+	case  62: calcChannel< 62>(ch, buf, num, pmPhase, amPhase); break;
+	case  63: calcChannel< 63>(ch, buf, num, pmPhase, amPhase); break;
+	case  64: calcChannel< 64>(ch, buf, num, pmPhase, amPhase); break;
+	case  65: calcChannel< 65>(ch, buf, num, pmPhase, amPhase); break;
+	case  66: calcChannel< 66>(ch, buf, num, pmPhase, amPhase); break;
+	case  67: calcChannel< 67>(ch, buf, num, pmPhase, amPhase); break;
+	case  68: calcChannel< 68>(ch, buf, num, pmPhase, amPhase); break;
+	case  69: calcChannel< 69>(ch, buf, num, pmPhase, amPhase); break;
+	case  70: calcChannel< 70>(ch, buf, num, pmPhase, amPhase); break;
+	case  71: calcChannel< 71>(ch, buf, num, pmPhase, amPhase); break;
+	case  72: calcChannel< 72>(ch, buf, num, pmPhase, amPhase); break;
+	case  73: calcChannel< 73>(ch, buf, num, pmPhase, amPhase); break;
+	case  74: calcChannel< 74>(ch, buf, num, pmPhase, amPhase); break;
+	case  75: calcChannel< 75>(ch, buf, num, pmPhase, amPhase); break;
+	case  76: calcChannel< 76>(ch, buf, num, pmPhase, amPhase); break;
+	case  77: calcChannel< 77>(ch, buf, num, pmPhase, amPhase); break;
+	case  78: calcChannel< 78>(ch, buf, num, pmPhase, amPhase); break;
+	case  79: calcChannel< 79>(ch, buf, num, pmPhase, amPhase); break;
+	case  80: calcChannel< 80>(ch, buf, num, pmPhase, amPhase); break;
+	case  81: calcChannel< 81>(ch, buf, num, pmPhase, amPhase); break;
+	case  82: calcChannel< 82>(ch, buf, num, pmPhase, amPhase); break;
+	case  83: calcChannel< 83>(ch, buf, num, pmPhase, amPhase); break;
+	case  84: calcChannel< 84>(ch, buf, num, pmPhase, amPhase); break;
+	case  85: calcChannel< 85>(ch, buf, num, pmPhase, amPhase); break;
+	case  86: calcChannel< 86>(ch, buf, num, pmPhase, amPhase); break;
+	case  87: calcChannel< 87>(ch, buf, num, pmPhase, amPhase); break;
+	case  88: calcChannel< 88>(ch, buf, num, pmPhase, amPhase); break;
+	case  89: calcChannel< 89>(ch, buf, num, pmPhase, amPhase); break;
+	case  90: calcChannel< 90>(ch, buf, num, pmPhase, amPhase); break;
+	case  91: calcChannel< 91>(ch, buf, num, pmPhase, amPhase); break;
+	case  92: calcChannel< 92>(ch, buf, num, pmPhase, amPhase); break;
+	case  93: calcChannel< 93>(ch, buf, num, pmPhase, amPhase); break;
+	case  94: calcChannel< 94>(ch, buf, num, pmPhase, amPhase); break;
+	case  95: calcChannel< 95>(ch, buf, num, pmPhase, amPhase); break;
+	case  96: calcChannel< 96>(ch, buf, num, pmPhase, amPhase); break;
+	case  97: calcChannel< 97>(ch, buf, num, pmPhase, amPhase); break;
+	case  98: calcChannel< 98>(ch, buf, num, pmPhase, amPhase); break;
+	case  99: calcChannel< 99>(ch, buf, num, pmPhase, amPhase); break;
+	case 100: calcChannel<100>(ch, buf, num, pmPhase, amPhase); break;
+	case 101: calcChannel<101>(ch, buf, num, pmPhase, amPhase); break;
+	case 102: calcChannel<102>(ch, buf, num, pmPhase, amPhase); break;
+	case 103: calcChannel<103>(ch, buf, num, pmPhase, amPhase); break;
+	case 104: calcChannel<104>(ch, buf, num, pmPhase, amPhase); break;
+	case 105: calcChannel<105>(ch, buf, num, pmPhase, amPhase); break;
+	case 106: calcChannel<106>(ch, buf, num, pmPhase, amPhase); break;
+	case 107: calcChannel<107>(ch, buf, num, pmPhase, amPhase); break;
+	case 108: calcChannel<108>(ch, buf, num, pmPhase, amPhase); break;
+	case 109: calcChannel<109>(ch, buf, num, pmPhase, amPhase); break;
+	case 110: calcChannel<110>(ch, buf, num, pmPhase, amPhase); break;
+	case 111: calcChannel<111>(ch, buf, num, pmPhase, amPhase); break;
+	case 112: calcChannel<112>(ch, buf, num, pmPhase, amPhase); break;
+	case 113: calcChannel<113>(ch, buf, num, pmPhase, amPhase); break;
+	case 114: calcChannel<114>(ch, buf, num, pmPhase, amPhase); break;
+	case 115: calcChannel<115>(ch, buf, num, pmPhase, amPhase); break;
+	case 116: calcChannel<116>(ch, buf, num, pmPhase, amPhase); break;
+	case 117: calcChannel<117>(ch, buf, num, pmPhase, amPhase); break;
+	case 118: calcChannel<118>(ch, buf, num, pmPhase, amPhase); break;
+	case 119: calcChannel<119>(ch, buf, num, pmPhase, amPhase); break;
+	case 120: calcChannel<120>(ch, buf, num, pmPhase, amPhase); break;
+	case 121: calcChannel<121>(ch, buf, num, pmPhase, amPhase); break;
+	case 122: calcChannel<122>(ch, buf, num, pmPhase, amPhase); break;
+	case 123: calcChannel<123>(ch, buf, num, pmPhase, amPhase); break;
+	case 124: calcChannel<124>(ch, buf, num, pmPhase, amPhase); break;
+	case 125: calcChannel<125>(ch, buf, num, pmPhase, amPhase); break;
+	case 126: calcChannel<126>(ch, buf, num, pmPhase, amPhase); break;
+	case 127: calcChannel<127>(ch, buf, num, pmPhase, amPhase); break;
+	default: UNREACHABLE;
+	}
+}
+
 void YM2413::generateChannels(int* bufs[9 + 5], unsigned num)
 {
 	assert(num != 0);
@@ -1158,152 +1323,19 @@ void YM2413::generateChannels(int* bufs[9 + 5], unsigned num)
 	for (unsigned i = 0; i < m; ++i) {
 		Channel& ch = channels[i];
 		if (ch.car.isActive()) {
-			// Below we choose between 128 specialized versions of
-			// calcChannel(). This allows to move a lot of
-			// conditional code out of the inner-loop.
-			bool carFixedEnv = (ch.car.state == SUSHOLD) ||
-			                   (ch.car.state == FINISH);
-			bool modFixedEnv = (ch.mod.state == SUSHOLD) ||
-			                   (ch.mod.state == FINISH);
-			if (ch.car.state == SETTLE) {
-				modFixedEnv = false;
-			}
-			unsigned flags = ( ch.car.patch.AMPM     << 0) |
-			                 ( ch.mod.patch.AMPM     << 2) |
-			                 ((ch.mod.patch.FB != 0) << 4) |
-			                 ( carFixedEnv           << 5) |
-			                 ( modFixedEnv           << 6);
-			switch (flags) {
-			case   0: calcChannel<  0>(ch, bufs[i], num); break;
-			case   1: calcChannel<  1>(ch, bufs[i], num); break;
-			case   2: calcChannel<  2>(ch, bufs[i], num); break;
-			case   3: calcChannel<  3>(ch, bufs[i], num); break;
-			case   4: calcChannel<  4>(ch, bufs[i], num); break;
-			case   5: calcChannel<  5>(ch, bufs[i], num); break;
-			case   6: calcChannel<  6>(ch, bufs[i], num); break;
-			case   7: calcChannel<  7>(ch, bufs[i], num); break;
-			case   8: calcChannel<  8>(ch, bufs[i], num); break;
-			case   9: calcChannel<  9>(ch, bufs[i], num); break;
-			case  10: calcChannel< 10>(ch, bufs[i], num); break;
-			case  11: calcChannel< 11>(ch, bufs[i], num); break;
-			case  12: calcChannel< 12>(ch, bufs[i], num); break;
-			case  13: calcChannel< 13>(ch, bufs[i], num); break;
-			case  14: calcChannel< 14>(ch, bufs[i], num); break;
-			case  15: calcChannel< 15>(ch, bufs[i], num); break;
-			case  16: calcChannel< 16>(ch, bufs[i], num); break;
-			case  17: calcChannel< 17>(ch, bufs[i], num); break;
-			case  18: calcChannel< 18>(ch, bufs[i], num); break;
-			case  19: calcChannel< 19>(ch, bufs[i], num); break;
-			case  20: calcChannel< 20>(ch, bufs[i], num); break;
-			case  21: calcChannel< 21>(ch, bufs[i], num); break;
-			case  22: calcChannel< 22>(ch, bufs[i], num); break;
-			case  23: calcChannel< 23>(ch, bufs[i], num); break;
-			case  24: calcChannel< 24>(ch, bufs[i], num); break;
-			case  25: calcChannel< 25>(ch, bufs[i], num); break;
-			case  26: calcChannel< 26>(ch, bufs[i], num); break;
-			case  27: calcChannel< 27>(ch, bufs[i], num); break;
-			case  28: calcChannel< 28>(ch, bufs[i], num); break;
-			case  29: calcChannel< 29>(ch, bufs[i], num); break;
-			case  30: calcChannel< 30>(ch, bufs[i], num); break;
-			case  31: calcChannel< 31>(ch, bufs[i], num); break;
-			case  32: calcChannel< 32>(ch, bufs[i], num); break;
-			case  33: calcChannel< 33>(ch, bufs[i], num); break;
-			case  34: calcChannel< 34>(ch, bufs[i], num); break;
-			case  35: calcChannel< 35>(ch, bufs[i], num); break;
-			case  36: calcChannel< 36>(ch, bufs[i], num); break;
-			case  37: calcChannel< 37>(ch, bufs[i], num); break;
-			case  38: calcChannel< 38>(ch, bufs[i], num); break;
-			case  39: calcChannel< 39>(ch, bufs[i], num); break;
-			case  40: calcChannel< 40>(ch, bufs[i], num); break;
-			case  41: calcChannel< 41>(ch, bufs[i], num); break;
-			case  42: calcChannel< 42>(ch, bufs[i], num); break;
-			case  43: calcChannel< 43>(ch, bufs[i], num); break;
-			case  44: calcChannel< 44>(ch, bufs[i], num); break;
-			case  45: calcChannel< 45>(ch, bufs[i], num); break;
-			case  46: calcChannel< 46>(ch, bufs[i], num); break;
-			case  47: calcChannel< 47>(ch, bufs[i], num); break;
-			case  48: calcChannel< 48>(ch, bufs[i], num); break;
-			case  49: calcChannel< 49>(ch, bufs[i], num); break;
-			case  50: calcChannel< 50>(ch, bufs[i], num); break;
-			case  51: calcChannel< 51>(ch, bufs[i], num); break;
-			case  52: calcChannel< 52>(ch, bufs[i], num); break;
-			case  53: calcChannel< 53>(ch, bufs[i], num); break;
-			case  54: calcChannel< 54>(ch, bufs[i], num); break;
-			case  55: calcChannel< 55>(ch, bufs[i], num); break;
-			case  56: calcChannel< 56>(ch, bufs[i], num); break;
-			case  57: calcChannel< 57>(ch, bufs[i], num); break;
-			case  58: calcChannel< 58>(ch, bufs[i], num); break;
-			case  59: calcChannel< 59>(ch, bufs[i], num); break;
-			case  60: calcChannel< 60>(ch, bufs[i], num); break;
-			case  61: calcChannel< 61>(ch, bufs[i], num); break;
-			case  62: calcChannel< 62>(ch, bufs[i], num); break;
-			case  63: calcChannel< 63>(ch, bufs[i], num); break;
-			case  64: calcChannel< 64>(ch, bufs[i], num); break;
-			case  65: calcChannel< 65>(ch, bufs[i], num); break;
-			case  66: calcChannel< 66>(ch, bufs[i], num); break;
-			case  67: calcChannel< 67>(ch, bufs[i], num); break;
-			case  68: calcChannel< 68>(ch, bufs[i], num); break;
-			case  69: calcChannel< 69>(ch, bufs[i], num); break;
-			case  70: calcChannel< 70>(ch, bufs[i], num); break;
-			case  71: calcChannel< 71>(ch, bufs[i], num); break;
-			case  72: calcChannel< 72>(ch, bufs[i], num); break;
-			case  73: calcChannel< 73>(ch, bufs[i], num); break;
-			case  74: calcChannel< 74>(ch, bufs[i], num); break;
-			case  75: calcChannel< 75>(ch, bufs[i], num); break;
-			case  76: calcChannel< 76>(ch, bufs[i], num); break;
-			case  77: calcChannel< 77>(ch, bufs[i], num); break;
-			case  78: calcChannel< 78>(ch, bufs[i], num); break;
-			case  79: calcChannel< 79>(ch, bufs[i], num); break;
-			case  80: calcChannel< 80>(ch, bufs[i], num); break;
-			case  81: calcChannel< 81>(ch, bufs[i], num); break;
-			case  82: calcChannel< 82>(ch, bufs[i], num); break;
-			case  83: calcChannel< 83>(ch, bufs[i], num); break;
-			case  84: calcChannel< 84>(ch, bufs[i], num); break;
-			case  85: calcChannel< 85>(ch, bufs[i], num); break;
-			case  86: calcChannel< 86>(ch, bufs[i], num); break;
-			case  87: calcChannel< 87>(ch, bufs[i], num); break;
-			case  88: calcChannel< 88>(ch, bufs[i], num); break;
-			case  89: calcChannel< 89>(ch, bufs[i], num); break;
-			case  90: calcChannel< 90>(ch, bufs[i], num); break;
-			case  91: calcChannel< 91>(ch, bufs[i], num); break;
-			case  92: calcChannel< 92>(ch, bufs[i], num); break;
-			case  93: calcChannel< 93>(ch, bufs[i], num); break;
-			case  94: calcChannel< 94>(ch, bufs[i], num); break;
-			case  95: calcChannel< 95>(ch, bufs[i], num); break;
-			case  96: calcChannel< 96>(ch, bufs[i], num); break;
-			case  97: calcChannel< 97>(ch, bufs[i], num); break;
-			case  98: calcChannel< 98>(ch, bufs[i], num); break;
-			case  99: calcChannel< 99>(ch, bufs[i], num); break;
-			case 100: calcChannel<100>(ch, bufs[i], num); break;
-			case 101: calcChannel<101>(ch, bufs[i], num); break;
-			case 102: calcChannel<102>(ch, bufs[i], num); break;
-			case 103: calcChannel<103>(ch, bufs[i], num); break;
-			case 104: calcChannel<104>(ch, bufs[i], num); break;
-			case 105: calcChannel<105>(ch, bufs[i], num); break;
-			case 106: calcChannel<106>(ch, bufs[i], num); break;
-			case 107: calcChannel<107>(ch, bufs[i], num); break;
-			case 108: calcChannel<108>(ch, bufs[i], num); break;
-			case 109: calcChannel<109>(ch, bufs[i], num); break;
-			case 110: calcChannel<110>(ch, bufs[i], num); break;
-			case 111: calcChannel<111>(ch, bufs[i], num); break;
-			case 112: calcChannel<112>(ch, bufs[i], num); break;
-			case 113: calcChannel<113>(ch, bufs[i], num); break;
-			case 114: calcChannel<114>(ch, bufs[i], num); break;
-			case 115: calcChannel<115>(ch, bufs[i], num); break;
-			case 116: calcChannel<116>(ch, bufs[i], num); break;
-			case 117: calcChannel<117>(ch, bufs[i], num); break;
-			case 118: calcChannel<118>(ch, bufs[i], num); break;
-			case 119: calcChannel<119>(ch, bufs[i], num); break;
-			case 120: calcChannel<120>(ch, bufs[i], num); break;
-			case 121: calcChannel<121>(ch, bufs[i], num); break;
-			case 122: calcChannel<122>(ch, bufs[i], num); break;
-			case 123: calcChannel<123>(ch, bufs[i], num); break;
-			case 124: calcChannel<124>(ch, bufs[i], num); break;
-			case 125: calcChannel<125>(ch, bufs[i], num); break;
-			case 126: calcChannel<126>(ch, bufs[i], num); break;
-			case 127: calcChannel<127>(ch, bufs[i], num); break;
-			default: UNREACHABLE;
-			}
+			// Split the buffer at the samples where the envelope of
+			// one of the slots changes state, so that each block can
+			// use the best specialized version of calcChannel()
+			// (e.g. a fixed envelope as soon as SUSHOLD is reached).
+			unsigned sample = 0;
+			do {
+				unsigned n = num - sample;
+				n = ch.mod.envelopeSamples(n);
+				n = ch.car.envelopeSamples(n);
+				calcChannelBlock(ch, bufs[i] + sample, n, pm_phase + sample,
+				                 (am_phase + sample) % (LFO_AM_TAB_ELEMENTS * 64));
+				sample += n;
+			} while (sample < num);
 		} else {
 			bufs[i] = nullptr;
 		}
@@ -73,6 +73,7 @@ public:
 	template <bool HAS_AM, bool FIXED_ENV>
 	inline unsigned calc_envelope(int lfo_am, unsigned fixed_env);
 	template <bool HAS_AM> unsigned calc_fixed_env() const;
+	unsigned envelopeSamples(unsigned limit) const;
 	void calc_envelope_outline(unsigned& out);
 	template<bool HAS_AM, bool FIXED_ENV>
 	inline int calc_slot_car(unsigned lfo_pm, int lfo_am, int fm, unsigned fixed_env);
@@ -152,7 +153,10 @@ public:
 	Patch& getPatch(unsigned instrument, bool carrier);
 
 	template <unsigned FLAGS>
-	inline void calcChannel(Channel& ch, int* buf, unsigned num);
+	inline void calcChannel(Channel& ch, int* buf, unsigned num,
+	                        unsigned pmPhase, unsigned amPhase);
+	void calcChannelBlock(Channel& ch, int* buf, unsigned num,
+	                      unsigned pmPhase, unsigned amPhase);
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
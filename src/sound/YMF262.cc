@@ -44,6 +44,7 @@
 #include "cstd.hh"
 #include "outer.hh"
 #include "serialize.hh"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -492,12 +493,6 @@ static CONSTEXPR SinTab getSinTab()
 static CONSTEXPR SinTab sin = getSinTab();
 
 
-// TODO clean this up
-static int phase_modulation;  // phase modulation input (SLOT 2)
-static int phase_modulation2; // phase modulation input (SLOT 3
-                              // in 4 operator channels)
-
-
 YMF262::Slot::Slot()
 	: Cnt(0), Incr(0)
 {
@@ -636,45 +631,80 @@ void YMF262::Slot::advancePhaseGenerator(Channel& ch, unsigned lfo_pm)
 	}
 }
 
-// advance to next sample
-void YMF262::advance()
+// A slot that is off (or in the release phase) and that is attenuated far
+// enough always outputs zero: op_calc() returns 0 for any phase and any LFO AM
+// value. It stays like that until the next key-on (register write).
+inline bool YMF262::Slot::isMuted() const
 {
-	// Vibrato: 8 output levels (triangle waveform);
-	// 1 level takes 1024 samples
-	lfo_pm_cnt.addQuantum();
-	unsigned lfo_pm = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
+	return ((state == EG_OFF) || (state == EG_RELEASE)) &&
+	       ((TLL + volume) >= ENV_QUIET);
+}
 
-	++eg_cnt;
-	for (auto& ch : channel) {
-		for (auto& op : ch.slot) {
-			op.advanceEnvelopeGenerator(eg_cnt);
-			op.advancePhaseGenerator(ch, lfo_pm);
-		}
+// advance envelope and phase of both slots to the next sample
+inline void YMF262::Channel::advance(unsigned eg_cnt, unsigned lfo_pm)
+{
+	for (auto& op : slot) {
+		op.advanceEnvelopeGenerator(eg_cnt);
+		op.advancePhaseGenerator(*this, lfo_pm);
 	}
+}
 
-	// The Noise Generator of the YM3812 is 23-bit shift register.
-	// Period is equal to 2^23-2 samples.
-	// Register works at sampling frequency of the chip, so output
-	// can change on every sample.
-	//
-	// Output of the register and input to the bit 22 is:
-	// bit0 XOR bit14 XOR bit15 XOR bit22
-	//
-	// Simply use bit 22 as the noise output.
-	//
-	// unsigned j = ((noise_rng >>  0) ^ (noise_rng >> 14) ^
-	//               (noise_rng >> 15) ^ (noise_rng >> 22)) & 1;
-	// noise_rng = (j << 22) | (noise_rng >> 1);
-	//
-	// Instead of doing all the logic operations above, we
-	// use a trick here (and use bit 0 as the noise output).
-	// The difference is only that the noise bit changes one
-	// step ahead. This doesn't matter since we don't know
-	// what is real state of the noise_rng after the reset.
-	if (noise_rng & 1) {
-		noise_rng ^= 0x800302;
+inline bool YMF262::Channel::isMuted() const
+{
+	return slot[MOD].isMuted() && slot[CAR].isMuted();
+}
+
+// calculate the shared state (LFOs, envelope counter and noise generator) for
+// each sample in the block
+void YMF262::prepareBlock(Block& block)
+{
+	for (unsigned j = 0; j < block.num; ++j) {
+		// Amplitude modulation: 27 output levels (triangle waveform);
+		// 1 level takes one of: 192, 256 or 448 samples
+		// One entry from LFO_AM_TABLE lasts for 64 samples
+		lfo_am_cnt.addQuantum();
+		if (lfo_am_cnt == LFOAMIndex(LFO_AM_TAB_ELEMENTS)) {
+			// lfo_am_table is 210 elements long
+			lfo_am_cnt = LFOAMIndex(0);
+		}
+		unsigned tmp = lfo_am_table[lfo_am_cnt.toInt()];
+		block.lfo_am[j] = lfo_am_depth ? tmp : tmp / 4;
+
+		// The noise bit is used for the output of this sample, the
+		// values below are used to advance to the next sample.
+		block.noise[j] = (noise_rng & 1) != 0;
+
+		// Vibrato: 8 output levels (triangle waveform);
+		// 1 level takes 1024 samples
+		lfo_pm_cnt.addQuantum();
+		block.lfo_pm[j] = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
+
+		block.eg_cnt[j] = ++eg_cnt;
+
+		// The Noise Generator of the YM3812 is 23-bit shift register.
+		// Period is equal to 2^23-2 samples.
+		// Register works at sampling frequency of the chip, so output
+		// can change on every sample.
+		//
+		// Output of the register and input to the bit 22 is:
+		// bit0 XOR bit14 XOR bit15 XOR bit22
+		//
+		// Simply use bit 22 as the noise output.
+		//
+		// unsigned j = ((noise_rng >>  0) ^ (noise_rng >> 14) ^
+		//               (noise_rng >> 15) ^ (noise_rng >> 22)) & 1;
+		// noise_rng = (j << 22) | (noise_rng >> 1);
+		//
+		// Instead of doing all the logic operations above, we
+		// use a trick here (and use bit 0 as the noise output).
+		// The difference is only that the noise bit changes one
+		// step ahead. This doesn't matter since we don't know
+		// what is real state of the noise_rng after the reset.
+		if (noise_rng & 1) {
+			noise_rng ^= 0x800302;
+		}
+		noise_rng >>= 1;
 	}
-	noise_rng >>= 1;
 }
 
 inline int YMF262::Slot::op_calc(unsigned phase, unsigned lfo_am) const
@@ -686,7 +716,8 @@ inline int YMF262::Slot::op_calc(unsigned phase, unsigned lfo_am) const
 
 // calculate output of a standard 2 operator channel
 // (or 1st part of a 4-op channel)
-void YMF262::Channel::chan_calc(unsigned lfo_am)
+void YMF262::Channel::chan_calc(unsigned lfo_am, int& phase_modulation,
+                                int& phase_modulation2)
 {
 	// !! something is wrong with this, it caused bug
 	// !!    [2823673] moonsound 4 operator FM fail
@@ -725,7 +756,8 @@ void YMF262::Channel::chan_calc(unsigned lfo_am)
 }
 
 // calculate output of a 2nd part of 4-op channel
-void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
+void YMF262::Channel::chan_calc_ext(unsigned lfo_am, int& phase_modulation,
+                                    int& phase_modulation2)
 {
 	// !! see remark in chan_cal(), something is wrong with this
 	// !! optimization disabled for now
@@ -781,7 +813,7 @@ void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
 // The following formulas can be well optimized.
 // I leave them in direct form for now (in case I've missed something).
 
-inline int YMF262::genPhaseHighHat()
+inline int YMF262::genPhaseHighHat(bool noise)
 {
 	// high hat phase generation (verified on real YM3812):
 	// phase = d0 or 234 (based on frequency only)
@@ -811,26 +843,26 @@ inline int YMF262::genPhaseHighHat()
 	// when phase & 0x200 is set and noise=1 then phase = 0x200|0xd0
 	// when phase & 0x200 is set and noise=0 then phase = 0x200|(0xd0>>2), ie no change
 	if (phase & 0x200) {
-		if (noise_rng & 1) {
+		if (noise) {
 			phase = 0x200 | 0xd0;
 		}
 	} else {
 	// when phase & 0x200 is clear and noise=1 then phase = 0xd0>>2
 	// when phase & 0x200 is clear and noise=0 then phase = 0xd0, ie no change
-		if (noise_rng & 1) {
+		if (noise) {
 			phase = 0xd0 >> 2;
 		}
 	}
 	return phase;
 }
 
-inline int YMF262::genPhaseSnare()
+inline int YMF262::genPhaseSnare(bool noise)
 {
 	// verified on real YM3812
 	// base frequency derived from operator 1 in channel 7
 	// noise bit XOR'es phase by 0x100
 	return ((channel[7].slot[MOD].Cnt.toInt() & 0x100) + 0x100)
-	     ^ ((noise_rng & 1) << 8);
+	     ^ (int(noise) << 8);
 }
 
 inline int YMF262::genPhaseCymbal()
@@ -853,7 +885,7 @@ inline int YMF262::genPhaseCymbal()
 }
 
 // calculate rhythm
-void YMF262::chan_calc_rhythm(unsigned lfo_am)
+void YMF262::chan_calc_rhythm(unsigned lfo_am, bool noise)
 {
 	// Bass Drum (verified on real YM3812):
 	//  - depends on the channel 6 'connect' register:
@@ -884,9 +916,9 @@ void YMF262::chan_calc_rhythm(unsigned lfo_am)
 	// TOM channel 8->slot1
 	// TOP channel 8->slot2
 	auto& mod7 = channel[7].slot[MOD];
-	chanout[7] += 2 * mod7.op_calc(genPhaseHighHat(), lfo_am);
+	chanout[7] += 2 * mod7.op_calc(genPhaseHighHat(noise), lfo_am);
 	auto& car7 = channel[7].slot[CAR];
-	chanout[7] += 2 * car7.op_calc(genPhaseSnare(),   lfo_am);
+	chanout[7] += 2 * car7.op_calc(genPhaseSnare(noise), lfo_am);
 	auto& mod8 = channel[8].slot[MOD];
 	chanout[8] += 2 * mod8.op_calc(mod8.Cnt.toInt(),  lfo_am);
 	auto& car8 = channel[8].slot[CAR];
@@ -1478,6 +1510,7 @@ YMF262::YMF262(const std::string& name_,
 	// avoid (harmless) UMR in serialize()
 	memset(chanout, 0, sizeof(chanout));
 	memset(reg, 0, sizeof(reg));
+	phase_modulation = phase_modulation2 = 0;
 
 	// For debugging: print out tables to be able to compare before/after
 	// when the calculation changes.
@@ -1514,7 +1547,7 @@ byte YMF262::peekStatus() const
 	return status | status2;
 }
 
-bool YMF262::checkMuteHelper()
+bool YMF262::isSilent() const
 {
 	// TODO this doesn't always mute when possible
 	for (auto& ch : channel) {
@@ -1538,7 +1571,7 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 {
 	// TODO implement per-channel mute (instead of all-or-nothing)
 	// TODO output rhythm on separate channels?
-	if (checkMuteHelper()) {
+	if (isSilent()) {
 		// TODO update internal state, even if muted
 		for (int i = 0; i < 18; ++i) {
 			bufs[i] = nullptr;
@@ -1548,62 +1581,152 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 
 	bool rhythmEnabled = (rhythm & 0x20) != 0;
 
-	for (unsigned j = 0; j < num; ++j) {
-		// Amplitude modulation: 27 output levels (triangle waveform);
-		// 1 level takes one of: 192, 256 or 448 samples
-		// One entry from LFO_AM_TABLE lasts for 64 samples
-		lfo_am_cnt.addQuantum();
-		if (lfo_am_cnt == LFOAMIndex(LFO_AM_TAB_ELEMENTS)) {
-			// lfo_am_table is 210 elements long
-			lfo_am_cnt = LFOAMIndex(0);
-		}
-		unsigned tmp = lfo_am_table[lfo_am_cnt.toInt()];
-		unsigned lfo_am = lfo_am_depth ? tmp : tmp / 4;
+	Block block;
+	for (unsigned pos = 0; pos < num; pos += block.num) {
+		block.num = std::min(num - pos, unsigned(BLOCK_SIZE));
+		prepareBlock(block);
 
-		// clear channel outputs
-		memset(chanout, 0, sizeof(chanout));
+		int* b[18];
+		for (int i = 0; i < 18; ++i) {
+			b[i] = bufs[i] + 2 * pos;
+		}
 
 		// channels 0,3 1,4 2,5  9,12 10,13 11,14
 		// in either 2op or 4op mode
 		for (int k = 0; k <= 9; k += 9) {
 			for (int i = 0; i < 3; ++i) {
-				auto& ch0 = channel[k + i + 0];
-				auto& ch3 = channel[k + i + 3];
-				// extended 4op ch#0 part 1 or 2op ch#0
-				ch0.chan_calc(lfo_am);
-				if (ch0.extended) {
-					// extended 4op ch#0 part 2
-					ch3.chan_calc_ext(lfo_am);
+				int c = k + i;
+				if (channel[c].extended) {
+					calc4OpChannelBlock(c, block, b[c], b[c + 3]);
 				} else {
-					// standard 2op ch#3
-					ch3.chan_calc(lfo_am);
+					calcChannelBlock(c + 0, block, b[c + 0]);
+					calcChannelBlock(c + 3, block, b[c + 3]);
 				}
 			}
 		}
 
 		// channels 6,7,8 rhythm or 2op mode
 		if (!rhythmEnabled) {
-			channel[6].chan_calc(lfo_am);
-			channel[7].chan_calc(lfo_am);
-			channel[8].chan_calc(lfo_am);
+			calcChannelBlock(6, block, b[6]);
+			calcChannelBlock(7, block, b[7]);
+			calcChannelBlock(8, block, b[8]);
 		} else {
-			// Rhythm part
-			chan_calc_rhythm(lfo_am);
+			calcRhythmBlock(block, b);
 		}
 
 		// channels 15,16,17 are fixed 2-operator channels only
-		channel[15].chan_calc(lfo_am);
-		channel[16].chan_calc(lfo_am);
-		channel[17].chan_calc(lfo_am);
+		calcChannelBlock(15, block, b[15]);
+		calcChannelBlock(16, block, b[16]);
+		calcChannelBlock(17, block, b[17]);
+	}
+}
 
-		for (int i = 0; i < 18; ++i) {
-			bufs[i][2 * j + 0] += chanout[i] & pan[4 * i + 0];
-			bufs[i][2 * j + 1] += chanout[i] & pan[4 * i + 1];
-			// unused c        += chanout[i] & pan[4 * i + 2];
-			// unused d        += chanout[i] & pan[4 * i + 3];
+// Only advance envelope and phase of a muted channel, its output is zero.
+void YMF262::skipChannelBlock(Channel& ch, const Block& block)
+{
+	for (unsigned j = 0; j < block.num; ++j) {
+		ch.advance(block.eg_cnt[j], block.lfo_pm[j]);
+	}
+}
+
+// Calculate a standard 2 operator channel for all samples in the block.
+void YMF262::calcChannelBlock(unsigned c, const Block& block, int* buf)
+{
+	auto& ch = channel[c];
+	auto& mod = ch.slot[MOD];
+	auto& car = ch.slot[CAR];
+	if (ch.isMuted()) {
+		// the modulator output (for feedback) becomes zero
+		mod.op1_out[0] = (block.num == 1) ? mod.op1_out[1] : 0;
+		mod.op1_out[1] = 0;
+		chanout[c] = 0;
+		skipChannelBlock(ch, block);
+		return;
+	}
+	unsigned panA = pan[4 * c + 0];
+	unsigned panB = pan[4 * c + 1];
+	if ((car.connect == &chanout[c]) &&
+	    ((mod.connect == &chanout[c]) || (mod.connect == &phase_modulation))) {
+		// The common case: the modulator output is either added to
+		// the output or it modulates the carrier. This is the same
+		// calculation as chan_calc(), but without the indirection
+		// via the 'connect' pointers it can be kept in registers.
+		bool additive = mod.connect == &chanout[c];
+		int out = 0;
+		for (unsigned j = 0; j < block.num; ++j) {
+			unsigned lfo_am = block.lfo_am[j];
+			int fb = mod.fb_shift
+				? mod.op1_out[0] + mod.op1_out[1]
+				: 0;
+			mod.op1_out[0] = mod.op1_out[1];
+			int m = mod.op_calc(mod.Cnt.toInt() + (fb >> mod.fb_shift), lfo_am);
+			mod.op1_out[1] = m;
+			out = additive
+			    ? m + car.op_calc(car.Cnt.toInt(), lfo_am)
+			    : car.op_calc(car.Cnt.toInt() + m, lfo_am);
+			buf[2 * j + 0] += out & panA;
+			buf[2 * j + 1] += out & panB;
+			ch.advance(block.eg_cnt[j], block.lfo_pm[j]);
 		}
+		chanout[c] = out;
+		return;
+	}
+	for (unsigned j = 0; j < block.num; ++j) {
+		chanout[c] = 0;
+		ch.chan_calc(block.lfo_am[j], phase_modulation, phase_modulation2);
+		buf[2 * j + 0] += chanout[c] & panA;
+		buf[2 * j + 1] += chanout[c] & panB;
+		// unused c    += chanout[c] & pan[4 * c + 2];
+		// unused d    += chanout[c] & pan[4 * c + 3];
+		ch.advance(block.eg_cnt[j], block.lfo_pm[j]);
+	}
+}
 
-		advance();
+// Calculate a 4 operator channel (channels c0 and c0 + 3) for all samples in
+// the block. Both parts have to be calculated together because the output of
+// the first part modulates the second part.
+void YMF262::calc4OpChannelBlock(unsigned c0, const Block& block,
+                                 int* buf0, int* buf3)
+{
+	unsigned c3 = c0 + 3;
+	auto& ch0 = channel[c0];
+	auto& ch3 = channel[c3];
+	if (ch0.isMuted() && ch3.isMuted()) {
+		// only the first part uses feedback (see chan_calc_ext())
+		auto& mod = ch0.slot[MOD];
+		mod.op1_out[0] = (block.num == 1) ? mod.op1_out[1] : 0;
+		mod.op1_out[1] = 0;
+		chanout[c0] = chanout[c3] = 0;
+		skipChannelBlock(ch0, block);
+		skipChannelBlock(ch3, block);
+		return;
+	}
+	for (unsigned j = 0; j < block.num; ++j) {
+		chanout[c0] = 0;
+		chanout[c3] = 0;
+		ch0.chan_calc    (block.lfo_am[j], phase_modulation, phase_modulation2);
+		ch3.chan_calc_ext(block.lfo_am[j], phase_modulation, phase_modulation2);
+		buf0[2 * j + 0] += chanout[c0] & pan[4 * c0 + 0];
+		buf0[2 * j + 1] += chanout[c0] & pan[4 * c0 + 1];
+		buf3[2 * j + 0] += chanout[c3] & pan[4 * c3 + 0];
+		buf3[2 * j + 1] += chanout[c3] & pan[4 * c3 + 1];
+		ch0.advance(block.eg_cnt[j], block.lfo_pm[j]);
+		ch3.advance(block.eg_cnt[j], block.lfo_pm[j]);
+	}
+}
+
+// Calculate the rhythm channels (6, 7 and 8) for all samples in the block.
+// These depend on each other, so they're calculated together.
+void YMF262::calcRhythmBlock(const Block& block, int** bufs)
+{
+	for (unsigned j = 0; j < block.num; ++j) {
+		chanout[6] = chanout[7] = chanout[8] = 0;
+		chan_calc_rhythm(block.lfo_am[j], block.noise[j]);
+		for (unsigned c = 6; c <= 8; ++c) {
+			bufs[c][2 * j + 0] += chanout[c] & pan[4 * c + 0];
+			bufs[c][2 * j + 1] += chanout[c] & pan[4 * c + 1];
+			channel[c].advance(block.eg_cnt[j], block.lfo_pm[j]);
+		}
 	}
 }
 
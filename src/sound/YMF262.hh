@@ -34,6 +34,9 @@ public:
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
+	// for YMF262Bench, plays register logs without the mixer
+	friend class YMF262Bench;
+
 public:
 	/** 16.16 fixed point type for frequency calculations */
 	using FreqIndex = FixedPoint<16>;
@@ -53,6 +56,7 @@ private:
 		inline void FM_KEYOFF(byte key_clr);
 		inline void advanceEnvelopeGenerator(unsigned eg_cnt);
 		inline void advancePhaseGenerator(Channel& ch, unsigned lfo_pm);
+		inline bool isMuted() const;
 		void update_ar_dr();
 		void update_rr();
 		void calc_fc(const Channel& ch);
@@ -113,8 +117,12 @@ private:
 	class Channel {
 	public:
 		Channel();
-		void chan_calc(unsigned lfo_am);
-		void chan_calc_ext(unsigned lfo_am);
+		void chan_calc(unsigned lfo_am, int& phase_modulation,
+		               int& phase_modulation2);
+		void chan_calc_ext(unsigned lfo_am, int& phase_modulation,
+		                   int& phase_modulation2);
+		inline void advance(unsigned eg_cnt, unsigned lfo_pm);
+		inline bool isMuted() const;
 
 		template<typename Archive>
 		void serialize(Archive& ar, unsigned version);
@@ -142,6 +150,7 @@ private:
 	// SoundDevice
 	int getAmplificationFactorImpl() const override;
 	void generateChannels(int** bufs, unsigned num) override;
+	bool isSilent() const override;
 
 	void callback(byte flag) override;
 
@@ -150,18 +159,35 @@ private:
 	void setStatus(byte flag);
 	void resetStatus(byte flag);
 	void changeStatusMask(byte flag);
-	void advance();
 
-	inline int genPhaseHighHat();
-	inline int genPhaseSnare();
+	/** The output is calculated in blocks of (at most) this many samples:
+	  * first the state that is shared by all channels (LFOs, envelope
+	  * counter and noise generator) for each sample in the block, then
+	  * all samples of the block for one channel after the other. */
+	static const unsigned BLOCK_SIZE = 128;
+	struct Block {
+		unsigned num;
+		unsigned lfo_am[BLOCK_SIZE];
+		unsigned lfo_pm[BLOCK_SIZE];
+		unsigned eg_cnt[BLOCK_SIZE];
+		bool noise[BLOCK_SIZE];
+	};
+	void prepareBlock(Block& block);
+	void calcChannelBlock(unsigned ch, const Block& block, int* buf);
+	void calc4OpChannelBlock(unsigned ch0, const Block& block,
+	                         int* buf0, int* buf3);
+	void calcRhythmBlock(const Block& block, int** bufs);
+	void skipChannelBlock(Channel& ch, const Block& block);
+
+	inline int genPhaseHighHat(bool noise);
+	inline int genPhaseSnare(bool noise);
 	inline int genPhaseCymbal();
 
-	void chan_calc_rhythm(unsigned lfo_am);
+	void chan_calc_rhythm(unsigned lfo_am, bool noise);
 	void set_mul(unsigned sl, byte v);
 	void set_ksl_tl(unsigned sl, byte v);
 	void set_ar_dr(unsigned sl, byte v);
 	void set_sl_rr(unsigned sl, byte v);
-	bool checkMuteHelper();
 
 	inline bool isExtended(unsigned ch) const;
 	inline Channel& getFirstOfPair(unsigned ch);
@@ -190,6 +216,9 @@ private:
 	IRQHelper irq;
 
 	int chanout[18]; // 18 channels
+	int phase_modulation;  // phase modulation input (SLOT 2)
+	int phase_modulation2; // phase modulation input (SLOT 3
+	                       // in 4 operator channels)
 
 	byte reg[512];
 	Channel channel[18];	// OPL3 chips have 18 channels
@@ -0,0 +1,331 @@
+// Regression test and benchmark for the YMF262 core.
+//
+// Plays a couple of register write logs on a YMF262 (without the resampler
+// and mixer, so directly at the native sample rate) and compares a SHA1 sum of
+// the output of each channel with the sums that the core produced before it
+// was optimized (see 'tests' below). All other channels must remain silent.
+// The logs generate the samples in irregular chunks, so that the blocks in
+// which the core internally calculates the output don't always align with
+// them. Also reports how long it takes to play each log.
+//
+// When the output of the core intentionally changes, the new sums are printed
+// on a mismatch, but only update the table after listening to the result.
+//
+// Usage: YMF262Bench [repeat]
+
+#include "YMF262.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "HardwareConfig.hh"
+#include "DeviceConfig.hh"
+#include "XMLElement.hh"
+#include "MSXException.hh"
+#include "sha1.hh"
+#include "Benchmark.hh"
+#include <SDL.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+static const unsigned CHANNELS = 18;
+
+
+struct RegWrite
+{
+	RegWrite(unsigned reg_, byte val_) : reg(reg_), val(val_) {}
+	unsigned reg; // 0x000-0x0FF: first register set, 0x100-0x1FF: second
+	byte val;
+};
+struct LogEvent
+{
+	vector<RegWrite> regWrites;
+	unsigned samples; // number of samples between this and next event
+};
+using Log = vector<LogEvent>;
+using Samples = vector<int>; // stereo, interleaved
+
+
+namespace openmsx {
+
+// Gives access to the private YMF262 methods that play the log.
+class YMF262Bench
+{
+public:
+	static void writeReg(YMF262& ymf262, unsigned reg, byte value)
+	{
+		ymf262.writeRegDirect(reg, value, EmuTime::zero);
+	}
+	static void generateChannels(YMF262& ymf262, int** bufs, unsigned num)
+	{
+		ymf262.generateChannels(bufs, num);
+	}
+};
+
+} // namespace openmsx
+
+
+static LogEvent event(unsigned samples, vector<RegWrite> regWrites = {})
+{
+	LogEvent result;
+	result.regWrites = std::move(regWrites);
+	result.samples = samples;
+	return result;
+}
+
+// Envelope, frequency and waveform settings for one slot.
+static void setSlot(vector<RegWrite>& w, unsigned bank, unsigned slot,
+                    byte multi, byte tl, byte arDr, byte slRr, byte wave)
+{
+	static const unsigned offset[18] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x09, 0x0A,
+		0x0B, 0x0C, 0x0D, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+	};
+	unsigned r = bank + offset[slot];
+	w.emplace_back(r + 0x20, multi);
+	w.emplace_back(r + 0x40, tl);
+	w.emplace_back(r + 0x60, arDr);
+	w.emplace_back(r + 0x80, slRr);
+	w.emplace_back(r + 0xE0, wave);
+}
+
+static vector<RegWrite> opl3Mode()
+{
+	return { { 0x105, 0x01 }, { 0x104, 0x00 } };
+}
+
+
+static Log logSilence()
+{
+	Log log;
+	log.push_back(event(1000, opl3Mode()));
+	log.push_back(event(1));
+	log.push_back(event(300));
+	return log;
+}
+
+// A single 2-op channel with feedback: attack, decay to the sustain level,
+// a frequency change and the release.
+static Log log2op()
+{
+	auto w = opl3Mode();
+	setSlot(w, 0, 0, 0x21, 0x1A, 0xF4, 0x55, 0x00);
+	setSlot(w, 0, 3, 0x21, 0x00, 0xF3, 0x36, 0x01);
+	w.emplace_back(0xC0, 0x30 | (5 << 1)); // pan left+right, FB=5, FM
+	w.emplace_back(0xA0, 0x98);
+	w.emplace_back(0xB0, 0x31); // key-on, block=4
+	Log log;
+	log.push_back(event(127, w));
+	log.push_back(event(1));
+	log.push_back(event(5000));
+	log.push_back(event(4321, { { 0xA0, 0x40 }, { 0xB0, 0x32 } }));
+	log.push_back(event(3, { { 0x43, 0x10 } })); // carrier volume
+	log.push_back(event(8000, { { 0xB0, 0x12 } })); // key-off
+	return log;
+}
+
+// A 4-op channel (channels 0 and 3) in the second register set, plus a 2-op
+// channel in the first set that's keyed on and off while it's playing.
+static Log log4op()
+{
+	auto w = opl3Mode();
+	w.emplace_back(0x104, 0x08); // channel 9+12 (=register set 1, 0+3) 4-op
+	setSlot(w, 0x100, 0, 0x01, 0x20, 0xE2, 0x24, 0x02);
+	setSlot(w, 0x100, 3, 0x02, 0x18, 0xD3, 0x35, 0x00);
+	setSlot(w, 0x100, 6, 0x04, 0x28, 0xF2, 0x14, 0x03);
+	setSlot(w, 0x100, 9, 0x01, 0x02, 0xF1, 0x47, 0x04);
+	w.emplace_back(0x1C0, 0x10 | (3 << 1) | 1); // left, FB=3
+	w.emplace_back(0x1C3, 0x10 | 0);           // connection: FM-FM-FM-FM
+	w.emplace_back(0x1A0, 0x57);
+	w.emplace_back(0x1B0, 0x2D); // key-on, block=3
+	setSlot(w, 0, 1, 0x23, 0x10, 0xF8, 0x2F, 0x05);
+	setSlot(w, 0, 4, 0x21, 0x00, 0xF8, 0x2F, 0x06);
+	w.emplace_back(0xC1, 0x20 | 1); // right, AM (additive)
+	w.emplace_back(0xA1, 0x20);
+	Log log;
+	log.push_back(event(300, w));
+	log.push_back(event(129, { { 0xB1, 0x39 } })); // key-on
+	log.push_back(event(1000, { { 0x1C3, 0x10 | 1 } })); // FM-AM-FM-FM
+	log.push_back(event(4000, { { 0xB1, 0x19 } })); // key-off
+	log.push_back(event(6000, { { 0x1B0, 0x0D } })); // key-off
+	return log;
+}
+
+// Rhythm mode (all five instruments) with the AM and PM LFOs at full depth
+// on a melodic channel.
+static Log logRhythm()
+{
+	auto w = opl3Mode();
+	setSlot(w, 0, 12, 0x01, 0x10, 0xF6, 0x46, 0x00); // bass drum
+	setSlot(w, 0, 15, 0x01, 0x00, 0xF6, 0x46, 0x00);
+	setSlot(w, 0, 13, 0x01, 0x00, 0xF7, 0x37, 0x00); // high hat
+	setSlot(w, 0, 16, 0x01, 0x00, 0xF7, 0x37, 0x00); // snare
+	setSlot(w, 0, 14, 0x05, 0x00, 0xF8, 0x28, 0x00); // tom
+	setSlot(w, 0, 17, 0x01, 0x00, 0xF5, 0x55, 0x00); // cymbal
+	for (unsigned ch = 6; ch < 9; ++ch) {
+		w.emplace_back(0xC0 + ch, 0x30);
+		w.emplace_back(0xA0 + ch, 0x40 + 0x20 * ch);
+		w.emplace_back(0xB0 + ch, 0x09);
+	}
+	setSlot(w, 0, 2, 0xC1, 0x14, 0xF2, 0x13, 0x00); // AM + vibrato
+	setSlot(w, 0, 5, 0xC1, 0x00, 0xF2, 0x13, 0x00);
+	w.emplace_back(0xC2, 0x30 | (2 << 1));
+	w.emplace_back(0xA2, 0x81);
+	w.emplace_back(0xB2, 0x2A);
+	w.emplace_back(0xBD, 0xC0 | 0x20 | 0x1F); // depth, rhythm, all keys
+	Log log;
+	log.push_back(event(3000, w));
+	log.push_back(event(2500, { { 0xBD, 0xE0 } })); // rhythm key-off
+	log.push_back(event(77,   { { 0xBD, 0xE5 } })); // snare, cymbal
+	log.push_back(event(6000, { { 0xBD, 0xFA } })); // bass, tom, high hat
+	log.push_back(event(2000, { { 0xBD, 0x00 } })); // back to melodic
+	return log;
+}
+
+
+struct Golden
+{
+	unsigned channel;
+	const char* sha1;
+};
+struct Test
+{
+	const char* name;
+	Log (*makeLog)();
+	vector<Golden> golden; // one entry per channel that isn't silent
+};
+
+// Generated with the YMF262 core from before the optimizations (without the
+// block-based generateChannels()), over the 16-bit little endian samples of
+// each channel.
+static const Test tests[] = {
+	{ "silence", logSilence, {} },
+	{ "2op",     log2op,     {
+		{  0, "1b27c72d22a32cc769e8b239b7ebc0f2ae4c0a0a" } } },
+	{ "4op",     log4op,     {
+		{  1, "9a8bfdbf33f3c38a05326145f140c216fcd58694" },
+		{  9, "097803aba0eeed0afc91c2bd50eb2d6fe993a3e6" },
+		{ 12, "2a1ee323644068b730e43dc5c766b7dd682f2573" } } },
+	{ "rhythm",  logRhythm,  {
+		{  2, "6f6b5e61e7a8c7de044f34c5dd4f67660159f21f" },
+		{  6, "5c9b14d809764699a711d9a7974c7e8f0a94322d" },
+		{  7, "ff45f6fbd27b95d2ec1ae96e232e9130dfb156f7" },
+		{  8, "a086bcd224e732d844437611935734a8bee5aa24" } } },
+};
+
+
+// Plays the log and returns the generated samples of each channel.
+static void play(YMF262& ymf262, const Log& log, Samples (&samples)[CHANNELS])
+{
+	for (auto& l : log) {
+		// write registers
+		for (auto& w : l.regWrites) {
+			YMF262Bench::writeReg(ymf262, w.reg, w.val);
+		}
+
+		// setup buffers
+		int* bufs[CHANNELS];
+		auto oldSize = samples[0].size();
+		for (unsigned i = 0; i < CHANNELS; ++i) {
+			samples[i].resize(oldSize + 2 * l.samples);
+			bufs[i] = &samples[i][oldSize];
+		}
+
+		// actually generate samples
+		YMF262Bench::generateChannels(ymf262, bufs, l.samples);
+
+		// nullptr means the channel was silent
+		for (unsigned i = 0; i < CHANNELS; ++i) {
+			if (!bufs[i]) {
+				std::fill(samples[i].begin() + oldSize,
+				          samples[i].end(), 0);
+			}
+		}
+	}
+}
+
+static Sha1Sum calcSum(const Samples& samples)
+{
+	SHA1 sha1;
+	for (auto& s : samples) {
+		assert(s == int16_t(s)); // shouldn't overflow 16-bit
+		uint8_t buf[2] = { uint8_t(s), uint8_t(s >> 8) };
+		sha1.update(buf, 2);
+	}
+	return sha1.digest();
+}
+
+static void verify(const Test& test, const Samples (&samples)[CHANNELS],
+                   Benchmark::Checker& checker)
+{
+	for (unsigned i = 0; i < CHANNELS; ++i) {
+		auto it = std::find_if(test.golden.begin(), test.golden.end(),
+			[&](const Golden& g) { return g.channel == i; });
+		if (it == test.golden.end()) {
+			bool silent = std::all_of(samples[i].begin(), samples[i].end(),
+			                          [](int s) { return s == 0; });
+			if (!silent) {
+				cout << "MISMATCH: " << test.name << " channel " << i
+				     << " should be silent" << endl;
+			}
+			checker.check(silent);
+		} else {
+			auto sum = calcSum(samples[i]);
+			bool same = sum == Sha1Sum(it->sha1);
+			if (!same) {
+				cout << "MISMATCH: " << test.name << " channel " << i
+				     << ": expected " << it->sha1
+				     << " but got " << sum << endl;
+			}
+			checker.check(same);
+		}
+	}
+}
+
+// Returns how long it took to play the log, verifies the output when 'checker'
+// is given.
+static double runTest(Reactor& reactor, const Test& test,
+                      Benchmark::Checker* checker)
+{
+	auto board = reactor.createEmptyMotherBoard();
+	HardwareConfig hwConf(*board, "YMF262Bench");
+	XMLElement devConf("YMF262");
+	devConf.addChild("sound").addChild("volume", "9000");
+	DeviceConfig config(hwConf, devConf);
+	YMF262 ymf262("YMF262Bench", config, false);
+
+	Log log = test.makeLog();
+	Samples samples[CHANNELS];
+	double duration = Benchmark::time([&] { play(ymf262, log, samples); });
+	if (checker) verify(test, samples, *checker);
+	return duration;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 10);
+	Benchmark::Checker checker;
+	try {
+		SDL_Init(SDL_INIT_NOPARACHUTE);
+		Reactor reactor;
+		reactor.init();
+		for (auto& test : tests) {
+			double best = std::numeric_limits<double>::max();
+			for (unsigned i = 0; i < repeat; ++i) {
+				best = std::min(best, runTest(reactor, test,
+				                              (i == 0) ? &checker : nullptr));
+			}
+			cout << test.name << ": " << best << "us" << endl;
+		}
+	} catch (MSXException& e) {
+		cerr << "Error: " << e.getMessage() << endl;
+		return 1;
+	}
+	return checker.exitCode("output of the YMF262 core changed");
+}
@@ -433,17 +433,17 @@ int16_t YMF278::getSample(Slot& op)
 	return sample;
 }
 
-bool YMF278::anyActive()
+bool YMF278::isSilent() const
 {
 	for (auto& op : slots) {
-		if (op.active) return true;
+		if (op.active) return false;
 	}
-	return false;
+	return true;
 }
 
 void YMF278::generateChannels(int** bufs, unsigned num)
 {
-	if (!anyActive()) {
+	if (isSilent()) {
 		// TODO update internal state, even if muted
 		// TODO also mute individual channels
 		for (int i = 0; i < 24; ++i) {
@@ -88,12 +88,12 @@ private:
 
 	// SoundDevice
 	void generateChannels(int** bufs, unsigned num) override;
+	bool isSilent() const override;
 
 	void writeRegDirect(byte reg, byte data, EmuTime::param time);
 	unsigned getRamAddress(unsigned addr) const;
 	int16_t getSample(Slot& op);
 	void advance();
-	bool anyActive();
 	void keyOnHelper(Slot& slot);
 
 	MSXMotherBoard& motherBoard;
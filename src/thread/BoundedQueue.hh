@@ -0,0 +1,101 @@
+#ifndef BOUNDEDQUEUE_HH
+#define BOUNDEDQUEUE_HH
+
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace openmsx {
+
+/** Fixed capacity FIFO that connects one producer thread with one consumer
+  * thread. Elements are constructed once and then reused in place, so after
+  * construction no more memory is allocated and (large) elements are never
+  * copied.
+  *
+  * Producer:  T& e = queue.back(); <fill in e>; queue.push();
+  * Consumer:  while (T* e = queue.front()) { <use *e>; queue.pop(); }
+  */
+template<typename T> class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: elems(capacity), head(0), count(0), closed(false)
+	{
+		assert(capacity > 0);
+	}
+
+	/** Returns the free slot at the end of the queue, blocks while the
+	  * queue is full. The element becomes visible to the consumer when
+	  * push() is called. */
+	T& back()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [&]() { return count < elems.size(); });
+		return elems[(head + count) % elems.size()];
+	}
+
+	/** Hand the element obtained via back() to the consumer. */
+	void push()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(count < elems.size());
+			++count;
+		}
+		notEmpty.notify_one();
+	}
+
+	/** Returns the oldest element, blocks while the queue is empty.
+	  * Returns nullptr once the queue is closed (and empty). */
+	T* front()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [&]() { return closed || (count != 0); });
+		return count ? &elems[head] : nullptr;
+	}
+
+	/** Release the element obtained via front(). */
+	void pop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(count != 0);
+			head = (head + 1) % elems.size();
+			--count;
+		}
+		// Both the producer and a drain() may be waiting.
+		notFull.notify_all();
+	}
+
+	/** Blocks until the consumer has popped all pushed elements. */
+	void drain()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [&]() { return count == 0; });
+	}
+
+	/** Wake up the consumer: front() returns nullptr once the remaining
+	  * elements are consumed. */
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		notEmpty.notify_all();
+	}
+
+private:
+	std::vector<T> elems;
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull; // also signals 'elements consumed'
+	size_t head;  // index of the oldest element
+	size_t count; // number of pushed, not yet popped elements
+	bool closed;
+};
+
+} // namespace openmsx
+
+#endif
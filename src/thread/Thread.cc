@@ -6,6 +6,7 @@ namespace openmsx {
 namespace Thread {
 
 static std::thread::id mainThreadId;
+static thread_local bool isMachine = false;
 
 void setMainThread()
 {
@@ -19,5 +20,15 @@ bool isMainThread()
 	return mainThreadId == std::this_thread::get_id();
 }
 
+void setMachineThread(bool machineThread)
+{
+	isMachine = machineThread;
+}
+
+bool isMachineThread()
+{
+	return isMachine || isMainThread();
+}
+
 } // namespace Thread
 } // namespace openmsx
@@ -14,6 +14,17 @@ namespace Thread {
 	  */
 	bool isMainThread();
 
+	/** Mark the calling thread as (temporarily) running an MSX machine on
+	  * behalf of the main thread. See Reactor::runBackgroundMachines().
+	  */
+	void setMachineThread(bool machineThread);
+
+	/** Returns true when called from the main thread or from a thread
+	  * that is marked with setMachineThread(). Use this (instead of
+	  * isMainThread()) for stuff that is private to a single machine.
+	  */
+	bool isMachineThread();
+
 } // namespace Thread
 } // namespace openmsx
 
@@ -0,0 +1,135 @@
+#include "WorkerPool.hh"
+#include <algorithm>
+#include <cassert>
+
+namespace openmsx {
+
+// The pool the current thread is a worker of (if any).
+static thread_local WorkerPool* currentPool = nullptr;
+
+WorkerPool::WorkerPool(unsigned numThreads)
+	: job(nullptr)
+	, request(nullptr)
+	, generation(0)
+	, next(0)
+	, num(0)
+	, busy(0)
+	, quit(false)
+{
+	if (numThreads == 0) numThreads = workersForCores();
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.emplace_back([this]() { run(); });
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	workCond.notify_all();
+	for (auto& t : threads) t.join();
+}
+
+unsigned WorkerPool::workersForCores(unsigned maxThreads)
+{
+	// hardware_concurrency() returns 0 when it can't tell
+	unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+	return std::max(std::min(cores, maxThreads), 1u) - 1;
+}
+
+void WorkerPool::parallelFor(unsigned num_,
+                             const std::function<void(unsigned)>& func)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	assert(!job); // not reentrant
+	job = &func;
+	exception = nullptr;
+	next = 0;
+	num = num_;
+	++generation;
+	lock.unlock();
+	workCond.notify_all();
+
+	lock.lock();
+	work(lock);
+	// While waiting for the workers, execute their runInCallerThread()
+	// requests.
+	while (true) {
+		doneCond.wait(lock, [&]() {
+			return request || ((next == num) && (busy == 0));
+		});
+		if (!request) break;
+		auto* r = request;
+		lock.unlock();
+		try {
+			(*r->func)();
+		} catch (...) {
+			r->exception = std::current_exception();
+		}
+		lock.lock();
+		r->done = true;
+		request = nullptr;
+		requestCond.notify_all();
+	}
+	job = nullptr;
+	if (exception) {
+		auto e = exception;
+		exception = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+void WorkerPool::runInCallerThread(const std::function<void()>& func)
+{
+	auto* pool = currentPool;
+	if (!pool) {
+		func();
+		return;
+	}
+	Request r = { &func, nullptr, false };
+	std::unique_lock<std::mutex> lock(pool->mutex);
+	// one request at a time
+	pool->requestCond.wait(lock, [&]() { return !pool->request; });
+	pool->request = &r;
+	pool->doneCond.notify_all();
+	pool->requestCond.wait(lock, [&]() { return r.done; });
+	if (r.exception) std::rethrow_exception(r.exception);
+}
+
+void WorkerPool::run()
+{
+	currentPool = this;
+	unsigned seen = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		workCond.wait(lock, [&]() { return quit || (generation != seen); });
+		if (quit) return;
+		seen = generation;
+		work(lock);
+	}
+}
+
+// Called with 'mutex' locked, executes work items until there are no more.
+void WorkerPool::work(std::unique_lock<std::mutex>& lock)
+{
+	while (job && (next < num)) {
+		unsigned i = next++;
+		++busy;
+		auto* func = job;
+		lock.unlock();
+		try {
+			(*func)(i);
+		} catch (...) {
+			lock.lock();
+			if (!exception) exception = std::current_exception();
+			lock.unlock();
+		}
+		lock.lock();
+		--busy;
+	}
+	if (busy == 0) doneCond.notify_all();
+}
+
+} // namespace openmsx
@@ -0,0 +1,79 @@
+#ifndef WORKERPOOL_HH
+#define WORKERPOOL_HH
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+/** A fixed set of worker threads to execute independent pieces of work in
+  * parallel. The calling thread participates in the work and parallelFor()
+  * only returns after all work items are finished, so from the point of view
+  * of the caller it behaves like a normal (blocking) loop.
+  */
+class WorkerPool
+{
+public:
+	/** Create a pool with the given number of worker threads. When
+	  * 'numThreads' is zero, one thread per (additional) host core is
+	  * created.
+	  */
+	explicit WorkerPool(unsigned numThreads = 0);
+	~WorkerPool();
+
+	/** Number of worker threads to create so that, together with the
+	  * calling thread, there's one thread per host core, but no more than
+	  * 'maxThreads' threads in total.
+	  */
+	static unsigned workersForCores(unsigned maxThreads = unsigned(-1));
+
+	/** Number of threads that execute work, including the calling thread. */
+	unsigned getNumThreads() const { return unsigned(threads.size() + 1); }
+
+	/** Execute func(i) for all i in [0, num), possibly in parallel.
+	  * If one of the invocations throws, the (first) exception is rethrown
+	  * after all work is finished.
+	  * Must not be called recursively (from within 'func').
+	  */
+	void parallelFor(unsigned num, const std::function<void(unsigned)>& func);
+
+	/** Execute 'func' in the thread that called parallelFor(). When called
+	  * from a worker thread of some pool, this blocks until that thread got
+	  * around to execute it (it does so while waiting for the other work
+	  * items to finish). In any other thread 'func' is executed directly.
+	  * Exceptions thrown by 'func' are passed on to the caller.
+	  */
+	static void runInCallerThread(const std::function<void()>& func);
+
+private:
+	struct Request {
+		const std::function<void()>* func;
+		std::exception_ptr exception;
+		bool done;
+	};
+
+	void run();
+	void work(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable workCond; // signals new work or quit
+	std::condition_variable doneCond; // signals all work finished or request
+	std::condition_variable requestCond; // signals request executed
+	const std::function<void(unsigned)>* job;
+	Request* request; // see runInCallerThread()
+	std::exception_ptr exception;
+	unsigned generation; // incremented for every parallelFor() call
+	unsigned next;       // next index to execute
+	unsigned num;        // total number of indices
+	unsigned busy;       // number of indices currently being executed
+	bool quit;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+#include "SpriteVisibility.hh"
+#include <cstring>
+
+using namespace openmsx;
+
+// Is the given sprite on exactly the lines [first, first + num) (modulo 256)?
+// Note: the sprites after the end marker are in the index as well.
+static bool onLines(const SpriteVisibility& v, int sprite, int first, int num)
+{
+	uint32_t bit = 1u << sprite;
+	for (int line = 0; line < 256; ++line) {
+		bool inside = byte(line - first) < num;
+		if (((v.getSprites(line) & bit) != 0) != inside) return false;
+	}
+	return true;
+}
+
+TEST_CASE("SpriteVisibility")
+{
+	// Sprite mode 2 attribute table: 32 sprites of 4 bytes, Y first.
+	byte sat[32 * 4];
+	memset(sat, 216, sizeof(sat)); // all sprites are 'end of table'
+	sat[0] = 10;
+
+	SpriteVisibility v;
+	CHECK(v.update(sat, 4, 216, 16) == 1);
+	CHECK(v.getY(0) == 10);
+	CHECK(onLines(v, 0, 10, 16));
+
+	// Move sprite 0, wrap around at the bottom.
+	sat[0] = 250;
+	CHECK(v.update(sat, 4, 216, 16) == 1);
+	CHECK(onLines(v, 0, 250, 16));
+
+	// Magnified sprites cover twice as many lines.
+	CHECK(v.update(sat, 4, 216, 32) == 1);
+	CHECK(onLines(v, 0, 250, 32));
+
+	// Remove the end marker of sprite 1, sprite 2 becomes the end.
+	sat[4] = 100;
+	CHECK(v.update(sat, 4, 216, 32) == 2);
+	CHECK(onLines(v, 1, 100, 32));
+}
+
+TEST_CASE("SpriteVisibility, non-canonical attribute table address")
+{
+	// In sprite mode 2 the Y coordinates are at index 0x200 + 4 * n of the
+	// attribute table window. With R5 A9=0 the VDP ignores that index
+	// bit, so the Y coordinates end up at VRAM offset 4 * n, the same
+	// bytes as the sprite color table. VRAM writes there don't look like
+	// writes to the attribute table, the index must pick them up anyway.
+	byte vram[0x400];
+	memset(vram, 216, sizeof(vram));
+	unsigned baseMask = ~0x200u;
+	const byte* yPtr = &vram[0x200 & baseMask];
+
+	SpriteVisibility v;
+	CHECK(v.update(yPtr, 4, 216, 8) == 0);
+
+	vram[4 * 0] = 20; // write via the mirrored address
+	vram[4 * 1] = 30;
+	CHECK(v.update(yPtr, 4, 216, 8) == 2);
+	CHECK(v.getY(0) == 20);
+	CHECK(v.getY(1) == 30);
+	CHECK(onLines(v, 0, 20, 8));
+	CHECK(onLines(v, 1, 30, 8));
+
+	vram[4 * 0] = 30;
+	CHECK(v.update(yPtr, 4, 216, 8) == 2);
+	CHECK(onLines(v, 0, 30, 8));
+	CHECK(onLines(v, 1, 30, 8));
+}
@@ -0,0 +1,75 @@
+#ifndef BENCHMARK_HH
+#define BENCHMARK_HH
+
+// Helpers for the *Bench.cc programs. Those are small stand-alone programs
+// that measure (and verify) an optimized part of openMSX. They are not part
+// of the regular build, build them with 'make benchmarks'. Each one is linked
+// with all object files of openMSX (except main.o) and ends up in
+// derived/<flavour>/bench/.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace openmsx {
+namespace Benchmark {
+
+/** Returns the time (in microseconds) of one execution of 'func'.
+  */
+template<typename FUNC> double time(FUNC&& func)
+{
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto stop = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(stop - start).count();
+}
+
+/** Returns the best time (in microseconds) of 'repeat' executions of 'func'.
+  * Taking the minimum filters out most of the noise of other processes.
+  */
+template<typename FUNC> double best(unsigned repeat, FUNC&& func)
+{
+	double result = std::numeric_limits<double>::max();
+	for (unsigned i = 0; i < repeat; ++i) {
+		result = std::min(result, time(func));
+	}
+	return result;
+}
+
+/** Returns argv[i] as a (strictly positive) count, or 'defaultValue' when
+  * there are less arguments.
+  */
+inline unsigned getCount(int argc, char** argv, int i, unsigned defaultValue)
+{
+	if (i >= argc) return defaultValue;
+	return std::max(1, atoi(argv[i]));
+}
+
+/** Remembers whether all correctness checks of a benchmark passed.
+  */
+class Checker
+{
+public:
+	void check(bool condition) { if (!condition) failed = true; }
+	bool ok() const { return !failed; }
+
+	/** Value to return from main(): prints 'error' and returns 1 when a
+	  * check failed.
+	  */
+	int exitCode(const char* error) const
+	{
+		if (!failed) return 0;
+		std::cout << "ERROR: " << error << std::endl;
+		return 1;
+	}
+
+private:
+	bool failed = false;
+};
+
+} // namespace Benchmark
+} // namespace openmsx
+
+#endif
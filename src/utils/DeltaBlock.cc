@@ -3,7 +3,10 @@
 #include "likely.hh"
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <thread>
 #include <tuple>
 #if STATISTICS
 #include <iostream>
@@ -181,39 +184,61 @@ static std::pair<const uint8_t*, const uint8_t*> scan_match(
 //   n2 number of bytes are different, and here are the bytes
 //   n3 number of bytes are equal
 //   ...
-static vector<uint8_t> calcDelta(const uint8_t* oldBuf, const uint8_t* newBuf, size_t size)
+// Only the pages that are marked in 'dirty' can be different, all other pages
+// are known to be equal. So the cost is proportional to the number of dirty
+// pages instead of to the buffer size.
+static vector<uint8_t> calcDelta(const uint8_t* oldBuf, const uint8_t* newBuf,
+                                 size_t size, const DirtyPages& dirty)
 {
 	vector<uint8_t> result;
+	size_t equal = 0; // number of equal bytes, not yet stored
+	size_t pos = 0;   // end of the previous dirty range
+
+	auto numPages = dirty.getNumPages();
+	size_t page = 0;
+	while (page != numPages) {
+		if (!dirty.isDirty(page)) {
+			++page;
+			continue;
+		}
+		// range of consecutive dirty pages
+		auto first = page;
+		do { ++page; } while ((page != numPages) && dirty.isDirty(page));
+		auto begin = first * DirtyPages::PAGE_SIZE;
+		auto end = std::min(page * DirtyPages::PAGE_SIZE, size);
+		equal += begin - pos;
+		pos = end;
+
+		auto* p = oldBuf + begin;
+		auto* q = newBuf + begin;
+		auto* p_end = oldBuf + end;
+		auto* q_end = newBuf + end;
+
+		auto* q1 = q;
+		std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+		equal += q - q1;
 
-	auto* p = oldBuf;
-	auto* q = newBuf;
-	auto* p_end = p + size;
-	auto* q_end = q + size;
-
-	// scan equal bytes (possibly zero)
-	auto* q1 = q;
-	std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
-	auto n1 = q - q1;
-	storeUleb(result, n1);
-
-	while (q != q_end) {
-		assert(*p != *q);
-
-		auto* q2 = q;
-	different:
-		std::tie(p, q) = scan_match(p + 1, p_end, q + 1, q_end);
-		auto n2 = q - q2;
+		while (q != q_end) {
+			assert(*p != *q);
 
-		auto* q3 = q;
-		std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
-		auto n3 = q - q3;
-		if ((q != q_end) && (n3 <= 2)) goto different;
+			auto* q2 = q;
+		different:
+			std::tie(p, q) = scan_match(p + 1, p_end, q + 1, q_end);
+			auto n2 = q - q2;
 
-		storeUleb(result, n2);
-		result.insert(result.end(), q2, q3);
+			auto* q3 = q;
+			std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+			auto n3 = q - q3;
+			if ((q != q_end) && (n3 <= 2)) goto different;
 
-		if (n3 != 0) storeUleb(result, n3);
+			storeUleb(result, equal);
+			storeUleb(result, n2);
+			result.insert(result.end(), q2, q3);
+			equal = n3;
+		}
 	}
+	equal += size - pos;
+	if (equal != 0) storeUleb(result, equal);
 
 	result.shrink_to_fit();
 	return result;
@@ -256,6 +281,7 @@ DeltaBlock::~DeltaBlock()
 DeltaBlockCopy::DeltaBlockCopy(const uint8_t* data, size_t size)
 	: block(size)
 	, compressedSize(0)
+	, compressing(false)
 {
 #ifdef DEBUG
 	sha1 = SHA1::calc(data, size);
@@ -272,6 +298,7 @@ DeltaBlockCopy::DeltaBlockCopy(const uint8_t* data, size_t size)
 
 void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 {
+	std::lock_guard<std::mutex> lock(mutex);
 	if (compressed()) {
 		snappy::uncompress(
 			reinterpret_cast<const char*>(block.data()), compressedSize,
@@ -286,20 +313,30 @@ void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 
 void DeltaBlockCopy::compress(size_t size)
 {
-	if (compressed()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (compressed() || compressing) return;
+		compressing = true;
+	}
 
+	// Other threads only read 'block' while we're compressing (and only
+	// one thread can be compressing), so no need to hold the lock here.
 	size_t dstLen = snappy::maxCompressedLength(size);
 	MemBuffer<uint8_t> buf2(dstLen);
 	snappy::compress(reinterpret_cast<const char*>(block.data()), size,
 	                 reinterpret_cast<char*>(buf2.data()), dstLen);
-	if (dstLen >= size) {
-		// compression isn't beneficial
-		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		compressing = false;
+		if (dstLen >= size) {
+			// compression isn't beneficial
+			return;
+		}
+		compressedSize = dstLen;
+		block.swap(buf2);
+		block.resize(compressedSize); // shrink to fit
+		assert(compressed());
 	}
-	compressedSize = dstLen;
-	block.swap(buf2);
-	block.resize(compressedSize); // shrink to fit
-	assert(compressed());
 #ifdef DEBUG
 	MemBuffer<uint8_t> buf3(size);
 	apply(buf3.data(), size);
@@ -325,10 +362,19 @@ const uint8_t* DeltaBlockCopy::getData()
 
 DeltaBlockDiff::DeltaBlockDiff(
 		const std::shared_ptr<DeltaBlockCopy>& prev_,
-		const uint8_t* data, size_t size)
+		const uint8_t* data, size_t size, const DirtyPages& dirty)
+	: DeltaBlockDiff(prev_, data, size,
+	                 calcDelta(prev_->getData(), data, size, dirty))
+{
+}
+
+DeltaBlockDiff::DeltaBlockDiff(
+		const std::shared_ptr<DeltaBlockCopy>& prev_,
+		const uint8_t* data, size_t size, vector<uint8_t>&& delta_)
 	: prev(prev_)
-	, delta(calcDelta(prev->getData(), data, size))
+	, delta(std::move(delta_))
 {
+	(void)data; (void)size; // avoid warning for non-DEBUG compiles
 #ifdef DEBUG
 	sha1 = SHA1::calc(data, size);
 
@@ -359,10 +405,97 @@ size_t DeltaBlockDiff::getDeltaSize() const
 }
 
 
+// class CompressionQueue
+
+// Compresses DeltaBlockCopy objects in a background thread. The number of
+// pending blocks is limited, when the queue is full the caller should compress
+// the block itself.
+class CompressionQueue
+{
+public:
+	static CompressionQueue& instance();
+	bool add(const std::shared_ptr<DeltaBlockCopy>& block, size_t size);
+
+private:
+	CompressionQueue();
+	~CompressionQueue();
+	void run();
+
+	static const size_t MAX_PENDING = 64;
+
+	struct Job {
+		std::weak_ptr<DeltaBlockCopy> block; // skip when already deleted
+		size_t size;
+	};
+	std::deque<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool quit;
+	std::thread thread; // must come last
+};
+
+CompressionQueue& CompressionQueue::instance()
+{
+	static CompressionQueue compressionQueue;
+	return compressionQueue;
+}
+
+CompressionQueue::CompressionQueue()
+	: quit(false)
+	, thread([this]() { run(); })
+{
+}
+
+CompressionQueue::~CompressionQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	cond.notify_one();
+	thread.join();
+}
+
+bool CompressionQueue::add(const std::shared_ptr<DeltaBlockCopy>& block, size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (jobs.size() >= MAX_PENDING) return false;
+		jobs.push_back({block, size});
+	}
+	cond.notify_one();
+	return true;
+}
+
+void CompressionQueue::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		cond.wait(lock, [&]() { return quit || !jobs.empty(); });
+		if (quit) return; // pending blocks simply stay uncompressed
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		lock.unlock();
+		if (auto block = job.block.lock()) {
+			block->compress(job.size);
+		}
+		lock.lock();
+	}
+}
+
+static void compressLater(const std::shared_ptr<DeltaBlockCopy>& block, size_t size)
+{
+	if (!CompressionQueue::instance().add(block, size)) {
+		block->compress(size);
+	}
+}
+
+
 // class LastDeltaBlocks
 
 std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
-		const void* id, const uint8_t* data, size_t size)
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty)
 {
 	auto it = std::lower_bound(begin(infos), end(infos), std::make_tuple(id, size),
 		[](const Info& info, const std::tuple<const void*, size_t>& info2) {
@@ -379,19 +512,28 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
 		if (ref) {
 			// We will switch to a new DeltaBlockCopy object. So
 			// now is a good time to compress the old one.
-			ref->compress(size);
+			compressLater(ref, size);
 		}
 		// Heuristic: create a new block when too many small
 		// differences have accumulated.
 		auto b = std::make_shared<DeltaBlockCopy>(data, size);
 		it->ref = b;
 		it->last = b;
+		it->dirty.clear();
 		it->accSize = 0;
 		return b;
 	} else {
 		// Create diff based on earlier reference block.
-		// Reference remains unchanged.
-		auto b = std::make_shared<DeltaBlockDiff>(ref, data, size);
+		// Reference remains unchanged. Pages that didn't change since
+		// the previous call can only differ from the reference when
+		// they changed in some earlier call.
+		if (dirty) {
+			it->dirty.merge(*dirty);
+		} else {
+			it->dirty.markAll();
+		}
+		auto b = std::make_shared<DeltaBlockDiff>(
+			ref, data, size, it->dirty);
 		it->last = b;
 		it->accSize += b->getDeltaSize();
 		return b;
@@ -415,6 +557,7 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNullDiff(
 		auto b = std::make_shared<DeltaBlockCopy>(data, size);
 		it->ref = b;
 		it->last = b;
+		it->dirty.clear();
 		it->accSize = 0;
 		return b;
 	} else {
@@ -429,7 +572,7 @@ void LastDeltaBlocks::clear()
 {
 	for (const Info& info : infos) {
 		if (auto ref = info.ref.lock()) {
-			ref->compress(info.size);
+			compressLater(ref, info.size);
 		}
 	}
 	infos.clear();
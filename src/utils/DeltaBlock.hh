@@ -4,8 +4,10 @@
 #define STATISTICS 0
 
 #include "MemBuffer.hh"
+#include "DirtyPages.hh"
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 #ifdef DEBUG
 #include "sha1.hh"
@@ -52,28 +54,50 @@ private:
 
 	MemBuffer<uint8_t> block;
 	size_t compressedSize;
+	// compress() normally runs in a background thread (see
+	// LastDeltaBlocks), concurrently with apply() in the main thread.
+	mutable std::mutex mutex;
+	bool compressing;
 };
 
 
 class DeltaBlockDiff final : public DeltaBlock
 {
 public:
+	// Only the pages that are marked in 'dirty' can be different from
+	// the data in 'prev'.
 	DeltaBlockDiff(const std::shared_ptr<DeltaBlockCopy>& prev_,
-	               const uint8_t* data, size_t size);
+	               const uint8_t* data, size_t size,
+	               const DirtyPages& dirty);
 	void apply(uint8_t* dst, size_t size) const override;
 	size_t getDeltaSize() const;
 
 private:
+	DeltaBlockDiff(const std::shared_ptr<DeltaBlockCopy>& prev_,
+	               const uint8_t* data, size_t size,
+	               std::vector<uint8_t>&& delta_);
+
 	const std::shared_ptr<DeltaBlockCopy> prev;
 	const std::vector<uint8_t> delta; // TODO could be tweaked to use OutputBuffer
 };
 
 
+/** Keeps track of the most recent DeltaBlock per blob, so that the next
+  * snapshot can be stored as a diff against it.
+  * When a DeltaBlockCopy is no longer used as reference for new diffs it gets
+  * compressed. This happens in a background thread, so that creating a
+  * snapshot (in the main thread) only needs to copy or diff the data.
+  */
 class LastDeltaBlocks
 {
 public:
+	/** Create a new block for the given data. Optionally 'dirty'
+	  * indicates which pages changed since the previous call for the same
+	  * block, then only those pages have to be compared.
+	  */
 	std::shared_ptr<DeltaBlock> createNew(
-		const void* id, const uint8_t* data, size_t size);
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty = nullptr);
 	std::shared_ptr<DeltaBlock> createNullDiff(
 		const void* id, const uint8_t* data, size_t size);
 	void clear();
@@ -81,12 +105,13 @@ public:
 private:
 	struct Info {
 		Info(const void* id_, size_t size_)
-			: id(id_), size(size_), accSize(0) {}
+			: id(id_), size(size_), dirty(size_), accSize(0) {}
 
 		const void* id;
 		size_t size;
 		std::weak_ptr<DeltaBlockCopy> ref;
 		std::weak_ptr<DeltaBlock> last;
+		DirtyPages dirty; // pages (possibly) changed since 'ref'
 		size_t accSize;
 	};
 
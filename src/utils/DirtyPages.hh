@@ -0,0 +1,71 @@
+#ifndef DIRTYPAGES_HH
+#define DIRTYPAGES_HH
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace openmsx {
+
+/** Keeps track of which pages (blocks of PAGE_SIZE bytes) of a memory block
+  * were (possibly) modified. Initially all pages are marked dirty.
+  *
+  * This is used to make reverse snapshots of large memory blocks cheaper:
+  * only the dirty pages need to be compared against the previous snapshot
+  * (see LastDeltaBlocks).
+  */
+class DirtyPages
+{
+public:
+	static const unsigned PAGE_BITS = 8;
+	static const size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+
+	explicit DirtyPages(size_t size)
+		: pages((size + PAGE_SIZE - 1) >> PAGE_BITS, 1)
+	{
+	}
+
+	size_t getNumPages() const { return pages.size(); }
+	bool isDirty(size_t page) const { return pages[page] != 0; }
+
+	void mark(size_t addr)
+	{
+		assert((addr >> PAGE_BITS) < pages.size());
+		pages[addr >> PAGE_BITS] = 1;
+	}
+	void mark(size_t addr, size_t num)
+	{
+		if (num == 0) return;
+		auto first = addr >> PAGE_BITS;
+		auto last = (addr + num - 1) >> PAGE_BITS;
+		assert(last < pages.size());
+		std::fill(pages.begin() + first, pages.begin() + last + 1, 1);
+	}
+	void markAll()
+	{
+		std::fill(pages.begin(), pages.end(), 1);
+	}
+	void clear()
+	{
+		std::fill(pages.begin(), pages.end(), 0);
+	}
+
+	/** Also mark all pages that are dirty in 'other'. */
+	void merge(const DirtyPages& other)
+	{
+		assert(pages.size() == other.pages.size());
+		for (size_t i = 0; i < pages.size(); ++i) {
+			pages[i] |= other.pages[i];
+		}
+	}
+
+private:
+	// One byte per page (instead of one bit) keeps mark() as cheap as
+	// possible, it's called on every write to the tracked memory.
+	std::vector<uint8_t> pages;
+};
+
+} // namespace openmsx
+
+#endif
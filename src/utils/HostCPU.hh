@@ -0,0 +1,58 @@
+#ifndef HOSTCPU_HH
+#define HOSTCPU_HH
+
+// Some hot loops have an alternative implementation that uses instructions
+// that are not enabled by the (generic) compiler flags. Such functions are
+// marked with TARGET_AVX2 and may only be called after checking
+// HostCPU::hasAVX2() at runtime.
+//
+// HAVE_AVX2_DISPATCH is 1 when the compiler supports this (gcc and clang on
+// x86). When the whole program is already compiled for AVX2 (e.g. with
+// -march=native), the runtime check always succeeds.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_AVX2_DISPATCH 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HAVE_AVX2_DISPATCH 0
+#define TARGET_AVX2
+#endif
+
+namespace openmsx {
+namespace HostCPU {
+
+namespace detail {
+	inline bool supportsAVX2()
+	{
+#if HAVE_AVX2_DISPATCH
+		static const bool supported = __builtin_cpu_supports("avx2");
+		return supported;
+#else
+		return false;
+#endif
+	}
+	inline bool& avx2Enabled()
+	{
+		static bool enabled = supportsAVX2();
+		return enabled;
+	}
+}
+
+/** Can functions marked with TARGET_AVX2 be used? */
+inline bool hasAVX2()
+{
+	return detail::avx2Enabled();
+}
+
+/** Enable or disable the AVX2 code paths. By default they are used when the
+  * CPU supports them, they can never be enabled when it doesn't.
+  * Only meant for testing and benchmarking. */
+inline void setAVX2Enabled(bool enabled)
+{
+	detail::avx2Enabled() = enabled && detail::supportsAVX2();
+}
+
+} // namespace HostCPU
+} // namespace openmsx
+
+#endif
@@ -1,6 +1,7 @@
 #include "AviRecorder.hh"
 #include "AviWriter.hh"
 #include "WavWriter.hh"
+#include "RawFrameWriter.hh"
 #include "Reactor.hh"
 #include "MSXMotherBoard.hh"
 #include "FileContext.hh"
@@ -36,10 +37,12 @@ AviRecorder::~AviRecorder()
 {
 	assert(!aviWriter);
 	assert(!wavWriter);
+	assert(!rawWriter);
 }
 
 void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
-                        bool recordStereo, const Filename& filename)
+                        bool recordStereo, bool recordRaw,
+                        const Filename& filename)
 {
 	stop();
 	MSXMotherBoard* motherBoard = reactor.getMotherBoard();
@@ -61,6 +64,7 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 		warnedSampleRate = false;
 	}
 	if (recordVideo) {
+		reactor.getDisplay().enableBatchRenderer();
 		// Set V99x8, V9990, Laserdisc, ... in record mode (when
 		// present). Only the active one will actually send frames to
 		// the video. This also works for Video9000.
@@ -81,9 +85,16 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 		prevTime = EmuTime::infinity;
 
 		try {
-			aviWriter = make_unique<AviWriter>(
-				filename, frameWidth, frameHeight, bpp,
-				(recordAudio && stereo) ? 2 : 1, sampleRate);
+			unsigned channels = (recordAudio && stereo) ? 2 : 1;
+			if (recordRaw) {
+				rawWriter = make_unique<RawFrameWriter>(
+					filename, bpp, channels, sampleRate,
+					reactor.getCliComm());
+			} else {
+				aviWriter = make_unique<AviWriter>(
+					filename, frameWidth, frameHeight, bpp,
+					channels, sampleRate, reactor.getCliComm());
+			}
 		} catch (MSXException& e) {
 			throw CommandException("Can't start recording: " +
 			                       e.getMessage());
@@ -113,6 +124,12 @@ void AviRecorder::stop()
 	sampleRate = 0;
 	aviWriter.reset();
 	wavWriter.reset();
+	rawWriter.reset();
+}
+
+bool AviRecorder::isRecording() const
+{
+	return aviWriter || wavWriter || rawWriter;
 }
 
 void AviRecorder::addWave(unsigned num, int16_t* data)
@@ -128,7 +145,7 @@ void AviRecorder::addWave(unsigned num, int16_t* data)
 		if (wavWriter) {
 			wavWriter->write(data, 2, num);
 		} else {
-			assert(aviWriter);
+			assert(aviWriter || rawWriter);
 			audioBuf.insert(end(audioBuf), data, data + 2 * num);
 		}
 	} else {
@@ -153,7 +170,7 @@ void AviRecorder::addWave(unsigned num, int16_t* data)
 		if (wavWriter) {
 			wavWriter->write(buf, 1, num);
 		} else {
-			assert(aviWriter);
+			assert(aviWriter || rawWriter);
 			audioBuf.insert(end(audioBuf), buf, buf + num);
 		}
 	}
@@ -162,6 +179,17 @@ void AviRecorder::addWave(unsigned num, int16_t* data)
 void AviRecorder::addImage(FrameSource* frame, EmuTime::param time)
 {
 	assert(!wavWriter);
+	if (rawWriter) {
+		// Frames are stored with their timestamp, so (unlike for avi)
+		// frame rate changes are not a problem.
+		if (mixer) {
+			mixer->updateStream(time);
+		}
+		rawWriter->addFrame(frame, time,
+		                    unsigned(audioBuf.size()), audioBuf.data());
+		audioBuf.clear();
+		return;
+	}
 	if (duration != EmuDuration::infinity) {
 		if (!warnedFps && ((time - prevTime) != duration)) {
 			warnedFps = true;
@@ -197,6 +225,7 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	bool recordVideo = true;
 	bool recordMono = false;
 	bool recordStereo = false;
+	bool recordRaw = false;
 	frameWidth = 320;
 	frameHeight = 240;
 
@@ -230,6 +259,8 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 			} else if (token == "-triplesize") {
 				frameWidth = 960;
 				frameHeight = 720;
+			} else if (token == "-raw") {
+				recordRaw = true;
 			} else {
 				throw CommandException("Invalid option: " + token);
 			}
@@ -246,6 +277,9 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	if (!recordAudio && (recordStereo || recordMono)) {
 		throw CommandException("Can't have both -videoonly and -stereo or -mono.");
 	}
+	if (recordRaw && !recordVideo) {
+		throw CommandException("Can't have both -audioonly and -raw.");
+	}
 	switch (arguments.size()) {
 	case 0:
 		// nothing
@@ -258,15 +292,16 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	}
 
 	string directory = recordVideo ? "videos" : "soundlogs";
-	string extension = recordVideo ? ".avi"   : ".wav";
+	string extension = recordRaw   ? RawFrameWriter::EXTENSION
+	                 : recordVideo ? ".avi" : ".wav";
 	filename = FileOperations::parseCommandFileArgument(
 		filename, directory, prefix, extension);
 
-	if (aviWriter || wavWriter) {
+	if (isRecording()) {
 		result.setString("Already recording.");
 	} else {
 		start(recordAudio, recordVideo, recordMono, recordStereo,
-				Filename(filename));
+				recordRaw, Filename(filename));
 		result.setString("Recording to " + filename);
 	}
 }
@@ -281,7 +316,7 @@ void AviRecorder::processStop(array_ref<TclObject> tokens)
 
 void AviRecorder::processToggle(array_ref<TclObject> tokens, TclObject& result)
 {
-	if (aviWriter || wavWriter) {
+	if (isRecording()) {
 		// drop extra tokens
 		processStop(make_array_ref(tokens.data(), 2));
 	} else {
@@ -295,12 +330,15 @@ void AviRecorder::status(array_ref<TclObject> tokens, TclObject& result) const
 		throw SyntaxError();
 	}
 	result.addListElement("status");
-	if (aviWriter || wavWriter) {
+	if (isRecording()) {
 		result.addListElement("recording");
 	} else {
 		result.addListElement("idle");
 	}
-
+	if (aviWriter) {
+		result.addListElement("frames_behind");
+		result.addListElement(int(aviWriter->getFramesBehind()));
+	}
 }
 
 // class AviRecorder::Cmd
@@ -338,12 +376,15 @@ string AviRecorder::Cmd::help(const vector<string>& /*tokens*/) const
 	       "record start -prefix foo  Record to file 'fooNNNN.avi'\n"
 	       "record stop               Stop recording\n"
 	       "record toggle             Toggle recording (useful as keybinding)\n"
-	       "record status             Query recording state\n"
+	       "record status             Query recording state (and the number of\n"
+	       "                          frames that still need to be encoded)\n"
 	       "\n"
 	       "The start subcommand also accepts an optional -audioonly, -videoonly, "
 	       " -mono, -stereo, -doublesize flag.\n"
 	       "Videos are recorded in a 320x240 size by default, at 640x480 when the "
-	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.";
+	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.\n"
+	       "With the -raw flag the unscaled frames and the audio are stored "
+	       "losslessly in a '.omr' file instead, to be converted by external tools.";
 }
 
 void AviRecorder::Cmd::tabCompletion(vector<string>& tokens) const
@@ -356,7 +397,7 @@ void AviRecorder::Cmd::tabCompletion(vector<string>& tokens) const
 	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
 		static const char* const options[] = {
 			"-prefix", "-videoonly", "-audioonly", "-doublesize", "-triplesize",
-			"-mono", "-stereo",
+			"-mono", "-stereo", "-raw",
 		};
 		completeFileName(tokens, userFileContext(), options);
 	}
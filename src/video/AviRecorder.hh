@@ -13,6 +13,7 @@ namespace openmsx {
 class Reactor;
 class AviWriter;
 class Wav16Writer;
+class RawFrameWriter;
 class Filename;
 class PostProcessor;
 class FrameSource;
@@ -32,7 +33,8 @@ public:
 
 private:
 	void start(bool recordAudio, bool recordVideo, bool recordMono,
-		   bool recordStereo, const Filename& filename);
+		   bool recordStereo, bool recordRaw, const Filename& filename);
+	bool isRecording() const;
 	void status(array_ref<TclObject> tokens, TclObject& result) const;
 
 	void processStart (array_ref<TclObject> tokens, TclObject& result);
@@ -51,6 +53,7 @@ private:
 	std::vector<int16_t> audioBuf;
 	std::unique_ptr<AviWriter>   aviWriter; // can be nullptr
 	std::unique_ptr<Wav16Writer> wavWriter; // can be nullptr
+	std::unique_ptr<RawFrameWriter> rawWriter; // can be nullptr
 	std::vector<PostProcessor*> postProcessors;
 	MSXMixer* mixer;
 	EmuDuration duration;
@@ -1,6 +1,7 @@
 // Code based on DOSBox-0.65
 
 #include "AviWriter.hh"
+#include "CliComm.hh"
 #include "FileOperations.hh"
 #include "MSXException.hh"
 #include "memory.hh"
@@ -15,16 +16,23 @@ namespace openmsx {
 
 static const unsigned AVI_HEADER_SIZE = 500;
 
+// Maximum number of frames that are waiting to be encoded. At 960x720 each
+// of these takes about 3MB.
+static const unsigned FRAME_QUEUE_SIZE = 4;
+
 AviWriter::AviWriter(const Filename& filename, unsigned width_,
                      unsigned height_, unsigned bpp, unsigned channels_,
-		     unsigned freq_)
+		     unsigned freq_, CliComm& cliComm_)
 	: file(filename, "wb")
+	, cliComm(cliComm_)
 	, codec(width_, height_, bpp)
 	, fps(0.0f) // will be filled in later
 	, width(width_)
 	, height(height_)
 	, channels(channels_)
 	, audiorate(freq_)
+	, queue(FRAME_QUEUE_SIZE)
+	, framesBehind(0)
 {
 	char dummy[AVI_HEADER_SIZE];
 	memset(dummy, 0, sizeof(dummy));
@@ -35,10 +43,29 @@ AviWriter::AviWriter(const Filename& filename, unsigned width_,
 	frames = 0;
 	written = 0;
 	audiowritten = 0;
+
+	encoderThread = std::thread([this]() { encoderThreadMain(); });
 }
 
 AviWriter::~AviWriter()
 {
+	// first encode and write all remaining frames
+	queue.close();
+	encoderThread.join();
+	if (error) {
+		try {
+			std::rethrow_exception(error);
+		} catch (MSXException& e) {
+			cliComm.printWarning(
+				"Error while writing the last frames of the video "
+				"file, it's probably incomplete: " + e.getMessage());
+		} catch (...) {
+			cliComm.printWarning(
+				"Error while writing the last frames of the video "
+				"file, it's probably incomplete.");
+		}
+	}
+
 	if (written == 0) {
 		// no data written yet (a recording less than one video frame)
 		std::string filename = file.getURL();
@@ -216,8 +243,11 @@ AviWriter::~AviWriter()
 		file.write(&index[0], idxSize);
 		file.seek(0);
 		file.write(&avi_header, AVI_HEADER_SIZE);
-	} catch (MSXException&) {
+	} catch (MSXException& e) {
 		// can't throw from destructor
+		cliComm.printWarning(
+			"Error while writing the header of the video file: " +
+			e.getMessage());
 	}
 }
 
@@ -246,26 +276,67 @@ void AviWriter::addAviChunk(const char* tag, unsigned size, void* data, unsigned
 
 void AviWriter::addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData)
 {
-	bool keyFrame = (frames++ % 300 == 0);
+	{
+		std::lock_guard<std::mutex> lock(errorMutex);
+		if (error) std::rethrow_exception(error);
+	}
+	if (samples) {
+		assert((samples % channels) == 0);
+		assert(audiorate != 0);
+	}
+
+	Job& job = queue.back();
+	codec.copyFrame(frame, job.frame);
+	job.samples.assign(sampleData, sampleData + samples);
+	job.keyFrame = (frames++ % 300 == 0);
+	++framesBehind;
+	queue.push();
+}
+
+void AviWriter::encoderThreadMain()
+{
+	// The video chunk of a frame is always directly followed by the audio
+	// chunk of that frame, exactly like when all was done in addFrame().
+	while (Job* job = queue.front()) {
+		bool failed;
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			failed = bool(error);
+		}
+		if (!failed) {
+			try {
+				writeFrame(*job);
+			} catch (...) {
+				// rethrown from the next addFrame() call
+				std::lock_guard<std::mutex> lock(errorMutex);
+				error = std::current_exception();
+			}
+		}
+		--framesBehind;
+		queue.pop();
+	}
+}
+
+void AviWriter::writeFrame(Job& job)
+{
 	void* buffer;
 	unsigned size;
-	codec.compressFrame(keyFrame, frame, buffer, size);
-	addAviChunk("00dc", size, buffer, keyFrame ? 0x10 : 0x0);
+	codec.compressFrame(job.keyFrame, job.frame, buffer, size);
+	addAviChunk("00dc", size, buffer, job.keyFrame ? 0x10 : 0x0);
 
+	auto samples = unsigned(job.samples.size());
 	if (samples) {
-		assert((samples % channels) == 0);
-		assert(audiorate != 0);
 		if (OPENMSX_BIGENDIAN) {
 			// See comment in WavWriter::write()
 			//VLA(Endian::L16, buf, samples); // doesn't work in clang
 			//std::vector<Endian::L16> buf(sampleData, sampleData + samples); // needs c++11
 			std::vector<Endian::L16> buf(samples);
 			for (unsigned i = 0; i < samples; ++i) {
-				buf[i] = sampleData[i];
+				buf[i] = job.samples[i];
 			}
 			addAviChunk("01wb", samples * sizeof(int16_t), buf.data(), 0);
 		} else {
-			addAviChunk("01wb", samples * sizeof(int16_t), sampleData, 0);
+			addAviChunk("01wb", samples * sizeof(int16_t), job.samples.data(), 0);
 		}
 		audiowritten += samples;
 	}
@@ -5,8 +5,13 @@
 
 #include "ZMBVEncoder.hh"
 #include "File.hh"
+#include "BoundedQueue.hh"
 #include "endian.hh"
+#include <atomic>
 #include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -14,20 +19,46 @@ namespace openmsx {
 
 class Filename;
 class FrameSource;
+class CliComm;
 
 class AviWriter
 {
 public:
 	AviWriter(const Filename& filename, unsigned width, unsigned height,
-	          unsigned bpp, unsigned channels, unsigned freq);
+	          unsigned bpp, unsigned channels, unsigned freq,
+	          CliComm& cliComm);
+
+	/** Writes the remaining frames and the header. Errors can't be
+	  * thrown from here, so they are reported via CliComm instead.
+	  */
 	~AviWriter();
+
+	/** Add a video frame and the audio samples that belong to it. The
+	  * frame is copied, the compression and writing to the file happen
+	  * later in a separate thread. Errors of previous frames are rethrown
+	  * here.
+	  */
 	void addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData);
 	void setFps(float fps_) { fps = fps_; }
 
+	/** The number of frames that were added, but that are not yet
+	  * compressed and written to the file.
+	  */
+	unsigned getFramesBehind() const { return framesBehind; }
+
 private:
+	struct Job {
+		ZMBVEncoder::Frame frame;
+		std::vector<int16_t> samples;
+		bool keyFrame;
+	};
+
+	void encoderThreadMain();
+	void writeFrame(Job& job);
 	void addAviChunk(const char* tag, unsigned size, void* data, unsigned flags);
 
 	File file;
+	CliComm& cliComm;
 	ZMBVEncoder codec;
 	std::vector<Endian::L32> index;
 
@@ -40,6 +71,14 @@ private:
 	unsigned frames;
 	unsigned audiowritten;
 	unsigned written;
+
+	// Frames are passed to the encoder thread via this queue. When the
+	// encoder falls too much behind, addFrame() blocks.
+	BoundedQueue<Job> queue;
+	std::atomic<unsigned> framesBehind;
+	std::mutex errorMutex;
+	std::exception_ptr error; // set by the encoder thread
+	std::thread encoderThread;
 };
 
 } // namespace openmsx
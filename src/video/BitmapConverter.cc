@@ -1,13 +1,227 @@
 #include "BitmapConverter.hh"
+#include "HostCPU.hh"
 #include "Math.hh"
 #include "likely.hh"
 #include "unreachable.hh"
 #include "build-info.hh"
 #include "components.hh"
 #include <cstdint>
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
+#if HAVE_AVX2_DISPATCH
+// AVX2 versions of the line converters, only for 32bpp. These produce exactly
+// the same output as the generic versions below.
+
+// A 32bpp palette with (up to) 16 entries, split in 4 tables, one per byte of
+// the pixel (see BitmapConverter::calcPalettePlanes()), so that palette
+// lookups can be done with vpshufb.
+struct Palette16Tables
+{
+	TARGET_AVX2 explicit Palette16Tables(const byte (*planes)[16])
+	{
+		for (unsigned b = 0; b < 4; ++b) {
+			t[b] = _mm256_broadcastsi128_si256(_mm_load_si128(
+				reinterpret_cast<const __m128i*>(planes[b])));
+		}
+	}
+
+	// Translate 32 palette indices (each in range [0..16)) to 32 pixels.
+	TARGET_AVX2 inline void lookup(__m256i idx, uint32_t* out) const
+	{
+		__m256i b0 = _mm256_shuffle_epi8(t[0], idx);
+		__m256i b1 = _mm256_shuffle_epi8(t[1], idx);
+		__m256i b2 = _mm256_shuffle_epi8(t[2], idx);
+		__m256i b3 = _mm256_shuffle_epi8(t[3], idx);
+		__m256i lo01 = _mm256_unpacklo_epi8(b0, b1);
+		__m256i lo23 = _mm256_unpacklo_epi8(b2, b3);
+		__m256i hi01 = _mm256_unpackhi_epi8(b0, b1);
+		__m256i hi23 = _mm256_unpackhi_epi8(b2, b3);
+		// per 128-bit lane: pixels [0..4), [4..8), [8..12), [12..16)
+		__m256i p0 = _mm256_unpacklo_epi16(lo01, lo23);
+		__m256i p1 = _mm256_unpackhi_epi16(lo01, lo23);
+		__m256i p2 = _mm256_unpacklo_epi16(hi01, hi23);
+		__m256i p3 = _mm256_unpackhi_epi16(hi01, hi23);
+		auto o = reinterpret_cast<__m256i*>(out);
+		_mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256(o + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+
+	__m256i t[4];
+};
+
+// Translate 16 bytes, each containing two 4-bit palette indices (high nibble
+// first), to 32 pixels.
+TARGET_AVX2 static inline void renderNibbles(
+	const Palette16Tables& tables, __m128i data, uint32_t* out)
+{
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+	__m128i lo = _mm_and_si128(data, mask);
+	__m256i idx = _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_unpacklo_epi8(hi, lo)),
+		_mm_unpackhi_epi8(hi, lo), 1);
+	tables.lookup(idx, out);
+}
+
+TARGET_AVX2 static void renderGraphic4_AVX2(
+	uint32_t* out, const byte* vramPtr0, const byte (*planes)[16])
+{
+	Palette16Tables tables(planes);
+	for (unsigned i = 0; i < 128; i += 16) {
+		__m128i data = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i));
+		renderNibbles(tables, data, out + 2 * i);
+	}
+}
+
+TARGET_AVX2 static void renderGraphic5_AVX2(
+	uint32_t* out, const byte* vramPtr0, const byte (*planes)[16])
+{
+	// Entries [0..4) are for even pixels, [4..8) for odd pixels.
+	Palette16Tables tables(planes);
+	// Repeat each of 8 input bytes 4 times (4 pixels per byte).
+	const __m256i repeat = _mm256_setr_epi8(
+		0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+		4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+	// Pixel 0 and 1 come from the high nibble, pixel 2 and 3 from the low.
+	const __m256i lowNibble = _mm256_set1_epi32(0xFFFF0000);
+	// Pixel 0 and 2 take the upper 2 bits of the nibble, pixel 1 and 3 the
+	// lower 2 bits (and use the odd palette).
+	const __m256i oddPixel = _mm256_set1_epi32(0xFF00FF00);
+	const __m256i m0F = _mm256_set1_epi8(0x0F);
+	const __m256i m03 = _mm256_set1_epi8(0x03);
+	const __m256i m04 = _mm256_set1_epi8(0x04);
+	for (unsigned i = 0; i < 128; i += 8) {
+		__m256i data = _mm256_broadcastq_epi64(_mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i)));
+		__m256i rep = _mm256_shuffle_epi8(data, repeat);
+		__m256i nib = _mm256_blendv_epi8(
+			_mm256_and_si256(_mm256_srli_epi16(rep, 4), m0F),
+			_mm256_and_si256(rep, m0F),
+			lowNibble);
+		__m256i idx = _mm256_blendv_epi8(
+			_mm256_and_si256(_mm256_srli_epi16(nib, 2), m03),
+			_mm256_or_si256(_mm256_and_si256(nib, m03), m04),
+			oddPixel);
+		tables.lookup(idx, out + 4 * i);
+	}
+}
+
+TARGET_AVX2 static void renderGraphic6_AVX2(
+	uint32_t* out, const byte* vramPtr0, const byte* vramPtr1,
+	const byte (*planes)[16])
+{
+	Palette16Tables tables(planes);
+	for (unsigned i = 0; i < 128; i += 16) {
+		__m128i data0 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i));
+		__m128i data1 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr1 + i));
+		renderNibbles(tables, _mm_unpacklo_epi8(data0, data1), out + 4 * i +  0);
+		renderNibbles(tables, _mm_unpackhi_epi8(data0, data1), out + 4 * i + 32);
+	}
+}
+
+TARGET_AVX2 static void renderGraphic7_AVX2(
+	uint32_t* out, const byte* vramPtr0, const byte* vramPtr1,
+	const uint32_t* palette256)
+{
+	auto pal = reinterpret_cast<const int*>(palette256);
+	for (unsigned i = 0; i < 128; i += 16) {
+		__m128i data0 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i));
+		__m128i data1 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr1 + i));
+		__m128i lo = _mm_unpacklo_epi8(data0, data1);
+		__m128i hi = _mm_unpackhi_epi8(data0, data1);
+		__m256i idx[4] = {
+			_mm256_cvtepu8_epi32(lo),
+			_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)),
+			_mm256_cvtepu8_epi32(hi),
+			_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)),
+		};
+		auto o = reinterpret_cast<__m256i*>(out + 2 * i);
+		for (unsigned j = 0; j < 4; ++j) {
+			_mm256_storeu_si256(o + j,
+				_mm256_i32gather_epi32(pal, idx[j], 4));
+		}
+	}
+}
+
+// Convert 8 pixels (2 groups of 4) in YJK or YAE mode. Returns the index in
+// the 32768 color palette. Also returns a mask of the YAE pixels and their
+// index in the 16 color palette (only when 'yae' is set).
+TARGET_AVX2 static inline __m256i yjkColors(__m128i data, bool yae,
+                                            __m256i& yaeMask, __m256i& yaeIdx)
+{
+	__m256i p = _mm256_cvtepu8_epi32(data);
+	__m256i low3 = _mm256_and_si256(p, _mm256_set1_epi32(7));
+	// 6-bit signed values, each 128-bit lane is a group of 4 pixels
+	__m256i k = _mm256_add_epi32(
+		_mm256_shuffle_epi32(low3, 0x00),
+		_mm256_slli_epi32(_mm256_shuffle_epi32(low3, 0x55), 3));
+	__m256i j = _mm256_add_epi32(
+		_mm256_shuffle_epi32(low3, 0xAA),
+		_mm256_slli_epi32(_mm256_shuffle_epi32(low3, 0xFF), 3));
+	k = _mm256_srai_epi32(_mm256_slli_epi32(k, 26), 26);
+	j = _mm256_srai_epi32(_mm256_slli_epi32(j, 26), 26);
+
+	__m256i y = _mm256_srli_epi32(p, 3);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi32(31);
+	__m256i r = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y, j), zero), max);
+	__m256i g = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y, k), zero), max);
+	// (5 * y - 2 * j - k) / 4, rounded towards zero like in C++
+	__m256i t = _mm256_sub_epi32(
+		_mm256_add_epi32(_mm256_slli_epi32(y, 2), y),
+		_mm256_add_epi32(_mm256_add_epi32(j, j), k));
+	t = _mm256_add_epi32(t, _mm256_and_si256(_mm256_srai_epi32(t, 31),
+	                                         _mm256_set1_epi32(3)));
+	__m256i b = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(t, 2), zero), max);
+
+	if (yae) {
+		const __m256i bit3 = _mm256_set1_epi32(8);
+		yaeMask = _mm256_cmpeq_epi32(_mm256_and_si256(p, bit3), bit3);
+		yaeIdx = _mm256_srli_epi32(p, 4);
+	}
+	return _mm256_or_si256(_mm256_or_si256(
+		_mm256_slli_epi32(r, 10), _mm256_slli_epi32(g, 5)), b);
+}
+
+TARGET_AVX2 static void renderYJK_AVX2(
+	uint32_t* out, const byte* vramPtr0, const byte* vramPtr1,
+	const uint32_t* palette16, const uint32_t* palette32768, bool yae)
+{
+	auto pal16    = reinterpret_cast<const int*>(palette16);
+	auto pal32768 = reinterpret_cast<const int*>(palette32768);
+	for (unsigned i = 0; i < 128; i += 8) {
+		// Same pixel order as in Graphic 7: alternating planes.
+		__m128i data = _mm_unpacklo_epi8(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr0 + i)),
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr1 + i)));
+		auto o = reinterpret_cast<__m256i*>(out + 2 * i);
+		for (unsigned h = 0; h < 2; ++h) {
+			__m256i yaeMask, yaeIdx;
+			__m256i col = yjkColors(data, yae, yaeMask, yaeIdx);
+			__m256i pix = _mm256_i32gather_epi32(pal32768, col, 4);
+			if (yae) {
+				pix = _mm256_blendv_epi8(pix,
+					_mm256_i32gather_epi32(pal16, yaeIdx, 4),
+					yaeMask);
+			}
+			_mm256_storeu_si256(o + h, pix);
+			data = _mm_srli_si128(data, 8);
+		}
+	}
+}
+#endif
+
 template <class Pixel>
 BitmapConverter<Pixel>::BitmapConverter(
 	const Pixel* palette16_, const Pixel* palette256_,
@@ -16,6 +230,7 @@ BitmapConverter<Pixel>::BitmapConverter(
 	, palette256(palette256_)
 	, palette32768(palette32768_)
 	, dPaletteValid(false)
+	, palettePlanesValid(false)
 {
 }
 
@@ -36,6 +251,22 @@ void BitmapConverter<Pixel>::calcDPalette()
 	}
 }
 
+template <class Pixel>
+void BitmapConverter<Pixel>::calcPalettePlanes()
+{
+	palettePlanesValid = true;
+	// Graphic5: entries [0..4) are for even pixels, [4..8) for odd pixels.
+	static const byte g5Index[8] = { 0, 1, 2, 3, 16, 17, 18, 19 };
+	for (unsigned b = 0; b < 4; ++b) {
+		for (unsigned i = 0; i < 16; ++i) {
+			palettePlanes[0][b][i] = uint32_t(palette16[i]) >> (8 * b);
+			palettePlanes[1][b][i] = (i < 8)
+				? uint32_t(palette16[g5Index[i]]) >> (8 * b)
+				: 0;
+		}
+	}
+}
+
 template <class Pixel>
 void BitmapConverter<Pixel>::convertLine(
 	Pixel* linePtr, const byte* vramPtr)
@@ -121,6 +352,15 @@ void BitmapConverter<Pixel>::renderGraphic4(
 		pixelPtr[2 * i + 3] = palette16[data1 & 15];
 	}*/
 
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		if (unlikely(!palettePlanesValid)) calcPalettePlanes();
+		renderGraphic4_AVX2(reinterpret_cast<uint32_t*>(pixelPtr), vramPtr0,
+		                    palettePlanes[0]);
+		return;
+	}
+#endif
+
 	if (unlikely(!dPaletteValid)) {
 		calcDPalette();
 	}
@@ -247,6 +487,15 @@ void BitmapConverter<Pixel>::renderGraphic5(
 	Pixel*      __restrict pixelPtr,
 	const byte* __restrict vramPtr0)
 {
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		if (unlikely(!palettePlanesValid)) calcPalettePlanes();
+		renderGraphic5_AVX2(reinterpret_cast<uint32_t*>(pixelPtr), vramPtr0,
+		                    palettePlanes[1]);
+		return;
+	}
+#endif
+
 	for (unsigned i = 0; i < 128; ++i) {
 		unsigned data = vramPtr0[i];
 		pixelPtr[4 * i + 0] = palette16[ 0 +  (data >> 6)     ];
@@ -270,6 +519,14 @@ void BitmapConverter<Pixel>::renderGraphic6(
 		pixelPtr[4 * i + 2] = palette16[data1 >> 4];
 		pixelPtr[4 * i + 3] = palette16[data1 & 15];
 	}*/
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		if (unlikely(!palettePlanesValid)) calcPalettePlanes();
+		renderGraphic6_AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		                    vramPtr0, vramPtr1, palettePlanes[0]);
+		return;
+	}
+#endif
 	if (unlikely(!dPaletteValid)) {
 		calcDPalette();
 	}
@@ -308,6 +565,15 @@ void BitmapConverter<Pixel>::renderGraphic7(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		renderGraphic7_AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		                    vramPtr0, vramPtr1,
+		                    reinterpret_cast<const uint32_t*>(palette256));
+		return;
+	}
+#endif
+
 	for (unsigned i = 0; i < 128; ++i) {
 		pixelPtr[2 * i + 0] = palette256[vramPtr0[i]];
 		pixelPtr[2 * i + 1] = palette256[vramPtr1[i]];
@@ -320,6 +586,17 @@ void BitmapConverter<Pixel>::renderYJK(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		renderYJK_AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		               vramPtr0, vramPtr1,
+		               reinterpret_cast<const uint32_t*>(palette16),
+		               reinterpret_cast<const uint32_t*>(palette32768),
+		               false);
+		return;
+	}
+#endif
+
 	for (unsigned i = 0; i < 64; ++i) {
 		unsigned p[4];
 		p[0] = vramPtr0[2 * i + 0];
@@ -347,6 +624,17 @@ void BitmapConverter<Pixel>::renderYAE(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		renderYJK_AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		               vramPtr0, vramPtr1,
+		               reinterpret_cast<const uint32_t*>(palette16),
+		               reinterpret_cast<const uint32_t*>(palette32768),
+		               true);
+		return;
+	}
+#endif
+
 	for (unsigned i = 0; i < 64; ++i) {
 		unsigned p[4];
 		p[0] = vramPtr0[2 * i + 0];
@@ -71,10 +71,12 @@ public:
 	inline void palette16Changed()
 	{
 		dPaletteValid = false;
+		palettePlanesValid = false;
 	}
 
 private:
 	void calcDPalette();
+	void calcPalettePlanes();
 
 	inline void renderGraphic4(Pixel* pixelPtr, const byte* vramPtr0);
 	inline void renderGraphic5(Pixel* pixelPtr, const byte* vramPtr0);
@@ -94,8 +96,13 @@ private:
 
 	using DPixel = typename DoublePixel<sizeof(Pixel)>::type;
 	DPixel dPalette[16 * 16];
+	// palette16 split in one table per byte of the (32bpp) pixel, for the
+	// AVX2 converters: [0] has the 16 colors for Graphic4 and Graphic6,
+	// [1] the 4 even and 4 odd colors for Graphic5.
+	alignas(16) byte palettePlanes[2][4][16];
 	DisplayMode mode;
 	bool dPaletteValid;
+	bool palettePlanesValid;
 };
 
 } // namespace openmsx
@@ -0,0 +1,135 @@
+// Micro-benchmark for BitmapConverter.
+//
+// Converts full frames (212 lines of random VRAM data) in each bitmap display
+// mode to 32bpp pixels, once with the AVX2 line converters (if the host CPU
+// supports them) and once with the generic C++ versions. Reports the time per
+// frame and verifies that both produce exactly the same pixels.
+//
+// Usage: BitmapConverterBench [repeat]
+
+#include "BitmapConverter.hh"
+#include "DisplayMode.hh"
+#include "HostCPU.hh"
+#include "Benchmark.hh"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+using Pixel = uint32_t;
+
+static const unsigned LINES = 212;
+
+struct Mode
+{
+	const char* name;
+	byte mode;
+};
+static const Mode modes[] = {
+	{ "GRAPHIC4 (screen 5) ", DisplayMode::GRAPHIC4 },
+	{ "GRAPHIC5 (screen 6) ", DisplayMode::GRAPHIC5 },
+	{ "GRAPHIC6 (screen 7) ", DisplayMode::GRAPHIC6 },
+	{ "GRAPHIC7 (screen 8) ", DisplayMode::GRAPHIC7 },
+	{ "YJK      (screen 12)", DisplayMode::GRAPHIC7 | DisplayMode::YJK },
+	{ "YAE      (screen 10)", DisplayMode::GRAPHIC7 | DisplayMode::YJK |
+	                          DisplayMode::YAE },
+};
+
+// Construct a DisplayMode from its byte encoding (YAE YJK M5..M1).
+static DisplayMode makeMode(byte mode)
+{
+	byte reg0  = (mode & 0x1C) >> 1;
+	byte reg1  = ((mode & 0x02) << 2) | ((mode & 0x01) << 4);
+	byte reg25 = (mode & 0x60) >> 2;
+	return DisplayMode(reg0, reg1, reg25);
+}
+
+struct Palettes
+{
+	Pixel palette16[16 * 2];
+	Pixel palette256[256];
+	Pixel palette32768[32768];
+};
+
+static void convertFrame(BitmapConverter<Pixel>& converter, DisplayMode mode,
+                         const vector<byte>& vram, vector<Pixel>& frame)
+{
+	for (unsigned y = 0; y < LINES; ++y) {
+		Pixel* line = &frame[y * 512];
+		if (mode.isPlanar()) {
+			const byte* plane0 = &vram[y * 128];
+			const byte* plane1 = &vram[y * 128 + 0x10000];
+			converter.convertLinePlanar(line, plane0, plane1);
+		} else {
+			converter.convertLine(line, &vram[y * 128]);
+		}
+	}
+}
+
+// Returns the best time per frame (in microseconds), the pixels of the last
+// converted frame are stored in 'frame'.
+static double measure(BitmapConverter<Pixel>& converter, DisplayMode mode,
+                      const vector<byte>& vram, vector<Pixel>& frame,
+                      unsigned repeat)
+{
+	converter.setDisplayMode(mode);
+	return Benchmark::best(repeat, [&]() {
+		convertFrame(converter, mode, vram, frame);
+	});
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 1000);
+
+	mt19937 gen(12345);
+	uniform_int_distribution<unsigned> dist;
+	vector<byte> vram(0x20000);
+	for (auto& b : vram) b = dist(gen);
+	Palettes pal;
+	for (auto& p : pal.palette16)    p = dist(gen);
+	for (auto& p : pal.palette256)   p = dist(gen);
+	for (auto& p : pal.palette32768) p = dist(gen);
+	BitmapConverter<Pixel> converter(
+		pal.palette16, pal.palette256, pal.palette32768);
+
+	bool avx2 = HostCPU::hasAVX2();
+	if (!avx2) {
+		cout << "Host CPU doesn't support AVX2, "
+		        "only measuring the generic code." << endl;
+	}
+	cout << "Best time per frame of " << LINES << " lines (us), "
+	     << repeat << " repetitions" << endl;
+	cout << "                      generic   AVX2" << endl;
+
+	Benchmark::Checker checker;
+	vector<Pixel> frameAVX2(LINES * 512), frameGeneric(LINES * 512);
+	for (auto& m : modes) {
+		DisplayMode mode = makeMode(m.mode);
+		double tAVX2 = 0.0;
+		if (avx2) {
+			tAVX2 = measure(converter, mode, vram, frameAVX2, repeat);
+		}
+		HostCPU::setAVX2Enabled(false);
+		double tGeneric = measure(converter, mode, vram, frameGeneric, repeat);
+		HostCPU::setAVX2Enabled(true);
+
+		cout << m.name << "  " << tGeneric;
+		if (avx2) {
+			cout << "   " << tAVX2;
+			unsigned width = (mode.getLineWidth() == 512) ? 512 : 256;
+			for (unsigned y = 0; y < LINES; ++y) {
+				for (unsigned x = 0; x < width; ++x) {
+					checker.check(frameAVX2   [y * 512 + x] ==
+					              frameGeneric[y * 512 + x]);
+				}
+			}
+		}
+		cout << endl;
+	}
+	return checker.exitCode(
+		"AVX2 and generic code produced different pixels");
+}
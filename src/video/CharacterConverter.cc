@@ -10,6 +10,7 @@ TODO:
 #include "CharacterConverter.hh"
 #include "VDP.hh"
 #include "VDPVRAM.hh"
+#include "HostCPU.hh"
 #include "build-info.hh"
 #include "components.hh"
 #include <cstdint>
@@ -17,6 +18,9 @@ TODO:
 #ifdef __SSE2__
 #include "emmintrin.h" // SSE2
 #endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -236,6 +240,59 @@ template<typename Pixel> static inline void draw8(
 	pixelPtr += 8;
 }
 
+#if HAVE_AVX2_DISPATCH
+// AVX2 versions, only for 32bpp, see HostCPU.hh.
+
+TARGET_AVX2 static inline __m256i expand8_AVX2(
+	uint32_t fg, uint32_t bg, unsigned pattern)
+{
+	const __m256i bits = _mm256_setr_epi32(
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	__m256i set = _mm256_cmpeq_epi32(
+		_mm256_and_si256(_mm256_set1_epi32(pattern), bits), bits);
+	return _mm256_blendv_epi8(
+		_mm256_set1_epi32(bg), _mm256_set1_epi32(fg), set);
+}
+
+TARGET_AVX2 static void renderGraphic2_AVX2(
+	uint32_t* __restrict out, const byte* namePtr,
+	const byte* patternArea, const byte* colorArea,
+	const uint32_t* palette)
+{
+	for (unsigned n = 0; n < 32; ++n) {
+		unsigned charCode8 = namePtr[n] * 8;
+		unsigned pattern = patternArea[charCode8];
+		unsigned color   = colorArea  [charCode8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * n),
+			expand8_AVX2(palette[color >> 4], palette[color & 0x0F], pattern));
+	}
+}
+
+TARGET_AVX2 static void renderText2_AVX2(
+	uint32_t* __restrict out, const byte* nameArea, const byte* patternArea,
+	unsigned colorPattern,
+	uint32_t plainFg, uint32_t plainBg, uint32_t blinkFg, uint32_t blinkBg)
+{
+	for (unsigned j = 0; j < 8; ++j) {
+		bool blink = (colorPattern << j) & 0x80;
+		__m256i pixels = expand8_AVX2(
+			blink ? blinkFg : plainFg,
+			blink ? blinkBg : plainBg,
+			patternArea[nameArea[j] * 8]);
+		// Characters are 6 pixels wide: the 2 extra pixels are
+		// overwritten by the next character, except for the last one.
+		auto p = out + 6 * j;
+		if (j == 7) {
+			_mm256_maskstore_epi32(reinterpret_cast<int*>(p),
+				_mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0),
+				pixels);
+		} else {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), pixels);
+		}
+	}
+}
+#endif
+
 template <class Pixel>
 void CharacterConverter<Pixel>::renderText1(
 	Pixel* __restrict pixelPtr, int line)
@@ -310,41 +367,60 @@ void CharacterConverter<Pixel>::renderText2(
 			(colorStart + i) | (~0u << 9));
 		const byte* nameArea = vram.nameTable.getReadArea(
 			(nameStart + 8 * i) | (~0u << 12), 8);
-		draw6(pixelPtr,
-		      (colorPattern & 0x80) ? blinkFg : plainFg,
-		      (colorPattern & 0x80) ? blinkBg : plainBg,
-		      patternArea[nameArea[0] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x40) ? blinkFg : plainFg,
-		      (colorPattern & 0x40) ? blinkBg : plainBg,
-		      patternArea[nameArea[1] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x20) ? blinkFg : plainFg,
-		      (colorPattern & 0x20) ? blinkBg : plainBg,
-		      patternArea[nameArea[2] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x10) ? blinkFg : plainFg,
-		      (colorPattern & 0x10) ? blinkBg : plainBg,
-		      patternArea[nameArea[3] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x08) ? blinkFg : plainFg,
-		      (colorPattern & 0x08) ? blinkBg : plainBg,
-		      patternArea[nameArea[4] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x04) ? blinkFg : plainFg,
-		      (colorPattern & 0x04) ? blinkBg : plainBg,
-		      patternArea[nameArea[5] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x02) ? blinkFg : plainFg,
-		      (colorPattern & 0x02) ? blinkBg : plainBg,
-		      patternArea[nameArea[6] * 8]);
-		draw6(pixelPtr,
-		      (colorPattern & 0x01) ? blinkFg : plainFg,
-		      (colorPattern & 0x01) ? blinkBg : plainBg,
-		      patternArea[nameArea[7] * 8]);
+		renderText2Chars(pixelPtr, nameArea, patternArea, colorPattern,
+		                 plainFg, plainBg, blinkFg, blinkBg);
+		pixelPtr += 8 * 6;
 	}
 }
 
+template <class Pixel>
+void CharacterConverter<Pixel>::renderText2Chars(
+	Pixel* __restrict pixelPtr, const byte* nameArea, const byte* patternArea,
+	unsigned colorPattern,
+	Pixel plainFg, Pixel plainBg, Pixel blinkFg, Pixel blinkBg)
+{
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		renderText2_AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		                 nameArea, patternArea, colorPattern,
+		                 plainFg, plainBg, blinkFg, blinkBg);
+		return;
+	}
+#endif
+	draw6(pixelPtr,
+	      (colorPattern & 0x80) ? blinkFg : plainFg,
+	      (colorPattern & 0x80) ? blinkBg : plainBg,
+	      patternArea[nameArea[0] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x40) ? blinkFg : plainFg,
+	      (colorPattern & 0x40) ? blinkBg : plainBg,
+	      patternArea[nameArea[1] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x20) ? blinkFg : plainFg,
+	      (colorPattern & 0x20) ? blinkBg : plainBg,
+	      patternArea[nameArea[2] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x10) ? blinkFg : plainFg,
+	      (colorPattern & 0x10) ? blinkBg : plainBg,
+	      patternArea[nameArea[3] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x08) ? blinkFg : plainFg,
+	      (colorPattern & 0x08) ? blinkBg : plainBg,
+	      patternArea[nameArea[4] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x04) ? blinkFg : plainFg,
+	      (colorPattern & 0x04) ? blinkBg : plainBg,
+	      patternArea[nameArea[5] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x02) ? blinkFg : plainFg,
+	      (colorPattern & 0x02) ? blinkBg : plainBg,
+	      patternArea[nameArea[6] * 8]);
+	draw6(pixelPtr,
+	      (colorPattern & 0x01) ? blinkFg : plainFg,
+	      (colorPattern & 0x01) ? blinkBg : plainBg,
+	      patternArea[nameArea[7] * 8]);
+}
+
 template <class Pixel>
 const byte* CharacterConverter<Pixel>::getNamePtr(int line, int scroll)
 {
@@ -390,14 +466,6 @@ template <class Pixel>
 void CharacterConverter<Pixel>::renderGraphic2(
 	Pixel* __restrict pixelPtr, int line)
 {
-	bool misAligned = false; // initialize with dummy
-	uint32_t partial = 0;    // values to avoid warning
-#ifdef __arm__
-	misAligned = sizeof(Pixel) == 2 && (reinterpret_cast<uintptr_t>(pixelPtr) & 3);
-	if (misAligned) pixelPtr--;
-	partial = *pixelPtr;
-#endif
-
 	int quarter8 = (((line / 8) * 32) & ~0xFF) * 8;
 	int line7 = line & 7;
 	int scroll = vdp.getHorizontalScrollHigh();
@@ -411,30 +479,68 @@ void CharacterConverter<Pixel>::renderGraphic2(
 		// This is very common, so make an optimized version for this.
 		const byte* patternArea = vram.patternTable.getReadArea(quarter8, 8 * 256) + line7;
 		const byte* colorArea   = vram.colorTable  .getReadArea(quarter8, 8 * 256) + line7;
-		for (unsigned n = 0; n < 32; ++n) {
-			unsigned charCode8 = namePtr[n] * 8;
-			unsigned pattern = patternArea[charCode8];
-			unsigned color   = colorArea  [charCode8];
-			Pixel fg = palFg[color >> 4];
-			Pixel bg = palFg[color & 0x0F];
-			draw8(pixelPtr, fg, bg, pattern, misAligned, partial);
-		}
-	} else {
-		// Slower variant, also works when:
-		// - there is mirroring in the color table
-		// - there is mirroring in the pattern table (TMS9929)
-		// - V9958 horizontal scroll feature is used
-		int baseLine = (~0u << 13) | quarter8 | line7;
-		for (unsigned n = 0; n < 32; ++n) {
-			unsigned charCode8 = namePtr[scroll & 0x1F] * 8;
-			unsigned index = charCode8 | baseLine;
-			unsigned pattern = vram.patternTable.readNP(index);
-			unsigned color   = vram.colorTable  .readNP(index);
-			Pixel fg = palFg[color >> 4];
-			Pixel bg = palFg[color & 0x0F];
-			draw8(pixelPtr, fg, bg, pattern, misAligned, partial);
-			if (!(++scroll & 0x1F)) namePtr = getNamePtr(line, scroll);
-		}
+		renderGraphic2Chars(pixelPtr, namePtr, patternArea, colorArea, palFg);
+		return;
+	}
+
+	bool misAligned = false; // initialize with dummy
+	uint32_t partial = 0;    // values to avoid warning
+#ifdef __arm__
+	misAligned = sizeof(Pixel) == 2 && (reinterpret_cast<uintptr_t>(pixelPtr) & 3);
+	if (misAligned) pixelPtr--;
+	partial = *pixelPtr;
+#endif
+
+	// Slower variant, also works when:
+	// - there is mirroring in the color table
+	// - there is mirroring in the pattern table (TMS9929)
+	// - V9958 horizontal scroll feature is used
+	int baseLine = (~0u << 13) | quarter8 | line7;
+	for (unsigned n = 0; n < 32; ++n) {
+		unsigned charCode8 = namePtr[scroll & 0x1F] * 8;
+		unsigned index = charCode8 | baseLine;
+		unsigned pattern = vram.patternTable.readNP(index);
+		unsigned color   = vram.colorTable  .readNP(index);
+		Pixel fg = palFg[color >> 4];
+		Pixel bg = palFg[color & 0x0F];
+		draw8(pixelPtr, fg, bg, pattern, misAligned, partial);
+		if (!(++scroll & 0x1F)) namePtr = getNamePtr(line, scroll);
+	}
+
+#ifdef __arm__
+	if (misAligned) *pixelPtr = static_cast<Pixel>(partial);
+#endif
+}
+
+template <class Pixel>
+void CharacterConverter<Pixel>::renderGraphic2Chars(
+	Pixel* __restrict pixelPtr, const byte* namePtr,
+	const byte* patternArea, const byte* colorArea, const Pixel* palette)
+{
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		renderGraphic2_AVX2(
+			reinterpret_cast<uint32_t*>(pixelPtr), namePtr,
+			patternArea, colorArea,
+			reinterpret_cast<const uint32_t*>(palette));
+		return;
+	}
+#endif
+	bool misAligned = false; // initialize with dummy
+	uint32_t partial = 0;    // values to avoid warning
+#ifdef __arm__
+	misAligned = sizeof(Pixel) == 2 && (reinterpret_cast<uintptr_t>(pixelPtr) & 3);
+	if (misAligned) pixelPtr--;
+	partial = *pixelPtr;
+#endif
+
+	for (unsigned n = 0; n < 32; ++n) {
+		unsigned charCode8 = namePtr[n] * 8;
+		unsigned pattern = patternArea[charCode8];
+		unsigned color   = colorArea  [charCode8];
+		Pixel fg = palette[color >> 4];
+		Pixel bg = palette[color & 0x0F];
+		draw8(pixelPtr, fg, bg, pattern, misAligned, partial);
 	}
 
 #ifdef __arm__
@@ -41,6 +41,35 @@ public:
 	  */
 	void setDisplayMode(DisplayMode mode);
 
+	// The inner loops of renderGraphic2() and renderText2(). These are
+	// public so that CharacterConverterBench can compare their AVX2 and
+	// generic versions.
+
+	/** Convert one line of 32 Graphic2/Graphic3 characters, for the
+	  * common case without table mirroring or horizontal scroll.
+	  * @param pixelPtr Output, 256 pixels.
+	  * @param namePtr The 32 character codes.
+	  * @param patternArea, colorArea Pattern and color table, already
+	  *   offset by the line within the character (table[8 * code]).
+	  * @param palette 16-entries palette.
+	  */
+	static void renderGraphic2Chars(
+		Pixel* pixelPtr, const byte* namePtr,
+		const byte* patternArea, const byte* colorArea,
+		const Pixel* palette);
+
+	/** Convert 8 Text2 characters (6 pixels wide).
+	  * @param pixelPtr Output, exactly 48 pixels.
+	  * @param nameArea The 8 character codes.
+	  * @param patternArea Pattern table, already offset by the line
+	  *   within the character (patternArea[8 * code]).
+	  * @param colorPattern Blink bits, bit 7 for the first character.
+	  */
+	static void renderText2Chars(
+		Pixel* pixelPtr, const byte* nameArea, const byte* patternArea,
+		unsigned colorPattern,
+		Pixel plainFg, Pixel plainBg, Pixel blinkFg, Pixel blinkBg);
+
 private:
 	inline void renderText1   (Pixel* pixelPtr, int line);
 	inline void renderText1Q  (Pixel* pixelPtr, int line);
@@ -0,0 +1,119 @@
+// Micro-benchmark for CharacterConverter.
+//
+// Runs the inner loops of the Graphic2 (screen 2) and Text2 (80 columns)
+// renderers on random VRAM data, once with the AVX2 versions (if the host CPU
+// supports them) and once with the generic C++ versions. Reports the time per
+// frame and verifies that both produce exactly the same pixels.
+//
+// Usage: CharacterConverterBench [repeat]
+
+#include "CharacterConverter.hh"
+#include "HostCPU.hh"
+#include "Benchmark.hh"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+using Pixel = uint32_t;
+using Converter = CharacterConverter<Pixel>;
+
+struct VRAM
+{
+	byte names[24 * 80];
+	byte colors[24 * 80 / 8];
+	byte patterns[8 * 256];
+	byte colorTable[8 * 256];
+	Pixel palette[16];
+};
+
+// 192 lines of 32 characters, returns 256 pixels per line.
+static void renderGraphic2(const VRAM& vram, vector<Pixel>& frame)
+{
+	for (unsigned y = 0; y < 192; ++y) {
+		Converter::renderGraphic2Chars(
+			&frame[y * 512], &vram.names[(y / 8) * 32],
+			&vram.patterns[y & 7], &vram.colorTable[y & 7],
+			vram.palette);
+	}
+}
+
+// 192 lines of 80 characters, returns 480 pixels per line.
+static void renderText2(const VRAM& vram, vector<Pixel>& frame)
+{
+	Pixel plainFg = vram.palette[15], plainBg = vram.palette[4];
+	Pixel blinkFg = vram.palette[ 1], blinkBg = vram.palette[6];
+	for (unsigned y = 0; y < 192; ++y) {
+		for (unsigned i = 0; i < (80 / 8); ++i) {
+			Converter::renderText2Chars(
+				&frame[y * 512 + 48 * i],
+				&vram.names[(y / 8) * 80 + 8 * i],
+				&vram.patterns[y & 7],
+				vram.colors[(y / 8) * 10 + i],
+				plainFg, plainBg, blinkFg, blinkBg);
+		}
+	}
+}
+
+struct Renderer
+{
+	const char* name;
+	void (*render)(const VRAM&, vector<Pixel>&);
+};
+static const Renderer renderers[] = {
+	{ "GRAPHIC2 (screen 2)  ", renderGraphic2 },
+	{ "TEXT2    (80 columns)", renderText2    },
+};
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 1000);
+
+	mt19937 gen(12345);
+	uniform_int_distribution<unsigned> dist;
+	VRAM vram;
+	for (auto& b : vram.names)      b = dist(gen);
+	for (auto& b : vram.colors)     b = dist(gen);
+	for (auto& b : vram.patterns)   b = dist(gen);
+	for (auto& b : vram.colorTable) b = dist(gen);
+	for (auto& p : vram.palette)    p = dist(gen);
+
+	bool avx2 = HostCPU::hasAVX2();
+	if (!avx2) {
+		cout << "Host CPU doesn't support AVX2, "
+		        "only measuring the generic code." << endl;
+	}
+	cout << "Best time per frame of 192 lines (us), "
+	     << repeat << " repetitions" << endl;
+	cout << "                       generic   AVX2" << endl;
+
+	Benchmark::Checker checker;
+	// The pixels after the end of each line stay zero, so comparing the
+	// full frames also checks that nothing is written past the end.
+	vector<Pixel> frameAVX2(192 * 512), frameGeneric(192 * 512);
+	for (auto& r : renderers) {
+		double tAVX2 = 0.0;
+		if (avx2) {
+			tAVX2 = Benchmark::best(repeat, [&]() {
+				r.render(vram, frameAVX2);
+			});
+		}
+		HostCPU::setAVX2Enabled(false);
+		double tGeneric = Benchmark::best(repeat, [&]() {
+			r.render(vram, frameGeneric);
+		});
+		HostCPU::setAVX2Enabled(true);
+
+		cout << r.name << "  " << tGeneric;
+		if (avx2) {
+			cout << "   " << tAVX2;
+			checker.check(frameAVX2 == frameGeneric);
+		}
+		cout << endl;
+	}
+	return checker.exitCode(
+		"AVX2 and generic code produced different pixels");
+}
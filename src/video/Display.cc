@@ -46,6 +46,7 @@ Display::Display(Reactor& reactor_)
 	, currentRenderer(RenderSettings::UNINITIALIZED)
 	, resolution(-1, -1)
 	, switchInProgress(false)
+	, batchWarmupFrames(0)
 {
 	frameDurationSum = 0;
 	for (unsigned i = 0; i < NUM_FRAME_DURATIONS; ++i) {
@@ -181,6 +182,9 @@ int Display::signalEvent(const std::shared_ptr<const Event>& event)
 			reactor.getEventDistributor().distributeEvent(
 				std::make_shared<SimpleEvent>(
 					OPENMSX_FRAME_DRAWN_EVENT));
+			if ((batchWarmupFrames != 0) && (--batchWarmupFrames == 0)) {
+				takePendingScreenShots();
+			}
 		}
 	} else if (event->getType() == OPENMSX_SWITCH_RENDERER_EVENT) {
 		doRendererSwitch();
@@ -314,6 +318,69 @@ void Display::doRendererSwitch2()
 	}
 }
 
+void Display::enableBatchRenderer()
+{
+	auto& rendererSetting = renderSettings.getRendererSetting();
+	if (!reactor.isBatchMode() || switchInProgress ||
+	    (rendererSetting.getEnum() != RenderSettings::DUMMY)) {
+		return;
+	}
+	// Unlike checkRendererSwitch() switch right away (like
+	// createVideoSystem() does). We're called from a command, not from a
+	// Tcl variable trace, and the caller needs the new video system now.
+	switchInProgress = true; // makes checkRendererSwitch() ignore this
+	rendererSetting.setValue(rendererSetting.getRestoreValue());
+	if (rendererSetting.getEnum() == RenderSettings::DUMMY) {
+		rendererSetting.setEnum(RenderSettings::SDL);
+	}
+	currentRenderer = renderSettings.getRenderer();
+	doRendererSwitch();
+	// The first frame after the switch is only partially drawn.
+	batchWarmupFrames = 2;
+}
+
+void Display::takePendingScreenShots()
+{
+	for (auto& shot : pendingScreenShots) {
+		try {
+			takeScreenShot(shot.filename, shot.rawShot,
+			               shot.doubleSize, shot.withOsd);
+		} catch (MSXException& e) {
+			getCliComm().printWarning(e.getMessage());
+		}
+	}
+	pendingScreenShots.clear();
+}
+
+void Display::takeScreenShot(const string& filename, bool rawShot,
+                             bool doubleSize, bool withOsd)
+{
+	if (!rawShot) {
+		// include all layers (OSD stuff, console)
+		try {
+			getVideoSystem().takeScreenShot(filename, withOsd);
+		} catch (MSXException& e) {
+			throw CommandException(
+				"Failed to take screenshot: " + e.getMessage());
+		}
+	} else {
+		auto videoLayer = dynamic_cast<VideoLayer*>(findActiveLayer());
+		if (!videoLayer) {
+			throw CommandException(
+				"Current renderer doesn't support taking screenshots.");
+		}
+		unsigned height = doubleSize ? 480 : 240;
+		try {
+			videoLayer->takeRawScreenShot(height, filename);
+		} catch (MSXException& e) {
+			throw CommandException(
+				"Failed to take screenshot: " + e.getMessage());
+		}
+	}
+
+	getCliComm().printInfo("Screen saved to " + filename);
+}
+
 void Display::repaint()
 {
 	if (switchInProgress) {
@@ -456,31 +523,16 @@ void Display::ScreenShotCmd::execute(array_ref<TclObject> tokens, TclObject& res
 	string filename = FileOperations::parseCommandFileArgument(
 		fname, "screenshots", prefix, ".png");
 
-	if (!rawShot) {
-		// include all layers (OSD stuff, console)
-		try {
-			display.getVideoSystem().takeScreenShot(filename, withOsd);
-		} catch (MSXException& e) {
-			throw CommandException(
-				"Failed to take screenshot: " + e.getMessage());
-		}
+	display.enableBatchRenderer();
+	if (display.batchWarmupFrames != 0) {
+		// Nothing (complete) has been drawn yet, take the screenshot
+		// once it has. The filename is already resolved, so we can
+		// already return it.
+		display.pendingScreenShots.push_back(
+			{filename, rawShot, doubleSize, withOsd});
 	} else {
-		auto videoLayer = dynamic_cast<VideoLayer*>(
-			display.findActiveLayer());
-		if (!videoLayer) {
-			throw CommandException(
-				"Current renderer doesn't support taking screenshots.");
-		}
-		unsigned height = doubleSize ? 480 : 240;
-		try {
-			videoLayer->takeRawScreenShot(height, filename);
-		} catch (MSXException& e) {
-			throw CommandException(
-				"Failed to take screenshot: " + e.getMessage());
-		}
+		display.takeScreenShot(filename, rawShot, doubleSize, withOsd);
 	}
-
-	display.getCliComm().printInfo("Screen saved to " + filename);
 	result.setString(filename);
 }
 
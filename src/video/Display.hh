@@ -14,6 +14,7 @@
 #include "gl_vec.hh"
 #include <memory>
 #include <vector>
+#include <string>
 #include <cstdint>
 
 namespace openmsx {
@@ -66,6 +67,13 @@ public:
 
 	std::string getWindowTitle();
 
+	/** In batch mode the renderer starts as 'none' (see
+	  * CommandLineParser::isHiddenStartup()). Commands that need the
+	  * video output ('screenshot', 'record') call this to switch to the
+	  * configured renderer. Does nothing in other cases.
+	  */
+	void enableBatchRenderer();
+
 private:
 	void resetVideoSystem();
 
@@ -82,6 +90,10 @@ private:
 	void doRendererSwitch();
 	void doRendererSwitch2();
 
+	void takeScreenShot(const std::string& filename, bool rawShot,
+	                    bool doubleSize, bool withOsd);
+	void takePendingScreenShots();
+
 	/** Find frontmost opaque layer.
 	  */
 	Layers::iterator baseLayer();
@@ -125,8 +137,19 @@ private:
 
 	gl::ivec2 resolution;
 
+	// batch mode: screenshots requested before the (just enabled)
+	// renderer drew a complete frame, see enableBatchRenderer()
+	struct PendingScreenShot {
+		std::string filename;
+		bool rawShot;
+		bool doubleSize;
+		bool withOsd;
+	};
+	std::vector<PendingScreenShot> pendingScreenShots;
+
 	bool renderFrozen;
 	bool switchInProgress;
+	unsigned batchWarmupFrames;
 };
 
 } // namespace openmsx
@@ -77,6 +77,10 @@ void DummyRenderer::updateColorBase(int /*addr*/, EmuTime::param /*time*/) {
 void DummyRenderer::updateSpritesEnabled(bool /*enabled*/, EmuTime::param /*time*/) {
 }
 
+bool DummyRenderer::isVRAMObserved(unsigned /*address*/, unsigned /*size*/) const {
+	return false;
+}
+
 void DummyRenderer::updateVRAM(unsigned /*offset*/, EmuTime::param /*time*/) {
 }
 
@@ -6,6 +6,7 @@
 #include "Scaler.hh"
 #include "ScalerFactory.hh"
 #include "OutputSurface.hh"
+#include "WorkerPool.hh"
 #include "IntegerSetting.hh"
 #include "FloatSetting.hh"
 #include "BooleanSetting.hh"
@@ -24,6 +25,17 @@
 
 namespace openmsx {
 
+// The image is scaled in (at most) this many bands in parallel.
+static const unsigned MAX_SCALER_THREADS = 4;
+
+// Shared by all FBPostProcessor objects, they are painted one after the other
+// from the main thread. The calling thread also scales one band.
+static WorkerPool& getScalerPool()
+{
+	static WorkerPool pool(WorkerPool::workersForCores(MAX_SCALER_THREADS));
+	return pool;
+}
+
 static const unsigned NOISE_SHIFT = 8192;
 static const unsigned NOISE_BUF_SIZE = 2 * NOISE_SHIFT;
 SSE_ALIGNED(static signed char noiseBuf[NOISE_BUF_SIZE]);
@@ -207,14 +219,14 @@ void FBPostProcessor<Pixel>::drawNoiseLine(
 }
 
 template <class Pixel>
-void FBPostProcessor<Pixel>::drawNoise(OutputSurface& output)
+void FBPostProcessor<Pixel>::drawNoise(
+	OutputSurface& output, unsigned startY, unsigned endY)
 {
 	if (renderSettings.getNoise() == 0.0f) return;
 
-	unsigned h = output.getHeight();
 	unsigned w = output.getWidth();
-	output.lock();
-	for (unsigned y = 0; y < h; ++y) {
+	assert(output.isLocked());
+	for (unsigned y = startY; y < endY; ++y) {
 		Pixel* buf = output.getLinePtrDirect<Pixel>(y);
 		drawNoiseLine(buf, &noiseBuf[noiseShift[y]], w);
 	}
@@ -275,9 +287,14 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 	if ((scaleAlgorithm != algo) || (scaleFactor != factor)) {
 		scaleAlgorithm = algo;
 		scaleFactor = factor;
-		currScaler = ScalerFactory<Pixel>::createScaler(
-			PixelOperations<Pixel>(output.getSDLFormat()),
-			renderSettings);
+		currScalers.clear();
+		auto& pool = getScalerPool();
+		do {
+			currScalers.push_back(ScalerFactory<Pixel>::createScaler(
+				PixelOperations<Pixel>(output.getSDLFormat()),
+				renderSettings));
+		} while (currScalers.front()->canScaleInParts() &&
+		         (currScalers.size() < pool.getNumThreads()));
 	}
 
 	// Scale image.
@@ -288,21 +305,73 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 	unsigned srcStep = srcHeight / g;
 	unsigned dstStep = dstHeight / g;
 
+	// Split the output in (about) equally high bands, each a multiple of
+	// 'dstStep' lines. Each band is scaled with its own Scaler object,
+	// possibly in a different thread.
+	auto numBands = unsigned(currScalers.size());
+	unsigned stepsPerBand = (g + numBands - 1) / numBands;
+	float horStretch = renderSettings.getHorizontalStretch();
+	unsigned inWidth = unsigned(horStretch + 0.5f);
+	output.lock();
+	auto doBand = [&](unsigned band) {
+		unsigned startStep = std::min(band * stepsPerBand, g);
+		unsigned endStep = std::min(startStep + stepsPerBand, g);
+		if (startStep == endStep) return;
+		scaleBand(output, *currScalers[band], inWidth,
+		          startStep * srcStep,
+		          startStep * dstStep, endStep * dstStep,
+		          srcStep, dstStep);
+	};
+	if (numBands == 1) {
+		doBand(0);
+	} else {
+		getScalerPool().parallelFor(numBands, doBand);
+	}
+
+	output.flushFrameBuffer(); // for SDLGL-FBxx
+}
+
+template <class Pixel>
+void FBPostProcessor<Pixel>::scaleBand(
+	OutputSurface& output, Scaler<Pixel>& scaler, unsigned inWidth,
+	unsigned bandSrcStartY, unsigned bandDstStartY, unsigned bandDstEndY,
+	unsigned srcStep, unsigned dstStep)
+{
+	// Note: possibly called from a worker thread.
+	std::unique_ptr<ScalerOutput<Pixel>> dst(
+		StretchScalerOutputFactory<Pixel>::create(
+			output, pixelOps, inWidth));
+	scaleRegions(scaler, *paintFrame, superImposeVideoFrame, *dst,
+	             bandSrcStartY, bandDstStartY, bandDstEndY,
+	             srcStep, dstStep);
+
+	drawNoise(output, bandDstStartY, bandDstEndY);
+}
+
+template <class Pixel>
+void FBPostProcessor<Pixel>::scaleRegions(
+	Scaler<Pixel>& scaler, FrameSource& src, const RawFrame* superImpose,
+	ScalerOutput<Pixel>& dst, unsigned bandSrcStartY,
+	unsigned bandDstStartY, unsigned bandDstEndY,
+	unsigned srcStep, unsigned dstStep)
+{
+	const unsigned srcHeight = src.getHeight();
+
 	// TODO: Store all MSX lines in RawFrame and only scale the ones that fit
 	//       on the PC screen, as a preparation for resizable output window.
-	unsigned srcStartY = 0;
-	unsigned dstStartY = 0;
-	while (dstStartY < dstHeight) {
+	unsigned srcStartY = bandSrcStartY;
+	unsigned dstStartY = bandDstStartY;
+	while (dstStartY < bandDstEndY) {
 		// Currently this is true because the source frame height
 		// is always >= dstHeight/(dstStep/srcStep).
 		assert(srcStartY < srcHeight);
 
 		// get region with equal lineWidth
-		unsigned lineWidth = getLineWidth(paintFrame, srcStartY, srcStep);
+		unsigned lineWidth = getLineWidth(&src, srcStartY, srcStep);
 		unsigned srcEndY = srcStartY + srcStep;
 		unsigned dstEndY = dstStartY + dstStep;
-		while ((srcEndY < srcHeight) && (dstEndY < dstHeight) &&
-		       (getLineWidth(paintFrame, srcEndY, srcStep) == lineWidth)) {
+		while ((srcEndY < srcHeight) && (dstEndY < bandDstEndY) &&
+		       (getLineWidth(&src, srcEndY, srcStep) == lineWidth)) {
 			srcEndY += srcStep;
 			dstEndY += dstStep;
 		}
@@ -310,25 +379,15 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 		// fill region
 		//fprintf(stderr, "post processing lines %d-%d: %d\n",
 		//	srcStartY, srcEndY, lineWidth );
-		output.lock();
-		float horStretch = renderSettings.getHorizontalStretch();
-		unsigned inWidth = unsigned(horStretch + 0.5f);
-		std::unique_ptr<ScalerOutput<Pixel>> dst(
-			StretchScalerOutputFactory<Pixel>::create(
-				output, pixelOps, inWidth));
-		currScaler->scaleImage(
-			*paintFrame, superImposeVideoFrame,
+		scaler.scaleImage(
+			src, superImpose,
 			srcStartY, srcEndY, lineWidth, // source
-			*dst, dstStartY, dstEndY); // dest
+			dst, dstStartY, dstEndY); // dest
 
 		// next region
 		srcStartY = srcEndY;
 		dstStartY = dstEndY;
 	}
-
-	drawNoise(output);
-
-	output.flushFrameBuffer(); // for SDLGL-FBxx
 }
 
 template <class Pixel>
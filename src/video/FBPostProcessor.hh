@@ -10,7 +10,10 @@ namespace openmsx {
 
 class MSXMotherBoard;
 class Display;
+class FrameSource;
+class RawFrame;
 template<typename Pixel> class Scaler;
+template<typename Pixel> class ScalerOutput;
 
 /** Rasterizer using SDL.
   */
@@ -30,18 +33,34 @@ public:
 	std::unique_ptr<RawFrame> rotateFrames(
 		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time) override;
 
+	/** Scales the source lines starting at 'bandSrcStartY' to the output
+	  * lines [bandDstStartY..bandDstEndY), split in regions of equal line
+	  * width. Each 'srcStep' source lines become 'dstStep' output lines.
+	  * Used for each band of the output, and by ScalerBench.
+	  */
+	static void scaleRegions(Scaler<Pixel>& scaler, FrameSource& src,
+	                         const RawFrame* superImpose,
+	                         ScalerOutput<Pixel>& dst, unsigned bandSrcStartY,
+	                         unsigned bandDstStartY, unsigned bandDstEndY,
+	                         unsigned srcStep, unsigned dstStep);
+
 private:
 	void preCalcNoise(float factor);
-	void drawNoise(OutputSurface& output);
+	void scaleBand(OutputSurface& output, Scaler<Pixel>& scaler,
+	               unsigned inWidth, unsigned srcStartY,
+	               unsigned dstStartY, unsigned dstEndY,
+	               unsigned srcStep, unsigned dstStep);
+	void drawNoise(OutputSurface& output, unsigned startY, unsigned endY);
 	void drawNoiseLine(Pixel* buf, signed char* noise,
 	                   size_t width);
 
 	// Observer<Setting>
 	void update(const Setting& setting) override;
 
-	/** The currently active scaler.
+	/** The currently active scaler. There is one object per band of
+	  * the output, so that the bands can be scaled in parallel.
 	  */
-	std::unique_ptr<Scaler<Pixel>> currScaler;
+	std::vector<std::unique_ptr<Scaler<Pixel>>> currScalers;
 
 	/** Currently active scale algorithm, used to detect scaler changes.
 	  */
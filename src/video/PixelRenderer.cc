@@ -23,6 +23,7 @@ TODO:
 #include "unreachable.hh"
 #include <algorithm>
 #include <cassert>
+#include <climits>
 
 namespace openmsx {
 
@@ -122,6 +123,10 @@ PixelRenderer::PixelRenderer(VDP& vdp_, Display& display)
 	finishFrameDuration = 0;
 	frameSkipCounter = 999; // force drawing of frame
 	prevRenderFrame = false;
+	accuracy = renderSettings.getAccuracy();
+	matchedChanges = 0;
+	reuseFromY = INT_MAX;
+	dirty = true;
 
 	renderSettings.getMaxFrameSkipSetting().attach(*this);
 	renderSettings.getMinFrameSkipSetting().attach(*this);
@@ -147,16 +152,39 @@ void PixelRenderer::reInit()
 
 	rasterizer->reset();
 	displayEnabled = vdp.isDisplayEnabled();
+
+	// Don't copy lines from the frame before this point.
+	unsignalledState = getUnsignalledState();
+	changedUntilY = INT_MAX;
 }
 
 void PixelRenderer::updateDisplayEnabled(bool enabled, EmuTime::param time)
 {
 	sync(time, true);
+	logChange(CHANGE_DISPLAY_ENABLED, enabled, time);
 	displayEnabled = enabled;
 }
 
 void PixelRenderer::frameStart(EmuTime::param time)
 {
+	// Which lines are drawn the same as in the previous frame? When that
+	// frame was not drawn, it must be identical to the one before it.
+	UnsignalledState state = getUnsignalledState();
+	if (!(state == unsignalledState)) {
+		unsignalledState = state;
+		changedUntilY = INT_MAX;
+	}
+	if (renderFrame) {
+		reuseFromY = changedUntilY;
+	} else if (changedUntilY != 0) {
+		reuseFromY = INT_MAX;
+	}
+	changedUntilY = 0;
+	dirty = false;
+	std::swap(changes, prevChanges);
+	changes.clear();
+	matchedChanges = 0;
+
 	if (!rasterizer->isActive()) {
 		frameSkipCounter = 999;
 		renderFrame = false;
@@ -176,7 +204,9 @@ void PixelRenderer::frameStart(EmuTime::param time)
 			renderFrame = true;
 		} else {
 			++frameSkipCounter;
-			if (rasterizer->isRecording()) {
+			if (rasterizer->isRecording() ||
+			    vdp.getMotherBoard().getReactor().isBatchMode()) {
+				// batch mode: no real time to keep up with
 				renderFrame = true;
 			} else {
 				renderFrame = realTime.timeLeft(
@@ -224,6 +254,7 @@ void PixelRenderer::frameEnd(EmuTime::param time)
 			skipEvent = true;
 		}
 	}
+	checkMissedChanges(INT_MAX, time);
 	if (vdp.getMotherBoard().isActive() &&
 	    !vdp.getMotherBoard().isFastForwarding()) {
 		eventDistributor.distributeEvent(
@@ -238,32 +269,37 @@ void PixelRenderer::updateHorizontalScrollLow(
 	byte scroll, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_HSCROLL_LOW, scroll, time);
 	rasterizer->setHorizontalScrollLow(scroll);
 }
 
 void PixelRenderer::updateHorizontalScrollHigh(
-	byte /*scroll*/, EmuTime::param time)
+	byte scroll, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_HSCROLL_HIGH, scroll, time);
 }
 
 void PixelRenderer::updateBorderMask(
 	bool masked, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_BORDER_MASK, masked, time);
 	rasterizer->setBorderMask(masked);
 }
 
 void PixelRenderer::updateMultiPage(
-	bool /*multiPage*/, EmuTime::param time)
+	bool multiPage, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_MULTI_PAGE, multiPage, time);
 }
 
 void PixelRenderer::updateTransparency(
 	bool enabled, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_TRANSPARENCY, enabled, time);
 	rasterizer->setTransparency(enabled);
 }
 
@@ -271,42 +307,48 @@ void PixelRenderer::updateSuperimposing(
 	const RawFrame* videoSource, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	markChanged(time);
 	rasterizer->setSuperimposeVideoFrame(videoSource);
 }
 
 void PixelRenderer::updateForegroundColor(
-	int /*color*/, EmuTime::param time)
+	int color, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_FOREGROUND, color, time);
 }
 
 void PixelRenderer::updateBackgroundColor(
 	int color, EmuTime::param time)
 {
 	sync(time);
+	logChange(CHANGE_BACKGROUND, color, time);
 	rasterizer->setBackgroundColor(color);
 }
 
 void PixelRenderer::updateBlinkForegroundColor(
-	int /*color*/, EmuTime::param time)
+	int color, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_BLINK_FOREGROUND, color, time);
 }
 
 void PixelRenderer::updateBlinkBackgroundColor(
-	int /*color*/, EmuTime::param time)
+	int color, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_BLINK_BACKGROUND, color, time);
 }
 
 void PixelRenderer::updateBlinkState(
-	bool /*enabled*/, EmuTime::param /*time*/)
+	bool enabled, EmuTime::param time)
 {
 	// TODO: When the sync call is enabled, the screen flashes on
 	//       every call to this method.
 	//       I don't know why exactly, but it's probably related to
 	//       being called at frame start.
 	//sync(time);
+	logChange(CHANGE_BLINK_STATE, enabled, time);
 }
 
 void PixelRenderer::updatePalette(
@@ -328,19 +370,22 @@ void PixelRenderer::updatePalette(
 			}
 		}
 	}
+	logChange(CHANGE_PALETTE, (index << 16) | grb, time);
 	rasterizer->setPalette(index, grb);
 }
 
 void PixelRenderer::updateVerticalScroll(
-	int /*scroll*/, EmuTime::param time)
+	int scroll, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_VSCROLL, scroll, time);
 }
 
 void PixelRenderer::updateHorizontalAdjust(
 	int adjust, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_HADJUST, adjust, time);
 	rasterizer->setHorizontalAdjust(adjust);
 }
 
@@ -356,31 +401,36 @@ void PixelRenderer::updateDisplayMode(
 	|| mode.getByte() == DisplayMode::GRAPHIC7) {
 		sync(time, true);
 	}
+	logChange(CHANGE_DISPLAY_MODE, mode.getByte(), time);
 	rasterizer->setDisplayMode(mode);
 }
 
 void PixelRenderer::updateNameBase(
-	int /*addr*/, EmuTime::param time)
+	int addr, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_NAME_BASE, addr, time);
 }
 
 void PixelRenderer::updatePatternBase(
-	int /*addr*/, EmuTime::param time)
+	int addr, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_PATTERN_BASE, addr, time);
 }
 
 void PixelRenderer::updateColorBase(
-	int /*addr*/, EmuTime::param time)
+	int addr, EmuTime::param time)
 {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_COLOR_BASE, addr, time);
 }
 
 void PixelRenderer::updateSpritesEnabled(
-	bool /*enabled*/, EmuTime::param time
+	bool enabled, EmuTime::param time
 ) {
 	if (displayEnabled) sync(time);
+	logChange(CHANGE_SPRITES_ENABLED, enabled, time);
 }
 
 static inline bool overlap(
@@ -464,21 +514,12 @@ inline bool PixelRenderer::checkSync(int offset, EmuTime::param time)
 		}
 		return false;
 	case DisplayMode::GRAPHIC4:
-	case DisplayMode::GRAPHIC5: {
-		// Is the address inside the visual page(s)?
-		// TODO: Also look at which lines are touched inside pages.
-		int visiblePage = vram.nameTable.getMask()
-			& (0x10000 | (vdp.getEvenOddMask() << 7));
-		if (vdp.isMultiPageScrolling()) {
-			return (offset & 0x18000) == visiblePage
-				|| (offset & 0x18000) == (visiblePage & 0x10000);
-		} else {
-			return (offset & 0x18000) == visiblePage;
-		}
-	}
+	case DisplayMode::GRAPHIC5:
 	case DisplayMode::GRAPHIC6:
 	case DisplayMode::GRAPHIC7:
-		return true; // TODO: Implement better detection.
+		// Is the address inside the visual page(s)?
+		// TODO: Also look at which lines are touched inside pages.
+		return isInVisiblePage(offset);
 	default:
 		// Range unknown; assume full range.
 		return vram.nameTable.isInside(offset)
@@ -487,6 +528,54 @@ inline bool PixelRenderer::checkSync(int offset, EmuTime::param time)
 	}
 }
 
+inline bool PixelRenderer::isInVisiblePage(unsigned offset) const
+{
+	// Same pages as the ones SDLRasterizer::drawDisplay() reads from. A
+	// page is 32kB: address bits 15-16 in Graphic4/5, in the planar
+	// Graphic6/7 modes bit 15 (in both planes).
+	unsigned pageMask = vdp.getDisplayMode().isPlanar() ? 0x08000 : 0x18000;
+	unsigned visiblePage = vram.nameTable.getMask() & pageMask
+		& (0x10000 | (vdp.getEvenOddMask() << 7));
+	unsigned page = offset & pageMask;
+	return (page == visiblePage) ||
+	       (vdp.isMultiPageScrolling() &&
+	        (page == (visiblePage & 0x10000)));
+}
+
+inline bool PixelRenderer::vramAffectsDisplay(unsigned offset) const
+{
+	switch (vdp.getDisplayMode().getBase()) {
+	case DisplayMode::GRAPHIC4:
+	case DisplayMode::GRAPHIC5:
+	case DisplayMode::GRAPHIC6:
+	case DisplayMode::GRAPHIC7:
+		// Drawing in a hidden page is very common in these modes.
+		return isInVisiblePage(offset) ||
+		       vram.spriteAttribTable.isInside(offset) ||
+		       vram.spritePatternTable.isInside(offset);
+	default:
+		return true;
+	}
+}
+
+bool PixelRenderer::isVRAMObserved(unsigned address, unsigned size) const
+{
+	// Writes for which both checkSync() and vramAffectsDisplay() return
+	// false don't have any effect on this renderer. The blocks are at
+	// most 256 bytes, so they never span two pages.
+	switch (vdp.getDisplayMode().getBase()) {
+	case DisplayMode::GRAPHIC4:
+	case DisplayMode::GRAPHIC5:
+	case DisplayMode::GRAPHIC6:
+	case DisplayMode::GRAPHIC7:
+		return isInVisiblePage(address) ||
+		       vram.spriteAttribTable.isInside(address, size) ||
+		       vram.spritePatternTable.isInside(address, size);
+	default:
+		return true;
+	}
+}
+
 void PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
 {
 	// Note: No need to sync if display is disabled, because then the
@@ -496,6 +585,7 @@ void PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
 		//	vdp.getTicksThisFrame(time) / VDP::TICKS_PER_LINE);
 		renderUntil(time);
 	}
+	if (vramAffectsDisplay(offset)) markChanged(time);
 }
 
 void PixelRenderer::updateWindow(bool /*enabled*/, EmuTime::param /*time*/)
@@ -528,33 +618,81 @@ void PixelRenderer::sync(EmuTime::param time, bool force)
 	}
 }
 
-void PixelRenderer::renderUntil(EmuTime::param time)
+inline int PixelRenderer::getRenderPosition(int ticks) const
 {
-	// Translate from time to pixel position.
-	int limitTicks = vdp.getTicksThisFrame(time);
-	assert(limitTicks <= vdp.getTicksPerFrame());
-	int limitX, limitY;
 	switch (accuracy) {
-	case RenderSettings::ACC_PIXEL: {
-		limitX = limitTicks % VDP::TICKS_PER_LINE;
-		limitY = limitTicks / VDP::TICKS_PER_LINE;
-		break;
-	}
+	case RenderSettings::ACC_PIXEL:
+		return ticks;
 	case RenderSettings::ACC_LINE:
-	case RenderSettings::ACC_SCREEN: {
+	case RenderSettings::ACC_SCREEN:
 		// Note: I'm not sure the rounding point is optimal.
 		//       It used to be based on the left margin, but that doesn't work
 		//       because the margin can change which leads to a line being
 		//       rendered even though the time doesn't advance.
-		limitX = 0;
-		limitY =
-			(limitTicks + VDP::TICKS_PER_LINE - 400) / VDP::TICKS_PER_LINE;
-		break;
-	}
+		return ((ticks + VDP::TICKS_PER_LINE - 400) / VDP::TICKS_PER_LINE)
+		       * VDP::TICKS_PER_LINE;
 	default:
 		UNREACHABLE;
-		limitX = limitY = 0; // avoid warning
+		return 0; // avoid warning
+	}
+}
+
+void PixelRenderer::markChanged(EmuTime::param time)
+{
+	dirty = true;
+	int beamY = vdp.getTicksThisFrame(time) / VDP::TICKS_PER_LINE;
+	changedUntilY = std::max(changedUntilY, std::max(nextY, beamY) + 1);
+}
+
+void PixelRenderer::logChange(ChangeType type, int value, EmuTime::param time)
+{
+	StateChange change;
+	change.position = getRenderPosition(vdp.getTicksThisFrame(time));
+	change.type = type;
+	change.value = value;
+	checkMissedChanges(change.position, time);
+	if ((matchedChanges < prevChanges.size()) &&
+	    (prevChanges[matchedChanges] == change)) {
+		// Same change at the same position as in the previous frame.
+		++matchedChanges;
+	} else {
+		markChanged(time);
 	}
+	changes.push_back(change);
+}
+
+void PixelRenderer::checkMissedChanges(int position, EmuTime::param time)
+{
+	while ((matchedChanges < prevChanges.size()) &&
+	       (prevChanges[matchedChanges].position < position)) {
+		markChanged(time);
+		++matchedChanges;
+	}
+}
+
+PixelRenderer::UnsignalledState PixelRenderer::getUnsignalledState() const
+{
+	UnsignalledState result;
+	result.spriteTableBases = vdp.getSpriteTableBases();
+	result.spriteSize       = vdp.getSpriteSize();
+	result.spriteMag        = vdp.isSpriteMag();
+	result.disableSprites   = renderSettings.getDisableSprites();
+	result.limitSprites     =
+		renderSettings.getLimitSpritesSetting().getBoolean();
+	result.accuracy         = renderSettings.getAccuracy();
+	result.lineZero         = vdp.getLineZero();
+	result.numberOfLines    = vdp.getNumberOfLines();
+	return result;
+}
+
+void PixelRenderer::renderUntil(EmuTime::param time)
+{
+	// Translate from time to pixel position.
+	int limitTicks = vdp.getTicksThisFrame(time);
+	assert(limitTicks <= vdp.getTicksPerFrame());
+	int limitPos = getRenderPosition(limitTicks);
+	int limitX = limitPos % VDP::TICKS_PER_LINE;
+	int limitY = limitPos / VDP::TICKS_PER_LINE;
 
 	// Stop here if there is nothing to render.
 	// This ensures that no pixels are rendered in a series of updates that
@@ -563,6 +701,55 @@ void PixelRenderer::renderUntil(EmuTime::param time)
 	// Also it is a small performance optimisation.
 	if (limitX == nextX && limitY == nextY) return;
 
+	checkMissedChanges(limitPos, time);
+	UnsignalledState state = getUnsignalledState();
+	if (!(state == unsignalledState)) {
+		unsignalledState = state;
+		markChanged(time);
+	}
+
+	// As long as nothing changed in this frame, the lines starting at
+	// reuseFromY are the same as in the previous frame. Copying them is a
+	// lot cheaper than drawing them again. A partial line is copied
+	// completely, if something changes before the end of that line, the
+	// remainder is drawn again.
+	if (!dirty) {
+		int copyFromY = std::max(nextY, reuseFromY);
+		int copyLimitY = limitY + (limitX ? 1 : 0);
+		if (copyFromY < copyLimitY) {
+			if (nextY < copyFromY) {
+				renderRange(time, nextX, nextY, 0, copyFromY);
+				nextX = 0;
+				nextY = copyFromY;
+			}
+			if (rasterizer->copyPreviousLines(nextY, copyLimitY)) {
+				if (displayEnabled &&
+				    vdp.getDisplayMode().isTextMode()) {
+					// Advance the text mode line counter
+					// like draw() would have done.
+					int zero = vdp.getLineZero();
+					int borderR = vdp.getRightBorder();
+					int fromY = nextY + ((nextX >= borderR) ? 1 : 0);
+					int toY = limitY + ((limitX >= borderR) ? 1 : 0);
+					textModeCounter +=
+						std::max(0, toY - zero) / 8 -
+						std::max(0, fromY - zero) / 8;
+				}
+				nextX = limitX;
+				nextY = limitY;
+				return;
+			}
+		}
+	}
+
+	renderRange(time, nextX, nextY, limitX, limitY);
+	nextX = limitX;
+	nextY = limitY;
+}
+
+void PixelRenderer::renderRange(
+	EmuTime::param time, int fromX, int fromY, int limitX, int limitY)
+{
 	if (displayEnabled) {
 		if (vdp.spritesEnabled()) {
 			// Update sprite checking, so that rasterizer can call getSprites.
@@ -583,21 +770,18 @@ void PixelRenderer::renderUntil(EmuTime::param time)
 		// It's important that right border is drawn last (after left
 		// border and display area). See comment in SDLRasterizer::drawBorder().
 		// Left border.
-		subdivide(nextX, nextY, limitX, limitY,
+		subdivide(fromX, fromY, limitX, limitY,
 			0, displayL, DRAW_BORDER);
 		// Display area.
-		subdivide(nextX, nextY, limitX, limitY,
+		subdivide(fromX, fromY, limitX, limitY,
 			displayL, borderR, DRAW_DISPLAY);
 		// Right border.
-		subdivide(nextX, nextY, limitX, limitY,
+		subdivide(fromX, fromY, limitX, limitY,
 			borderR, VDP::TICKS_PER_LINE, DRAW_BORDER);
 	} else {
-		subdivide(nextX, nextY, limitX, limitY,
+		subdivide(fromX, fromY, limitX, limitY,
 			0, VDP::TICKS_PER_LINE, DRAW_BORDER);
 	}
-
-	nextX = limitX;
-	nextY = limitY;
 }
 
 void PixelRenderer::update(const Setting& setting)
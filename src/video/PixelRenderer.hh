@@ -6,6 +6,7 @@
 #include "RenderSettings.hh"
 #include "openmsx.hh"
 #include <memory>
+#include <vector>
 
 namespace openmsx {
 
@@ -54,6 +55,7 @@ public:
 	void updatePatternBase(int addr, EmuTime::param time) override;
 	void updateColorBase(int addr, EmuTime::param time) override;
 	void updateSpritesEnabled(bool enabled, EmuTime::param time) override;
+	bool isVRAMObserved(unsigned address, unsigned size) const override;
 	void updateVRAM(unsigned offset, EmuTime::param time) override;
 	void updateWindow(bool enabled, EmuTime::param time) override;
 
@@ -61,6 +63,53 @@ private:
 	/** Indicates whether the area to be drawn is border or display. */
 	enum DrawType { DRAW_BORDER, DRAW_DISPLAY };
 
+	/** The update method that signalled a VDP state change. */
+	enum ChangeType {
+		CHANGE_HSCROLL_LOW, CHANGE_HSCROLL_HIGH, CHANGE_BORDER_MASK,
+		CHANGE_MULTI_PAGE, CHANGE_TRANSPARENCY, CHANGE_FOREGROUND,
+		CHANGE_BACKGROUND, CHANGE_BLINK_FOREGROUND,
+		CHANGE_BLINK_BACKGROUND, CHANGE_BLINK_STATE, CHANGE_PALETTE,
+		CHANGE_VSCROLL, CHANGE_HADJUST, CHANGE_DISPLAY_ENABLED,
+		CHANGE_DISPLAY_MODE, CHANGE_NAME_BASE, CHANGE_PATTERN_BASE,
+		CHANGE_COLOR_BASE, CHANGE_SPRITES_ENABLED
+	};
+
+	/** A VDP state change signalled via one of the update methods. */
+	struct StateChange {
+		int position; // render position, see getRenderPosition()
+		ChangeType type;
+		int value;
+		bool operator==(const StateChange& other) const {
+			return (position == other.position) &&
+			       (type     == other.type) &&
+			       (value    == other.value);
+		}
+	};
+
+	/** State that influences the rendered image, but of which changes
+	  * are not signalled via the update methods.
+	  */
+	struct UnsignalledState {
+		unsigned spriteTableBases;
+		int spriteSize;
+		bool spriteMag;
+		bool disableSprites;
+		bool limitSprites;
+		RenderSettings::Accuracy accuracy;
+		int lineZero;      // vertical adjust (R#18) and LN bit (R#9)
+		int numberOfLines; // LN bit (R#9)
+		bool operator==(const UnsignalledState& other) const {
+			return (spriteTableBases == other.spriteTableBases) &&
+			       (spriteSize       == other.spriteSize) &&
+			       (spriteMag        == other.spriteMag) &&
+			       (disableSprites   == other.disableSprites) &&
+			       (limitSprites     == other.limitSprites) &&
+			       (accuracy         == other.accuracy) &&
+			       (lineZero         == other.lineZero) &&
+			       (numberOfLines    == other.numberOfLines);
+		}
+	};
+
 	// Observer<Setting> interface:
 	void update(const Setting& setting) override;
 
@@ -84,6 +133,38 @@ private:
 
 	inline bool checkSync(int offset, EmuTime::param time);
 
+	/** Can a change of the given VRAM byte change the rendered image? */
+	inline bool vramAffectsDisplay(unsigned offset) const;
+
+	/** In the bitmap modes: is the given VRAM address inside the
+	  * displayed page(s)? */
+	inline bool isInVisiblePage(unsigned offset) const;
+
+	/** Translate a moment in the current frame (expressed in VDP ticks
+	  * since the start of the frame) to the render position it corresponds
+	  * to with the current accuracy. */
+	inline int getRenderPosition(int ticks) const;
+
+	/** Something changed that influences the rendered image: the lines
+	  * that are not yet rendered in this frame, and in the next frame the
+	  * lines up to the current beam position, can be different from the
+	  * previous frame.
+	  */
+	void markChanged(EmuTime::param time);
+
+	/** Record a change signalled via an update method. Changes that also
+	  * happened at the same render position in the previous frame don't
+	  * call markChanged().
+	  */
+	void logChange(ChangeType type, int value, EmuTime::param time);
+
+	/** Calls markChanged() for each change that happened in the previous
+	  * frame before the given render position, but not in this frame.
+	  */
+	void checkMissedChanges(int position, EmuTime::param time);
+
+	UnsignalledState getUnsignalledState() const;
+
 	/** Update renderer state to specified moment in time.
 	  * @param time Moment in emulated time to update to.
 	  * @param force When screen accuracy is used,
@@ -99,6 +180,10 @@ private:
 	  */
 	void renderUntil(EmuTime::param time);
 
+	/** Render the area between two scan positions. */
+	void renderRange(EmuTime::param time,
+	                 int fromX, int fromY, int limitX, int limitY);
+
 	/** The VDP of which the video output is being rendered.
 	  */
 	VDP& vdp;
@@ -148,6 +233,34 @@ private:
 	  */
 	bool renderFrame;
 	bool prevRenderFrame;
+
+	/** Lines that are rendered exactly the same as in the previous frame
+	  * are copied from that frame instead (see renderUntil()). For that
+	  * the state changes in the current and the previous frame are
+	  * compared.
+	  */
+	std::vector<StateChange> changes;
+	std::vector<StateChange> prevChanges;
+
+	/** Number of elements in prevChanges that were repeated (or missed)
+	  * in this frame so far. */
+	unsigned matchedChanges;
+
+	/** Lines [reuseFromY, ...) of this frame can be copied from the
+	  * previous frame, as long as nothing changed in this frame.
+	  * Expressed in number of lines since start of frame.
+	  */
+	int reuseFromY;
+
+	/** Lines [0, changedUntilY) of the next frame can be different from
+	  * this frame, because of changes that happened in this frame.
+	  */
+	int changedUntilY;
+
+	/** Did anything change in this frame (so far)? */
+	bool dirty;
+
+	UnsignalledState unsignalledState;
 };
 
 } // namespace openmsx
@@ -87,6 +87,12 @@ public:
 	  */
 	FrameSource* getPaintFrame() const { return paintFrame; }
 
+	/** Get the frame that was passed to the last rotateFrames() call, or
+	  * nullptr if there is none. It stays valid (and unmodified) until the
+	  * next call to rotateFrames().
+	  */
+	const RawFrame* getLastFrame() const { return lastFrames[0].get(); }
+
 	// VideoLayer
 	void takeRawScreenShot(unsigned height, const std::string& filename) override;
 
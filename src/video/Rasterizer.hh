@@ -100,6 +100,17 @@ public:
 		int displayX, int displayY,
 		int displayWidth, int displayHeight) = 0;
 
+	/** Copy complete lines (border, display and sprites) from the
+	  * previous frame instead of drawing them. The caller guarantees that
+	  * these lines would be drawn exactly the same as in that frame.
+	  * @param fromY Y coordinate of the first line (inclusive).
+	  * @param limitY Y coordinate of the last line (exclusive).
+	  * @return False if the previous frame cannot be used (e.g. a
+	  *         rendering setting changed), then nothing is copied and the
+	  *         lines must be drawn as usual.
+	  */
+	virtual bool copyPreviousLines(int fromY, int limitY) = 0;
+
 	/** Is video recording active?
 	  */
 	virtual bool isRecording() const = 0;
@@ -31,6 +31,10 @@ public:
 	Pixel* getLinePtrDirect(unsigned y) {
 		return reinterpret_cast<Pixel*>(data.data() + y * pitch);
 	}
+	template<typename Pixel>
+	const Pixel* getLinePtrDirect(unsigned y) const {
+		return reinterpret_cast<const Pixel*>(data.data() + y * pitch);
+	}
 
 	unsigned getLineWidthDirect(unsigned y) const {
 		return lineWidths[y];
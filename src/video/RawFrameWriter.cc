@@ -0,0 +1,382 @@
+#include "RawFrameWriter.hh"
+#include "FrameSource.hh"
+#include "Filename.hh"
+#include "FileException.hh"
+#include "CliComm.hh"
+#include "endian.hh"
+#include "systemfuncs.hh"
+#include "unreachable.hh"
+#include "build-info.hh"
+#include <SDL.h>
+#if HAVE_MMAP && HAVE_FTRUNCATE
+#include "unistdp.hh"
+#include <sys/mman.h>
+#if HAVE_POSIX_FALLOCATE
+#include <fcntl.h>
+#endif
+#define RAWFRAMEWRITER_MMAP 1
+#else
+#define RAWFRAMEWRITER_MMAP 0
+#endif
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sys/types.h>
+
+namespace openmsx {
+
+using L64 = Endian::EndianT<uint64_t, Endian::ConvLittle<OPENMSX_BIGENDIAN>>;
+
+static const char MAGIC[8] = { 'O', 'M', 'S', 'X', 'R', 'A', 'W', '\x1a' };
+static const unsigned VERSION = 1;
+static const unsigned MAX_LINE_WIDTH = 1280; // see FrameSource::getLineColor()
+static const uint32_t LINE_INDEXED = 0x80000000;
+
+// The file is mapped in windows of (at least) this size, their start is
+// aligned to a multiple of MAP_ALIGN (a multiple of the page size on all
+// platforms).
+static const size_t MAP_WINDOW = 32 * 1024 * 1024;
+static const size_t MAP_ALIGN = 1024 * 1024;
+
+struct FileHeader {
+	char        magic[8];
+	Endian::L32 version;
+	Endian::L32 bytesPerPixel;
+	Endian::L32 redMask;
+	Endian::L32 greenMask;
+	Endian::L32 blueMask;
+	Endian::L32 channels;
+	Endian::L32 sampleRate;
+	Endian::L32 ticksPerSecond;
+	Endian::L32 numFrames;
+	Endian::L32 reserved1;
+	L64         indexOffset;
+	L64         reserved2;
+};
+static_assert(sizeof(FileHeader) == 64, "unexpected header size");
+
+struct FrameHeader {
+	char        tag[4];
+	Endian::L32 size;
+	L64         time;
+	Endian::L32 height;
+	Endian::L32 field;
+	Endian::L32 paletteSize;
+	Endian::L32 samples;
+};
+static_assert(sizeof(FrameHeader) == 32, "unexpected header size");
+
+static inline size_t align4(size_t n) { return (n + 3) & ~size_t(3); }
+static inline size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// Set the file position, also beyond 2GB on 32-bit platforms (off_t is 64-bit
+// there when _FILE_OFFSET_BITS is 64).
+static bool seek(FILE* f, uint64_t pos)
+{
+#if defined _WIN32
+	return _fseeki64(f, pos, SEEK_SET) == 0;
+#else
+	if (pos > uint64_t(std::numeric_limits<off_t>::max())) return false;
+	return fseeko(f, off_t(pos), SEEK_SET) == 0;
+#endif
+}
+
+const char* const RawFrameWriter::EXTENSION = ".omr";
+
+RawFrameWriter::RawFrameWriter(const Filename& filename_, unsigned bpp,
+                               unsigned channels_, unsigned freq,
+                               CliComm& cliComm_)
+	: filename(filename_.getResolved())
+	, cliComm(cliComm_)
+	, bufferSize(0)
+	, mapping(nullptr)
+	, mapStart(0)
+	, mapSize(0)
+	, fileSize(0)
+	, startTime(EmuTime::zero)
+	, redMask(0), greenMask(0), blueMask(0)
+	, paletteSize(0)
+	, bytesPerPixel((bpp == 32) ? 4 : 2)
+	, channels(channels_)
+	, sampleRate(freq)
+{
+	file = FileOperations::openFile(
+		FileOperations::getNativePath(filename), "wb+");
+	if (!file) {
+		throw FileException("Error opening file \"" + filename + "\"");
+	}
+	// Reserve space for the header, it's written when the file is closed.
+	uint8_t* header = reserve(sizeof(FileHeader));
+	memset(header, 0, sizeof(FileHeader));
+	commit(sizeof(FileHeader));
+}
+
+RawFrameWriter::~RawFrameWriter()
+{
+	try {
+		finish();
+	} catch (MSXException& e) {
+		// can't throw from destructor
+		cliComm.printWarning(
+			"Error while finishing the raw video file, it's "
+			"probably incomplete: " + e.getMessage());
+	}
+	if (index.empty()) {
+		// no frames written (a recording less than one video frame)
+		file.reset();
+		FileOperations::unlink(filename);
+	}
+}
+
+void RawFrameWriter::finish()
+{
+	unmap();
+#if RAWFRAMEWRITER_MMAP
+	// remove the unused part of the last window
+	if (ftruncate(fileno(file.get()), fileSize)) {
+		throw FileException(std::string("Error truncating file: ") +
+		                    strerror(errno));
+	}
+#endif
+	if (index.empty()) return;
+
+	std::vector<L64> idx(index.size());
+	for (size_t i = 0; i < index.size(); ++i) {
+		idx[i] = index[i];
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version        = VERSION;
+	header.bytesPerPixel  = bytesPerPixel;
+	header.redMask        = redMask;
+	header.greenMask      = greenMask;
+	header.blueMask       = blueMask;
+	header.channels       = sampleRate ? channels : 0;
+	header.sampleRate     = sampleRate;
+	header.ticksPerSecond = MAIN_FREQ32;
+	header.numFrames      = unsigned(index.size());
+	header.indexOffset    = fileSize;
+
+	FILE* f = file.get();
+	if (!seek(f, fileSize) ||
+	    (fwrite(idx.data(), sizeof(L64), idx.size(), f) != idx.size()) ||
+	    !seek(f, 0) ||
+	    (fwrite(&header, sizeof(header), 1, f) != 1) ||
+	    (fflush(f) != 0)) {
+		throw FileException("Error writing file");
+	}
+}
+
+void RawFrameWriter::addFrame(FrameSource* frame, EmuTime::param time,
+                              unsigned samples, const int16_t* sampleData)
+{
+	assert((samples % std::max(channels, 1u)) == 0);
+	if (index.empty()) {
+		startTime = time;
+		const SDL_PixelFormat& format = frame->getSDLPixelFormat();
+		redMask   = format.Rmask;
+		greenMask = format.Gmask;
+		blueMask  = format.Bmask;
+	}
+	uint64_t ticks = (time - startTime).length();
+
+	// Reserve room for the worst case: every line at the maximum width
+	// as direct pixels, a full palette.
+	unsigned height = frame->getHeight();
+	size_t maxSize = sizeof(FrameHeader) +
+	                 height * sizeof(Endian::L32) +
+	                 height * align4(MAX_LINE_WIDTH * bytesPerPixel) +
+	                 align4(256 * bytesPerPixel) +
+	                 align8(samples * sizeof(int16_t));
+	uint8_t* dest = reserve(maxSize);
+
+	size_t size;
+	switch (bytesPerPixel) {
+#if HAVE_16BPP
+	case 2:
+		size = writeFrame<uint16_t>(*frame, ticks, samples, sampleData, dest);
+		break;
+#endif
+#if HAVE_32BPP
+	case 4:
+		size = writeFrame<uint32_t>(*frame, ticks, samples, sampleData, dest);
+		break;
+#endif
+	default:
+		UNREACHABLE; size = 0;
+	}
+	assert(size <= maxSize);
+	index.push_back(fileSize);
+	commit(size);
+}
+
+template<typename Pixel>
+size_t RawFrameWriter::writeFrame(
+	FrameSource& frame, uint64_t time,
+	unsigned samples, const int16_t* sampleData, uint8_t* dest)
+{
+	unsigned height = frame.getHeight();
+	auto& header = *reinterpret_cast<FrameHeader*>(dest);
+	auto* lineTable = reinterpret_cast<Endian::L32*>(dest + sizeof(FrameHeader));
+	uint8_t* out = dest + sizeof(FrameHeader) + height * sizeof(Endian::L32);
+
+	// start with an empty palette
+	paletteSize = 0;
+	std::fill_n(colorIndex, COLOR_HASH_SIZE, -1);
+
+	SSE_ALIGNED(Pixel buf[MAX_LINE_WIDTH]);
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned width;
+		auto* line = static_cast<const Pixel*>(
+			frame.getLineInfo(y, width, buf, MAX_LINE_WIDTH));
+		assert(width <= MAX_LINE_WIDTH);
+		if (indexLine(line, width, out)) {
+			lineTable[y] = width | LINE_INDEXED;
+			out += align4(width);
+		} else {
+			lineTable[y] = width;
+			memcpy(out, line, width * sizeof(Pixel));
+			out += align4(width * sizeof(Pixel));
+		}
+	}
+
+	if (OPENMSX_BIGENDIAN) {
+		using LE_P = typename Endian::Little<Pixel>::type;
+		auto* p = reinterpret_cast<LE_P*>(out);
+		for (unsigned i = 0; i < paletteSize; ++i) p[i] = palette[i];
+	} else {
+		auto* p = reinterpret_cast<Pixel*>(out);
+		for (unsigned i = 0; i < paletteSize; ++i) p[i] = palette[i];
+	}
+	out += align4(paletteSize * sizeof(Pixel));
+
+	auto* s = reinterpret_cast<Endian::L16*>(out);
+	for (unsigned i = 0; i < samples; ++i) s[i] = sampleData[i];
+	size_t size = align8((out - dest) + samples * sizeof(int16_t));
+
+	memcpy(header.tag, "FRAM", sizeof(header.tag));
+	header.size        = unsigned(size);
+	header.time        = time;
+	header.height      = height;
+	header.field       = frame.getField();
+	header.paletteSize = paletteSize;
+	header.samples     = samples;
+	return size;
+}
+
+// Convert a line to palette indices, colors that are not yet in the palette
+// are added. Returns false when the palette is full.
+template<typename Pixel>
+bool RawFrameWriter::indexLine(const Pixel* in, unsigned width, uint8_t* out)
+{
+	// Most lines consist of long runs of the same color.
+	Pixel prev = in[0];
+	int idx = lookupColor(prev);
+	for (unsigned x = 0; x < width; ++x) {
+		Pixel p = in[x];
+		if (p != prev) {
+			prev = p;
+			idx = lookupColor(p);
+		}
+		if (idx < 0) return false;
+		out[x] = idx;
+	}
+	return true;
+}
+
+int RawFrameWriter::lookupColor(uint32_t color)
+{
+	unsigned h = (color * 0x9E3779B1u) >> 22; // 10 bits
+	while (colorIndex[h] >= 0) {
+		if (colorKey[h] == color) return colorIndex[h];
+		h = (h + 1) % COLOR_HASH_SIZE;
+	}
+	if (paletteSize == 256) return -1;
+	colorKey[h] = color;
+	colorIndex[h] = paletteSize;
+	palette[paletteSize] = color;
+	return paletteSize++;
+}
+
+// Returns a pointer to (at least) 'size' bytes at the end of the file. They
+// become part of the file with commit().
+uint8_t* RawFrameWriter::reserve(size_t size)
+{
+#if RAWFRAMEWRITER_MMAP
+	if (!mapping || ((fileSize + size) > (mapStart + mapSize))) {
+		remap(size);
+	}
+	return mapping + (fileSize - mapStart);
+#else
+	if (bufferSize < size) {
+		buffer.resize(size);
+		bufferSize = size;
+	}
+	return buffer.data();
+#endif
+}
+
+void RawFrameWriter::commit(size_t size)
+{
+#if RAWFRAMEWRITER_MMAP
+	assert((fileSize + size) <= (mapStart + mapSize));
+#else
+	if (fwrite(buffer.data(), 1, size, file.get()) != size) {
+		throw FileException("Error writing file");
+	}
+#endif
+	fileSize += size;
+}
+
+void RawFrameWriter::remap(size_t size)
+{
+#if RAWFRAMEWRITER_MMAP
+	unmap();
+	mapStart = fileSize & ~uint64_t(MAP_ALIGN - 1);
+	size_t needed = size_t(fileSize - mapStart) + size;
+	mapSize = (std::max(needed, MAP_WINDOW) + MAP_ALIGN - 1) & ~(MAP_ALIGN - 1);
+
+	if ((mapStart + mapSize) > uint64_t(std::numeric_limits<off_t>::max())) {
+		throw FileException("Error growing file: file too large");
+	}
+	int fd = fileno(file.get());
+#if HAVE_POSIX_FALLOCATE
+	// Really allocate the disk space. With a sparse file a full disk would
+	// only show up as a SIGBUS while writing to the mapping.
+	int err = posix_fallocate(fd, off_t(mapStart), off_t(mapSize));
+#else
+	int err = ftruncate(fd, off_t(mapStart + mapSize)) ? errno : 0;
+#endif
+	if (err) {
+		throw FileException(std::string("Error growing file: ") +
+		                    strerror(err));
+	}
+	void* p = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+	                 MAP_SHARED, fd, off_t(mapStart));
+	// MAP_FAILED is #define'd using an old-style cast, we
+	// have to redefine it ourselves to avoid a warning
+	auto MY_MAP_FAILED = reinterpret_cast<void*>(-1);
+	if (p == MY_MAP_FAILED) {
+		throw FileException("Error mmapping file");
+	}
+	mapping = static_cast<uint8_t*>(p);
+#else
+	(void)size;
+#endif
+}
+
+void RawFrameWriter::unmap()
+{
+#if RAWFRAMEWRITER_MMAP
+	if (mapping) {
+		::munmap(mapping, mapSize);
+		mapping = nullptr;
+	}
+#endif
+}
+
+} // namespace openmsx
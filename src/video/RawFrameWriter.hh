@@ -0,0 +1,113 @@
+#ifndef RAWFRAMEWRITER_HH
+#define RAWFRAMEWRITER_HH
+
+#include "EmuTime.hh"
+#include "FileOperations.hh"
+#include "MemBuffer.hh"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class CliComm;
+class Filename;
+class FrameSource;
+
+/** Writes the unscaled MSX frames and the sound samples losslessly to a
+  * simple container file. This is meant for pixel-exact recordings, e.g.
+  * for regression tests. Compared to AviWriter there is almost no work per
+  * frame: the lines are copied as-is (or as 8-bit palette indices when a
+  * frame has at most 256 different colors) to the end of the (memory
+  * mapped) file. Converting to a real video format is left to offline
+  * tools.
+  *
+  * File layout, all values are little endian:
+  *
+  *   file header (64 bytes)
+  *     char[8] magic   "OMSXRAW\x1a"
+  *     u32 version     currently 1
+  *     u32 bytes per pixel (2 or 4)
+  *     u32 red, green, blue mask of the (host) pixel format
+  *     u32 audio channels (0 when there is no audio), audio sample rate
+  *     u32 ticks per second of the frame timestamps
+  *     u32 number of frames (0 when the file was not properly closed)
+  *     u32 reserved
+  *     u64 file offset of the frame index (0 when not properly closed)
+  *     u64 reserved
+  *   frame records, one per frame, each starts 8-byte aligned
+  *     char[4] tag     "FRAM"
+  *     u32 size        of the complete record (multiple of 8)
+  *     u64 time        timestamp in ticks, relative to the first frame
+  *     u32 height      number of lines
+  *     u32 field       0 = not interlaced, 1 = even field, 2 = odd field
+  *     u32 palette size (0..256)
+  *     u32 samples     number of 16-bit audio samples (all channels)
+  *     u32[height]     per line: bits 15-0: width in pixels,
+  *                     bit 31: line data consists of palette indices
+  *     line data       per line 'width' bytes or pixels, padded to 4 bytes
+  *     palette         palette size pixels, padded to 4 bytes
+  *     samples         interleaved s16 samples, padded to 8 bytes
+  *   frame index
+  *     u64[number of frames]  file offset of each frame record
+  *
+  * When the index is missing, the frames can still be found by walking
+  * over the records.
+  */
+class RawFrameWriter
+{
+public:
+	static const char* const EXTENSION;
+
+	RawFrameWriter(const Filename& filename, unsigned bpp,
+	               unsigned channels, unsigned freq, CliComm& cliComm);
+	~RawFrameWriter();
+
+	void addFrame(FrameSource* frame, EmuTime::param time,
+	              unsigned samples, const int16_t* sampleData);
+
+private:
+	template<typename Pixel> size_t writeFrame(
+		FrameSource& frame, uint64_t time,
+		unsigned samples, const int16_t* sampleData, uint8_t* dest);
+	template<typename Pixel> bool indexLine(
+		const Pixel* in, unsigned width, uint8_t* out);
+	int lookupColor(uint32_t color);
+
+	uint8_t* reserve(size_t size);
+	void commit(size_t size);
+	void remap(size_t size);
+	void unmap();
+	void finish();
+
+	FileOperations::FILE_t file;
+	const std::string filename;
+	CliComm& cliComm;
+	std::vector<uint64_t> index;
+	MemBuffer<uint8_t, SSE2_ALIGNMENT> buffer; // when not memory mapped
+	size_t bufferSize;
+	uint8_t* mapping;
+	uint64_t mapStart;
+	size_t mapSize;
+	uint64_t fileSize; // committed bytes
+
+	EmuTime startTime;
+	// Pixel format of the first frame, for the file header.
+	uint32_t redMask, greenMask, blueMask;
+
+	// Palette of the current frame, with a small hash table to find the
+	// index of a color.
+	static const unsigned COLOR_HASH_SIZE = 1024;
+	uint32_t palette[256];
+	unsigned paletteSize;
+	uint32_t colorKey[COLOR_HASH_SIZE];
+	int16_t colorIndex[COLOR_HASH_SIZE]; // -1 means empty
+
+	const unsigned bytesPerPixel;
+	const unsigned channels;
+	const unsigned sampleRate;
+};
+
+} // namespace openmsx
+
+#endif
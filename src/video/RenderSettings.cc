@@ -186,6 +186,14 @@ RenderSettings::RenderSettings(CommandController& commandController)
 		"Useful on (100Hz+) lightboost enabled monitors to reduce "
 		"motion blur and double frame artifacts.",
 		false)
+
+	, renderThreadSetting(commandController,
+		"render_thread",
+		"Draw the MSX screen in a separate thread, in parallel with the "
+		"emulation. Only the bitmap screen modes (SCREEN 5 and up), "
+		"sprites and borders are drawn in that thread. This has no "
+		"effect on V9990 video output.",
+		false)
 {
 	brightnessSetting.attach(*this);
 	contrastSetting  .attach(*this);
@@ -169,6 +169,9 @@ public:
 		return interleaveBlackFrameSetting.getBoolean();
 	}
 
+	/** Render the MSX screen in a separate thread? */
+	BooleanSetting& getRenderThreadSetting() { return renderThreadSetting; }
+
 	/** Apply brightness, contrast and gamma transformation on the input
 	  * color component. The component is expected to be in the range
 	  * [0.0 .. 1.0] but it's not an error if it lays outside of this range.
@@ -225,6 +228,7 @@ private:
 	FloatSetting horizontalStretchSetting;
 	FloatSetting pointerHideDelaySetting;
 	BooleanSetting interleaveBlackFrameSetting;
+	BooleanSetting renderThreadSetting;
 
 	float brightness;
 	float contrast;
@@ -177,6 +177,14 @@ public:
 	  */
 	virtual void updateSpritesEnabled(bool enabled, EmuTime::param time) = 0;
 
+	/** Can a VRAM change in the given block change the rendered image?
+	  * When it can't, the renderer doesn't need to be informed of each
+	  * separate write in that block (see VDPVRAM::isObserved()).
+	  * @param address Start of the block, a multiple of 'size'.
+	  * @param size Size of the block, a power of two, at most 256.
+	  */
+	virtual bool isVRAMObserved(unsigned address, unsigned size) const = 0;
+
 	/** Sprite palette in Graphic 7 mode.
 	  * Each palette entry is a word in GRB format:
 	  * bit 10..8 is green, bit 6..4 is red and bit 2..0 is blue.
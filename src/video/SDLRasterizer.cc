@@ -12,11 +12,13 @@
 #include "MemoryOps.hh"
 #include "VisibleSurface.hh"
 #include "memory.hh"
+#include "unreachable.hh"
 #include "build-info.hh"
 #include "components.hh"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 
 using namespace gl;
 
@@ -33,6 +35,11 @@ static const int TICKS_LEFT_BORDER = 100 + 102;
 static const int TICKS_VISIBLE_MIDDLE =
 	TICKS_LEFT_BORDER + (VDP::TICKS_PER_LINE - TICKS_LEFT_BORDER - 27) / 2;
 
+/** Number of draw commands that can be queued for the render thread.
+  * A frame needs about one command per (display and sprite) line.
+  */
+static const size_t RENDER_QUEUE_SIZE = 256;
+
 /** Translate from absolute VDP coordinates to screen coordinates:
   * Note: In reality, there are only 569.5 visible pixels on a line.
   *       Because it looks better, the borders are extended to 640.
@@ -70,6 +77,23 @@ inline void SDLRasterizer<Pixel>::renderBitmapLine(Pixel* buf, unsigned vramLine
 	}
 }
 
+template <class Pixel>
+void SDLRasterizer<Pixel>::copyBitmapLine(byte* buf, unsigned vramLine)
+{
+	if (vdp.getDisplayMode().isPlanar()) {
+		const byte* vramPtr0;
+		const byte* vramPtr1;
+		vram.bitmapCacheWindow.getReadAreaPlanar(
+			vramLine * 256, 256, vramPtr0, vramPtr1);
+		memcpy(buf,       vramPtr0, 128);
+		memcpy(buf + 128, vramPtr1, 128);
+	} else {
+		const byte* vramPtr =
+			vram.bitmapCacheWindow.getReadArea(vramLine * 128, 128);
+		memcpy(buf, vramPtr, 128);
+	}
+}
+
 template <class Pixel>
 SDLRasterizer<Pixel>::SDLRasterizer(
 		VDP& vdp_, Display& display, VisibleSurface& screen_,
@@ -82,6 +106,12 @@ SDLRasterizer<Pixel>::SDLRasterizer(
 	, characterConverter(vdp, palFg, palBg)
 	, bitmapConverter(palFg, PALETTE256, V9958_COLORS)
 	, spriteConverter(vdp.getSpriteChecker())
+	, prevFrame(nullptr)
+	, prevLineRenderTop(-1)
+	, prevFrameBlocked(true)
+	, renderBitmapConverter(renderPalFg, PALETTE256, V9958_COLORS)
+	, renderSpriteConverter(vdp.getSpriteChecker())
+	, paletteChanged(true)
 {
 	// Init the palette.
 	precalcPalette();
@@ -98,17 +128,153 @@ SDLRasterizer<Pixel>::SDLRasterizer(
 	renderSettings.getBrightnessSetting() .attach(*this);
 	renderSettings.getContrastSetting()   .attach(*this);
 	renderSettings.getColorMatrixSetting().attach(*this);
+	renderSettings.getRenderThreadSetting().attach(*this);
+	updateRenderThread();
 }
 
 template <class Pixel>
 SDLRasterizer<Pixel>::~SDLRasterizer()
 {
+	stopRenderThread();
+	renderSettings.getRenderThreadSetting().detach(*this);
 	renderSettings.getColorMatrixSetting().detach(*this);
 	renderSettings.getGammaSetting()      .detach(*this);
 	renderSettings.getBrightnessSetting() .detach(*this);
 	renderSettings.getContrastSetting()   .detach(*this);
 }
 
+template <class Pixel>
+void SDLRasterizer<Pixel>::updateRenderThread()
+{
+	bool enabled = renderSettings.getRenderThreadSetting().getBoolean();
+	if (enabled == bool(renderQueue)) return;
+	if (enabled) {
+		renderQueue = make_unique<BoundedQueue<DrawCommand>>(
+			RENDER_QUEUE_SIZE);
+		paletteChanged = true;
+		renderThread = std::thread([this]() { renderThreadMain(); });
+	} else {
+		stopRenderThread();
+	}
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::stopRenderThread()
+{
+	if (!renderQueue) return;
+	renderQueue->close(); // thread first executes all remaining commands
+	renderThread.join();
+	renderQueue.reset();
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::syncRenderThread()
+{
+	if (renderQueue) renderQueue->drain();
+}
+
+template <class Pixel>
+typename SDLRasterizer<Pixel>::DrawCommand& SDLRasterizer<Pixel>::newCommand(
+	typename DrawCommand::Type type)
+{
+	if (paletteChanged) {
+		paletteChanged = false;
+		auto& cmd = renderQueue->back();
+		cmd.type = DrawCommand::PALETTE;
+		memcpy(cmd.palette.palFg, palFg, sizeof(palFg));
+		memcpy(cmd.palette.palBg, palBg, sizeof(palBg));
+		renderQueue->push();
+	}
+	auto& cmd = renderQueue->back();
+	cmd.type = type;
+	return cmd;
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::renderThreadMain()
+{
+	while (const DrawCommand* cmd = renderQueue->front()) {
+		execute(*cmd);
+		renderQueue->pop();
+	}
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::execute(const DrawCommand& cmd)
+{
+	switch (cmd.type) {
+	case DrawCommand::PALETTE:
+		memcpy(renderPalFg, cmd.palette.palFg, sizeof(renderPalFg));
+		memcpy(renderPalBg, cmd.palette.palBg, sizeof(renderPalBg));
+		renderBitmapConverter.palette16Changed();
+		break;
+	case DrawCommand::BORDER: {
+		auto& b = cmd.border;
+		fillBorder(cmd.y, b.endY, b.x, b.num, b.width,
+		           b.color0, b.color1, b.fullLines, b.canSkip);
+		break;
+	}
+	case DrawCommand::BITMAP: {
+		auto& bm = cmd.bitmap;
+		renderBitmapConverter.setDisplayMode(bm.mode);
+		bool planar = bm.mode.isPlanar();
+		auto convert = [&](Pixel* dst, const byte* vramPtr) {
+			if (planar) {
+				renderBitmapConverter.convertLinePlanar(
+					dst, vramPtr, vramPtr + 128);
+			} else {
+				renderBitmapConverter.convertLine(dst, vramPtr);
+			}
+		};
+		Pixel buf[512];
+		Pixel* dst = workFrame->getLinePtrDirect<Pixel>(cmd.y) + bm.dstX;
+		if (bm.firstWidth > 0) {
+			if (bm.direct) {
+				convert(dst, bm.vram[0]);
+			} else {
+				convert(buf, bm.vram[0]);
+				memcpy(dst, buf + bm.firstSrcX,
+				       bm.firstWidth * sizeof(Pixel));
+			}
+		}
+		if (bm.secondWidth > 0) {
+			if (!bm.reuse) convert(buf, bm.vram[1]);
+			memcpy(dst + bm.firstWidth, buf + bm.secondSrcX,
+			       bm.secondWidth * sizeof(Pixel));
+		}
+		break;
+	}
+	case DrawCommand::SPRITES: {
+		auto& sp = cmd.sprites;
+		renderSpriteConverter.setTransparency(sp.transparency);
+		renderSpriteConverter.setPalette(
+			(sp.mode == DisplayMode::GRAPHIC7) ? palGraphic7Sprites
+			                                   : renderPalBg);
+		Pixel* pixelPtr =
+			workFrame->getLinePtrDirect<Pixel>(cmd.y) + sp.screenX;
+		if (sp.spriteMode == 1) {
+			renderSpriteConverter.drawMode1(
+				sp.sprites, sp.count, sp.minX, sp.maxX, pixelPtr);
+		} else if (sp.mode == DisplayMode::GRAPHIC5) {
+			renderSpriteConverter.template drawMode2<DisplayMode::GRAPHIC5>(
+				sp.sprites, sp.count, sp.minX, sp.maxX, pixelPtr);
+		} else if (sp.mode == DisplayMode::GRAPHIC6) {
+			renderSpriteConverter.template drawMode2<DisplayMode::GRAPHIC6>(
+				sp.sprites, sp.count, sp.minX, sp.maxX, pixelPtr);
+		} else {
+			renderSpriteConverter.template drawMode2<DisplayMode::GRAPHIC4>(
+				sp.sprites, sp.count, sp.minX, sp.maxX, pixelPtr);
+		}
+		break;
+	}
+	case DrawCommand::COPY:
+		copyLines(*cmd.copy.src, cmd.y, cmd.copy.endY);
+		break;
+	default:
+		UNREACHABLE;
+	}
+}
+
 template <class Pixel>
 PostProcessor* SDLRasterizer<Pixel>::getPostProcessor() const
 {
@@ -131,6 +297,7 @@ void SDLRasterizer<Pixel>::reset()
 	spriteConverter.setTransparency(vdp.getTransparency());
 
 	resetPalette();
+	blockCopyPreviousLines();
 }
 
 template <class Pixel>
@@ -150,11 +317,13 @@ void SDLRasterizer<Pixel>::setSuperimposeVideoFrame(const RawFrame* videoSource)
 	postProcessor->setSuperimposeVideoFrame(videoSource);
 	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
 	                   videoSource, vdp.getBackgroundColor());
+	blockCopyPreviousLines();
 }
 
 template <class Pixel>
 void SDLRasterizer<Pixel>::frameStart(EmuTime::param time)
 {
+	syncRenderThread();
 	workFrame = postProcessor->rotateFrames(std::move(workFrame), time);
 	workFrame->init(
 	    vdp.isInterlaced() ? (vdp.getEvenOdd() ? FrameSource::FIELD_ODD
@@ -168,6 +337,19 @@ void SDLRasterizer<Pixel>::frameStart(EmuTime::param time)
 	// PAL:  display at [59..271).
 	lineRenderTop = vdp.isPalTiming() ? 59 - 14 : 32 - 14;
 
+	// Lines can only be copied from the previous frame if it has the same
+	// layout and was drawn with the same rendering settings. In interlace
+	// and even/odd mode consecutive frames show different lines or pages.
+	prevFrame = postProcessor->getLastFrame();
+	if (prevFrameBlocked || !prevFrame ||
+	    (prevFrame->getField() != FrameSource::FIELD_NONINTERLACED) ||
+	    (lineRenderTop != prevLineRenderTop) ||
+	    vdp.isInterlaced() || vdp.isEvenOddEnabled() ||
+	    vdp.isSuperimposing()) {
+		prevFrame = nullptr;
+	}
+	prevFrameBlocked = false;
+	prevLineRenderTop = lineRenderTop;
 
 	// We haven't drawn any left/right borders yet this frame, thus so far
 	// all is still consistent (same settings for all left/right borders).
@@ -188,6 +370,7 @@ void SDLRasterizer<Pixel>::frameStart(EmuTime::param time)
 template <class Pixel>
 void SDLRasterizer<Pixel>::frameEnd()
 {
+	syncRenderThread();
 	auto& borderInfo = workFrame->getBorderInfo();
 	if (mixedLeftRightBorders) {
 		// This frame contains left/right borders drawn with different
@@ -246,6 +429,7 @@ void SDLRasterizer<Pixel>::setPalette(int index, int grb)
 	palFg[index + 16] = newColor;
 	palBg[index     ] = newColor;
 	bitmapConverter.palette16Changed();
+	paletteChanged = true;
 
 	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
 	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
@@ -291,6 +475,7 @@ void SDLRasterizer<Pixel>::setTransparency(bool enabled)
 template <class Pixel>
 void SDLRasterizer<Pixel>::precalcPalette()
 {
+	paletteChanged = true;
 	if (vdp.isMSX1VDP()) {
 		// Fixed palette.
 		const auto palette = vdp.getMSX1Palette();
@@ -410,6 +595,7 @@ void SDLRasterizer<Pixel>::precalcColorIndex0(DisplayMode mode,
 		if (palFg[0] != c) {
 			palFg[0] = c;
 			bitmapConverter.palette16Changed();
+			paletteChanged = true;
 		}
 	} else {
 		// TODO: superimposing
@@ -418,6 +604,7 @@ void SDLRasterizer<Pixel>::precalcColorIndex0(DisplayMode mode,
 			palFg[ 0] = palBg[tpIndex >> 2];
 			palFg[16] = palBg[tpIndex &  3];
 			bitmapConverter.palette16Changed();
+			paletteChanged = true;
 		}
 	}
 }
@@ -452,9 +639,51 @@ void SDLRasterizer<Pixel>::drawBorder(
 
 	int startY = std::max(fromY - lineRenderTop, 0);
 	int endY = std::min(limitY - lineRenderTop, 240);
-	if ((fromX == 0) && (limitX == VDP::TICKS_PER_LINE) &&
-	    (border0 == border1)) {
-		// complete lines, non striped
+	// complete lines, non striped?
+	bool fullLines = (fromX == 0) && (limitX == VDP::TICKS_PER_LINE) &&
+	                 (border0 == border1);
+	unsigned x = 0;
+	unsigned num = 0;
+	unsigned width = 0;
+	if (!fullLines) {
+		unsigned lineWidth = vdp.getDisplayMode().getLineWidth();
+		x = translateX(fromX, (lineWidth == 512));
+		num = translateX(limitX, (lineWidth == 512)) - x;
+		if (limitX == VDP::TICKS_PER_LINE) {
+			// Only set line width at the end (right border) of
+			// the line. This ensures we can keep testing the
+			// width of the previous version of this line for all
+			// (partial) updates of this line.
+			width = (lineWidth == 512) ? 640 : 320;
+		}
+	}
+
+	if (renderQueue) {
+		if (startY >= endY) return;
+		auto& cmd = newCommand(DrawCommand::BORDER);
+		cmd.y = startY;
+		auto& b = cmd.border;
+		b.endY = endY;
+		b.x = x;
+		b.num = num;
+		b.width = width;
+		b.color0 = border0;
+		b.color1 = border1;
+		b.fullLines = fullLines;
+		b.canSkip = canSkipLeftRightBorders;
+		renderQueue->push();
+	} else {
+		fillBorder(startY, endY, x, num, width, border0, border1,
+		           fullLines, canSkipLeftRightBorders);
+	}
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::fillBorder(
+	int startY, int endY, unsigned x, unsigned num, unsigned width,
+	Pixel border0, Pixel border1, bool fullLines, bool canSkip)
+{
+	if (fullLines) {
 		for (int y = startY; y < endY; y++) {
 			workFrame->setBlank(y, border0);
 			// setBlank() implies this line is not suitable
@@ -462,24 +691,15 @@ void SDLRasterizer<Pixel>::drawBorder(
 			// frame.
 		}
 	} else {
-		unsigned lineWidth = vdp.getDisplayMode().getLineWidth();
-		unsigned x = translateX(fromX, (lineWidth == 512));
-		unsigned num = translateX(limitX, (lineWidth == 512)) - x;
-		unsigned width = (lineWidth == 512) ? 640 : 320;
 		MemoryOps::MemSet2<Pixel> memset;
 		for (int y = startY; y < endY; ++y) {
 			// workFrame->linewidth != 1 means the line has
 			// left/right borders.
-			if (canSkipLeftRightBorders &&
+			if (canSkip &&
 			    (workFrame->getLineWidthDirect(y) != 1)) continue;
 			memset(workFrame->getLinePtrDirect<Pixel>(y) + x,
 			       num, border0, border1);
-			if (limitX == VDP::TICKS_PER_LINE) {
-				// Only set line width at the end (right
-				// border) of the line. This ensures we can
-				// keep testing the width of the previous
-				// version of this line for all (partial)
-				// updates of this line.
+			if (width) {
 				workFrame->setLineWidth(y, width);
 			}
 		}
@@ -560,6 +780,32 @@ void SDLRasterizer<Pixel>::drawDisplay(
 				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | displayY)
 			};
 
+			if (renderQueue) {
+				// Same as below, but executed in the render thread.
+				auto& cmd = newCommand(DrawCommand::BITMAP);
+				cmd.y = y;
+				auto& bm = cmd.bitmap;
+				bm.mode = mode;
+				bm.dstX = leftBackground + displayX;
+				bm.firstWidth = std::max(pageBorder - displayX, 0);
+				bm.firstSrcX = displayX + hScroll;
+				bm.direct = bm.firstSrcX == 0;
+				if (bm.firstWidth > 0) {
+					copyBitmapLine(bm.vram[0], vramLine[scrollPage1]);
+				}
+				bm.secondWidth = displayWidth - bm.firstWidth;
+				bm.secondSrcX = displayX < pageBorder
+				              ? 0 : displayX + hScroll - lineWidth;
+				bm.reuse = (bm.firstWidth > 0) && !bm.direct &&
+				           (vramLine[scrollPage1] == vramLine[scrollPage2]);
+				if ((bm.secondWidth > 0) && !bm.reuse) {
+					copyBitmapLine(bm.vram[1], vramLine[scrollPage2]);
+				}
+				renderQueue->push();
+				displayY = (displayY + 1) & 255;
+				continue;
+			}
+
 			Pixel buf[512];
 			int lineInBuf = -1; // buffer data not valid
 			Pixel* dst = workFrame->getLinePtrDirect<Pixel>(y)
@@ -591,6 +837,9 @@ void SDLRasterizer<Pixel>::drawDisplay(
 			displayY = (displayY + 1) & 255;
 		}
 	} else {
+		// CharacterConverter reads VRAM while converting, so this is
+		// still done in the emulation thread.
+		syncRenderThread();
 		// horizontal scroll (high) is implemented in CharacterConverter
 		for (int y = screenY; y < screenLimitY; y++) {
 			assert(!vdp.isMSX1VDP() || displayY < 192);
@@ -640,7 +889,27 @@ void SDLRasterizer<Pixel>::drawSprites(
 	int screenX = translateX(
 		vdp.getLeftSprites(),
 		vdp.getDisplayMode().getLineWidth() == 512);
-	if (spriteMode == 1) {
+	if (renderQueue) {
+		auto& spriteChecker = vdp.getSpriteChecker();
+		for (int y = fromY; y < limitY; y++, screenY++) {
+			const SpriteChecker::SpriteInfo* visibleSprites;
+			int count = spriteChecker.getSprites(y, visibleSprites);
+			// Lines without any sprites are very common.
+			if (count == 0) continue;
+			auto& cmd = newCommand(DrawCommand::SPRITES);
+			cmd.y = screenY;
+			auto& sp = cmd.sprites;
+			sp.spriteMode = spriteMode;
+			sp.mode = vdp.getDisplayMode().getByte();
+			sp.transparency = vdp.getTransparency();
+			sp.minX = displayX;
+			sp.maxX = displayLimitX;
+			sp.screenX = screenX;
+			sp.count = count;
+			std::copy_n(visibleSprites, count + 1, sp.sprites); // incl sentinel
+			renderQueue->push();
+		}
+	} else if (spriteMode == 1) {
 		for (int y = fromY; y < limitY; y++, screenY++) {
 			Pixel* pixelPtr = workFrame->getLinePtrDirect<Pixel>(screenY) + screenX;
 			spriteConverter.drawMode1(y, displayX, displayLimitX, pixelPtr);
@@ -669,6 +938,48 @@ void SDLRasterizer<Pixel>::drawSprites(
 	}
 }
 
+template <class Pixel>
+bool SDLRasterizer<Pixel>::copyPreviousLines(int fromY, int limitY)
+{
+	if (!prevFrame) return false;
+
+	int startY = std::max(fromY - lineRenderTop, 0);
+	int endY = std::min(limitY - lineRenderTop, 240);
+	if (startY >= endY) return true;
+
+	if (renderQueue) {
+		auto& cmd = newCommand(DrawCommand::COPY);
+		cmd.y = startY;
+		cmd.copy.src = prevFrame;
+		cmd.copy.endY = endY;
+		renderQueue->push();
+	} else {
+		copyLines(*prevFrame, startY, endY);
+	}
+	return true;
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::copyLines(const RawFrame& src, int startY, int endY)
+{
+	for (int y = startY; y < endY; ++y) {
+		// Also copies the left/right borders, so the line width
+		// (which tells whether the line has such borders) is copied
+		// as well.
+		unsigned width = src.getLineWidthDirect(y);
+		memcpy(workFrame->getLinePtrDirect<Pixel>(y),
+		       src.getLinePtrDirect<Pixel>(y), width * sizeof(Pixel));
+		workFrame->setLineWidth(y, width);
+	}
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::blockCopyPreviousLines()
+{
+	prevFrame = nullptr;
+	prevFrameBlocked = true;
+}
+
 template <class Pixel>
 bool SDLRasterizer<Pixel>::isRecording() const
 {
@@ -682,8 +993,13 @@ void SDLRasterizer<Pixel>::update(const Setting& setting)
 	    (&setting == &renderSettings.getBrightnessSetting()) ||
 	    (&setting == &renderSettings.getContrastSetting()) ||
 	    (&setting == &renderSettings.getColorMatrixSetting())) {
+		// The render thread uses the precalculated palettes.
+		syncRenderThread();
 		precalcPalette();
 		resetPalette();
+		blockCopyPreviousLines();
+	} else if (&setting == &renderSettings.getRenderThreadSetting()) {
+		updateRenderThread();
 	}
 }
 
@@ -5,9 +5,11 @@
 #include "BitmapConverter.hh"
 #include "CharacterConverter.hh"
 #include "SpriteConverter.hh"
+#include "BoundedQueue.hh"
 #include "Observer.hh"
 #include "openmsx.hh"
 #include <memory>
+#include <thread>
 
 namespace openmsx {
 
@@ -60,11 +62,87 @@ public:
 		int fromX, int fromY,
 		int displayX, int displayY,
 		int displayWidth, int displayHeight) override;
+	bool copyPreviousLines(int fromY, int limitY) override;
 	bool isRecording() const override;
 
 private:
+	/** A drawing operation recorded by the emulation thread and executed
+	  * by the render thread. All VDP state it depends on is resolved at
+	  * recording time, the VRAM and sprite data it needs is copied.
+	  */
+	struct DrawCommand {
+		enum Type { PALETTE, BORDER, BITMAP, SPRITES, COPY };
+		Type type;
+		int y; // screen line, for BORDER and COPY: first line
+		struct { // PALETTE
+			Pixel palFg[16 * 2];
+			Pixel palBg[16];
+		} palette;
+		struct { // BORDER
+			int endY;
+			unsigned x, num, width;
+			Pixel color0, color1;
+			bool fullLines, canSkip;
+		} border;
+		struct { // BITMAP
+			DisplayMode mode;
+			int dstX;
+			int firstWidth, firstSrcX;  // first page
+			int secondWidth, secondSrcX; // second page
+			bool direct; // first page converted directly to frame
+			bool reuse;  // second page is the same line as first
+			// Non-planar modes use the first 128 bytes, planar
+			// modes 2x128 bytes (even and odd plane).
+			byte vram[2][256];
+		} bitmap;
+		struct { // SPRITES
+			int spriteMode;
+			byte mode; // DisplayMode byte
+			bool transparency;
+			int minX, maxX, screenX;
+			int count;
+			SpriteChecker::SpriteInfo sprites[32 + 1]; // +1 for sentinel
+		} sprites;
+		struct { // COPY
+			const RawFrame* src;
+			int endY;
+		} copy;
+	};
+
 	inline void renderBitmapLine(Pixel* buf, unsigned vramLine);
 
+	/** Fill (part of) the border on the given screen lines. Used by both
+	  * drawBorder() and the render thread. */
+	void fillBorder(int startY, int endY, unsigned x, unsigned num,
+	                unsigned width, Pixel border0, Pixel border1,
+	                bool fullLines, bool canSkip);
+
+	/** Start or stop the render thread, depending on the setting. */
+	void updateRenderThread();
+	void stopRenderThread();
+
+	/** Wait till the render thread has executed all queued commands. */
+	void syncRenderThread();
+
+	/** Get a command slot in the render queue. Takes care of first
+	  * sending the current palette to the render thread when needed. */
+	DrawCommand& newCommand(typename DrawCommand::Type type);
+
+	/** Copy the given VRAM line into 'buf' (see DrawCommand::bitmap). */
+	void copyBitmapLine(byte* buf, unsigned vramLine);
+
+	/** Copy the given screen lines from 'src' to 'workFrame'. */
+	void copyLines(const RawFrame& src, int startY, int endY);
+
+	/** Called when a rendering setting changes: from now on no lines are
+	  * copied from the previous frame, until a frame has been drawn
+	  * completely with the new settings. */
+	void blockCopyPreviousLines();
+
+	/** Main loop of the render thread. */
+	void renderThreadMain();
+	void execute(const DrawCommand& cmd);
+
 	/** Reload entire palette from VDP.
 	  */
 	void resetPalette();
@@ -133,6 +211,16 @@ private:
 	  */
 	int lineRenderTop;
 
+	/** The previous frame, if copyPreviousLines() may use it. */
+	const RawFrame* prevFrame;
+
+	/** lineRenderTop of the previous frame. */
+	int prevLineRenderTop;
+
+	/** Set when a rendering setting changed, the next frame can then not
+	  * use prevFrame either. */
+	bool prevFrameBlocked;
+
 	/** Host colors corresponding to each VDP palette entry.
 	  * palFg has entry 0 set to the current background color.
 	  *       The 16 first entries are for even pixels, the next 16 are for
@@ -168,6 +256,26 @@ private:
 	// during this frame (meaning the border pixels of this frame cannot
 	// be reused for future frames).
 	bool mixedLeftRightBorders;
+
+	/** Commands from the emulation thread to the render thread.
+	  * Only exists while the render thread is running.
+	  * The render thread owns 'workFrame' while this queue is non-empty,
+	  * so it must be drained before the emulation thread accesses the
+	  * frame itself.
+	  */
+	std::unique_ptr<BoundedQueue<DrawCommand>> renderQueue;
+	std::thread renderThread;
+
+	/** Copies of palFg and palBg used by the render thread. */
+	Pixel renderPalFg[16 * 2], renderPalBg[16];
+
+	/** Converters used by the render thread. */
+	BitmapConverter<Pixel> renderBitmapConverter;
+	SpriteConverter<Pixel> renderSpriteConverter;
+
+	/** True iff palFg or palBg changed since they were last sent to the
+	  * render thread. */
+	bool paletteChanged;
 };
 
 } // namespace openmsx
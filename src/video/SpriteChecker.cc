@@ -36,6 +36,7 @@ void SpriteChecker::reset(EmuTime::param time)
 	frameStart(time);
 
 	updateSpritesMethod = &SpriteChecker::updateSprites1;
+	visibility.invalidate();
 }
 
 static inline SpriteChecker::SpritePattern doublePattern(SpriteChecker::SpritePattern a)
@@ -97,21 +98,14 @@ void SpriteChecker::updateSprites1(int limit)
 
 inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 {
-	// This implementation contains a double for-loop. The outer loop goes
-	// over the sprites, the inner loop over the to-be-checked lines. This
-	// is not the order in which the real VDP performs this operation: the
-	// real VDP renders line-per-line and for each line checks all 32
-	// sprites.
-	//
-	// Though this 'reverse' order allows to skip over very large regions
-	// of the inner loop: we only have to process the lines were a
-	// particular sprite is actually visible. I measured this makes this
-	// routine 4x-5x faster!
-	//
-	// This routine also needs to detect the sprite number of the 'first'
-	// 5th-sprite-condition. With 'first' meaning the first line where this
-	// condition occurs. Because our loops are swapped compared to the real
-	// VDP, we need some extra fixup logic to correctly detect this.
+	// Like the real VDP we go line-per-line, but instead of checking all
+	// 32 sprites on each line, we look up the sprites that cover the line
+	// in the visibility index. That index only changes when the Y
+	// coordinates change, so for most calls (one or a few lines,
+	// triggered by a VRAM write) this only touches the visible sprites.
+	// Because the lines are processed in order, the first 5th-sprite-
+	// condition we encounter is the one that ends up in the status
+	// register.
 
 	// Calculate display line.
 	// This is the line sprites are checked at; the line they are displayed
@@ -126,31 +120,25 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 	const byte* attributePtr = vram.spriteAttribTable.getReadArea(0, 32 * 4);
 	byte patternIndexMask = size == 16 ? 0xFC : 0xFF;
 	int fifthSpriteNum  = -1;  // no 5th sprite detected yet
-	int fifthSpriteLine = 999; // larger than any possible valid line
 
-	int sprite = 0;
-	for (/**/; sprite < 32; ++sprite) {
-		int y = attributePtr[4 * sprite + 0];
-		if (y == 208) break;
-
-		for (int line = minLine; line < maxLine; ++line) {
+	int numSprites = visibility.update(attributePtr, 4, 208, magSize);
+	uint32_t checked = (numSprites == 32) ? ~0u : ((1u << numSprites) - 1);
+	for (int line = minLine; line < maxLine; ++line) {
+		int displayLine = line + displayDelta;
+		uint32_t sprites = visibility.getSprites(displayLine) & checked;
+		while (sprites) {
+			int sprite = Math::findFirstSet(sprites) - 1;
+			sprites &= sprites - 1;
 			// Calculate line number within the sprite.
-			int displayLine = line + displayDelta;
-			int spriteLine = (displayLine - y) & 0xFF;
-			if (spriteLine >= magSize) {
-				// Skip ahead till sprite becomes visible.
-				line += 256 - spriteLine - 1; // -1 because of for-loop
-				continue;
-			}
+			int spriteLine = (displayLine - visibility.getY(sprite)) & 0xFF;
+			assert(spriteLine < magSize);
 
 			int visibleIndex = spriteCount[line];
 			if (visibleIndex == 4) {
-				// Find earliest line where this condition occurs.
-				if (line < fifthSpriteLine) {
-					fifthSpriteLine = line;
-					fifthSpriteNum = sprite;
-				}
-				if (limitSprites) continue;
+				if (fifthSpriteNum == -1) fifthSpriteNum = sprite;
+				// All following sprites on this line are
+				// dropped as well.
+				if (limitSprites) break;
 			}
 
 			SpriteInfo& sip = spriteBuffer[line][visibleIndex];
@@ -178,7 +166,7 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 	}
 	if (~status & 0x40) {
 		// No 5th sprite detected, store number of latest sprite processed.
-		status = (status & 0x20) | std::min(sprite, 31);
+		status = (status & 0x20) | std::min(numSprites, 31);
 	}
 	vdp.setSpriteStatus(status);
 
@@ -267,7 +255,7 @@ void SpriteChecker::updateSprites2(int limit)
 
 inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 {
-	// See comment in checkSprites1() about order of inner and outer loops.
+	// See comment in checkSprites1() about the visibility index.
 
 	// Calculate display line.
 	// This is the line sprites are checked at; the line they are displayed
@@ -281,39 +269,32 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 	int magSize = (mag + 1) * size;
 	int patternIndexMask = (size == 16) ? 0xFC : 0xFF;
 	int ninthSpriteNum  = -1;  // no 9th sprite detected yet
-	int ninthSpriteLine = 999; // larger than any possible valid line
 
 	// Because it gave a measurable performance boost, we duplicated the
 	// code for planar and non-planar modes.
-	int sprite = 0;
+	int numSprites;
 	if (planar) {
 		const byte* attributePtr0;
 		const byte* attributePtr1;
 		vram.spriteAttribTable.getReadAreaPlanar(
 			512, 32 * 4, attributePtr0, attributePtr1);
+		numSprites = visibility.update(attributePtr0, 2, 216, magSize);
+		uint32_t checked = (numSprites == 32) ? ~0u : ((1u << numSprites) - 1);
 		// TODO: Verify CC implementation.
-		for (/**/; sprite < 32; ++sprite) {
-			int y = attributePtr0[2 * sprite + 0];
-			if (y == 216) break;
-
-			for (int line = minLine; line < maxLine; ++line) {
+		for (int line = minLine; line < maxLine; ++line) {
+			int displayLine = line + displayDelta;
+			uint32_t sprites = visibility.getSprites(displayLine) & checked;
+			while (sprites) {
+				int sprite = Math::findFirstSet(sprites) - 1;
+				sprites &= sprites - 1;
 				// Calculate line number within the sprite.
-				int displayLine = line + displayDelta;
-				int spriteLine = (displayLine - y) & 0xFF;
-				if (spriteLine >= magSize) {
-					// Skip ahead till sprite is visible.
-					line += 256 - spriteLine - 1;
-					continue;
-				}
+				int spriteLine = (displayLine - visibility.getY(sprite)) & 0xFF;
+				assert(spriteLine < magSize);
 
 				int visibleIndex = spriteCount[line];
 				if (visibleIndex == 8) {
-					// Find earliest line where this condition occurs.
-					if (line < ninthSpriteLine) {
-						ninthSpriteLine = line;
-						ninthSpriteNum = sprite;
-					}
-					if (limitSprites) continue;
+					if (ninthSpriteNum == -1) ninthSpriteNum = sprite;
+					if (limitSprites) break;
 				}
 
 				if (mag) spriteLine /= 2;
@@ -339,29 +320,23 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 	} else {
 		const byte* attributePtr0 =
 			vram.spriteAttribTable.getReadArea(512, 32 * 4);
+		numSprites = visibility.update(attributePtr0, 4, 216, magSize);
+		uint32_t checked = (numSprites == 32) ? ~0u : ((1u << numSprites) - 1);
 		// TODO: Verify CC implementation.
-		for (/**/; sprite < 32; ++sprite) {
-			int y = attributePtr0[4 * sprite + 0];
-			if (y == 216) break;
-
-			for (int line = minLine; line < maxLine; ++line) {
+		for (int line = minLine; line < maxLine; ++line) {
+			int displayLine = line + displayDelta;
+			uint32_t sprites = visibility.getSprites(displayLine) & checked;
+			while (sprites) {
+				int sprite = Math::findFirstSet(sprites) - 1;
+				sprites &= sprites - 1;
 				// Calculate line number within the sprite.
-				int displayLine = line + displayDelta;
-				int spriteLine = (displayLine - y) & 0xFF;
-				if (spriteLine >= magSize) {
-					// Skip ahead till sprite is visible.
-					line += 256 - spriteLine - 1;
-					continue;
-				}
+				int spriteLine = (displayLine - visibility.getY(sprite)) & 0xFF;
+				assert(spriteLine < magSize);
 
 				int visibleIndex = spriteCount[line];
 				if (visibleIndex == 8) {
-					// Find earliest line where this condition occurs.
-					if (line < ninthSpriteLine) {
-						ninthSpriteLine = line;
-						ninthSpriteNum = sprite;
-					}
-					if (limitSprites) continue;
+					if (ninthSpriteNum == -1) ninthSpriteNum = sprite;
+					if (limitSprites) break;
 				}
 
 				if (mag) spriteLine /= 2;
@@ -406,7 +381,7 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 	}
 	if (~status & 0x40) {
 		// No 9th sprite detected, store number of latest sprite processed.
-		status = (status & 0x20) | std::min(sprite, 31);
+		status = (status & 0x20) | std::min(numSprites, 31);
 	}
 	vdp.setSpriteStatus(status);
 
@@ -501,6 +476,7 @@ void SpriteChecker::serialize(Archive& ar, unsigned version)
 		// first (partial) frame after loadstate.
 		for (auto& c : spriteCount) c = 0;
 		// content of spriteBuffer[] doesn't matter if spriteCount[] is 0
+		// The visibility index was invalidated by setDisplayMode().
 	}
 	ar.serialize("collisionX", collisionX);
 	ar.serialize("collisionY", collisionY);
@@ -4,6 +4,7 @@
 #include "VDP.hh"
 #include "VDPVRAM.hh"
 #include "VRAMObserver.hh"
+#include "SpriteVisibility.hh"
 #include "DisplayMode.hh"
 #include "serialize_meta.hh"
 #include "unreachable.hh"
@@ -252,6 +253,8 @@ private:
 	/** Calculate 'updateSpritesMethod' and 'planar'.
 	  */
 	inline void setDisplayMode(DisplayMode mode) {
+		// The 'end of table' Y coordinate depends on the sprite mode.
+		visibility.invalidate();
 		switch (mode.getSpriteMode(vdp.isMSX1VDP())) {
 		case 0:
 			updateSpritesMethod = nullptr;
@@ -364,6 +367,11 @@ private:
 	  */
 	uint8_t spriteCount[313];
 
+	/** Sprites per display line, see SpriteVisibility.
+	  * This index is not serialized, it's rebuilt after loadstate.
+	  */
+	SpriteVisibility visibility;
+
 	/** Is current display mode planar or not?
 	  * TODO: Introduce separate update methods for planar/nonplanar modes.
 	  */
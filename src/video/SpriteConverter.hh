@@ -92,9 +92,21 @@ public:
 	               Pixel* __restrict pixelPtr) __restrict
 	{
 		// Determine sprites visible on this line.
-		const SpriteChecker::SpriteInfo* visibleSprites;
+		const SpriteChecker::SpriteInfo* visibleSprites = nullptr;
 		int visibleIndex =
 			spriteChecker.getSprites(absLine, visibleSprites);
+		drawMode1(visibleSprites, visibleIndex, minX, maxX, pixelPtr);
+	}
+
+	/** Draw sprites in sprite mode 1.
+	  * Like above, but takes the visible sprites as an explicit array
+	  * (see SpriteChecker::getSprites()) instead of fetching them from
+	  * the SpriteChecker.
+	  */
+	void drawMode1(const SpriteChecker::SpriteInfo* visibleSprites,
+	               int visibleIndex, int minX, int maxX,
+	               Pixel* __restrict pixelPtr) __restrict
+	{
 		// Optimisation: return at once if no sprites on this line.
 		// Lines without any sprites are very common in most programs.
 		if (visibleIndex == 0) return;
@@ -143,9 +155,23 @@ public:
 	               Pixel* __restrict pixelPtr) __restrict
 	{
 		// Determine sprites visible on this line.
-		const SpriteChecker::SpriteInfo* visibleSprites;
+		const SpriteChecker::SpriteInfo* visibleSprites = nullptr;
 		int visibleIndex =
 			spriteChecker.getSprites(absLine, visibleSprites);
+		drawMode2<MODE>(visibleSprites, visibleIndex,
+		                minX, maxX, pixelPtr);
+	}
+
+	/** Draw sprites in sprite mode 2.
+	  * Like above, but takes the visible sprites as an explicit array.
+	  * Note that this array must end with a sentinel element (like the
+	  * one returned by SpriteChecker::getSprites()).
+	  */
+	template <unsigned MODE>
+	void drawMode2(const SpriteChecker::SpriteInfo* visibleSprites,
+	               int visibleIndex, int minX, int maxX,
+	               Pixel* __restrict pixelPtr) __restrict
+	{
 		// Optimisation: return at once if no sprites on this line.
 		// Lines without any sprites are very common in most programs.
 		if (visibleIndex == 0) return;
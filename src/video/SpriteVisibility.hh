@@ -0,0 +1,114 @@
+#ifndef SPRITEVISIBILITY_HH
+#define SPRITEVISIBILITY_HH
+
+#include "openmsx.hh"
+#include "Math.hh"
+#include <cstdint>
+
+namespace openmsx {
+
+/** Visibility index of SpriteChecker: per display line (modulo 256) a
+  * bitmask of the sprites that cover that line according to their Y
+  * coordinate. It only depends on the Y coordinates in the sprite attribute
+  * table and on the sprite size, so when those didn't change, the index
+  * can be reused instead of rescanning all sprites for every line.
+  *
+  * At each update() the 32 Y coordinates are compared with the ones the
+  * index is based on. So the index doesn't depend on how VRAM writes map to
+  * attribute table entries, e.g. when a non-canonical attribute table base
+  * address mirrors the table onto other VRAM.
+  */
+class SpriteVisibility
+{
+public:
+	SpriteVisibility()
+		: endMarkers(0), magSize(0)
+	{
+	}
+
+	/** The index must be rebuilt from scratch at the next update().
+	  */
+	void invalidate() { magSize = 0; }
+
+	/** Bring the index up-to-date with the Y coordinates in VRAM.
+	  * @param yPtr Pointer to the Y coordinate of sprite 0.
+	  * @param stride Distance between the Y coordinates of two sprites.
+	  * @param endY Y coordinate that marks the end of the sprite table.
+	  * @param newMagSize Sprite size, including magnification.
+	  * @return The number of sprites before the end marker.
+	  */
+	inline int update(const byte* yPtr, int stride, byte endY,
+	                  int newMagSize);
+
+	/** Bitmask of the sprites that cover the given display line.
+	  */
+	uint32_t getSprites(int displayLine) const {
+		return lineSprites[displayLine & 0xFF];
+	}
+
+	/** The Y coordinate of a sprite, as of the last update().
+	  */
+	byte getY(int sprite) const { return spriteY[sprite]; }
+
+private:
+	/** Add the lines of a sprite to the index, or remove them if they
+	  * are already in it.
+	  */
+	inline void toggleLines(int sprite);
+
+	uint32_t lineSprites[256];
+
+	/** The Y coordinates 'lineSprites' is based on.
+	  */
+	byte spriteY[32];
+
+	/** Bitmask of the sprites that have the 'end of table' Y coordinate.
+	  */
+	uint32_t endMarkers;
+
+	/** Sprite size (including magnification) the index was built for,
+	  * or 0 when it must be rebuilt.
+	  */
+	int magSize;
+};
+
+inline void SpriteVisibility::toggleLines(int sprite)
+{
+	uint32_t bit = 1u << sprite;
+	byte y = spriteY[sprite];
+	for (int i = 0; i < magSize; ++i) {
+		lineSprites[byte(y + i)] ^= bit;
+	}
+}
+
+inline int SpriteVisibility::update(
+	const byte* yPtr, int stride, byte endY, int newMagSize)
+{
+	if (newMagSize != magSize) {
+		magSize = newMagSize;
+		for (auto& l : lineSprites) l = 0;
+		endMarkers = 0;
+		for (int sprite = 0; sprite < 32; ++sprite) {
+			byte y = yPtr[stride * sprite];
+			spriteY[sprite] = y;
+			toggleLines(sprite);
+			if (y == endY) endMarkers |= 1u << sprite;
+		}
+	} else {
+		for (int sprite = 0; sprite < 32; ++sprite) {
+			byte y = yPtr[stride * sprite];
+			if (y == spriteY[sprite]) continue;
+			toggleLines(sprite); // remove old lines
+			spriteY[sprite] = y;
+			toggleLines(sprite); // add new lines
+			uint32_t bit = 1u << sprite;
+			endMarkers = (y == endY) ? (endMarkers | bit)
+			                         : (endMarkers & ~bit);
+		}
+	}
+	return endMarkers ? int(Math::findFirstSet(endMarkers) - 1) : 32;
+}
+
+} // namespace openmsx
+
+#endif
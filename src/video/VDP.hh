@@ -315,6 +315,13 @@ public:
 		return displayStart / TICKS_PER_LINE;
 	}
 
+	/** Gets the number of display lines per screen.
+	  * @return 192 or 212.
+	  */
+	inline int getNumberOfLines() const {
+		return controlRegs[9] & 0x80 ? 212 : 192;
+	}
+
 	/** Is PAL timing active?
 	  * This setting is fixed at start of frame.
 	  * @return True if PAL timing, false if NTSC timing.
@@ -395,6 +402,14 @@ public:
 		return controlRegs[1] & 1;
 	}
 
+	/** Gets the sprite attribute and sprite pattern table base registers
+	  * (R#11, R#5 and R#6) combined in a single value.
+	  */
+	inline unsigned getSpriteTableBases() const {
+		return (controlRegs[11] << 16) | (controlRegs[5] << 8) |
+		       controlRegs[6];
+	}
+
 	/** Are commands possible in non Graphic modes? (V9958 only)
 	  * @return True iff CMD bit set.
 	  */
@@ -662,13 +677,6 @@ private:
 	  */
 	static const int LINE_COUNT_RESET_TICKS = 15 * TICKS_PER_LINE;
 
-	/** Gets the number of display lines per screen.
-	  * @return 192 or 212.
-	  */
-	inline int getNumberOfLines() const {
-		return controlRegs[9] & 0x80 ? 212 : 192;
-	}
-
 	/** Gets the value of the horizontal retrace status bit.
 	  * Note that HR flipping continues at all times, not just during
 	  * vertical display range.
@@ -718,6 +718,129 @@ using TXorOp = TransparentOp<XorOp>;
 using TNotOp = TransparentOp<NotOp>;
 
 
+// Per-line fast path for the block commands (HMMV, HMMM, YMMM and LMMM).
+//
+// The command engine is always synchronized before the CPU accesses VRAM or
+// changes a VDP register, so no other access can interleave with the
+// accesses done within a single execute call. When a complete line of a
+// command fits before the limit of such a call and no subsystem observes
+// the VRAM of that line, it doesn't matter at which exact moment each byte
+// of that line is written. Then the memory operations of the line are done
+// in one go (with memset/memmove in the non-planar modes) and only the
+// access slot timing is still followed access by access. In all other
+// cases the commands take the regular (exact) path.
+
+/** Advance the calculator over all VRAM accesses of one line of 'num'
+  * pixels (or bytes). Each pixel does one access per element of 'deltas',
+  * which holds the delay after that access. After the last access of the
+  * line 'lineDelta' is used instead, or, when this is the last line of the
+  * command, the calculator stays at that last access.
+  * @return false when the limit is reached before one of the accesses,
+  *         then the calculator is left in an undefined state.
+  */
+template<size_t N>
+static inline bool skipLine(Calculator& calc, unsigned num,
+                            const Delta (&deltas)[N], Delta lineDelta,
+                            bool lastLine)
+{
+	for (unsigned i = 1; i < num; ++i) {
+		for (auto delta : deltas) {
+			if (unlikely(calc.limitReached())) return false;
+			calc.next(delta);
+		}
+	}
+	for (size_t j = 0; j < N; ++j) {
+		if (unlikely(calc.limitReached())) return false;
+		if (j != (N - 1)) {
+			calc.next(deltas[j]);
+		} else if (!lastLine) {
+			calc.next(lineDelta);
+		}
+	}
+	return true;
+}
+
+/** Are consecutive bytes of a line also consecutive in VRAM? (Not so in the
+  * planar Graphic6 and Graphic7 modes.) */
+template<typename Mode>
+static inline bool isLinear()
+{
+	return Mode::addressOf(Mode::PIXELS_PER_BYTE, 0, false) == 1;
+}
+
+static bool lineFastPathEnabled = true;
+
+void VDPCmdEngine::setLineFastPathEnabled(bool enabled)
+{
+	lineFastPathEnabled = enabled;
+}
+
+/** Can line 'y' take the fast path: is it enabled and is no part of the
+  * line observed? A line spans one or two 128 byte blocks (per plane), the
+  * first and the last pixel are in those blocks. */
+template<typename Mode>
+static inline bool useLineFastPath(const VDPVRAM& vram, unsigned y, bool ext)
+{
+	if (!lineFastPathEnabled) return false;
+	unsigned first = Mode::addressOf(0, y, ext);
+	unsigned last  = Mode::addressOf(Mode::PIXELS_PER_LINE - 1, y, ext);
+	return !vram.isObserved(first & ~127u, 128) &&
+	       !vram.isObserved(last  & ~127u, 128);
+}
+
+/** Fill 'num' bytes of an unobserved line, starting at 'x' in direction
+  * 'tx' (in pixels, so +/- PIXELS_PER_BYTE). */
+template<typename Mode>
+static inline void fillLine(
+	VDPVRAM& vram, unsigned x, unsigned y, bool ext, int tx, unsigned num,
+	byte value, EmuTime::param time)
+{
+	if (isLinear<Mode>()) {
+		unsigned addr = Mode::addressOf(x, y, ext);
+		if (tx < 0) addr -= num - 1;
+		vram.cmdFillUnobserved(addr, num, value);
+	} else {
+		for (unsigned i = 0; i < num; ++i, x += tx) {
+			vram.cmdWrite(Mode::addressOf(x, y, ext), value, time);
+		}
+	}
+}
+
+/** Copy 'num' bytes to an unobserved line, in direction 'tx'. The result is
+  * the same as when copying byte by byte, also for overlapping lines.
+  * @return The last byte that was read from the source.
+  */
+template<typename Mode>
+static inline byte copyLine(
+	VDPVRAM& vram, unsigned sx, unsigned sy, bool srcExt,
+	unsigned dx, unsigned dy, bool dstExt, int tx, unsigned num,
+	EmuTime::param time)
+{
+	assert(num > 0);
+	byte p = 0; // dummy value to avoid warning, always overwritten
+	if (isLinear<Mode>()) {
+		unsigned src = Mode::addressOf(sx, sy, srcExt);
+		unsigned dst = Mode::addressOf(dx, dy, dstExt);
+		unsigned last = (tx > 0) ? (src + num - 1) : (src - num + 1);
+		if (tx < 0) {
+			src = last;
+			dst -= num - 1;
+		}
+		vram.cmdCopyUnobserved(dst, src, num, tx < 0);
+		// When copying byte by byte, the last source byte is read after
+		// all writes that could change it.
+		p = vram.cmdReadWindow.readNP(last);
+	} else {
+		for (unsigned i = 0; i < num; ++i, sx += tx, dx += tx) {
+			p = vram.cmdReadWindow.readNP(
+				Mode::addressOf(sx, sy, srcExt));
+			vram.cmdWrite(Mode::addressOf(dx, dy, dstExt), p, time);
+		}
+	}
+	return p;
+}
+
+
 // Commands
 
 void VDPCmdEngine::calcFinishTime(unsigned nx, unsigned ny, unsigned ticksPerPixel)
@@ -1095,6 +1218,34 @@ void VDPCmdEngine::executeLmmm(EmuTime::param limit)
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
+		if ((ASX == SX) && (ADX == DX) && (ANX == tmpNX) &&
+		    likely(doPoint && doPset) &&
+		    useLineFastPath<Mode>(vram, DY, dstExt)) {
+			// fast path, complete line
+			static const Delta deltas[] = { DELTA_32, DELTA_24, DELTA_64 };
+			auto lineCalc = calculator;
+			if (skipLine(lineCalc, tmpNX, deltas, DELTA_128,
+			             tmpNY == 1)) {
+				EmuTime time = calculator.getTime();
+				for (unsigned i = 0; i < tmpNX; ++i) {
+					tmpSrc = Mode::point(vram, ASX, SY, srcExt);
+					tmpDst = vram.cmdWriteWindow.readNP(dstAddr);
+					Mode::pset(time, vram, ADX, dstAddr,
+					           tmpDst, tmpSrc, LogOp());
+					ASX += TX; ADX += TX;
+					dstAddr = Mode::addressOf(ADX, DY, dstExt);
+				}
+				calculator = lineCalc;
+				SY += TY; DY += TY; --NY;
+				ASX = SX; ADX = DX;
+				dstAddr = Mode::addressOf(ADX, DY, dstExt);
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				goto loop;
+			}
+		}
 		tmpSrc = likely(doPoint)
 		       ? Mode::point(vram, ASX, SY, srcExt)
 		       : 0xFF;
@@ -1344,6 +1495,24 @@ void VDPCmdEngine::executeHmmv(EmuTime::param limit)
 	auto calculator = getSlotCalculator(limit);
 
 	while (!calculator.limitReached()) {
+		if ((ADX == DX) && (ANX == tmpNX) && likely(doPset) &&
+		    useLineFastPath<Mode>(vram, DY, dstExt)) {
+			// fast path, complete line
+			static const Delta deltas[] = { DELTA_48 };
+			auto lineCalc = calculator;
+			if (skipLine(lineCalc, tmpNX, deltas, DELTA_104,
+			             tmpNY == 1)) {
+				fillLine<Mode>(vram, DX, DY, dstExt, TX, tmpNX,
+				               COL, calculator.getTime());
+				calculator = lineCalc;
+				DY += TY; --NY;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				continue;
+			}
+		}
 		if (likely(doPset)) {
 			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
 			              COL, calculator.getTime());
@@ -1454,6 +1623,26 @@ void VDPCmdEngine::executeHmmm(EmuTime::param limit)
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
+		if ((ASX == SX) && (ADX == DX) && (ANX == tmpNX) &&
+		    likely(doPoint && doPset) &&
+		    useLineFastPath<Mode>(vram, DY, dstExt)) {
+			// fast path, complete line
+			static const Delta deltas[] = { DELTA_24, DELTA_64 };
+			auto lineCalc = calculator;
+			if (skipLine(lineCalc, tmpNX, deltas, DELTA_128,
+			             tmpNY == 1)) {
+				tmpSrc = copyLine<Mode>(
+					vram, SX, SY, srcExt, DX, DY, dstExt,
+					TX, tmpNX, calculator.getTime());
+				calculator = lineCalc;
+				SY += TY; DY += TY; --NY;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				goto loop;
+			}
+		}
 		tmpSrc = likely(doPoint)
 			? vram.cmdReadWindow.readNP(
 			       Mode::addressOf(ASX, SY, srcExt))
@@ -1588,6 +1777,25 @@ void VDPCmdEngine::executeYmmm(EmuTime::param limit)
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
+		if ((ADX == DX) && (ANX == tmpNX) && likely(doPset) &&
+		    useLineFastPath<Mode>(vram, DY, dstExt)) {
+			// fast path, complete line
+			static const Delta deltas[] = { DELTA_24, DELTA_40 };
+			auto lineCalc = calculator;
+			if (skipLine(lineCalc, tmpNX, deltas, DELTA_40,
+			             tmpNY == 1)) {
+				tmpSrc = copyLine<Mode>(
+					vram, DX, SY, dstExt, DX, DY, dstExt,
+					TX, tmpNX, calculator.getTime());
+				calculator = lineCalc;
+				SY += TY; DY += TY; --NY;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				goto loop;
+			}
+		}
 		if (likely(doPset)) {
 			tmpSrc = vram.cmdReadWindow.readNP(
 			       Mode::addressOf(ADX, SY, dstExt));
@@ -40,6 +40,12 @@ public:
 	}
 	void sync2(EmuTime::param time);
 
+	/** Enable or disable the per-line fast path of the block commands
+	  * (see VDPCmdEngine.cc). By default it's enabled. Both give exactly
+	  * the same results, this is only meant for testing and benchmarking.
+	  */
+	static void setLineFastPathEnabled(bool enabled);
+
 	/** Steal a VRAM access slot from the CmdEngine.
 	 * Used when the CPU reads/writes VRAM.
 	 * @param time The moment in time the CPU read/write is performed.
@@ -0,0 +1,265 @@
+// Test and micro-benchmark for the line fast path of VDPCmdEngine.
+//
+// Runs a number of VDP commands (HMMV, HMMM, YMMM and LMMM) in all bitmap
+// modes on a real VDP, while the 'CPU' keeps reading and writing VRAM in the
+// area the command is working on and polls the status registers until the
+// command is done. Every scenario is run once with the line fast path and
+// once with the per byte code (see VDPCmdEngine::setLineFastPathEnabled()),
+// both runs must give byte-for-byte the same VRAM contents and read the same
+// values. The displayed page and the sprite tables are in page 0, so lines in
+// page 1 take the fast path and the other lines don't.
+//
+// Usage: VDPCmdEngineBench [repeat]
+
+#include "VDP.hh"
+#include "VDPCmdEngine.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "Scheduler.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "EmuTime.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "Benchmark.hh"
+#include <SDL.h>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned VRAM_SIZE = 128 * 1024;
+
+static const char* const machineXML =
+	"<?xml version=\"1.0\" ?>\n"
+	"<!DOCTYPE msxconfig SYSTEM 'msxconfig2.dtd'>\n"
+	"<msxconfig>\n"
+	"  <info><type>MSX2+</type></info>\n"
+	"  <devices>\n"
+	"    <VDP id=\"VDP\">\n"
+	"      <version>V9958</version>\n"
+	"      <vram>128</vram>\n"
+	"      <io base=\"0x98\" num=\"4\"/>\n"
+	"    </VDP>\n"
+	"  </devices>\n"
+	"</msxconfig>\n";
+
+struct Mode {
+	const char* name;
+	byte r0;
+	unsigned width;  // in pixels
+	unsigned height; // number of lines reachable by the commands
+};
+static const Mode modes[] = {
+	{ "G4", 0x06, 256, 1024 },
+	{ "G5", 0x08, 512, 1024 },
+	{ "G6", 0x0A, 512,  512 },
+	{ "G7", 0x0E, 256,  512 },
+};
+
+struct VdpCommand {
+	const char* name;
+	byte cmd;
+	byte arg;
+};
+static const VdpCommand commands[] = {
+	{ "HMMV",              0xC0, 0x00 },
+	{ "HMMM",              0xD0, 0x00 },
+	{ "HMMM backwards",    0xD0, 0x0C }, // DIX and DIY
+	{ "YMMM",              0xE0, 0x00 },
+	{ "YMMM backwards",    0xE0, 0x08 }, // DIY
+	{ "LMMM TIMP",         0x98, 0x00 },
+	{ "LMMM XOR backwards",0x93, 0x0C },
+};
+
+// Drives the I/O ports of the VDP like a Z80 would, running the scheduler up
+// to each access.
+class Driver
+{
+public:
+	Driver(MSXMotherBoard& board_, VDP& vdp_)
+		: board(board_), vdp(vdp_), time(board.getCurrentTime()) {}
+
+	void write(word port, byte value, unsigned cycles = 12)
+	{
+		sync();
+		vdp.writeIO(port, value, time);
+		time += EmuDuration::hz(3579545) * cycles;
+	}
+	byte read(word port, unsigned cycles = 12)
+	{
+		sync();
+		byte result = vdp.readIO(port, time);
+		time += EmuDuration::hz(3579545) * cycles;
+		return result;
+	}
+
+	void setReg(byte reg, byte value)
+	{
+		write(1, value);
+		write(1, 0x80 | reg);
+	}
+	void setVramAddr(unsigned addr, bool forWrite)
+	{
+		setReg(14, addr >> 14);
+		write(1, addr & 0xFF);
+		write(1, ((addr >> 8) & 0x3F) | (forWrite ? 0x40 : 0x00));
+	}
+	byte readStatus(byte reg)
+	{
+		setReg(15, reg);
+		return read(1);
+	}
+	void startCommand(unsigned sx, unsigned sy, unsigned dx, unsigned dy,
+	                  unsigned nx, unsigned ny, byte clr, byte arg, byte cmd)
+	{
+		setReg(17, 32); // indirect register writes with auto-increment
+		for (unsigned v : { sx, sy, dx, dy, nx, ny }) {
+			write(3, v & 0xFF);
+			write(3, v >> 8);
+		}
+		write(3, clr);
+		write(3, arg);
+		write(3, cmd);
+	}
+	void wait(unsigned cycles)
+	{
+		time += EmuDuration::hz(3579545) * cycles;
+	}
+
+private:
+	void sync()
+	{
+		board.getScheduler().schedule(time);
+	}
+
+	MSXMotherBoard& board;
+	VDP& vdp;
+	EmuTime time;
+};
+
+struct Result {
+	vector<byte> vram;
+	vector<byte> reads;
+	double duration; // of the commands only, in microseconds
+};
+
+static Result runScenario(Reactor& reactor, const string& machine,
+                          const Mode& mode, const VdpCommand& command,
+                          unsigned seed)
+{
+	auto board = reactor.createEmptyMotherBoard();
+	board->loadMachine(machine);
+	board->powerUp();
+	auto& vdp = *dynamic_cast<VDP*>(board->findDevice("VDP"));
+	Driver drv(*board, vdp);
+	mt19937 random(seed);
+
+	drv.setReg(0, mode.r0);
+	drv.setReg(1, 0x40); // display enabled
+	drv.setReg(8, 0x08); // 64K chips, sprites enabled
+	drv.setReg(2, 0x1F); // display page 0
+	drv.setReg(5, 0xEF); // sprite tables in page 0
+	drv.setReg(11, 0x00);
+	drv.setReg(6, 0x0F);
+
+	drv.setVramAddr(0, true);
+	for (unsigned i = 0; i < VRAM_SIZE; ++i) {
+		drv.write(0, random(), 0); // timing doesn't matter here
+	}
+
+	Result result;
+	result.duration = 0.0;
+	for (unsigned n = 0; n < 16; ++n) {
+		// Areas that are often partly in the displayed page and partly
+		// in the hidden page, and that overlap each other.
+		unsigned nx = 1 + random() % mode.width;
+		unsigned ny = 1 + random() % 64;
+		unsigned sx = random() % mode.width;
+		unsigned dx = random() % mode.width;
+		unsigned sy = (192 + random() % 128) % mode.height;
+		unsigned dy = (sy + random() % 32) % mode.height;
+		byte clr = random();
+
+		result.duration += Benchmark::time([&] {
+			drv.startCommand(sx, sy, dx, dy, nx, ny, clr,
+			                 command.arg, command.cmd);
+			while (drv.readStatus(2) & 0x01) { // CE
+				unsigned addr = (dy * mode.width / 2 + random() % 0x2000)
+				              % VRAM_SIZE;
+				if (random() & 1) {
+					drv.setVramAddr(addr, true);
+					drv.write(0, random());
+				} else {
+					drv.setVramAddr(addr, false);
+					result.reads.push_back(drv.read(0));
+				}
+				drv.wait(random() % 256);
+			}
+		});
+		result.reads.push_back(drv.readStatus(2));
+	}
+
+	auto& debuggable = *board->getDebugger().findDebuggable("physical VRAM");
+	result.vram.resize(VRAM_SIZE);
+	for (unsigned i = 0; i < VRAM_SIZE; ++i) {
+		result.vram[i] = debuggable.read(i);
+	}
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = Benchmark::getCount(argc, argv, 1, 3);
+	Benchmark::Checker checker;
+	string machine = FileOperations::join(
+		FileOperations::getTempDir(), "VDPCmdEngineBench");
+	try {
+		SDL_Init(SDL_INIT_NOPARACHUTE);
+		Reactor reactor;
+		reactor.init();
+		{
+			ofstream out(machine + ".xml");
+			out << machineXML;
+		}
+		unsigned seed = 0;
+		for (auto& mode : modes) {
+			for (auto& command : commands) {
+				++seed;
+				double fast = 0.0;
+				double slow = 0.0;
+				for (unsigned i = 0; i < repeat; ++i) {
+					VDPCmdEngine::setLineFastPathEnabled(true);
+					auto r1 = runScenario(reactor, machine, mode, command, seed);
+					VDPCmdEngine::setLineFastPathEnabled(false);
+					auto r2 = runScenario(reactor, machine, mode, command, seed);
+					bool same = (r1.vram == r2.vram) &&
+					            (r1.reads == r2.reads);
+					if (!same) {
+						cout << "MISMATCH: " << mode.name << ' '
+						     << command.name << endl;
+					}
+					checker.check(same);
+					fast += r1.duration;
+					slow += r2.duration;
+				}
+				cout << mode.name << ' ' << command.name
+				     << ": per byte " << slow / repeat
+				     << "us, fast path " << fast / repeat
+				     << "us" << endl;
+			}
+		}
+		VDPCmdEngine::setLineFastPathEnabled(true);
+	} catch (MSXException& e) {
+		cerr << "Error: " << e.getMessage() << endl;
+		FileOperations::unlink(machine + ".xml");
+		return 1;
+	}
+	FileOperations::unlink(machine + ".xml");
+	return checker.exitCode("fast path differs from per byte path");
+}
@@ -238,6 +238,15 @@ void VDPVRAM::setRenderer(Renderer* newRenderer, EmuTime::param time)
 	bitmapVisibleWindow.setObserver(renderer);
 }
 
+bool VDPVRAM::isObserved(unsigned address, unsigned size) const
+{
+	address &= sizeMask;
+	return (bitmapVisibleWindow.isInside(address, size) &&
+	        renderer->isVRAMObserved(address, size)) ||
+	       spriteAttribTable  .isInside(address, size) ||
+	       spritePatternTable .isInside(address, size);
+}
+
 void VDPVRAM::change4k8kMapping(bool mapping8k)
 {
 	/* Sources:
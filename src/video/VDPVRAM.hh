@@ -10,6 +10,7 @@
 #include "openmsx.hh"
 #include "likely.hh"
 #include <cassert>
+#include <cstring>
 
 namespace openmsx {
 
@@ -297,6 +298,17 @@ public:
 		return (address & combiMask) == unsigned(baseAddr);
 	}
 
+	/** Test whether any address of a block is inside this window.
+	  * @param address Start of the block, must be a multiple of 'size'.
+	  * @param size Size of the block, must be a power of two.
+	  * @return true iff at least one address of the block is inside this
+	  *         window.
+	  */
+	inline bool isInside(unsigned address, unsigned size) const {
+		unsigned mask = combiMask & ~(size - 1);
+		return (address & mask) == (unsigned(baseAddr) & ~(size - 1));
+	}
+
 	/** Notifies the observer of this window of a VRAM change,
 	  * if the changes address is inside this window.
 	  * @param address The address to test.
@@ -428,6 +440,55 @@ public:
 		writeCommon(address, value, time);
 	}
 
+	/** Is any subsystem interested in changes to the given block of VRAM?
+	  * For unobserved blocks the command engine may skip the per-byte
+	  * bookkeeping of cmdWrite(), see cmdFillUnobserved() and
+	  * cmdCopyUnobserved().
+	  * bitmapVisibleWindow covers all of VRAM, so the renderer (its
+	  * observer) is asked which part of it it actually looks at.
+	  * @param address Start of the block, must be a multiple of 'size'.
+	  * @param size Size of the block, a power of two, at most 256.
+	  */
+	bool isObserved(unsigned address, unsigned size) const;
+
+	/** Fill 'num' bytes with the same value from the command engine.
+	  * Has the same effect as the corresponding cmdWrite() calls, but the
+	  * bytes must be part of an unobserved block (see isObserved()), so
+	  * there is no time parameter.
+	  */
+	inline void cmdFillUnobserved(unsigned address, unsigned num, byte value) {
+		address &= sizeMask;
+		if (unlikely(address >= actualSize)) return; // see cmdWrite()
+		memset(&data[address], value, num);
+	}
+
+	/** Copy 'num' bytes within VRAM from the command engine. Same as
+	  * cmdFillUnobserved(), but the result is the same as copying byte
+	  * per byte, in ascending or (when 'descending' is set) descending
+	  * address order. 'dst' and 'src' are the lowest addresses of the
+	  * blocks, the source address is handled like cmdReadWindow.readNP()
+	  * does.
+	  */
+	inline void cmdCopyUnobserved(unsigned dst, unsigned src, unsigned num,
+	                              bool descending) {
+		dst &= sizeMask;
+		if (unlikely(dst >= actualSize)) return; // see cmdWrite()
+		src &= sizeMask;
+		// memmove() gives the same result, unless a byte that still has
+		// to be read gets overwritten first.
+		if (!descending && (src < dst) && (dst < (src + num))) {
+			for (unsigned i = 0; i < num; ++i) {
+				data[dst + i] = data[src + i];
+			}
+		} else if (descending && (dst < src) && (src < (dst + num))) {
+			for (unsigned i = num; i-- > 0; ) {
+				data[dst + i] = data[src + i];
+			}
+		} else {
+			memmove(&data[dst], &data[src], num);
+		}
+	}
+
 	/** Write a byte to VRAM through the CPU interface.
 	  * @param address The address to write.
 	  * @param value The value to write.
@@ -22,6 +22,9 @@ static const unsigned BLOCK_WIDTH  = MAX_VECTOR;
 static const unsigned BLOCK_HEIGHT = MAX_VECTOR;
 static const unsigned FLAG_KEYFRAME = 0x01;
 
+// The motion vector search is done in (at most) this many threads in parallel.
+static const unsigned MAX_SEARCH_THREADS = 4;
+
 struct CodecVector {
 	float cost() const {
 		float c = sqrtf(float(x * x + y * y));
@@ -118,7 +121,8 @@ static void createVectorTable()
 }
 
 ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_, unsigned bpp)
-	: width(width_)
+	: searchPool(WorkerPool::workersForCores(MAX_SEARCH_THREADS))
+	, width(width_)
 	, height(height_)
 {
 	setupBuffers(bpp);
@@ -166,7 +170,7 @@ void ZMBVEncoder::setupBuffers(unsigned bpp)
 	}
 
 	pitch = width + 2 * MAX_VECTOR;
-	unsigned bufsize = (height + 2 * MAX_VECTOR) * pitch * pixelSize + 2048;
+	bufsize = (height + 2 * MAX_VECTOR) * pitch * pixelSize + 2048;
 
 	oldframe.resize(bufsize);
 	newframe.resize(bufsize);
@@ -181,6 +185,7 @@ void ZMBVEncoder::setupBuffers(unsigned bpp)
 	unsigned xblocks = width / BLOCK_WIDTH;
 	unsigned yblocks = height / BLOCK_HEIGHT;
 	blockOffsets.resize(xblocks * yblocks);
+	rowWorkUsed.resize(yblocks);
 	for (unsigned y = 0; y < yblocks; ++y) {
 		for (unsigned x = 0; x < xblocks; ++x) {
 			blockOffsets[y * xblocks + x] =
@@ -231,7 +236,8 @@ unsigned ZMBVEncoder::compareBlock(int vx, int vy, unsigned offset)
 
 template<class P>
 void ZMBVEncoder::addXorBlock(
-	const PixelOperations<P>& pixelOps, int vx, int vy, unsigned offset, unsigned& workUsed)
+	const PixelOperations<P>& pixelOps, int vx, int vy, unsigned offset,
+	uint8_t* dest, unsigned& used)
 {
 	using LE_P = typename Endian::Little<P>::type;
 
@@ -240,31 +246,46 @@ void ZMBVEncoder::addXorBlock(
 	for (unsigned y = 0; y < BLOCK_HEIGHT; ++y) {
 		for (unsigned x = 0; x < BLOCK_WIDTH; ++x) {
 			P pxor = pnew[x] ^ pold[x];
-			writePixel(pixelOps, pxor, *reinterpret_cast<LE_P*>(&work[workUsed]));
-			workUsed += sizeof(P);
+			writePixel(pixelOps, pxor, *reinterpret_cast<LE_P*>(&dest[used]));
+			used += sizeof(P);
 		}
 		pold += pitch;
 		pnew += pitch;
 	}
 }
 
+// Search the motion vectors for one row of blocks, the xor data of the
+// changed blocks is written to 'dest'. Returns the number of bytes written.
+// Different rows can be handled in parallel.
 template<class P>
-void ZMBVEncoder::addXorFrame(const SDL_PixelFormat& pixelFormat, unsigned& workUsed)
+unsigned ZMBVEncoder::addXorRow(
+	const PixelOperations<P>& pixelOps, unsigned row,
+	int8_t* vectors, uint8_t* dest)
 {
-	PixelOperations<P> pixelOps(pixelFormat);
-	auto* vectors = reinterpret_cast<int8_t*>(&work[workUsed]);
-
 	unsigned xblocks = width / BLOCK_WIDTH;
-	unsigned yblocks = height / BLOCK_HEIGHT;
-	unsigned blockcount = xblocks * yblocks;
-
-	// Align the following xor data on 4 byte boundary
-	workUsed = (workUsed + blockcount * 2 + 3) & ~3;
+	const unsigned* offsets = &blockOffsets[row * xblocks];
+	vectors += row * xblocks * 2;
+
+	// If the row is the same as in the previous frame there's no need to
+	// search for motion vectors.
+	unsigned linePitch = pitch * sizeof(P);
+	const uint8_t* pold = &oldframe[offsets[0] * sizeof(P)];
+	const uint8_t* pnew = &newframe[offsets[0] * sizeof(P)];
+	bool changed = false;
+	for (unsigned y = 0; !changed && (y < BLOCK_HEIGHT); ++y) {
+		changed = memcmp(pold + y * linePitch, pnew + y * linePitch,
+		                 width * sizeof(P)) != 0;
+	}
+	if (!changed) {
+		memset(vectors, 0, xblocks * 2);
+		return 0;
+	}
 
+	unsigned used = 0;
 	int bestvx = 0;
 	int bestvy = 0;
-	for (unsigned b = 0; b < blockcount; ++b) {
-		unsigned offset = blockOffsets[b];
+	for (unsigned b = 0; b < xblocks; ++b) {
+		unsigned offset = offsets[b];
 		// first try best vector of previous block
 		unsigned bestchange = compareBlock<P>(bestvx, bestvy, offset);
 		if (bestchange >= 4) {
@@ -287,9 +308,43 @@ void ZMBVEncoder::addXorFrame(const SDL_PixelFormat& pixelFormat, unsigned& work
 		vectors[b * 2 + 1] = (bestvy << 1);
 		if (bestchange) {
 			vectors[b * 2 + 0] |= 1;
-			addXorBlock<P>(pixelOps, bestvx, bestvy, offset, workUsed);
+			addXorBlock<P>(pixelOps, bestvx, bestvy, offset, dest, used);
 		}
 	}
+	return used;
+}
+
+template<class P>
+void ZMBVEncoder::addXorFrame(const SDL_PixelFormat& pixelFormat, unsigned& workUsed)
+{
+	PixelOperations<P> pixelOps(pixelFormat);
+	auto* vectors = reinterpret_cast<int8_t*>(&work[workUsed]);
+
+	unsigned xblocks = width / BLOCK_WIDTH;
+	unsigned yblocks = height / BLOCK_HEIGHT;
+	unsigned blockcount = xblocks * yblocks;
+
+	// Align the following xor data on 4 byte boundary
+	workUsed = (workUsed + blockcount * 2 + 3) & ~3;
+
+	// Each row of blocks writes its xor data to its own (worst case sized)
+	// part of the work buffer. Afterwards these parts are moved together.
+	// Because a row doesn't start from the best vector of the previous
+	// row, the result is not identical to a serial search, but it doesn't
+	// depend on the number of threads.
+	unsigned rowSize = xblocks * BLOCK_WIDTH * BLOCK_HEIGHT * sizeof(P);
+	uint8_t* rowWork = &work[workUsed];
+	searchPool.parallelFor(yblocks, [&](unsigned row) {
+		rowWorkUsed[row] = addXorRow<P>(
+			pixelOps, row, vectors, rowWork + row * rowSize);
+	});
+	for (unsigned row = 0; row < yblocks; ++row) {
+		unsigned used = rowWorkUsed[row];
+		uint8_t* src = rowWork + row * rowSize;
+		uint8_t* dst = &work[workUsed];
+		if (used && (src != dst)) memmove(dst, src, used);
+		workUsed += used;
+	}
 }
 
 template<class P>
@@ -311,7 +366,7 @@ void ZMBVEncoder::addFullFrame(const SDL_PixelFormat& pixelFormat, unsigned& wor
 	}
 }
 
-const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf_)
+const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf_) const
 {
 #if HAVE_32BPP
 	if (pixelSize == 4) { // 32bpp
@@ -347,10 +402,39 @@ const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf
 	return nullptr; // avoid warning
 }
 
+void ZMBVEncoder::copyFrame(FrameSource* frame, Frame& dest) const
+{
+	if (dest.pixels.empty()) {
+		dest.pixels.resize(bufsize);
+		memset(dest.pixels.data(), 0, bufsize); // black border
+	}
+	dest.pixelFormat = frame->getSDLPixelFormat();
+
+	// copy lines (to add black border)
+	unsigned linePitch = pitch * pixelSize;
+	unsigned lineWidth = width * pixelSize;
+	uint8_t* d = &dest.pixels[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
+	for (unsigned i = 0; i < height; ++i) {
+		auto* scaled = getScaledLine(frame, i, d);
+		if (scaled != d) memcpy(d, scaled, lineWidth);
+		d += linePitch;
+	}
+}
+
 void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
                                 void*& buffer, unsigned& written)
 {
+	copyFrame(frame, scratchFrame);
+	compressFrame(keyFrame, scratchFrame, buffer, written);
+}
+
+void ZMBVEncoder::compressFrame(bool keyFrame, Frame& frame,
+                                void*& buffer, unsigned& written)
+{
+	assert(!frame.pixels.empty());
 	std::swap(newframe, oldframe); // replace oldframe with newframe
+	newframe.swap(frame.pixels);   // and newframe with the given frame
+	const SDL_PixelFormat& pixelFormat = frame.pixelFormat;
 
 	// Reset the work buffer
 	unsigned workUsed = 0;
@@ -372,29 +456,18 @@ void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
 		deflateReset(&zstream); // restart deflate
 	}
 
-	// copy lines (to add black border)
-	unsigned linePitch = pitch * pixelSize;
-	unsigned lineWidth = width * pixelSize;
-	uint8_t* dest =
-		&newframe[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
-	for (unsigned i = 0; i < height; ++i) {
-		auto* scaled = getScaledLine(frame, i, dest);
-		if (scaled != dest) memcpy(dest, scaled, lineWidth);
-		dest += linePitch;
-	}
-
 	// Add the frame data.
 	if (keyFrame) {
 		// Key frame: full frame data.
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addFullFrame<uint16_t>(frame->getSDLPixelFormat(), workUsed);
+			addFullFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addFullFrame<uint32_t>(frame->getSDLPixelFormat(), workUsed);
+			addFullFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
@@ -405,12 +478,12 @@ void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addXorFrame<uint16_t>(frame->getSDLPixelFormat(), workUsed);
+			addXorFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addXorFrame<uint32_t>(frame->getSDLPixelFormat(), workUsed);
+			addXorFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
@@ -4,11 +4,11 @@
 #define ZMBVENCODER_HH
 
 #include "MemBuffer.hh"
+#include "WorkerPool.hh"
+#include <SDL.h>
 #include <cstdint>
 #include <zlib.h>
 
-struct SDL_PixelFormat;
-
 namespace openmsx {
 
 class FrameSource;
@@ -19,8 +19,32 @@ class ZMBVEncoder
 public:
 	static const char* CODEC_4CC;
 
+	/** A copy of an input frame, see copyFrame(). */
+	struct Frame {
+		MemBuffer<uint8_t, SSE2_ALIGNMENT> pixels; // including border
+		// A copy, the FrameSource may be gone (or changed) by the time
+		// the frame gets compressed.
+		SDL_PixelFormat pixelFormat;
+	};
+
 	ZMBVEncoder(unsigned width, unsigned height, unsigned bpp);
 
+	/** Copy (and scale) the given frame into 'dest'. This is the only
+	  * step that accesses the FrameSource, so the actual compression can
+	  * be done later, possibly in another thread. This method does not
+	  * touch the encoder state, it may run concurrently with
+	  * compressFrame(Frame&, ...).
+	  */
+	void copyFrame(FrameSource* frame, Frame& dest) const;
+
+	/** Compress a frame that was copied with copyFrame(). The pixel
+	  * buffer of 'frame' is taken over by the encoder, in return 'frame'
+	  * gets an older buffer that can be reused for a next copyFrame().
+	  */
+	void compressFrame(bool keyFrame, Frame& frame,
+	                   void*& buffer, unsigned& written);
+
+	/** Shortcut for copyFrame() followed by compressFrame(). */
 	void compressFrame(bool keyFrame, FrameSource* frame,
 	                   void*& buffer, unsigned& written);
 
@@ -34,20 +58,28 @@ private:
 	unsigned neededSize();
 	template<class P> void addFullFrame(const SDL_PixelFormat& pixelFormat, unsigned& workUsed);
 	template<class P> void addXorFrame (const SDL_PixelFormat& pixelFormat, unsigned& workUsed);
+	template<class P> unsigned addXorRow(
+		const PixelOperations<P>& pixelOps, unsigned row,
+		int8_t* vectors, uint8_t* dest);
 	template<class P> unsigned possibleBlock(int vx, int vy, unsigned offset);
 	template<class P> unsigned compareBlock(int vx, int vy, unsigned offset);
 	template<class P> void addXorBlock(
 		const PixelOperations<P>& pixelOps, int vx, int vy,
-		unsigned offset, unsigned& workUsed);
-	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf);
+		unsigned offset, uint8_t* dest, unsigned& used);
+	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf) const;
 
+	Frame scratchFrame; // only used by compressFrame(bool, FrameSource*, ...)
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> oldframe;
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> newframe;
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> work;
 	MemBuffer<uint8_t> output;
 	MemBuffer<unsigned> blockOffsets;
+	MemBuffer<unsigned> rowWorkUsed; // per row of blocks, see addXorFrame()
+	unsigned bufsize;
 	unsigned outputSize;
 
+	WorkerPool searchPool;
+
 	z_stream zstream;
 
 	const unsigned width;
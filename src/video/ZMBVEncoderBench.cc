@@ -0,0 +1,134 @@
+// Micro-benchmark for ZMBVEncoder.
+//
+// Encodes a sequence of 320x240 32bpp frames (a key frame every 300 frames,
+// like AviWriter does), at normal size and scaled to 960x720 (like
+// 'record start -triplesize'), for two typical kinds of MSX screens:
+//  - a static BASIC screen: only the blinking cursor changes,
+//  - a scrolling game: the whole playfield scrolls one pixel per frame,
+//    only a status bar at the bottom stays the same.
+// Reports the time per frame and the size of the compressed data.
+//
+// Usage: ZMBVEncoderBench [frames]
+
+#include "ZMBVEncoder.hh"
+#include "RawFrame.hh"
+#include "Benchmark.hh"
+#include <SDL.h>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned WIDTH = 320;
+static const unsigned HEIGHT = 240;
+
+// Border, text area and cursor color of the MSX BASIC screen.
+static const uint32_t BLUE  = 0x5455ED;
+static const uint32_t WHITE = 0xFFFFFF;
+
+static void drawBasicScreen(RawFrame& frame, const vector<uint8_t>& font,
+                            unsigned frameNum)
+{
+	bool cursor = (frameNum / 15) & 1; // toggles every 15 frames
+	for (unsigned y = 0; y < HEIGHT; ++y) {
+		auto* line = frame.getLinePtrDirect<uint32_t>(y);
+		for (unsigned x = 0; x < WIDTH; ++x) line[x] = BLUE;
+		if ((y < 24) || (y >= 24 + 192)) continue; // border
+		unsigned row = (y - 24) / 8;
+		if (row >= 12) continue; // lower half of the screen is empty
+		for (unsigned col = 0; col < 40; ++col) {
+			uint8_t pattern = font[(row * 40 + col) * 8 + (y & 7)];
+			if (cursor && (row == 11) && (col == 0)) {
+				pattern = ~pattern;
+			}
+			for (unsigned i = 0; i < 6; ++i) {
+				if (pattern & (0x80 >> i)) {
+					line[16 + col * 6 + i] = WHITE;
+				}
+			}
+		}
+		frame.setLineWidth(y, WIDTH);
+	}
+}
+
+static void drawScrollingGame(RawFrame& frame,
+                              const vector<uint32_t>& background,
+                              unsigned frameNum)
+{
+	for (unsigned y = 0; y < HEIGHT; ++y) {
+		auto* line = frame.getLinePtrDirect<uint32_t>(y);
+		if ((y < 24) || (y >= 24 + 192)) {
+			for (unsigned x = 0; x < WIDTH; ++x) line[x] = 0;
+		} else if (y >= 24 + 160) {
+			// status bar
+			for (unsigned x = 0; x < WIDTH; ++x) {
+				line[x] = background[(y * 1024) + x];
+			}
+		} else {
+			for (unsigned x = 0; x < WIDTH; ++x) {
+				line[x] = background[(y * 1024) +
+				                     ((x + frameNum) & 1023)];
+			}
+		}
+		frame.setLineWidth(y, WIDTH);
+	}
+}
+
+template<typename DrawFunc>
+static void measure(const char* name, unsigned numFrames, unsigned scale,
+                    DrawFunc draw)
+{
+	SDL_PixelFormat format = {};
+	format.BitsPerPixel = 32;
+	format.BytesPerPixel = 4;
+	format.Rmask = 0xFF0000; format.Rshift = 16;
+	format.Gmask = 0x00FF00; format.Gshift =  8;
+	format.Bmask = 0x0000FF; format.Bshift =  0;
+	RawFrame frame(format, WIDTH, HEIGHT);
+	ZMBVEncoder encoder(WIDTH * scale, HEIGHT * scale, 32);
+
+	double total = 0.0;
+	size_t bytes = 0;
+	for (unsigned i = 0; i < numFrames; ++i) {
+		draw(frame, i);
+		void* buffer;
+		unsigned size;
+		total += Benchmark::time([&]() {
+			encoder.compressFrame((i % 300) == 0, &frame, buffer, size);
+		});
+		bytes += size;
+	}
+	cout << name << ' ' << scale << "x  " << total / numFrames << " us/frame, "
+	     << bytes / numFrames << " bytes/frame" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned numFrames = Benchmark::getCount(argc, argv, 1, 3000);
+
+	mt19937 gen(12345);
+	uniform_int_distribution<unsigned> dist;
+	vector<uint8_t> font(12 * 40 * 8);
+	for (auto& f : font) f = dist(gen) & 0xFC;
+	vector<uint32_t> background(HEIGHT * 1024);
+	for (unsigned i = 0; i < background.size(); i += 8) {
+		// 8 pixels wide tiles with a few different colors
+		uint32_t color = dist(gen) & 0xC0C0C0;
+		for (unsigned j = 0; j < 8; ++j) background[i + j] = color;
+	}
+
+	cout << "Encoding " << numFrames << " frames of "
+	     << WIDTH << 'x' << HEIGHT << " pixels" << endl;
+	for (unsigned scale : {1, 3}) {
+		measure("static BASIC screen", numFrames, scale,
+		        [&](RawFrame& frame, unsigned i) {
+				drawBasicScreen(frame, font, i); });
+		measure("scrolling game     ", numFrames, scale,
+		        [&](RawFrame& frame, unsigned i) {
+				drawScrollingGame(frame, background, i); });
+	}
+	return 0;
+}
@@ -27,7 +27,11 @@ void SaI2xScaler<Pixel>::scaleBlank1to2(
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY)
 {
 	unsigned dstHeight = dst.getHeight();
-	unsigned stopDstY = (dstEndY == dstHeight)
+	// The last blank line is interpolated with the next (non-blank)
+	// line, unless the area ends at the bottom of the screen or in the
+	// middle of a blank area (possible when scaling in parts).
+	unsigned stopDstY = ((dstEndY == dstHeight) ||
+	                     (src.getLineWidth(srcEndY) == 1))
 	                  ? dstEndY : dstEndY - 2;
 	unsigned srcY = srcStartY, dstY = dstStartY;
 	for (/* */; dstY < stopDstY; srcY += 1, dstY += 2) {
@@ -35,7 +39,7 @@ void SaI2xScaler<Pixel>::scaleBlank1to2(
 		dst.fillLine(dstY + 0, color);
 		dst.fillLine(dstY + 1, color);
 	}
-	if (dstY != dstHeight) {
+	if (dstY != dstEndY) {
 		unsigned nextLineWidth = src.getLineWidth(srcY + 1);
 		assert(src.getLineWidth(srcY) == 1);
 		assert(nextLineWidth != 1);
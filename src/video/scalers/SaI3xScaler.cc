@@ -27,7 +27,11 @@ void SaI3xScaler<Pixel>::scaleBlank1to3(
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY)
 {
 	unsigned dstHeight = dst.getHeight();
-	unsigned stopDstY = (dstEndY == dstHeight)
+	// The last blank line is interpolated with the next (non-blank)
+	// line, unless the area ends at the bottom of the screen or in the
+	// middle of a blank area (possible when scaling in parts).
+	unsigned stopDstY = ((dstEndY == dstHeight) ||
+	                     (src.getLineWidth(srcEndY) == 1))
 	                  ? dstEndY : dstEndY - 3;
 	unsigned srcY = srcStartY, dstY = dstStartY;
 	for (/* */; dstY < stopDstY; srcY += 1, dstY += 3) {
@@ -36,7 +40,7 @@ void SaI3xScaler<Pixel>::scaleBlank1to3(
 			dst.fillLine(dstY + i, color);
 		}
 	}
-	if (dstY != dstHeight) {
+	if (dstY != dstEndY) {
 		unsigned nextLineWidth = src.getLineWidth(srcY + 1);
 		assert(src.getLineWidth(srcY) == 1);
 		assert(nextLineWidth != 1);
@@ -30,6 +30,14 @@ public:
 	virtual void scaleImage(FrameSource& src, const RawFrame* superImpose,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) = 0;
+
+	/** Does scaling an area in several (horizontal) parts give the same
+	  * result as scaling it as a whole? Then the parts can be scaled in
+	  * parallel (each with its own Scaler object). This is the case for
+	  * scalers that only look at a fixed number of neighbour lines, those
+	  * are fetched from 'src', so they can lie outside the scaled area.
+	  */
+	virtual bool canScaleInParts() const { return true; }
 };
 
 } // namespace openmsx
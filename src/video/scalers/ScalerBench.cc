@@ -0,0 +1,671 @@
+// Benchmark and regression test for the software scalers.
+//
+// Feeds a set of MSX screens through every scaler that ScalerFactory can
+// create (each scale factor and scale algorithm), both at 16bpp and at 32bpp,
+// with the same code as FBPostProcessor. Reports the time per output pixel and
+// compares a checksum of the output against golden checksums. So it can be
+// used to validate (and measure) optimized versions of the scalers without
+// running the emulator.
+//
+// The screens are read from recordings made with 'record start -raw' (see
+// RawFrameWriter), so a corpus of real screens is easily captured. Without
+// recordings a few built-in synthetic screens are used: a text mode screen
+// (in 512 pixels wide mode), a tile based game screen with a status bar in a
+// different width, and a bitmap screen with many colors. The checksums for
+// those are in 'builtinGolden' below and are checked by default. For the
+// scalers that can scale in parts, it also checks that scaling the screen in
+// horizontal bands (each with its own scaler, like FBPostProcessor does on a
+// multi-core host) gives exactly the same output as scaling it in one go.
+//
+// Usage: ScalerBench [-n repeat] [-frames n] [-golden file [-update]]
+//                    [-dump dir] [recording.omr ...]
+//   -n       number of times each screen is scaled for the timing (10)
+//   -frames  number of frames used from each recording, evenly spread (8)
+//   -golden  compare the checksums with the ones in this file instead of
+//            the built-in ones, or with -update (re)create that file
+//   -dump    also write the output of each scaler as PNG files in 'dir'
+// The exit code is non-zero when there's a mismatch with a golden checksum.
+//
+// The scalers need the real RenderSettings, so this creates a Reactor (but no
+// machine).
+
+#include "Reactor.hh"
+#include "CommandController.hh"
+#include "RenderSettings.hh"
+#include "ScalerFactory.hh"
+#include "Scaler.hh"
+#include "ScalerOutput.hh"
+#include "FBPostProcessor.hh"
+#include "PixelOperations.hh"
+#include "RawFrame.hh"
+#include "PNG.hh"
+#include "Math.hh"
+#include "MSXException.hh"
+#include "sha1.hh"
+#include "build-info.hh"
+#include "Benchmark.hh"
+#include <SDL.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned MAX_WIDTH = 1280;
+// Number of bands to compare against scaling in one go.
+static const unsigned NUM_BANDS = 4;
+
+// A screen in a format independent of the host pixel format: per line the
+// width and the pixels as 0x00RRGGBB.
+struct Screen {
+	string name;
+	vector<vector<uint32_t>> lines;
+};
+
+static SDL_PixelFormat makeFormat(unsigned bpp)
+{
+	SDL_PixelFormat format = {};
+	format.BitsPerPixel = bpp;
+	format.BytesPerPixel = bpp / 8;
+	if (bpp == 32) {
+		format.Rmask = 0xFF0000; format.Rshift = 16; format.Rloss = 0;
+		format.Gmask = 0x00FF00; format.Gshift =  8; format.Gloss = 0;
+		format.Bmask = 0x0000FF; format.Bshift =  0; format.Bloss = 0;
+	} else {
+		format.Rmask = 0xF800; format.Rshift = 11; format.Rloss = 3;
+		format.Gmask = 0x07E0; format.Gshift =  5; format.Gloss = 2;
+		format.Bmask = 0x001F; format.Bshift =  0; format.Bloss = 3;
+	}
+	format.Aloss = 8;
+	return format;
+}
+
+template<typename Pixel> static Pixel fromRGB(uint32_t rgb)
+{
+	if (sizeof(Pixel) == 4) return rgb;
+	return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+}
+
+
+// Built-in screens. Like the rasterizer renders them, the lines include the
+// left and right border: 320 pixels wide for 256 pixels wide modes, 640 for
+// 512 pixels wide modes. These use the raw output of mt19937 (and no
+// distribution), so they're the same with every standard library.
+
+static Screen makeTextScreen(mt19937& gen)
+{
+	// Text mode with 80 columns: border, 24 rows of 6x8 characters.
+	const uint32_t border = 0x2020E0, bg = 0x5455ED, fg = 0xFFFFFF;
+	Screen screen;
+	screen.name = "builtin:text80";
+	for (unsigned y = 0; y < 240; ++y) {
+		if ((y < 24) || (y >= 24 + 192)) {
+			screen.lines.push_back({border});
+			continue;
+		}
+		vector<uint32_t> line(640, border);
+		for (unsigned x = 64 + 16; x < 640 - 64 - 16; ++x) line[x] = bg;
+		bool empty = ((y - 24) / 8) >= 20; // lower part is empty
+		for (unsigned col = 0; !empty && (col < 80); ++col) {
+			unsigned pattern = ((y & 7) == 7) ? 0 : (gen() & 0xFC);
+			for (unsigned i = 0; i < 6; ++i) {
+				if (pattern & (0x80 >> i)) line[80 + col * 6 + i] = fg;
+			}
+		}
+		screen.lines.push_back(line);
+	}
+	return screen;
+}
+
+static Screen makeGameScreen(mt19937& gen)
+{
+	// 256 pixels wide tile based playfield with a few 'sprites', and a
+	// status bar in 512 pixels wide mode (split screen).
+	uint32_t palette[16];
+	for (auto& p : palette) p = gen() & 0xE0E0E0;
+	vector<uint8_t> tiles(32 * 24), patterns(256 * 8);
+	for (auto& t : tiles) t = gen() & 0xFF;
+	for (auto& p : patterns) p = gen() & 0xFF;
+	Screen screen;
+	screen.name = "builtin:game";
+	for (unsigned y = 0; y < 240; ++y) {
+		if ((y < 24) || (y >= 24 + 192)) {
+			screen.lines.push_back({palette[0]});
+			continue;
+		}
+		unsigned row = (y - 24) / 8;
+		if (row >= 21) {
+			vector<uint32_t> line(640, palette[0]);
+			for (unsigned x = 64; x < 576; ++x) {
+				line[x] = ((x / 4 + y) % 7 == 0) ? palette[15]
+				                                  : palette[1];
+			}
+			screen.lines.push_back(line);
+			continue;
+		}
+		vector<uint32_t> line(320, palette[0]);
+		for (unsigned x = 0; x < 256; ++x) {
+			unsigned tile = tiles[row * 32 + x / 8];
+			bool set = patterns[tile * 8 + (y & 7)] & (0x80 >> (x & 7));
+			line[32 + x] = palette[set ? (tile & 15) : (tile >> 4)];
+		}
+		for (unsigned s = 0; s < 8; ++s) {
+			unsigned sy = 30 + 20 * s, sx = 32 + 20 + 28 * s;
+			if ((y < sy) || (y >= sy + 16)) continue;
+			for (unsigned x = 0; x < 16; ++x) {
+				if ((x ^ (y - sy)) & 2) line[sx + x] = palette[8 + s];
+			}
+		}
+		screen.lines.push_back(line);
+	}
+	return screen;
+}
+
+static Screen makeBitmapScreen(mt19937& gen)
+{
+	// 256 pixels wide bitmap with gradients and noise (like screen 8).
+	Screen screen;
+	screen.name = "builtin:bitmap";
+	for (unsigned y = 0; y < 240; ++y) {
+		if ((y < 14) || (y >= 14 + 212)) {
+			screen.lines.push_back({0});
+			continue;
+		}
+		vector<uint32_t> line(320, 0);
+		for (unsigned x = 0; x < 256; ++x) {
+			unsigned r = (x + y) & 0xE0;
+			unsigned g = (y * 2) & 0xE0;
+			unsigned b = (x * 3 + (gen() & 0x3F)) & 0xC0;
+			line[32 + x] = (r << 16) | (g << 8) | b;
+		}
+		screen.lines.push_back(line);
+	}
+	return screen;
+}
+
+
+// Screens from a raw recording, see RawFrameWriter.hh for the file format.
+
+static uint32_t getL32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint32_t maskToRGB(uint32_t pixel, uint32_t mask)
+{
+	if (!mask) return 0;
+	unsigned shift = 0;
+	while (!((mask >> shift) & 1)) ++shift;
+	unsigned bits = 0;
+	while ((mask >> (shift + bits)) & 1) ++bits;
+	uint32_t v = (pixel & mask) >> shift;
+	return (bits >= 8) ? (v >> (bits - 8)) : (v * 255 / ((1u << bits) - 1));
+}
+
+static void loadRecording(const string& filename, unsigned maxFrames,
+                          vector<Screen>& screens)
+{
+	ifstream in(filename, ios::binary);
+	vector<uint8_t> data((istreambuf_iterator<char>(in)),
+	                     istreambuf_iterator<char>());
+	if ((data.size() < 64) || (memcmp(data.data(), "OMSXRAW\x1a", 8) != 0)) {
+		cerr << filename << ": not a raw recording" << endl;
+		exit(1);
+	}
+	unsigned bytesPerPixel = getL32(&data[12]);
+	uint32_t masks[3] = { getL32(&data[16]), getL32(&data[20]), getL32(&data[24]) };
+	auto toRGB = [&](uint32_t p) {
+		return (maskToRGB(p, masks[0]) << 16) |
+		       (maskToRGB(p, masks[1]) <<  8) |
+		        maskToRGB(p, masks[2]);
+	};
+	auto readPixel = [&](const uint8_t* p) {
+		return (bytesPerPixel == 4) ? getL32(p) : uint32_t(p[0] | (p[1] << 8));
+	};
+
+	// Walk over the frame records (works without index too).
+	vector<size_t> frames;
+	for (size_t pos = 64; (pos + 32) <= data.size(); ) {
+		uint32_t size = getL32(&data[pos + 4]);
+		if ((memcmp(&data[pos], "FRAM", 4) != 0) || (size == 0) ||
+		    ((pos + size) > data.size())) break;
+		frames.push_back(pos);
+		pos += size;
+	}
+	unsigned num = min<unsigned>(maxFrames, frames.size());
+	for (unsigned i = 0; i < num; ++i) {
+		unsigned n = (num == 1) ? 0 : unsigned(i * (frames.size() - 1) / (num - 1));
+		const uint8_t* frame = &data[frames[n]];
+		unsigned height = getL32(frame + 16);
+		unsigned paletteSize = getL32(frame + 24);
+		const uint8_t* lineTable = frame + 32;
+		const uint8_t* lineData = lineTable + 4 * height;
+		const uint8_t* palette = lineData;
+		for (unsigned y = 0; y < height; ++y) {
+			uint32_t entry = getL32(lineTable + 4 * y);
+			unsigned width = entry & 0xFFFF;
+			size_t bytes = (entry & 0x80000000) ? width : width * bytesPerPixel;
+			palette += (bytes + 3) & ~3;
+		}
+		Screen screen;
+		screen.name = filename + ':' + to_string(n);
+		for (unsigned y = 0; y < height; ++y) {
+			uint32_t entry = getL32(lineTable + 4 * y);
+			unsigned width = entry & 0xFFFF;
+			bool indexed = (entry & 0x80000000) != 0;
+			vector<uint32_t> line(width);
+			for (unsigned x = 0; x < width; ++x) {
+				uint32_t p;
+				if (indexed) {
+					assert(lineData[x] < paletteSize); (void)paletteSize;
+					p = readPixel(palette + lineData[x] * bytesPerPixel);
+				} else {
+					p = readPixel(lineData + x * bytesPerPixel);
+				}
+				line[x] = toRGB(p);
+			}
+			size_t bytes = indexed ? width : width * bytesPerPixel;
+			lineData += (bytes + 3) & ~3;
+			screen.lines.push_back(line);
+		}
+		screens.push_back(move(screen));
+	}
+}
+
+
+// Scaling.
+
+template<typename Pixel>
+class MemoryScalerOutput final : public ScalerOutput<Pixel>
+{
+public:
+	MemoryScalerOutput(unsigned width_, unsigned height_)
+		: width(width_), height(height_), pixels(width_ * height_) {}
+
+	unsigned getWidth()  const override { return width; }
+	unsigned getHeight() const override { return height; }
+	Pixel* acquireLine(unsigned y) override { return &pixels[y * width]; }
+	void releaseLine(unsigned /*y*/, Pixel* /*buf*/) override {}
+	void fillLine(unsigned y, Pixel color) override {
+		fill_n(&pixels[y * width], width, color);
+	}
+
+	const unsigned width;
+	const unsigned height;
+	vector<Pixel> pixels;
+};
+
+template<typename Pixel>
+static unique_ptr<RawFrame> makeFrame(const SDL_PixelFormat& format,
+                                      const Screen& screen)
+{
+	auto height = unsigned(screen.lines.size());
+	auto frame = make_unique<RawFrame>(format, MAX_WIDTH, height);
+	frame->init(FrameSource::FIELD_NONINTERLACED);
+	for (unsigned y = 0; y < height; ++y) {
+		auto& line = screen.lines[y];
+		auto width = min<unsigned>(unsigned(line.size()), MAX_WIDTH);
+		if (width <= 1) {
+			frame->setBlank(y, fromRGB<Pixel>(width ? line[0] : 0));
+			continue;
+		}
+		Pixel* dst = frame->getLinePtrDirect<Pixel>(y);
+		for (unsigned x = 0; x < width; ++x) dst[x] = fromRGB<Pixel>(line[x]);
+		frame->setLineWidth(y, width);
+	}
+	return frame;
+}
+
+// Same as one band of FBPostProcessor::paint(), for the complete output.
+template<typename Pixel>
+static void scaleFrame(Scaler<Pixel>& scaler, FrameSource& frame,
+                       MemoryScalerOutput<Pixel>& output)
+{
+	unsigned g = Math::gcd(frame.getHeight(), output.getHeight());
+	FBPostProcessor<Pixel>::scaleRegions(
+		scaler, frame, nullptr, output, 0, 0, output.getHeight(),
+		frame.getHeight() / g, output.getHeight() / g);
+}
+
+// Same as FBPostProcessor::paint() with 'numBands' threads, but the bands are
+// scaled one after the other. Each band gets its own scaler, like in paint().
+template<typename Pixel>
+static void scaleFrameInBands(vector<unique_ptr<Scaler<Pixel>>>& scalers,
+                              FrameSource& frame,
+                              MemoryScalerOutput<Pixel>& output)
+{
+	unsigned g = Math::gcd(frame.getHeight(), output.getHeight());
+	unsigned srcStep = frame.getHeight() / g;
+	unsigned dstStep = output.getHeight() / g;
+	auto numBands = unsigned(scalers.size());
+	unsigned stepsPerBand = (g + numBands - 1) / numBands;
+	for (unsigned band = 0; band < numBands; ++band) {
+		unsigned startStep = min(band * stepsPerBand, g);
+		unsigned endStep = min(startStep + stepsPerBand, g);
+		if (startStep == endStep) continue;
+		FBPostProcessor<Pixel>::scaleRegions(
+			*scalers[band], frame, nullptr, output,
+			startStep * srcStep,
+			startStep * dstStep, endStep * dstStep,
+			srcStep, dstStep);
+	}
+}
+
+template<typename Pixel>
+static string checksum(const MemoryScalerOutput<Pixel>& output)
+{
+	// Little endian pixels, so the golden file is the same on all hosts.
+	vector<uint8_t> buf(output.pixels.size() * sizeof(Pixel));
+	for (size_t i = 0; i < output.pixels.size(); ++i) {
+		for (unsigned j = 0; j < sizeof(Pixel); ++j) {
+			buf[i * sizeof(Pixel) + j] = output.pixels[i] >> (8 * j);
+		}
+	}
+	return SHA1::calc(buf.data(), buf.size()).toString();
+}
+
+template<typename Pixel>
+static void dumpPNG(const MemoryScalerOutput<Pixel>& output,
+                    const SDL_PixelFormat& format, const string& filename)
+{
+	vector<const void*> rows(output.height);
+	for (unsigned y = 0; y < output.height; ++y) {
+		rows[y] = &output.pixels[y * output.width];
+	}
+	PNG::save(output.width, output.height, rows.data(), format, filename);
+}
+
+// Checksums of the built-in screens, made with the scalers from before they
+// could be scaled in parts (with 'set blur 50' and 'set scanline 20'). MLAA is
+// only available in development builds.
+static const char* const builtinGolden[][2] = {
+	{ "16bpp 1x builtin:bitmap", "bed503c73ec4234604a4e3a8a267f1b6b16da108" },
+	{ "16bpp 1x builtin:game", "ac994017dc523932cc73b5755cc598707ee9b390" },
+	{ "16bpp 1x builtin:text80", "8be3b988bea1fa3e4e644e28d644d7ab3747da84" },
+	{ "16bpp 2x-MLAA builtin:bitmap", "ca23d5be54ae53b39825ece94554e8b9994ea966" },
+	{ "16bpp 2x-MLAA builtin:game", "6c4848fd7655878c50d0c3584c900f282bd59648" },
+	{ "16bpp 2x-MLAA builtin:text80", "0a6659ca8d6b2b3c6da0982ff6ca4bda605ac6f1" },
+	{ "16bpp 2x-RGBtriplet builtin:bitmap", "7f3918a6179d31c42103ea4d94719101b2d12919" },
+	{ "16bpp 2x-RGBtriplet builtin:game", "399512e859df37ce7a725b060b59025b7fbad7cb" },
+	{ "16bpp 2x-RGBtriplet builtin:text80", "98eee98bcd4bf1e90308ee284c3c9b4a46936456" },
+	{ "16bpp 2x-SaI builtin:bitmap", "9f2df7b0730e64ace904a1ef3f9921a0d531fff7" },
+	{ "16bpp 2x-SaI builtin:game", "bc55a4802e01b4aaf832f66e8e43c85fa2e6c351" },
+	{ "16bpp 2x-SaI builtin:text80", "90f6616a22b960eaf93a6426407b6c3ec875aee1" },
+	{ "16bpp 2x-ScaleNx builtin:bitmap", "7b3903034f28fe571dede51bda0a488685e9818b" },
+	{ "16bpp 2x-ScaleNx builtin:game", "5296cc7cec1a02fefd917d675255a3a243d4ed23" },
+	{ "16bpp 2x-ScaleNx builtin:text80", "b6f2ce8c550cf57b37af6d9bf5258da63cb02693" },
+	{ "16bpp 2x-hq builtin:bitmap", "3f141fb253f8141458b32121a7bafb5523258383" },
+	{ "16bpp 2x-hq builtin:game", "a04a39c270206446b33e861426b34ffbe5e691f8" },
+	{ "16bpp 2x-hq builtin:text80", "5076098a35b34c86da6b2d528f3e43dd2bca7668" },
+	{ "16bpp 2x-hqlite builtin:bitmap", "3f141fb253f8141458b32121a7bafb5523258383" },
+	{ "16bpp 2x-hqlite builtin:game", "fc39d0b9ffe3c45adee014744d4f0ed945f247dc" },
+	{ "16bpp 2x-hqlite builtin:text80", "5076098a35b34c86da6b2d528f3e43dd2bca7668" },
+	{ "16bpp 2x-simple builtin:bitmap", "7f3918a6179d31c42103ea4d94719101b2d12919" },
+	{ "16bpp 2x-simple builtin:game", "399512e859df37ce7a725b060b59025b7fbad7cb" },
+	{ "16bpp 2x-simple builtin:text80", "98eee98bcd4bf1e90308ee284c3c9b4a46936456" },
+	{ "16bpp 3x-MLAA builtin:bitmap", "0364f533470ccace0933103befb4a61d14118f86" },
+	{ "16bpp 3x-MLAA builtin:game", "e4bd16e4091a879e2502142729e0633d4c4032c1" },
+	{ "16bpp 3x-MLAA builtin:text80", "d465e1d93262d338b2ce8872e93a51febc306cfd" },
+	{ "16bpp 3x-RGBtriplet builtin:bitmap", "d9f242469f35a87bdefccd66e493eba76b7c8bca" },
+	{ "16bpp 3x-RGBtriplet builtin:game", "4e664e69b809a20935b9d60a11e08d0eadb7be90" },
+	{ "16bpp 3x-RGBtriplet builtin:text80", "ef10d180e6aad11b61e19c28065f78696c1d1435" },
+	{ "16bpp 3x-SaI builtin:bitmap", "c8a4851148b00d1c3ef79bfcd23a76f3f7b98628" },
+	{ "16bpp 3x-SaI builtin:game", "62ea811b00437cb1227850c7ff8c4bc6772c93f2" },
+	{ "16bpp 3x-SaI builtin:text80", "ace3f5e81716e4b064ffab8f2255a331beaf1f00" },
+	{ "16bpp 3x-ScaleNx builtin:bitmap", "0433a193c5742a020e1a8e17559be4163ddf34eb" },
+	{ "16bpp 3x-ScaleNx builtin:game", "d98e424712ef87d8020f7cefa4efd2376f584a96" },
+	{ "16bpp 3x-ScaleNx builtin:text80", "ace3f5e81716e4b064ffab8f2255a331beaf1f00" },
+	{ "16bpp 3x-hq builtin:bitmap", "81d48c8f5222a0747ebeafe95b53acdbb2be762c" },
+	{ "16bpp 3x-hq builtin:game", "d67ea356ca6edab660b39f3a31ae50ae35bcab7a" },
+	{ "16bpp 3x-hq builtin:text80", "a6cafb24a3f1ec99a4946b7139629f58ec6ce8e6" },
+	{ "16bpp 3x-hqlite builtin:bitmap", "81d48c8f5222a0747ebeafe95b53acdbb2be762c" },
+	{ "16bpp 3x-hqlite builtin:game", "90cbf8068891a08f4c689d65d73b0050e1182069" },
+	{ "16bpp 3x-hqlite builtin:text80", "a6cafb24a3f1ec99a4946b7139629f58ec6ce8e6" },
+	{ "16bpp 3x-simple builtin:bitmap", "fc8563005a7c1000c76e0a1cc99fb8ac4539206a" },
+	{ "16bpp 3x-simple builtin:game", "99649e481865d011c2cfc0513a15cfe051f59ba0" },
+	{ "16bpp 3x-simple builtin:text80", "4f5e5fc086b3daa8143b3b34c7ec9357e3b4290a" },
+	{ "32bpp 1x builtin:bitmap", "8f3616fefff16c4edb1e65d660fcffa9b7fa3e2c" },
+	{ "32bpp 1x builtin:game", "a5b0ec762b2164060ec76fa45759a17b820ffcb7" },
+	{ "32bpp 1x builtin:text80", "b8530d00eca91828cda0b4628819e73281718e7e" },
+	{ "32bpp 2x-MLAA builtin:bitmap", "1e2ae721db42b372f4963c9bbc5afc5dbe208e67" },
+	{ "32bpp 2x-MLAA builtin:game", "0141b0d67b6e9303e0c252847e0d989e318acd42" },
+	{ "32bpp 2x-MLAA builtin:text80", "ee0bafe800af0a8ea3419ae0cc6a4f5ff403c2b7" },
+	{ "32bpp 2x-RGBtriplet builtin:bitmap", "cccb4508fff7aa923858ec720c10d25b969d7c7b" },
+	{ "32bpp 2x-RGBtriplet builtin:game", "94c8f355237271f193e3932fdf5ef48912f1f086" },
+	{ "32bpp 2x-RGBtriplet builtin:text80", "fe5b5b22b1e85371ec252df3c3b1ea8277e9533f" },
+	{ "32bpp 2x-SaI builtin:bitmap", "04350f4bf79f4535a846c119709923e96be6b224" },
+	{ "32bpp 2x-SaI builtin:game", "13b55e2c398d595dd7b082f0a64b1bffbab3b769" },
+	{ "32bpp 2x-SaI builtin:text80", "565f4c8cd2b1a71bbaf3f846e72db40ebc4f37db" },
+	{ "32bpp 2x-ScaleNx builtin:bitmap", "ef59e813e1bb96dc617f999311e5b3328e552961" },
+	{ "32bpp 2x-ScaleNx builtin:game", "1f4c02c6c1b5c0290a58155c088d7e7fb90bb06a" },
+	{ "32bpp 2x-ScaleNx builtin:text80", "b76972d10f01ccb03c6a49128bd038f70b3259dc" },
+	{ "32bpp 2x-hq builtin:bitmap", "3d81d1a30a5d62090354c9a6163d1c8fb25c18cc" },
+	{ "32bpp 2x-hq builtin:game", "1355224eb2f183579cad72449853341ff2925858" },
+	{ "32bpp 2x-hq builtin:text80", "e95f98d3ccb34671ed7dff36788cc7e203eb46ae" },
+	{ "32bpp 2x-hqlite builtin:bitmap", "3d81d1a30a5d62090354c9a6163d1c8fb25c18cc" },
+	{ "32bpp 2x-hqlite builtin:game", "0cf057918c1948d8e34a4f6b7fb01ad8e665529d" },
+	{ "32bpp 2x-hqlite builtin:text80", "e95f98d3ccb34671ed7dff36788cc7e203eb46ae" },
+	{ "32bpp 2x-simple builtin:bitmap", "cccb4508fff7aa923858ec720c10d25b969d7c7b" },
+	{ "32bpp 2x-simple builtin:game", "94c8f355237271f193e3932fdf5ef48912f1f086" },
+	{ "32bpp 2x-simple builtin:text80", "fe5b5b22b1e85371ec252df3c3b1ea8277e9533f" },
+	{ "32bpp 3x-MLAA builtin:bitmap", "5df9696460c52cf9eab27b8e84715811ad767794" },
+	{ "32bpp 3x-MLAA builtin:game", "9cdf1107e54e3728b5c2630c8ac6213ba6eaa49c" },
+	{ "32bpp 3x-MLAA builtin:text80", "d33fee66445cb79efca772f5b553993ab721fc7b" },
+	{ "32bpp 3x-RGBtriplet builtin:bitmap", "3f669780b92f090704aa88f49e65583bfe89684e" },
+	{ "32bpp 3x-RGBtriplet builtin:game", "063c844b830b24f29e833d5e855582ba6791c3a9" },
+	{ "32bpp 3x-RGBtriplet builtin:text80", "a11ce341c9af2ed147968ff68e2eceb1d48b5e66" },
+	{ "32bpp 3x-SaI builtin:bitmap", "191eeea45c9f562feafd7ab16cb738e107254a02" },
+	{ "32bpp 3x-SaI builtin:game", "10063cda39dae6aaaf0a1b957552240e5c6aecd9" },
+	{ "32bpp 3x-SaI builtin:text80", "d92fe81a39abeeca2a7386b924e9d72bf3ab77e6" },
+	{ "32bpp 3x-ScaleNx builtin:bitmap", "fdf294cf0297be0953062346ad029ec47fde1219" },
+	{ "32bpp 3x-ScaleNx builtin:game", "1337118e28cc07e296bb9fad429472c4808f109d" },
+	{ "32bpp 3x-ScaleNx builtin:text80", "d92fe81a39abeeca2a7386b924e9d72bf3ab77e6" },
+	{ "32bpp 3x-hq builtin:bitmap", "4540a6ec466f873c51a5f54a34e250375cbdea9b" },
+	{ "32bpp 3x-hq builtin:game", "6d086b027f770e99487a3c6fa683f0f551d94517" },
+	{ "32bpp 3x-hq builtin:text80", "e45d2bd3964b7ef2df2a102d2e8691bb4e815d7b" },
+	{ "32bpp 3x-hqlite builtin:bitmap", "4540a6ec466f873c51a5f54a34e250375cbdea9b" },
+	{ "32bpp 3x-hqlite builtin:game", "6438fa0839338d32863a3913cf5ae55caa56de7f" },
+	{ "32bpp 3x-hqlite builtin:text80", "e45d2bd3964b7ef2df2a102d2e8691bb4e815d7b" },
+	{ "32bpp 3x-simple builtin:bitmap", "c9a21f0af49a55ab28d0d0185f49d23863e04f0a" },
+	{ "32bpp 3x-simple builtin:game", "5fb36eef54384cd48e6bd75f4345146e34745af2" },
+	{ "32bpp 3x-simple builtin:text80", "c8bc9d66ee59e3150257c9a83c997a6863921a18" },
+};
+
+struct Options {
+	unsigned repeat = 10;
+	string dumpDir;
+	map<string, string> golden; // key -> checksum
+	map<string, string> results;
+	unsigned mismatches = 0;
+};
+
+template<typename Pixel>
+static void benchScaler(const string& name, RenderSettings& settings,
+                        const vector<Screen>& screens, Options& options)
+{
+	unsigned bpp = 8 * sizeof(Pixel);
+	SDL_PixelFormat format = makeFormat(bpp);
+	PixelOperations<Pixel> pixelOps(format);
+	auto scaler = ScalerFactory<Pixel>::createScaler(pixelOps, settings);
+	unsigned factor = settings.getScaleFactor();
+	MemoryScalerOutput<Pixel> output(320 * factor, 240 * factor);
+
+	vector<unique_ptr<RawFrame>> frames;
+	for (auto& screen : screens) frames.push_back(makeFrame<Pixel>(format, screen));
+
+	// Verify (also warms up the caches).
+	for (size_t i = 0; i < frames.size(); ++i) {
+		scaleFrame(*scaler, *frames[i], output);
+		string key = to_string(bpp) + "bpp " + name + ' ' + screens[i].name;
+		string sum = checksum(output);
+		options.results[key] = sum;
+		auto it = options.golden.find(key);
+		if ((it != options.golden.end()) && (it->second != sum)) {
+			cout << "MISMATCH " << key << ": expected " << it->second
+			     << " but got " << sum << endl;
+			++options.mismatches;
+		}
+		if (!options.dumpDir.empty()) {
+			string filename = to_string(bpp) + "bpp-" + name + '-' +
+			                  screens[i].name + ".png";
+			replace(filename.begin(), filename.end(), ':', '-');
+			replace(filename.begin(), filename.end(), '/', '-');
+			dumpPNG(output, format, options.dumpDir + '/' + filename);
+		}
+		// Scaling in bands (as FBPostProcessor does when there are
+		// multiple cores) must give exactly the same output.
+		if (scaler->canScaleInParts()) {
+			vector<unique_ptr<Scaler<Pixel>>> bandScalers;
+			for (unsigned b = 0; b < NUM_BANDS; ++b) {
+				bandScalers.push_back(ScalerFactory<Pixel>::createScaler(
+					pixelOps, settings));
+			}
+			fill(output.pixels.begin(), output.pixels.end(), 0);
+			scaleFrameInBands(bandScalers, *frames[i], output);
+			string bandSum = checksum(output);
+			if (bandSum != sum) {
+				cout << "MISMATCH " << key << " in " << NUM_BANDS
+				     << " bands: got " << bandSum << " instead of "
+				     << sum << endl;
+				++options.mismatches;
+			}
+		}
+	}
+
+	double ns = 1000.0 * Benchmark::time([&]() {
+		for (unsigned r = 0; r < options.repeat; ++r) {
+			for (auto& frame : frames) scaleFrame(*scaler, *frame, output);
+		}
+	});
+	double pixels = double(output.width) * output.height *
+	                frames.size() * options.repeat;
+	printf("%2ubpp %-14s %7.3f ns/pixel %9.1f us/frame\n", bpp, name.c_str(),
+	       ns / pixels, ns / 1000.0 / (frames.size() * options.repeat));
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	unsigned maxFrames = 8;
+	string goldenFile;
+	bool update = false;
+	vector<string> recordings;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if ((arg == "-n") && (i + 1 < argc)) {
+			options.repeat = Benchmark::getCount(argc, argv, ++i, 10);
+		} else if ((arg == "-frames") && (i + 1 < argc)) {
+			maxFrames = Benchmark::getCount(argc, argv, ++i, 8);
+		} else if ((arg == "-golden") && (i + 1 < argc)) {
+			goldenFile = argv[++i];
+		} else if (arg == "-update") {
+			update = true;
+		} else if ((arg == "-dump") && (i + 1 < argc)) {
+			options.dumpDir = argv[++i];
+		} else if (!arg.empty() && (arg[0] != '-')) {
+			recordings.push_back(arg);
+		} else {
+			cerr << "Usage: " << argv[0] << " [-n repeat] [-frames n] "
+			        "[-golden file [-update]] [-dump dir] "
+			        "[recording.omr ...]" << endl;
+			return 1;
+		}
+	}
+
+	vector<Screen> screens;
+	if (recordings.empty()) {
+		mt19937 gen(12345);
+		screens.push_back(makeTextScreen(gen));
+		screens.push_back(makeGameScreen(gen));
+		screens.push_back(makeBitmapScreen(gen));
+	} else {
+		for (auto& r : recordings) loadRecording(r, maxFrames, screens);
+	}
+
+	if (goldenFile.empty()) {
+		if (recordings.empty()) {
+			for (auto& g : builtinGolden) options.golden[g[0]] = g[1];
+		}
+	} else if (!update) {
+		ifstream in(goldenFile);
+		if (!in) {
+			cerr << "Can't read " << goldenFile << endl;
+			return 1;
+		}
+		string line;
+		while (getline(in, line)) {
+			if (line.empty() || (line[0] == '#')) continue;
+			auto pos = line.rfind(' ');
+			if (pos == string::npos) continue;
+			options.golden[line.substr(0, pos)] = line.substr(pos + 1);
+		}
+	}
+
+	try {
+		SDL_Init(SDL_INIT_NOPARACHUTE);
+		Reactor reactor;
+		reactor.init();
+		auto& controller = reactor.getCommandController();
+		RenderSettings settings(controller);
+		// Fixed values for the settings the scalers use, the golden
+		// checksums depend on them.
+		controller.executeCommand("set blur 50");
+		controller.executeCommand("set scanline 20");
+
+		static const char* const algorithms[] = {
+			"simple", "SaI", "ScaleNx", "hq", "hqlite", "RGBtriplet", "MLAA"
+		};
+		cout << "Scaling " << screens.size() << " screens, "
+		     << options.repeat << " times" << endl;
+		for (int factor = MIN_SCALE_FACTOR; factor <= min(MAX_SCALE_FACTOR, 3); ++factor) {
+			controller.executeCommand("set scale_factor " + to_string(factor));
+			for (auto* algo : algorithms) {
+				try {
+					controller.executeCommand(string("set scale_algorithm ") + algo);
+				} catch (MSXException&) {
+					continue; // not available in this build
+				}
+				// factor 1 ignores the algorithm
+				string name = (factor == 1) ? string("1x")
+				                            : (to_string(factor) + "x-" + algo);
+#if HAVE_16BPP
+				benchScaler<uint16_t>(name, settings, screens, options);
+#endif
+#if HAVE_32BPP
+				benchScaler<uint32_t>(name, settings, screens, options);
+#endif
+				if (factor == 1) break;
+			}
+		}
+	} catch (MSXException& e) {
+		cerr << "Error: " << e.getMessage() << endl;
+		return 1;
+	}
+
+	if (update) {
+		ofstream out(goldenFile);
+		out << "# ScalerBench golden checksums: <bpp> <scaler> <screen> <sha1>\n";
+		for (auto& r : options.results) out << r.first << ' ' << r.second << '\n';
+		cout << "Wrote " << options.results.size() << " checksums to "
+		     << goldenFile << endl;
+	} else if (!options.golden.empty()) {
+		unsigned missing = 0;
+		for (auto& r : options.results) {
+			if (!options.golden.count(r.first)) ++missing;
+		}
+		cout << options.mismatches << " mismatches, " << missing
+		     << " results without golden checksum" << endl;
+	}
+	return options.mismatches ? 1 : 0;
+}
@@ -39,7 +39,11 @@ void Simple2xScaler<Pixel>::scaleBlank1to2(
 	int scanlineFactor = settings.getScanlineFactor();
 
 	unsigned dstHeight = dst.getHeight();
-	unsigned stopDstY = (dstEndY == dstHeight)
+	// The last blank line is interpolated with the next (non-blank)
+	// line, unless the area ends at the bottom of the screen or in the
+	// middle of a blank area (possible when scaling in parts).
+	unsigned stopDstY = ((dstEndY == dstHeight) ||
+	                     (src.getLineWidth(srcEndY) == 1))
 	                  ? dstEndY : dstEndY - 2;
 	unsigned srcY = srcStartY, dstY = dstStartY;
 	for (/* */; dstY < stopDstY; srcY += 1, dstY += 2) {
@@ -48,7 +52,7 @@ void Simple2xScaler<Pixel>::scaleBlank1to2(
 		Pixel color1 = scanline.darken(color0, scanlineFactor);
 		dst.fillLine(dstY + 1, color1);
 	}
-	if (dstY != dstHeight) {
+	if (dstY != dstEndY) {
 		unsigned nextLineWidth = src.getLineWidth(srcY + 1);
 		assert(src.getLineWidth(srcY) == 1);
 		assert(nextLineWidth != 1);
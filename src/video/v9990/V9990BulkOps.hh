@@ -0,0 +1,120 @@
+#ifndef V9990BULKOPS_HH
+#define V9990BULKOPS_HH
+
+#include "openmsx.hh"
+#include <cstring>
+
+namespace openmsx {
+
+/** Row-at-a-time versions of the logical operations of the V9990 command
+  * engine, used by LMMV and LMMM. They work on a range of consecutive bytes
+  * within one VRAM bank.
+  *
+  * The logical operation tables (indexed by '256 * dst + src') work per
+  * pixel: the result for one pixel only depends on the bits of that pixel.
+  * So applying them to a complete byte gives the same result as applying
+  * them to each of the pixels in that byte one after the other.
+  *
+  * The common cases (plain and transparent IMP with all bits writable) are
+  * written so that the compiler can vectorise them.
+  */
+namespace V9990BulkOps {
+
+/** Is the logical operation (value of the LOG register) IMP, possibly with
+  * transparency? IOW is the result the source color? */
+inline bool isImp(byte op)
+{
+	return (op & 0x0F) == 0x0C;
+}
+
+/** dst = (dst & ~mask) | (op(dst, color) & mask)
+  */
+inline void fill(byte* dst, unsigned num, byte color, byte mask,
+                 const byte* lut)
+{
+	byte v0 = lut[256 * 0x00 + color];
+	byte v1 = lut[256 * 0xFF + color];
+	if (v0 == v1) {
+		// The result doesn't depend on the destination, true for
+		// e.g. IMP (also transparent IMP when no pixel of 'color'
+		// is transparent).
+		if (mask == 0xFF) {
+			memset(dst, v0, num);
+		} else if (mask) {
+			byte v = v0 & mask;
+			for (unsigned i = 0; i < num; ++i) {
+				dst[i] = (dst[i] & ~mask) | v;
+			}
+		}
+		return;
+	}
+	for (unsigned i = 0; i < num; ++i) {
+		byte d = dst[i];
+		dst[i] = (d & ~mask) | (lut[256 * d + color] & mask);
+	}
+}
+
+/** dst = (dst & ~mask) | (op(dst, src) & mask)
+  * @param bytePixels True in 8bpp mode, then the transparent IMP operation
+  *                   can be done without table.
+  * Source and destination may not overlap.
+  */
+inline void copy(byte* __restrict dst, const byte* __restrict src,
+                 unsigned num, byte mask, const byte* lut, byte op,
+                 bool bytePixels)
+{
+	if (isImp(op) && (mask == 0xFF)) {
+		if (!(op & 0x10)) {
+			memcpy(dst, src, num);
+			return;
+		}
+		if (bytePixels) {
+			for (unsigned i = 0; i < num; ++i) {
+				byte s = src[i];
+				dst[i] = s ? s : dst[i];
+			}
+			return;
+		}
+	}
+	for (unsigned i = 0; i < num; ++i) {
+		byte d = dst[i];
+		dst[i] = (d & ~mask) | (lut[256 * d + src[i]] & mask);
+	}
+}
+
+/** Transparent copy in 16bpp mode: the low and high bytes of the pixels are
+  * in different VRAM banks, a pixel is only transparent when both are zero.
+  * Otherwise the (non-transparent) operation works per byte, like copy().
+  */
+inline void copy16Transparent(
+	byte* __restrict dstLo, byte* __restrict dstHi,
+	const byte* __restrict srcLo, const byte* __restrict srcHi,
+	unsigned num, word mask, const byte* lut, byte op)
+{
+	if (isImp(op) && (mask == 0xFFFF)) {
+		for (unsigned i = 0; i < num; ++i) {
+			byte sl = srcLo[i];
+			byte sh = srcHi[i];
+			bool t = (sl | sh) == 0;
+			dstLo[i] = t ? dstLo[i] : sl;
+			dstHi[i] = t ? dstHi[i] : sh;
+		}
+		return;
+	}
+	byte maskLo = mask & 0xFF;
+	byte maskHi = mask >> 8;
+	for (unsigned i = 0; i < num; ++i) {
+		byte sl = srcLo[i];
+		byte sh = srcHi[i];
+		if ((sl | sh) == 0) continue;
+		byte dl = dstLo[i];
+		byte dh = dstHi[i];
+		dstLo[i] = (dl & ~maskLo) | (lut[256 * dl + sl] & maskLo);
+		dstHi[i] = (dh & ~maskHi) | (lut[256 * dh + sh] & maskHi);
+	}
+}
+
+} // namespace V9990BulkOps
+} // namespace openmsx
+
+#endif
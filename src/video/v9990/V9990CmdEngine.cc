@@ -2,6 +2,7 @@
 #include "V9990.hh"
 #include "V9990VRAM.hh"
 #include "V9990DisplayTiming.hh"
+#include "V9990BulkOps.hh"
 #include "MSXMotherBoard.hh"
 #include "RenderSettings.hh"
 #include "BooleanSetting.hh"
@@ -11,6 +12,8 @@
 #include "serialize.hh"
 #include "likely.hh"
 #include "unreachable.hh"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace openmsx {
@@ -1009,6 +1012,196 @@ void V9990CmdEngine::executeLMMC(EmuTime::param limit)
 	}
 }
 
+// Row-at-a-time LMMV and LMMM
+//
+// LMMV and LMMM take the same time for every pixel, so it's easy to know how
+// many pixels can be done before 'limit'. The pixels of one row (up to the
+// point where the coordinates wrap) are consecutive bytes in VRAM. In the Bx
+// modes these bytes alternate between the two VRAM banks, in 16bpp mode the
+// low and high bytes of a pixel are in different banks. In both cases a row
+// consists of (two) ranges of consecutive bytes on which the operations of
+// V9990BulkOps work. The P1 and P2 modes always use the per pixel code.
+
+// Maximum number of bytes (per bank) processed at once by bulkLMMM().
+static const unsigned MAX_BULK = 2048;
+
+static bool bulkEnabled = true;
+
+void V9990CmdEngine::setBulkEnabled(bool enabled)
+{
+	bulkEnabled = enabled;
+}
+
+unsigned V9990CmdEngine::getBulkLimit(
+	EmuDuration::param delta, EmuTime::param limit) const
+{
+	// the pixel loops execute while 'engineTime < limit'
+	if (delta == EmuDuration::zero) return ANX;
+	return std::min<unsigned>(ANX, (limit - engineTime).divUp(delta));
+}
+
+template<typename Mode>
+unsigned V9990CmdEngine::bulkLMMV(
+	unsigned num, unsigned pitch, int dx, const byte* lut)
+{
+	// Bx modes with 2, 4 or 8 bpp, only complete bytes
+	static const unsigned PPB = Mode::PIXELS_PER_BYTE;
+	if ((DX & (PPB - 1)) != ((dx > 0) ? 0 : (PPB - 1))) return 0;
+	unsigned col = (DX / PPB) & (pitch - 1);
+	unsigned bytes = std::min(num / PPB, (dx > 0) ? (pitch - col) : (col + 1));
+	if (bytes == 0) return 0;
+	unsigned lin = col + DY * pitch;
+	if (dx < 0) lin -= bytes - 1;
+	lin &= 0x7FFFF;
+	if ((lin + bytes) > 0x80000) return 0;
+
+	for (unsigned i = 0; i < std::min(bytes, 2u); ++i) {
+		unsigned addr = V9990VRAM::transformBx(lin + i);
+		unsigned n = (bytes - i + 1) / 2;
+		bool high = (addr & 0x40000) != 0;
+		V9990BulkOps::fill(vram.getWriteBackdoor(addr, n), n,
+		                   high ? (fgCol >> 8) : (fgCol & 0xFF),
+		                   high ? (WM    >> 8) : (WM    & 0xFF), lut);
+	}
+	return bytes * PPB;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMV<V9990CmdEngine::V9990P1>(
+	unsigned /*num*/, unsigned /*pitch*/, int /*dx*/, const byte* /*lut*/)
+{
+	return 0;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMV<V9990CmdEngine::V9990P2>(
+	unsigned /*num*/, unsigned /*pitch*/, int /*dx*/, const byte* /*lut*/)
+{
+	return 0;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMV<V9990CmdEngine::V9990Bpp16>(
+	unsigned num, unsigned pitch, int dx, const byte* lut)
+{
+	unsigned col = DX & (pitch - 1);
+	num = std::min(num, (dx > 0) ? (pitch - col) : (col + 1));
+	unsigned addr = col + DY * pitch;
+	if (dx < 0) addr -= num - 1;
+	addr &= 0x3FFFF;
+	if ((addr + num) > 0x40000) return 0;
+
+	if ((LOG & 0x10) && (fgCol == 0)) {
+		// transparent, nothing changes
+		return num;
+	}
+	V9990BulkOps::fill(vram.getWriteBackdoor(addr + 0x00000, num), num,
+	                   fgCol & 0xFF, WM & 0xFF, lut);
+	V9990BulkOps::fill(vram.getWriteBackdoor(addr + 0x40000, num), num,
+	                   fgCol >> 8, WM >> 8, lut);
+	return num;
+}
+
+template<typename Mode>
+unsigned V9990CmdEngine::bulkLMMM(
+	unsigned num, unsigned pitch, int dx, const byte* lut)
+{
+	// Bx modes with 2, 4 or 8 bpp, only complete bytes (so source and
+	// destination must be equally aligned)
+	static const unsigned PPB = Mode::PIXELS_PER_BYTE;
+	unsigned sub = (dx > 0) ? 0 : (PPB - 1);
+	if (((DX & (PPB - 1)) != sub) || ((SX & (PPB - 1)) != sub)) return 0;
+	unsigned dCol = (DX / PPB) & (pitch - 1);
+	unsigned sCol = (SX / PPB) & (pitch - 1);
+	unsigned bytes = std::min(num / PPB, (dx > 0)
+		? (pitch - std::max(dCol, sCol))
+		: (std::min(dCol, sCol) + 1));
+	bytes = std::min(bytes, MAX_BULK);
+	if (bytes == 0) return 0;
+	unsigned dLin = dCol + DY * pitch;
+	unsigned sLin = sCol + SY * pitch;
+	if (dx < 0) {
+		dLin -= bytes - 1;
+		sLin -= bytes - 1;
+	}
+	dLin &= 0x7FFFF;
+	sLin &= 0x7FFFF;
+	if (((dLin + bytes) > 0x80000) || ((sLin + bytes) > 0x80000)) return 0;
+	// When the per pixel code would read a source byte that it already
+	// overwrote, the result differs from a copy.
+	if ((dx > 0) ? ((sLin < dLin) && (dLin < (sLin + bytes)))
+	             : ((dLin < sLin) && (sLin < (dLin + bytes)))) {
+		return 0;
+	}
+
+	// Read all source bytes first, the ranges may overlap.
+	byte buf[2][MAX_BULK / 2];
+	unsigned n[2];
+	unsigned dAddr[2];
+	unsigned parts = std::min(bytes, 2u);
+	for (unsigned i = 0; i < parts; ++i) {
+		n[i] = (bytes - i + 1) / 2;
+		dAddr[i] = V9990VRAM::transformBx(dLin + i);
+		memcpy(buf[i],
+		       vram.getReadBackdoor(V9990VRAM::transformBx(sLin + i)),
+		       n[i]);
+	}
+	for (unsigned i = 0; i < parts; ++i) {
+		bool high = (dAddr[i] & 0x40000) != 0;
+		V9990BulkOps::copy(vram.getWriteBackdoor(dAddr[i], n[i]), buf[i],
+		                   n[i], high ? (WM >> 8) : (WM & 0xFF), lut,
+		                   LOG, PPB == 1);
+	}
+	return bytes * PPB;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMM<V9990CmdEngine::V9990P1>(
+	unsigned /*num*/, unsigned /*pitch*/, int /*dx*/, const byte* /*lut*/)
+{
+	return 0;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMM<V9990CmdEngine::V9990P2>(
+	unsigned /*num*/, unsigned /*pitch*/, int /*dx*/, const byte* /*lut*/)
+{
+	return 0;
+}
+template<>
+unsigned V9990CmdEngine::bulkLMMM<V9990CmdEngine::V9990Bpp16>(
+	unsigned num, unsigned pitch, int dx, const byte* lut)
+{
+	unsigned dCol = DX & (pitch - 1);
+	unsigned sCol = SX & (pitch - 1);
+	num = std::min(num, (dx > 0) ? (pitch - std::max(dCol, sCol))
+	                             : (std::min(dCol, sCol) + 1));
+	num = std::min(num, MAX_BULK);
+	unsigned dAddr = dCol + DY * pitch;
+	unsigned sAddr = sCol + SY * pitch;
+	if (dx < 0) {
+		dAddr -= num - 1;
+		sAddr -= num - 1;
+	}
+	dAddr &= 0x3FFFF;
+	sAddr &= 0x3FFFF;
+	if (((dAddr + num) > 0x40000) || ((sAddr + num) > 0x40000)) return 0;
+	if ((dx > 0) ? ((sAddr < dAddr) && (dAddr < (sAddr + num)))
+	             : ((dAddr < sAddr) && (sAddr < (dAddr + num)))) {
+		return 0;
+	}
+
+	byte bufLo[MAX_BULK];
+	byte bufHi[MAX_BULK];
+	memcpy(bufLo, vram.getReadBackdoor(sAddr + 0x00000), num);
+	memcpy(bufHi, vram.getReadBackdoor(sAddr + 0x40000), num);
+	byte* dstLo = vram.getWriteBackdoor(dAddr + 0x00000, num);
+	byte* dstHi = vram.getWriteBackdoor(dAddr + 0x40000, num);
+	if (LOG & 0x10) {
+		V9990BulkOps::copy16Transparent(
+			dstLo, dstHi, bufLo, bufHi, num, WM, lut, LOG);
+	} else {
+		V9990BulkOps::copy(dstLo, bufLo, num, WM & 0xFF, lut, LOG, false);
+		V9990BulkOps::copy(dstHi, bufHi, num, WM >> 8,   lut, LOG, false);
+	}
+	return num;
+}
+
 // LMMV
 void V9990CmdEngine::startLMMV(EmuTime::param time)
 {
@@ -1020,19 +1213,26 @@ void V9990CmdEngine::startLMMV(EmuTime::param time)
 template<typename Mode>
 void V9990CmdEngine::executeLMMV(EmuTime::param limit)
 {
-	// TODO can be optimized a lot
-
 	auto delta = getTiming(LMMV_TIMING);
 	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
 	int dx = (ARG & DIX) ? -1 : 1;
 	int dy = (ARG & DIY) ? -1 : 1;
 	const byte* lut = Mode::getLogOpLUT(LOG);
 	while (engineTime < limit) {
-		engineTime += delta;
-		Mode::psetColor(vram, DX, DY, pitch, fgCol, WM, lut, LOG);
+		unsigned num = bulkEnabled
+			? bulkLMMV<Mode>(getBulkLimit(delta, limit), pitch, dx, lut)
+			: 0;
+		if (num) {
+			engineTime += delta * num;
+		} else {
+			engineTime += delta;
+			Mode::psetColor(vram, DX, DY, pitch, fgCol, WM, lut, LOG);
+			num = 1;
+		}
 
-		DX += dx;
-		if (!--(ANX)) {
+		DX += num * dx;
+		ANX -= num;
+		if (!ANX) {
 			DX -= (NX * dx);
 			DY += dy;
 			if (!--(ANY)) {
@@ -1112,22 +1312,29 @@ void V9990CmdEngine::startLMMM(EmuTime::param time)
 template<typename Mode>
 void V9990CmdEngine::executeLMMM(EmuTime::param limit)
 {
-	// TODO can be optimized a lot
-
 	auto delta = getTiming(LMMM_TIMING);
 	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
 	int dx = (ARG & DIX) ? -1 : 1;
 	int dy = (ARG & DIY) ? -1 : 1;
 	const byte* lut = Mode::getLogOpLUT(LOG);
 	while (engineTime < limit) {
-		engineTime += delta;
-		auto src = Mode::point(vram, SX, SY, pitch);
-		src = Mode::shift(src, SX, DX);
-		Mode::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
+		unsigned num = bulkEnabled
+			? bulkLMMM<Mode>(getBulkLimit(delta, limit), pitch, dx, lut)
+			: 0;
+		if (num) {
+			engineTime += delta * num;
+		} else {
+			engineTime += delta;
+			auto src = Mode::point(vram, SX, SY, pitch);
+			src = Mode::shift(src, SX, DX);
+			Mode::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
+			num = 1;
+		}
 
-		DX += dx;
-		SX += dx;
-		if (!--(ANX)) {
+		DX += num * dx;
+		SX += num * dx;
+		ANX -= num;
+		if (!ANX) {
 			DX -= (NX * dx);
 			SX -= (NX * dx);
 			DY += dy;
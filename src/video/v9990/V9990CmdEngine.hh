@@ -42,6 +42,12 @@ public:
 	}
 	void sync2(EmuTime::param time);
 
+	/** Enable or disable the row-at-a-time execution of LMMV and LMMM
+	  * (see V9990CmdEngine.cc). By default it's enabled. Both give exactly
+	  * the same results, this is only meant for testing and benchmarking.
+	  */
+	static void setBulkEnabled(bool enabled);
+
 	/** Set a value to one of the command registers
 	  */
 	void setCmdReg(byte reg, byte val, EmuTime::param time);
@@ -242,6 +248,17 @@ private:
 	                        void executePSET (EmuTime::param limit);
 	                        void executeADVN (EmuTime::param limit);
 
+	/** Row-at-a-time versions of LMMV and LMMM: process (at most) 'num'
+	  * pixels of the current row at once.
+	  * @return The number of processed pixels, zero when the regular per
+	  *         pixel code must be used for the next pixel.
+	  */
+	template<typename Mode> unsigned bulkLMMV(
+		unsigned num, unsigned pitch, int dx, const byte* lut);
+	template<typename Mode> unsigned bulkLMMM(
+		unsigned num, unsigned pitch, int dx, const byte* lut);
+	unsigned getBulkLimit(EmuDuration::param delta, EmuTime::param limit) const;
+
 	RenderSettings& settings;
 
 	/** Only call reportV9990Command() when this setting is turned on
@@ -0,0 +1,319 @@
+// Micro-benchmark for the LMMV and LMMM commands of V9990CmdEngine.
+//
+// Replays a sequence of V9990 commands on a real V9990, once with the per
+// pixel code and once with the row-at-a-time operations of V9990BulkOps (see
+// V9990CmdEngine::setBulkEnabled()). Like a Z80 would, it writes the command
+// registers through the I/O ports and polls the status port until the
+// command is done. Both runs must give the same VRAM contents and need the
+// same number of polls (so the command timing is the same as well). Reports
+// the time per replay.
+//
+// The command sequence is read from a file in the format of the
+// 'v9990cmdtrace' setting (which prints to stderr), so a capture from real
+// GFX9000 software can be made with something like:
+//   openmsx -command "set v9990cmdtrace on" 2> trace.txt
+// Only LMMV and LMMM are replayed, other commands are skipped. Because the
+// trace doesn't contain the display mode, the color depth and image width
+// must be given on the command line. Without a trace file, a built-in
+// sequence is used that resembles a frame of a typical GFX9000 game: clear
+// the back buffer, copy a scrolled background, then blit a number of
+// (transparent) 16x16 sprites on top of it.
+//
+// Usage: V9990CmdEngineBench [-bpp 2|4|8|16] [-width n] [-n repeat] [trace]
+
+#include "V9990.hh"
+#include "V9990CmdEngine.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "Scheduler.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "EmuTime.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "Benchmark.hh"
+#include <SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+
+static const unsigned VRAM_SIZE = 512 * 1024;
+
+// V9990 I/O ports (relative to 0x60) and registers
+static const word REGISTER_DATA = 3;
+static const word REGISTER_SELECT = 4;
+static const word STATUS = 5;
+static const byte SCREEN_MODE_0 = 6;
+static const byte CMD_PARAM_SRC_ADDRESS_0 = 32;
+
+static const byte DIX = 0x04;
+
+static const char* const machineXML =
+	"<?xml version=\"1.0\" ?>\n"
+	"<!DOCTYPE msxconfig SYSTEM 'msxconfig2.dtd'>\n"
+	"<msxconfig>\n"
+	"  <info><type>MSX2</type></info>\n"
+	"  <devices>\n"
+	"    <V9990 id=\"V9990\">\n"
+	"      <io base=\"0x60\" num=\"0x10\"/>\n"
+	"    </V9990>\n"
+	"  </devices>\n"
+	"</msxconfig>\n";
+
+struct TraceCommand {
+	word SX, SY, DX, DY, NX, NY;
+	word WM, fgCol;
+	byte ARG, LOG, CMD;
+};
+
+static unsigned bpp = 8;
+static unsigned width = 256;
+
+// Drives the I/O ports of the V9990 like a Z80 would, running the scheduler
+// up to each access.
+class Driver
+{
+public:
+	Driver(MSXMotherBoard& board_, V9990& v9990_)
+		: board(board_), v9990(v9990_), time(board.getCurrentTime()) {}
+
+	void write(word port, byte value)
+	{
+		sync();
+		v9990.writeIO(0x60 + port, value, time);
+		wait(12);
+	}
+	byte read(word port)
+	{
+		sync();
+		byte result = v9990.readIO(0x60 + port, time);
+		wait(12);
+		return result;
+	}
+	void setReg(byte reg, byte value)
+	{
+		write(REGISTER_SELECT, reg);
+		write(REGISTER_DATA, value);
+	}
+	void startCommand(const TraceCommand& c)
+	{
+		write(REGISTER_SELECT, CMD_PARAM_SRC_ADDRESS_0); // auto-increment
+		for (word v : { c.SX, c.SY, c.DX, c.DY, c.NX, c.NY }) {
+			write(REGISTER_DATA, v & 0xFF);
+			write(REGISTER_DATA, v >> 8);
+		}
+		write(REGISTER_DATA, c.ARG);
+		write(REGISTER_DATA, c.LOG);
+		write(REGISTER_DATA, c.WM & 0xFF);
+		write(REGISTER_DATA, c.WM >> 8);
+		write(REGISTER_DATA, c.fgCol & 0xFF);
+		write(REGISTER_DATA, c.fgCol >> 8);
+		write(REGISTER_DATA, 0); // BC
+		write(REGISTER_DATA, 0);
+		write(REGISTER_DATA, c.CMD);
+	}
+	void wait(unsigned cycles)
+	{
+		time += EmuDuration::hz(3579545) * cycles;
+	}
+
+private:
+	void sync()
+	{
+		board.getScheduler().schedule(time);
+	}
+
+	MSXMotherBoard& board;
+	V9990& v9990;
+	EmuTime time;
+};
+
+struct Result {
+	vector<byte> vram;
+	vector<unsigned> polls; // per command
+	double duration; // of the commands only, in microseconds
+};
+
+static Result replay(Reactor& reactor, const string& machine,
+                     const vector<TraceCommand>& cmds)
+{
+	auto board = reactor.createEmptyMotherBoard();
+	board->loadMachine(machine);
+	board->powerUp();
+	auto& v9990 = *dynamic_cast<V9990*>(board->findDevice("V9990"));
+	auto& vramDebuggable = *board->getDebugger().findDebuggable("V9990 VRAM");
+	Driver drv(*board, v9990);
+
+	// Bitmap mode with the given image width and color depth.
+	byte ximm = (width == 256) ? 0 : (width == 512) ? 1 : (width == 1024) ? 2 : 3;
+	byte clrm = (bpp == 2) ? 0 : (bpp == 4) ? 1 : (bpp == 8) ? 2 : 3;
+	drv.setReg(SCREEN_MODE_0, 0x80 | (ximm << 2) | clrm);
+	drv.wait(3 * 228); // the mode changes at the next line
+
+	unsigned seed = 12345;
+	for (unsigned i = 0; i < VRAM_SIZE; ++i) {
+		seed = seed * 1103515245 + 12345;
+		vramDebuggable.write(i, seed >> 24);
+	}
+
+	Result result;
+	result.duration = Benchmark::time([&] {
+		for (auto& c : cmds) {
+			drv.startCommand(c);
+			unsigned polls = 0;
+			while (drv.read(STATUS) & V9990CmdEngine::CE) {
+				drv.wait(500);
+				++polls;
+			}
+			result.polls.push_back(polls);
+		}
+	});
+
+	result.vram.resize(VRAM_SIZE);
+	for (unsigned i = 0; i < VRAM_SIZE; ++i) {
+		result.vram[i] = vramDebuggable.read(i);
+	}
+	return result;
+}
+
+static bool parseTrace(const char* filename, vector<TraceCommand>& cmds,
+                       unsigned& skipped)
+{
+	ifstream is(filename);
+	if (!is) return false;
+	string line;
+	while (getline(is, line)) {
+		if (line.compare(0, 9, "V9990Cmd ") != 0) continue;
+		unsigned sx, sy, dx, dy, nx, ny, arg, log, wm, fc, bc, cmd;
+		char name[8];
+		if (sscanf(line.c_str(),
+		           "V9990Cmd %7s SX=%u SY=%u DX=%u DY=%u NX=%u NY=%u "
+		           "ARG=%x LOG=%x WM=%x FC=%x BC=%x CMD=%x",
+		           name, &sx, &sy, &dx, &dy, &nx, &ny,
+		           &arg, &log, &wm, &fc, &bc, &cmd) != 13) {
+			continue;
+		}
+		if (((cmd >> 4) != 2) && ((cmd >> 4) != 4)) {
+			++skipped;
+			continue;
+		}
+		TraceCommand c;
+		c.SX = sx; c.SY = sy; c.DX = dx; c.DY = dy; c.NX = nx; c.NY = ny;
+		c.WM = wm; c.fgCol = fc; c.ARG = arg; c.LOG = log; c.CMD = cmd;
+		cmds.push_back(c);
+	}
+	return true;
+}
+
+static void builtinTrace(vector<TraceCommand>& cmds)
+{
+	// one frame of a (made up) scrolling game with a 256 pixel wide
+	// visible area, the sprite patterns are stored at y=768
+	auto cmd = [&](byte command, word sx, word sy, word dx, word dy,
+	               word nx, word ny, byte arg, byte log, word fc) {
+		TraceCommand c;
+		c.SX = sx; c.SY = sy; c.DX = dx; c.DY = dy; c.NX = nx; c.NY = ny;
+		c.WM = 0xFFFF; c.fgCol = fc; c.ARG = arg; c.LOG = log;
+		c.CMD = command;
+		cmds.push_back(c);
+	};
+	for (unsigned frame = 0; frame < 8; ++frame) {
+		word page = (frame & 1) ? 256 : 0;
+		cmd(0x20, 0, 0, 0, page, 256, 212, 0, 0x0C, 0x0000); // clear
+		// background, scrolled horizontally in two parts
+		unsigned s = frame * 3;
+		cmd(0x40, s, 512, 0, page, 256 - s, 200, 0, 0x0C, 0);
+		if (s) cmd(0x40, 0, 512, 256 - s, page, s, 200, 0, 0x0C, 0);
+		// 32 sprites, some of them drawn right to left (mirrored)
+		for (unsigned i = 0; i < 32; ++i) {
+			word x = (i * 37 + frame * 5) & 0xEF;
+			word y = page + ((i * 53 + frame * 7) % 190);
+			byte arg = (i & 3) ? 0 : DIX;
+			word sx = ((i & 7) * 16) + ((arg & DIX) ? 15 : 0);
+			word dx = x + ((arg & DIX) ? 15 : 0);
+			cmd(0x40, sx, 768, dx, y, 16, 16, arg, 0x1C, 0);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned repeat = 10;
+	const char* traceFile = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if ((arg == "-bpp") && (i + 1 < argc)) {
+			bpp = atoi(argv[++i]);
+		} else if ((arg == "-width") && (i + 1 < argc)) {
+			width = atoi(argv[++i]);
+		} else if ((arg == "-n") && (i + 1 < argc)) {
+			repeat = Benchmark::getCount(argc, argv, ++i, repeat);
+		} else {
+			traceFile = argv[i];
+		}
+	}
+	if ((bpp != 2) && (bpp != 4) && (bpp != 8) && (bpp != 16)) {
+		cerr << "Unsupported color depth: " << bpp << endl;
+		return 1;
+	}
+	if ((width != 256) && (width != 512) && (width != 1024) && (width != 2048)) {
+		cerr << "Unsupported image width: " << width << endl;
+		return 1;
+	}
+
+	vector<TraceCommand> cmds;
+	unsigned skipped = 0;
+	if (traceFile) {
+		if (!parseTrace(traceFile, cmds, skipped)) {
+			cerr << "Can't read " << traceFile << endl;
+			return 1;
+		}
+	} else {
+		builtinTrace(cmds);
+	}
+	cout << "Replaying " << cmds.size() << " commands (" << skipped
+	     << " skipped), " << bpp << "bpp, width " << width << endl;
+
+	string machine = FileOperations::join(
+		FileOperations::getTempDir(), "V9990CmdEngineBench");
+	double times[2];
+	vector<Result> results;
+	try {
+		SDL_Init(SDL_INIT_NOPARACHUTE);
+		Reactor reactor;
+		reactor.init();
+		{
+			ofstream out(machine + ".xml");
+			out << machineXML;
+		}
+		for (int bulk = 0; bulk < 2; ++bulk) {
+			V9990CmdEngine::setBulkEnabled(bulk != 0);
+			double total = 0.0;
+			for (unsigned r = 0; r < repeat; ++r) {
+				auto result = replay(reactor, machine, cmds);
+				total += result.duration;
+				if (r == 0) results.push_back(move(result));
+			}
+			times[bulk] = total / repeat;
+		}
+		V9990CmdEngine::setBulkEnabled(true);
+	} catch (MSXException& e) {
+		cerr << "Error: " << e.getMessage() << endl;
+		FileOperations::unlink(machine + ".xml");
+		return 1;
+	}
+	FileOperations::unlink(machine + ".xml");
+
+	cout << "per pixel:     " << times[0] << " us/replay" << endl;
+	cout << "row-at-a-time: " << times[1] << " us/replay" << endl;
+	Benchmark::Checker checker;
+	checker.check(results[0].vram == results[1].vram);
+	checker.check(results[0].polls == results[1].polls);
+	return checker.exitCode("VRAM contents or command timing differ!");
+}
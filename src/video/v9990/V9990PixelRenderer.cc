@@ -80,7 +80,9 @@ void V9990PixelRenderer::frameStart(EmuTime::param time)
 			drawFrame = true;
 		} else {
 			++frameSkipCounter;
-			if (rasterizer->isRecording()) {
+			if (rasterizer->isRecording() ||
+			    vdp.getMotherBoard().getReactor().isBatchMode()) {
+				// batch mode: no real time to keep up with
 				drawFrame = true;
 			} else {
 				drawFrame = realTime.timeLeft(
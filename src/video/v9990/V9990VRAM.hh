@@ -78,6 +78,16 @@ public:
 		data.write(address, value);
 	}
 
+	/** Direct access to a range of VRAM, for the bulk operations of the
+	  * command engine. See TrackedRam::getWriteBackdoor().
+	  */
+	inline byte* getWriteBackdoor(unsigned address, unsigned size) {
+		return data.getWriteBackdoor(address, size);
+	}
+	inline const byte* getReadBackdoor(unsigned address) const {
+		return &data[address];
+	}
+
 	byte readVRAMCPU(unsigned address, EmuTime::param time);
 	void writeVRAMCPU(unsigned address, byte val, EmuTime::param time);
 